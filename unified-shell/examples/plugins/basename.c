@@ -0,0 +1,47 @@
+/**
+ * basename.c - Example loadable builtin
+ *
+ * Replaces /usr/bin/basename inside scripts that call it in a loop:
+ *
+ *   gcc -shared -fPIC -Iinclude -o basename.so examples/plugins/basename.c
+ *   enable -f ./basename.so basename
+ *   for f in *.c; do echo $(basename $f .c); done
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "ushell_builtin.h"
+
+static int basename_main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: basename NAME [SUFFIX]\n");
+        return 1;
+    }
+
+    // Strip trailing slashes, then everything up to the last slash
+    const char *name = argv[1];
+    size_t end = strlen(name);
+    while (end > 1 && name[end - 1] == '/') end--;
+    size_t start = end;
+    while (start > 0 && name[start - 1] != '/') start--;
+    if (end == 1 && name[0] == '/') start = 0;
+
+    // Remove SUFFIX unless it is the whole name
+    if (argc == 3) {
+        size_t suffix = strlen(argv[2]);
+        if (suffix > 0 && suffix < end - start &&
+            memcmp(name + end - suffix, argv[2], suffix) == 0) {
+            end -= suffix;
+        }
+    }
+
+    printf("%.*s\n", (int)(end - start), name + start);
+    return 0;
+}
+
+const struct ushell_builtin basename_ushell_builtin = {
+    .abi_version = USHELL_BUILTIN_ABI,
+    .name = "basename",
+    .summary = "Strip directory and suffix from a file name",
+    .func = basename_main,
+};
@@ -62,13 +62,16 @@
  *   filename     - Archive filename (e.g., "mytools-1.0.tar.gz")
  *   dependencies - Comma-separated list of dependencies
  *   installed    - 1 if installed, 0 otherwise
+ *
+ * The strings are interned (intern.h) and never NULL; a missing field is
+ * "". Values longer than the APT_*_LEN limits are truncated on load.
  */
 typedef struct {
-    char name[APT_NAME_LEN];
-    char version[APT_VERSION_LEN];
-    char description[APT_DESC_LEN];
-    char filename[APT_FILENAME_LEN];
-    char dependencies[APT_DEPS_LEN];
+    const char *name;
+    const char *version;
+    const char *description;
+    const char *filename;
+    const char *dependencies;
     int installed;
 } Package;
 
@@ -76,12 +79,14 @@ typedef struct {
  * PackageIndex - Collection of packages in the repository
  * 
  * Fields:
- *   packages     - Array of package structures
+ *   packages     - Array of package structures, grown on demand (MEM_APT)
  *   count        - Number of packages in the array
+ *   capacity     - Allocated entries (at most APT_MAX_PACKAGES)
  */
 typedef struct {
-    Package packages[APT_MAX_PACKAGES];
+    Package *packages;
     int count;
+    int capacity;
 } PackageIndex;
 
 /**
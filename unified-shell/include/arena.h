@@ -0,0 +1,70 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/**
+ * @file arena.h
+ * @brief Bump-pointer arena allocator
+ *
+ * An arena hands out memory from large chunks and frees everything at
+ * once. It is used where many small, short-lived allocations share a
+ * single lifetime (fuzzy finder candidates, per-command temporaries), so
+ * individual malloc/free calls and their per-block overhead disappear.
+ *
+ * Arenas are not thread-safe; give each thread its own or serialize access.
+ */
+
+/**
+ * @brief One chunk of arena memory (internal)
+ */
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t size;        // Usable bytes in data[]
+    size_t used;        // Bytes handed out so far
+    char data[];
+} ArenaChunk;
+
+/**
+ * @brief Arena handle
+ */
+typedef struct {
+    ArenaChunk *head;       // Current chunk (allocation happens here)
+    size_t chunk_size;      // Default size of new chunks
+    size_t total_allocated; // Bytes handed out since last reset
+} Arena;
+
+/**
+ * @brief Initialize an arena
+ * @param arena Arena to initialize
+ * @param chunk_size Default chunk size in bytes (0 selects 64KB)
+ */
+void arena_init(Arena *arena, size_t chunk_size);
+
+/**
+ * @brief Allocate size bytes aligned for any type
+ * @return Pointer into the arena, or NULL if out of memory
+ */
+void *arena_alloc(Arena *arena, size_t size);
+
+/**
+ * @brief Copy len bytes of str into the arena and NUL-terminate them
+ */
+char *arena_strndup(Arena *arena, const char *str, size_t len);
+
+/**
+ * @brief Copy a NUL-terminated string into the arena
+ */
+char *arena_strdup(Arena *arena, const char *str);
+
+/**
+ * @brief Release everything but keep the first chunk for reuse
+ */
+void arena_reset(Arena *arena);
+
+/**
+ * @brief Release all memory owned by the arena
+ */
+void arena_free(Arena *arena);
+
+#endif // ARENA_H
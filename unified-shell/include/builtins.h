@@ -11,14 +11,6 @@
  */
 typedef int (*builtin_func)(char **argv, Env *env);
 
-/**
- * Built-in command structure
- */
-typedef struct {
-    const char *name;
-    builtin_func func;
-} Builtin;
-
 /**
  * Find a built-in command by name
  * @param name Command name to search for
@@ -45,6 +37,34 @@ int builtin_apt(char **argv, Env *env);
 int builtin_jobs(char **argv, Env *env);
 int builtin_fg(char **argv, Env *env);
 int builtin_bg(char **argv, Env *env);
+int builtin_kill(char **argv, Env *env);
+int builtin_wait(char **argv, Env *env);
+int builtin_coproc(char **argv, Env *env);
+int builtin_jobctl(char **argv, Env *env);
+int builtin_pool(char **argv, Env *env);
+int builtin_memstats(char **argv, Env *env);
 int builtin_commands(char **argv, Env *env);
+int builtin_myfzf(char **argv, Env *env);
+int builtin_test(char **argv, Env *env);
+int builtin_bracket(char **argv, Env *env);
+int builtin_dbracket(char **argv, Env *env);
+int builtin_true(char **argv, Env *env);
+int builtin_false(char **argv, Env *env);
+int builtin_break(char **argv, Env *env);
+int builtin_continue(char **argv, Env *env);
+int builtin_return(char **argv, Env *env);
+int builtin_read(char **argv, Env *env);
+int builtin_mapfile(char **argv, Env *env);
+int builtin_source(char **argv, Env *env);
+int builtin_exec(char **argv, Env *env);
+int builtin_enable(char **argv, Env *env);
+
+/**
+ * Run the myfzf picker over paths below the current directory
+ * Used by terminal_readline for the Ctrl-T and Alt-C bindings.
+ * @param want_dirs Non-zero to list directories only
+ * @return Selected path (caller must free), or NULL if cancelled
+ */
+char *myfzf_pick(int want_dirs);
 
 #endif /* BUILTINS_H */
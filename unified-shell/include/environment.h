@@ -3,24 +3,52 @@
 
 #include <pthread.h>
 
-#define MAX_VARS 100
+#define ENV_INITIAL_BINDINGS 16  /* Binding table grows by doubling */
 #define VAR_NAME_MAX 64
 #define VAR_VALUE_MAX 256
 
 // Variable binding structure
 typedef struct {
-    char *name;
+    const char *name;   /* Interned (intern.h), never freed */
     char *value;
+    size_t value_cap;   /* Bytes allocated for value (reused when it fits) */
 } Binding;
 
+// Indexed array variable (read -a, mapfile)
+typedef struct {
+    char *name;
+    char **items;
+    int count;
+} ArrayBinding;
+
+// Undo journal of a copy-on-write snapshot (fork-free subshells)
+typedef struct EnvSnapshot EnvSnapshot;
+
 // Environment structure for variable storage
 // Thread-safe: All access to env must be protected by env_mutex
 typedef struct {
-    Binding bindings[MAX_VARS];
+    Binding *bindings;          /* Grown on demand (MEM_ENV) */
     int count;
+    int capacity;
+    unsigned long generation;   /* Bumped whenever binding indices change */
+    ArrayBinding *arrays;       /* Indexed arrays, grown on demand */
+    int array_count;
+    int array_capacity;
+    EnvSnapshot *snapshot;      /* Innermost open snapshot, or NULL */
     pthread_mutex_t env_mutex;  /* Mutex for thread-safe environment access */
 } Env;
 
+// Cached lookup of one variable by name
+// The binding index is reused until the environment's generation changes,
+// so hot loops resolve a name once instead of scanning every binding.
+typedef struct {
+    const char *name;
+    int index;                  /* -1 when not bound in env */
+    unsigned long generation;   /* 0 = never resolved */
+} EnvSlot;
+
+#define ENV_SLOT_INIT(n) { (n), -1, 0 }
+
 // Environment management functions
 Env* env_new(void);
 void env_free(Env *env);
@@ -29,4 +57,23 @@ void env_set(Env *env, const char *name, const char *value);
 void env_unset(Env *env, const char *name);
 void env_print(Env *env);
 
+// Slot-cached variants of env_get/env_set
+char* env_get_slot(Env *env, EnvSlot *slot);
+void env_set_slot(Env *env, EnvSlot *slot, const char *value);
+
+// Indexed arrays
+// env_array_assign takes ownership of items (malloc'd array of malloc'd strings)
+void env_array_assign(Env *env, const char *name, char **items, int count);
+int env_array_count(Env *env, const char *name);
+const char* env_array_get(Env *env, const char *name, int index);
+char** env_array_items(Env *env, const char *name, int *count);
+
+// Copy-on-write snapshots
+// After env_snapshot_begin, the first change to each variable (or array)
+// saves its previous state; env_snapshot_discard puts back every saved
+// variable, so a ( ... ) subshell can run in the shell process and leave
+// no trace. Snapshots nest and must be discarded in reverse order.
+EnvSnapshot* env_snapshot_begin(Env *env);
+void env_snapshot_discard(Env *env, EnvSnapshot *snap);
+
 #endif // ENVIRONMENT_H
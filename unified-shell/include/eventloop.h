@@ -0,0 +1,75 @@
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include <stddef.h>
+
+/**
+ * @file eventloop.h
+ * @brief Interactive event loop (epoll over input, signals, timers, notices)
+ *
+ * While the line editor waits for a key, one epoll set watches:
+ *   - the terminal (stdin)
+ *   - a signalfd for SIGCHLD, SIGWINCH and SIGINT, blocked only for the
+ *     duration of the wait so the handlers keep working while commands run
+ *   - a timerfd that batches notices arriving close together, so a burst
+ *     of finished jobs costs one redraw
+ *   - an eventfd written by other threads (MCP server) and by the signal
+ *     handlers when a signal lands on a thread other than the main one
+ *
+ * Notices (shell_notice) are queued and printed above the prompt, after
+ * which the prompt and the line being edited are redrawn. Without an
+ * interactive terminal the loop is never initialised and notices are
+ * written to stdout immediately.
+ */
+
+#define EVENTLOOP_READY 1           // The descriptor is readable
+#define EVENTLOOP_INTERRUPTED 0     // SIGINT arrived while waiting
+#define EVENTLOOP_ERROR -1
+
+/**
+ * @brief Create the epoll set (call once, when stdin is a terminal)
+ * @return 0 on success, -1 on error (the shell falls back to plain reads)
+ */
+int eventloop_init(void);
+
+/**
+ * @brief Check whether eventloop_init succeeded
+ */
+int eventloop_active(void);
+
+/**
+ * @brief Wait until fd is readable, dispatching other events meanwhile
+ * @return EVENTLOOP_READY, EVENTLOOP_INTERRUPTED or EVENTLOOP_ERROR
+ */
+int eventloop_wait_readable(int fd);
+
+/**
+ * @brief Set the function run (in the main thread) after SIGCHLD
+ */
+void eventloop_set_child_handler(void (*handler)(void));
+
+/**
+ * @brief Set how notices are shown and how the input line is redrawn
+ * @param print Writes text above the line being edited, then redraws it
+ * @param resize Redraws the line after the terminal size changed
+ */
+void eventloop_set_display_callbacks(void (*print)(const char *text, size_t len),
+                                     void (*resize)(void));
+
+/**
+ * @brief Print queued notices now
+ */
+void eventloop_flush_notices(void);
+
+/**
+ * @brief Wake the loop from a signal handler (async-signal-safe)
+ */
+void eventloop_wake(void);
+
+/**
+ * @brief Queue a message for the terminal (thread-safe, printf-style)
+ * A trailing newline is added when missing.
+ */
+void shell_notice(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+#endif // EVENTLOOP_H
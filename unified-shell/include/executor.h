@@ -11,9 +11,63 @@ typedef struct {
     char *infile;     // Input redirection file (NULL if none)
     char *outfile;    // Output redirection file (NULL if none)
     int append;       // 1 if >> (append), 0 if > (truncate)
+    int in_fd;        // Descriptor infile applies to (N<file, default 0)
+    int out_fd;       // Descriptor outfile applies to (N>file, default 1)
     int background;   // 1 if command should run in background (&)
 } Command;
 
+/**
+ * Descriptors saved while a redirection applies to the shell itself
+ */
+typedef struct {
+    int in_fd;        // Redirected input descriptor (usually 0)
+    int saved_in;     // Copy of the original (-1 not redirected, -2 was closed)
+    int out_fd;       // Redirected output descriptor (usually 1)
+    int saved_out;
+} RedirectSave;
+
+/**
+ * Set by the script interpreter just before running the last command of
+ * a -c string or script file: an external command may then replace the
+ * shell (exec) instead of being forked and waited for
+ */
+extern int exec_tail_call;
+
+/**
+ * Apply < and > / >> redirections to the shell process
+ * Used for builtins, functions and compound commands, which must run in
+ * the shell so that variable assignments (e.g. by read) persist.
+ * @param infile Input file or NULL
+ * @param outfile Output file or NULL
+ * @param append 1 for >>, 0 for >
+ * @param save Output: descriptors to restore with redirect_pop
+ * @return 0 on success, -1 if a file could not be opened (nothing applied)
+ */
+int redirect_push(const char *infile, const char *outfile, int append, RedirectSave *save);
+
+/**
+ * redirect_push for arbitrary descriptors (2>file, 3<file)
+ * A target of "&N" duplicates descriptor N and "&-" closes the descriptor.
+ */
+int redirect_push_fds(int in_fd, const char *infile, int out_fd, const char *outfile,
+                      int append, RedirectSave *save);
+
+/**
+ * Apply a redirection to the current process for good (forked pipeline
+ * stages and the exec builtin)
+ * @param fd Descriptor to replace
+ * @param target File name, "&N" or "&-"
+ * @param output 1 for > / >>, 0 for <
+ * @return 0 on success, -1 on error (message printed)
+ */
+int redirect_apply(int fd, const char *target, int output, int append);
+
+/**
+ * Undo redirect_push
+ * @param save Descriptors saved by redirect_push
+ */
+void redirect_pop(RedirectSave *save);
+
 /**
  * Execute a command with arguments
  * @param argv NULL-terminated array of command arguments
@@ -30,6 +84,14 @@ int execute_command(char **argv, Env *env);
  */
 char** tokenize_command(char *line);
 
+/**
+ * Backslash-escape the quoted pattern operands of a [[ ]] command
+ * @param argv Arguments of [[ (malloc'd strings, replaced in place)
+ * @param quoted Per-argument flag, 1 for words written in quotes
+ * @return 0 on success, -1 on allocation failure
+ */
+int escape_test_operands(char **argv, const char *quoted);
+
 /**
  * Free memory allocated by tokenize_command
  * @param argv Array to free
@@ -61,4 +123,14 @@ int execute_pipeline(Command *commands, int count, Env *env);
  */
 void free_pipeline(Command *commands, int count);
 
+/**
+ * Parse and execute one command line or script text
+ * Handles lists, control flow, functions, pipelines and simple commands
+ * exactly like the interactive REPL does, and updates last_exit_status.
+ * @param line Command text to execute (not modified, may span lines)
+ * @param env Environment for the shell
+ * @return Exit status of the last command, or -1 on syntax error
+ */
+int execute_line(const char *line, Env *env);
+
 #endif /* EXECUTOR_H */
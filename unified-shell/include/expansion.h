@@ -7,6 +7,18 @@
 // Caller must free the returned string
 char* expand_variables(const char *input, Env *env);
 
+// Expand one line of an unquoted here-document (quotes stay literal)
+// Caller must free the returned string
+char* expand_here_line(const char *line, size_t len, Env *env);
+
+// Expand one word of a [[ ]] command into one argument (quotes removed,
+// no splitting or globbing); caller must free the returned string
+char* expand_test_word(const char *word, size_t len, Env *env);
+
+// Exit status of the last command substitution of the most recent
+// expansion, or -1 if there was none (x=$(cmd) sets $? from it)
+int expand_substitution_status(void);
+
 // Function to expand variables in-place in an existing buffer
 // Safer for fixed-size buffers
 void expand_variables_inplace(char *input, Env *env, size_t bufsize);
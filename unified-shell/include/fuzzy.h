@@ -0,0 +1,117 @@
+#ifndef FUZZY_H
+#define FUZZY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+
+/**
+ * @file fuzzy.h
+ * @brief Fuzzy matching engine used by the myfzf builtin
+ *
+ * Candidates are stored in an arena and carry a precomputed character
+ * mask so most non-matches are rejected with a single AND. Survivors are
+ * located with a SIMD subsequence scan and scored with a Smith-Waterman
+ * style alignment that rewards word boundaries and consecutive runs.
+ * Searches are split across worker threads and only the best K results
+ * are kept in a heap. Typing more characters narrows the previous match
+ * list instead of rescanning every candidate.
+ */
+
+#define FUZZY_MAX_QUERY 128
+#define FUZZY_NO_MATCH INT32_MIN
+
+/**
+ * @brief One candidate line
+ */
+typedef struct {
+    const char *text;   // NUL-terminated, owned by the set's arena
+    uint32_t len;
+    uint64_t charmask;  // Case-folded characters present (see fuzzy_charmask)
+} FuzzyCandidate;
+
+/**
+ * @brief Growable candidate collection
+ */
+typedef struct {
+    Arena arena;
+    FuzzyCandidate *items;
+    size_t count;
+    size_t capacity;
+} FuzzySet;
+
+/**
+ * @brief One ranked result
+ */
+typedef struct {
+    uint32_t index;     // Index into FuzzySet.items
+    int32_t score;
+} FuzzyMatch;
+
+/**
+ * @brief Search state, reused across keystrokes for incremental narrowing
+ */
+typedef struct {
+    char query[FUZZY_MAX_QUERY + 1];
+    size_t scanned;         // Candidates [0, scanned) have been considered
+    int valid;              // 0 until the first search
+
+    uint32_t *matched;      // Every matching index in candidate order
+    size_t matched_count;   // (unused while the query is empty)
+    size_t matched_capacity;
+
+    FuzzyMatch *top;        // Min-heap of the best k matches
+    size_t top_count;
+    size_t k;
+    size_t total_matches;
+} FuzzyResult;
+
+void fuzzy_set_init(FuzzySet *set);
+void fuzzy_set_free(FuzzySet *set);
+
+/**
+ * @brief Copy a candidate into the set
+ * @return 0 on success, -1 on allocation failure
+ */
+int fuzzy_set_add(FuzzySet *set, const char *text, size_t len);
+
+/**
+ * @brief Compute the case-folded character mask for a string
+ */
+uint64_t fuzzy_charmask(const char *text, size_t len);
+
+/**
+ * @brief Score one candidate against a query
+ *
+ * Matching is case-insensitive unless the query contains an uppercase
+ * letter ("smart case").
+ *
+ * @return Score (higher is better), or FUZZY_NO_MATCH
+ */
+int32_t fuzzy_score(const char *query, size_t query_len, const FuzzyCandidate *cand);
+
+/**
+ * @brief Initialize a result keeping the best k matches
+ */
+void fuzzy_result_init(FuzzyResult *res, size_t k);
+void fuzzy_result_free(FuzzyResult *res);
+
+/**
+ * @brief Bring res up to date for query over every candidate in set
+ *
+ * Only candidates added since the last call are scored when the query is
+ * unchanged, and only previous matches are rescored when the query
+ * extends the previous one.
+ *
+ * @param threads Worker threads to use (0 = number of online CPUs)
+ */
+void fuzzy_search(const FuzzySet *set, const char *query, FuzzyResult *res, int threads);
+
+/**
+ * @brief Sort res->top best-first (destroys the heap order)
+ *
+ * Call fuzzy_search() again before reusing the result incrementally.
+ */
+void fuzzy_result_sort(const FuzzySet *set, FuzzyResult *res);
+
+#endif // FUZZY_H
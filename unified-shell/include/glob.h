@@ -10,6 +10,63 @@
  * current directory and expanded to a list of matching filenames.
  */
 
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief One step of a compiled glob pattern
+ */
+typedef struct {
+    uint8_t type;       // GLOB_OP_LITERAL, GLOB_OP_ANY, GLOB_OP_STAR, GLOB_OP_CLASS
+    uint8_t ch;         // Literal character
+    uint16_t class_idx; // Index into GlobPattern.classes
+} GlobOp;
+
+/**
+ * @brief Glob pattern compiled once and matched many times
+ *
+ * Character classes become 256-bit membership bitmaps and matching is
+ * iterative (single star backtrack point), so it never recurses and
+ * cannot go exponential on patterns like "a*a*a*b".
+ */
+typedef struct {
+    GlobOp *ops;
+    int count;
+    uint8_t (*classes)[32];
+    int class_count;
+    size_t min_len;     // Shortest string the pattern can match
+    int has_star;       // Pattern contains '*'
+} GlobPattern;
+
+enum {
+    GLOB_OP_LITERAL,
+    GLOB_OP_ANY,
+    GLOB_OP_STAR,
+    GLOB_OP_CLASS
+};
+
+/**
+ * @brief Compile a glob pattern
+ *
+ * Supports *, ?, [abc], [a-z], [!abc]/[^abc] and backslash escapes.
+ *
+ * @param gp Output compiled pattern (release with glob_free)
+ * @param pattern Pattern text
+ * @return 0 on success, -1 on allocation failure
+ */
+int glob_compile(GlobPattern *gp, const char *pattern);
+
+/**
+ * @brief Match the first len bytes of str against a compiled pattern
+ * @return 1 if the whole range matches, 0 otherwise
+ */
+int glob_match(const GlobPattern *gp, const char *str, size_t len);
+
+/**
+ * @brief Release a compiled pattern
+ */
+void glob_free(GlobPattern *gp);
+
 /**
  * @brief Expand a glob pattern to matching filenames
  * 
@@ -30,7 +87,7 @@ char **expand_glob(const char *pattern, int *count);
 /**
  * @brief Check if a string matches a glob pattern
  * 
- * Recursively matches pattern against string.
+ * Compiles the pattern and matches it against the whole string.
  * 
  * @param pattern The glob pattern
  * @param str The string to match against
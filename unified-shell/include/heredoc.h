@@ -0,0 +1,29 @@
+#ifndef HEREDOC_H
+#define HEREDOC_H
+
+#include <stddef.h>
+#include "environment.h"
+
+/**
+ * @file heredoc.h
+ * @brief Descriptors for here-documents (<<EOF, <<-EOF) and here-strings (<<<)
+ *
+ * The body is written into a pipe before the command starts. Only what
+ * fits in the pipe buffer can be queued that way (nobody reads until the
+ * command runs), so a body that outgrows it moves into a sealed memfd
+ * instead. Nothing is written to disk in either case.
+ */
+
+/**
+ * @brief Open a descriptor that reads a here-document body
+ * @param text Body text, normally lines ending in '\n'
+ * @param len Length of text
+ * @param expand 1 to expand $var, ${...}, $(cmd) and $((expr)) one line
+ *        at a time as the body is written (unquoted delimiter)
+ * @param env Environment for expansion
+ * @return Close-on-exec read descriptor positioned at the start of the
+ *         body, or -1 on error (message printed)
+ */
+int heredoc_open(const char *text, size_t len, int expand, Env *env);
+
+#endif // HEREDOC_H
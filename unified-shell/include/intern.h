@@ -0,0 +1,34 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+
+/**
+ * @file intern.h
+ * @brief Process-wide string interning
+ *
+ * intern() returns one shared, immutable copy of each distinct string.
+ * Strings that repeat across many records (variable names, package
+ * sections, priorities, architectures, maintainers) are stored once and
+ * compared by pointer where convenient. Interned strings live until the
+ * process exits; never free or modify them.
+ *
+ * Thread-safe.
+ */
+
+/**
+ * @brief Return the interned copy of str (NULL if out of memory)
+ */
+const char *intern(const char *str);
+
+/**
+ * @brief Return the interned copy of the first len bytes of str
+ */
+const char *intern_n(const char *str, size_t len);
+
+/**
+ * @brief Number of distinct strings and bytes of string storage in use
+ */
+void intern_stats(size_t *strings, size_t *bytes);
+
+#endif // INTERN_H
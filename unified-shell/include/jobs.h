@@ -15,7 +15,10 @@
 #ifndef JOBS_H
 #define JOBS_H
 
+#include <stdio.h>
 #include <sys/types.h>
+#include "tools.h"
+#include "jobsched.h"
 
 /* ============================================================================
  * Constants and Limits
@@ -27,6 +30,12 @@
 /* Maximum length of command string stored for each job */
 #define MAX_CMD_LEN 1024
 
+/* Job table slots allocated at first use; the table doubles up to MAX_JOBS */
+#define JOBS_INITIAL_SLOTS 4
+
+/* Process substitution helpers tracked per job (more are still reaped) */
+#define MAX_JOB_HELPERS 8
+
 /* ============================================================================
  * Job Status Enumeration
  * ============================================================================ */
@@ -57,13 +66,29 @@ typedef enum {
  *   command:    Command string that started the job
  *   status:     Current status (running/stopped/done)
  *   background: 1 if job was started in background, 0 otherwise
+ *   monitor:    Pipe throughput monitor, owned by the job, or NULL
+ *   notified:   Last status announced by jobs_notify()
+ *   thread:     Tool running on the worker pool, or NULL for a process
+ *   exit_status: Exit status once the job is done
+ *   term_signal: Signal that ended a done job (kill %N), 0 if it exited
+ *   helpers:    <(cmd) / >(cmd) processes started for the job
+ * 
+ * Thread jobs have pid 0: they run inside the shell, and stopping or
+ * killing them goes through jobs_signal() rather than kill(2).
  */
 typedef struct {
     int job_id;                  /* Job number (user-visible ID) */
     pid_t pid;                   /* Process ID */
-    char command[MAX_CMD_LEN];   /* Command that started this job */
+    char *command;               /* Command that started this job (MEM_JOBS) */
     JobStatus status;            /* Current status */
     int background;              /* 1 = background job, 0 = foreground */
+    struct PipeMonitor *monitor; /* Pipe statistics (USHELL_PIPE_MONITOR) */
+    JobStatus notified;          /* Status last shown in a notice */
+    struct ThreadJob *thread;    /* Pool-backed job (pid is 0), or NULL */
+    int exit_status;             /* Valid once status is JOB_DONE */
+    int term_signal;             /* Signal that ended the job, or 0 */
+    pid_t helpers[MAX_JOB_HELPERS]; /* Process substitutions, reaped with the job */
+    int helper_count;
 } Job;
 
 /* ============================================================================
@@ -74,12 +99,14 @@ typedef struct {
  * JobList - Container for all tracked jobs
  * 
  * Fields:
- *   jobs:  Array of Job structures (fixed size)
- *   count: Number of active jobs in the array
+ *   jobs:     Array of Job structures, grown on demand
+ *   count:    Number of active jobs in the array
+ *   capacity: Slots allocated (at most MAX_JOBS)
  */
 typedef struct {
-    Job jobs[MAX_JOBS];          /* Array of jobs */
+    Job *jobs;                   /* Array of jobs */
     int count;                   /* Number of active jobs */
+    int capacity;                /* Allocated slots */
 } JobList;
 
 /* ============================================================================
@@ -110,6 +137,106 @@ void jobs_init(void);
  */
 int jobs_add(pid_t pid, const char *cmd, int bg);
 
+/**
+ * jobs_add_helper - Attach a process substitution helper to a job
+ * 
+ * The helper is reaped without blocking whenever job status is updated,
+ * and is not part of the job's own status. Helpers of unknown jobs
+ * (job_id -1) and of removed jobs are reaped the same way.
+ * 
+ * @param job_id: Job the helper belongs to, or -1
+ * @param pid: Helper process
+ */
+void jobs_add_helper(int job_id, pid_t pid);
+
+/**
+ * jobs_add_thread - Run an integrated tool on the worker pool as a job
+ * 
+ * The tool gets its own context: the given streams, the current
+ * directory (kept even if the shell cd's later) and a cancel flag that
+ * jobs_signal() sets. Streams other than stdin/stdout/stderr are closed
+ * when the tool returns. Prints "[N] thread" before the tool starts.
+ * 
+ * @param tool: Tool to run
+ * @param argv: Arguments (copied)
+ * @param in, out, err: Streams for the tool
+ * @param cmd: Command string shown by jobs
+ * 
+ * Returns: Job ID, or -1 if no worker is free (nothing is started and
+ *          the streams stay with the caller)
+ */
+int jobs_add_thread(tool_func tool, char **argv, FILE *in, FILE *out, FILE *err,
+                    const char *cmd);
+
+/**
+ * jobs_signal - Send a signal to a job
+ * 
+ * Process jobs get kill(2) on their process group. Thread jobs pause at
+ * their next cancellation check on SIGSTOP/SIGTSTP, resume on SIGCONT
+ * and are cancelled by any other signal (status 128 + signal).
+ * 
+ * @param job_id: Job to signal
+ * @param sig: Signal number (0 only checks that the job exists)
+ * 
+ * Returns: 0 on success, -1 if the job does not exist or kill(2) failed
+ */
+int jobs_signal(int job_id, int sig);
+
+/**
+ * jobs_sched - Set a job's CPU affinity, scheduling class, nice, ionice
+ * 
+ * Process jobs: every thread of every process in the job's group.
+ * Thread jobs: the worker running the tool, for as long as it runs it;
+ * settings made before the tool starts are applied when it does.
+ * 
+ * @param job_id: Job to change
+ * @param sched: Settings to change (unset fields are left alone)
+ * 
+ * Returns: 0 on success, -1 with errno set (ESRCH: no such job)
+ */
+int jobs_sched(int job_id, const JobSched *sched);
+
+/**
+ * jobs_sched_get - Read a job's current settings
+ * 
+ * Reads the job's process group leader, or the worker of a thread job
+ * (the pending settings if the tool has not started).
+ * 
+ * Returns: 0 on success, -1 with errno set
+ */
+int jobs_sched_get(int job_id, JobSched *sched);
+
+/**
+ * jobs_apply_policy - Apply the background job policy to a new job
+ * 
+ * @param job_id: Job just started with &
+ * @param policy: Value of USHELL_BG_POLICY (jobctl options), or NULL
+ */
+void jobs_apply_policy(int job_id, const char *policy);
+
+/**
+ * jobs_wait - Block until a job finishes
+ * 
+ * With foreground set (fg), Ctrl+C cancels a thread job and Ctrl+Z
+ * pauses it and returns; otherwise (wait) Ctrl+C stops the wait.
+ * A job that finished is marked announced so no "Done" notice follows.
+ * 
+ * @param job_id: Job to wait for
+ * @param foreground: 1 when called by fg
+ * 
+ * Returns: Exit status of the job, 128 + SIGTSTP if it was stopped,
+ *          130 if the wait was interrupted, -1 if there is no such job
+ */
+int jobs_wait(int job_id, int foreground);
+
+/**
+ * jobs_shutdown_threads - Finish thread jobs before the shell exits
+ * 
+ * @param cancel: 1 to cancel running thread jobs (interactive exit),
+ *                0 to let them complete (end of a script or -c)
+ */
+void jobs_shutdown_threads(int cancel);
+
 /**
  * jobs_get - Retrieve a job by its job ID
  * 
@@ -166,6 +293,16 @@ void jobs_update_status(void);
  */
 void jobs_print_all(void);
 
+/**
+ * jobs_notify - Queue "[N]+ Done  command" notices for the terminal
+ * 
+ * Reports background jobs whose status changed to done or stopped since
+ * the last call (see shell_notice in eventloop.h). Interactive only.
+ * 
+ * Returns: Number of notices queued
+ */
+int jobs_notify(void);
+
 /**
  * jobs_count - Get the number of active jobs
  * 
@@ -194,6 +331,15 @@ int jobs_cleanup(void);
  */
 const char* job_status_to_string(JobStatus status);
 
+/**
+ * job_state_to_string - Describe a job for jobs and completion notices
+ * @job: Job to describe
+ * 
+ * Returns: job_status_to_string(job->status), except that a job ended by
+ *          a signal is named after it ("Terminated", "Killed")
+ */
+const char* job_state_to_string(const Job *job);
+
 /**
  * jobs_get_by_index - Get job by array index (not job_id)
  * @index: Array index (0-based)
@@ -0,0 +1,93 @@
+#ifndef JOBSCHED_H
+#define JOBSCHED_H
+
+#include <stdio.h>
+#include <sys/types.h>
+
+/**
+ * @file jobsched.h
+ * @brief CPU affinity, scheduling class, nice and I/O priority for jobs
+ *
+ * A JobSched holds the settings jobctl was asked to change; fields left
+ * unset keep the task's current value. Process jobs get them on every
+ * thread of every process in their group (sched_setaffinity and
+ * sched_setscheduler per thread, setpriority/ioprio_set on the group),
+ * thread jobs and pool workers on their own thread IDs.
+ *
+ * USHELL_BG_POLICY holds jobctl options applied to each new background
+ * job, e.g. USHELL_BG_POLICY='--sched batch --ionice idle'.
+ */
+
+/* CPUs jobctl --cpus can name (CPU_SETSIZE) */
+#define JOBSCHED_MAX_CPUS 1024
+
+/* I/O priority classes (linux/ioprio.h) */
+#define JOBSCHED_IO_NONE 0
+#define JOBSCHED_IO_RT   1
+#define JOBSCHED_IO_BE   2
+#define JOBSCHED_IO_IDLE 3
+
+typedef struct {
+    int set_cpus;
+    unsigned char cpus[JOBSCHED_MAX_CPUS / 8];  // Bit n = CPU n
+    int policy;     // SCHED_OTHER, SCHED_BATCH, SCHED_IDLE, or -1
+    int set_nice;
+    int nice;
+    int io_class;   // JOBSCHED_IO_*, or -1
+    int io_level;   // 0 (highest) - 7 for RT and BE
+} JobSched;
+
+/**
+ * @brief Initialise s to "change nothing"
+ */
+void jobsched_init(JobSched *s);
+
+/**
+ * @brief Whether s changes anything
+ */
+int jobsched_empty(const JobSched *s);
+
+/**
+ * @brief Parse one option at argv[*i] (--cpus, --sched, --nice, --ionice)
+ * Advances *i past the option and its value.
+ * @return 1 if an option was parsed, 0 if argv[*i] is not one,
+ *         -1 on a bad value (message printed with prefix who)
+ */
+int jobsched_parse_option(char **argv, int *i, JobSched *s, const char *who);
+
+/**
+ * @brief Parse a whole option string (USHELL_BG_POLICY)
+ * @return 0 on success, -1 on error (message printed with prefix who)
+ */
+int jobsched_parse_string(const char *spec, JobSched *s, const char *who);
+
+/**
+ * @brief Copy the fields set in from into to
+ */
+void jobsched_merge(JobSched *to, const JobSched *from);
+
+/**
+ * @brief Apply s to every thread of every process in group pgid
+ * @return 0 on success, -1 if any change failed (errno of the first)
+ */
+int jobsched_apply_pgrp(pid_t pgid, const JobSched *s);
+
+/**
+ * @brief Apply s to one thread (0 for the calling thread)
+ * @return 0 on success, -1 if any change failed (errno of the first)
+ */
+int jobsched_apply_task(pid_t tid, const JobSched *s);
+
+/**
+ * @brief Read the current settings of a thread (0 for the caller)
+ * Every field is filled in, so the result restores the thread exactly.
+ * @return 0 on success, -1 on error
+ */
+int jobsched_get(pid_t tid, JobSched *s);
+
+/**
+ * @brief Print settings as "cpus 0-3  sched batch  nice 0  ionice idle"
+ */
+void jobsched_print(FILE *out, const JobSched *s);
+
+#endif /* JOBSCHED_H */
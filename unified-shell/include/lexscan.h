@@ -0,0 +1,83 @@
+#ifndef LEXSCAN_H
+#define LEXSCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file lexscan.h
+ * @brief Block-at-a-time byte classification for the command lexer
+ *
+ * lexscan_init() makes one pass over a line and records, for every byte,
+ * which lexical classes it belongs to as 64-bit masks (one bit per byte,
+ * one mask per class per 64-byte block). The lexer then finds token
+ * boundaries, quotes and operators by scanning the masks with count-
+ * trailing-zeros instead of testing each byte several times.
+ *
+ * Classification uses AVX2 (32 bytes per step) or SSE2 (16 bytes) when
+ * the CPU has them and a lookup table otherwise. USHELL_LEXER=scalar,
+ * sse2 or avx2 in the process environment forces a variant (the fastest
+ * available is used by default); all give identical results.
+ */
+
+/* Byte classes (combine with | to search several at once) */
+#define LEX_SPACE   0x01    // ' ' '\t' '\n' (token delimiters)
+#define LEX_QUOTE   0x02    // ' "
+#define LEX_OPER    0x04    // | < > & ;
+#define LEX_EXPAND  0x08    // $ `
+#define LEX_GLOB    0x10    // * ? [
+#define LEX_CLOSE   0x20    // ] (ends [[ ]] tests and bracket globs)
+#define LEX_NCLASSES 6
+
+/* Lines up to this many bytes keep their masks inside the LexScan
+ * (which must therefore not be copied) */
+#define LEXSCAN_INLINE_BYTES 512
+
+typedef struct {
+    size_t len;             // Bytes classified
+    size_t nblocks;         // 64-byte blocks (the last one zero-padded)
+    unsigned seen;          // Every class present anywhere in the line
+    uint64_t *bits;         // bits[block * LEX_NCLASSES + class]
+    uint64_t inline_bits[(LEXSCAN_INLINE_BYTES / 64) * LEX_NCLASSES];
+} LexScan;
+
+/**
+ * @brief Classify len bytes of s
+ * @return 0 on success, -1 if the masks could not be allocated
+ */
+int lexscan_init(LexScan *ls, const char *s, size_t len);
+
+/**
+ * @brief Release masks allocated for long lines
+ */
+void lexscan_free(LexScan *ls);
+
+/**
+ * @brief Position of the first byte at or after from in any of classes
+ * @return The position, or ls->len if there is none
+ */
+size_t lexscan_next(const LexScan *ls, unsigned classes, size_t from);
+
+/**
+ * @brief Position of the first byte at or after from in none of classes
+ * @return The position, or ls->len if there is none
+ */
+size_t lexscan_next_not(const LexScan *ls, unsigned classes, size_t from);
+
+/**
+ * @brief Whether any byte in [from, to) belongs to one of classes
+ */
+int lexscan_any(const LexScan *ls, unsigned classes, size_t from, size_t to);
+
+/**
+ * @brief Classes present in len bytes of s, without keeping masks
+ * Used for quick checks such as "needs expansion" or "needs glob".
+ */
+unsigned lexscan_classes(const char *s, size_t len);
+
+/**
+ * @brief Name of the classifier in use ("avx2", "sse2" or "scalar")
+ */
+const char *lexscan_variant(void);
+
+#endif // LEXSCAN_H
@@ -19,7 +19,8 @@
  */
 
 /* Maximum buffer sizes for MCP operations */
-#define MCP_BUFFER_SIZE 16384
+#define MCP_BUFFER_SIZE 16384     /* Largest request a client may send */
+#define MCP_INITIAL_BUFFER 1024   /* Per-client buffer before it grows */
 #define MCP_MAX_CLIENTS 10
 #define MCP_DEFAULT_PORT 9000
 #define MCP_CMD_TIMEOUT 30
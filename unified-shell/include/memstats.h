@@ -0,0 +1,59 @@
+#ifndef MEMSTATS_H
+#define MEMSTATS_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * @file memstats.h
+ * @brief Counting allocator wrappers for per-subsystem memory statistics
+ *
+ * Subsystems that keep long-lived state (variables, the job table, the
+ * package index, MCP buffers, interned strings) allocate through
+ * mem_malloc() and friends, tagging each call with a MemSubsystem. The
+ * wrappers count allocations, frees and live bytes (malloc_usable_size,
+ * so allocator rounding is included) with atomic counters; the memstats
+ * builtin prints them next to the process RSS and heap totals.
+ *
+ * Memory from mem_malloc() must be released with mem_free() under the
+ * same subsystem, or the live counts drift.
+ */
+
+typedef enum {
+    MEM_ENV,        // Variable bindings and values
+    MEM_JOBS,       // Job table and command strings
+    MEM_APT,        // Package index
+    MEM_MCP,        // MCP client and output buffers
+    MEM_INTERN,     // String intern table
+    MEM_SUBSYSTEM_COUNT
+} MemSubsystem;
+
+typedef struct {
+    unsigned long allocs;   // Successful allocations (realloc of NULL counts)
+    unsigned long frees;    // Frees (realloc to a new block counts as neither)
+    size_t live_bytes;      // Bytes currently allocated
+    size_t peak_bytes;      // High-water mark of live_bytes
+} MemCounters;
+
+void *mem_malloc(MemSubsystem sub, size_t size);
+void *mem_calloc(MemSubsystem sub, size_t n, size_t size);
+void *mem_realloc(MemSubsystem sub, void *ptr, size_t size);
+char *mem_strdup(MemSubsystem sub, const char *str);
+void mem_free(MemSubsystem sub, void *ptr);
+
+/**
+ * @brief Snapshot the counters of one subsystem
+ */
+void mem_counters(MemSubsystem sub, MemCounters *out);
+
+/**
+ * @brief Short lowercase name of a subsystem ("env", "jobs", ...)
+ */
+const char *mem_subsystem_name(MemSubsystem sub);
+
+/**
+ * @brief Print the per-subsystem table, RSS and heap statistics
+ */
+void mem_print_stats(FILE *out);
+
+#endif // MEMSTATS_H
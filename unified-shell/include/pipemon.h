@@ -0,0 +1,83 @@
+#ifndef PIPEMON_H
+#define PIPEMON_H
+
+#include <stdio.h>
+
+/**
+ * @file pipemon.h
+ * @brief Pipeline pipe sizing and throughput monitor
+ *
+ * USHELL_PIPE_SIZE (e.g. 1M, 256K, 1048576) enlarges every pipeline pipe
+ * with F_SETPIPE_SZ; as a prefix assignment it applies to one pipeline:
+ *   USHELL_PIPE_SIZE=4M producer | consumer
+ *
+ * With USHELL_PIPE_MONITOR=1 each pipe between two stages is split in
+ * two and a relay thread in the shell moves data between the halves with
+ * splice(2). The relay counts bytes and time spent waiting on either side:
+ *   - writer blocked: output side full, so the producer is being held up
+ *     by a slower consumer
+ *   - reader starved: no input, so the consumer is waiting on the producer
+ * Background jobs show the figures in `jobs -l`; foreground pipelines
+ * print them to stderr when they finish.
+ */
+
+typedef struct PipeMonitor PipeMonitor;
+
+/**
+ * @brief Parse a pipe size ("64K", "1M", "65536")
+ * @return Size in bytes, or 0 if value is NULL or invalid
+ */
+long pipe_size_parse(const char *value);
+
+/**
+ * @brief Create a pipe, enlarged to size bytes when size > 0
+ * @return 0 on success, -1 on error (errno set)
+ */
+int pipe_open_sized(int fds[2], long size);
+
+/**
+ * @brief Check whether USHELL_PIPE_MONITOR=1 is set (shell or process env)
+ */
+int pipe_monitor_requested(const char *value);
+
+/**
+ * @brief Create a monitor for a pipeline
+ * @param stages Number of stages; stage_names[i] names stage i
+ * @return Monitor with one owner reference, or NULL
+ */
+PipeMonitor *pipe_monitor_new(int stages, char *const *stage_names);
+
+/**
+ * @brief Open the monitored pipe between stage index and index + 1
+ * fds[1] is the producer's write end and fds[0] the consumer's read end,
+ * as with pipe(); the relay keeps the two inner ends.
+ * @return 0 on success, -1 on error
+ */
+int pipe_monitor_open(PipeMonitor *mon, int index, int fds[2], long size);
+
+/**
+ * @brief Close the relay ends in a forked pipeline child
+ */
+void pipe_monitor_close_child(PipeMonitor *mon);
+
+/**
+ * @brief Start the relay threads (after all stages are forked)
+ */
+void pipe_monitor_start(PipeMonitor *mon);
+
+/**
+ * @brief Wait until every relay has seen end of input or a closed reader
+ */
+void pipe_monitor_wait(PipeMonitor *mon);
+
+/**
+ * @brief Print one line per pipe: bytes, rate, writer blocked, reader starved
+ */
+void pipe_monitor_print(PipeMonitor *mon, FILE *out, const char *indent);
+
+/**
+ * @brief Drop the owner reference (relays keep theirs until they finish)
+ */
+void pipe_monitor_release(PipeMonitor *mon);
+
+#endif // PIPEMON_H
@@ -0,0 +1,47 @@
+#ifndef PLUGINS_H
+#define PLUGINS_H
+
+#include <stdio.h>
+#include "builtins.h"
+
+/**
+ * @file plugins.h
+ * @brief Builtins loaded from shared objects (see ushell_builtin.h)
+ *
+ * Loaded commands are found by find_builtin() ahead of the compiled-in
+ * table, so they run without a fork like any other builtin. Each keeps
+ * call counts and wall time, shown by 'enable'.
+ */
+
+/**
+ * @brief Load NAME from a shared object
+ * @param path Library path (searched like dlopen when it has no '/')
+ * @param name Command to register
+ * @param err Buffer for an error message on failure
+ * @return 0 on success, -1 on error
+ */
+int plugin_load(const char *path, const char *name, char *err, size_t err_size);
+
+/**
+ * @brief Remove a loaded command; the library is closed with its last command
+ * @return 0 on success, -1 if name is not a loaded command
+ */
+int plugin_unload(const char *name);
+
+/**
+ * @brief Builtin entry point for a loaded command (argv[0] selects it)
+ * @return builtin_func to run name, or NULL if name is not loaded
+ */
+builtin_func plugin_find(const char *name);
+
+/**
+ * @brief Print loaded commands with their library and timing
+ */
+void plugin_print(FILE *out);
+
+/**
+ * @brief Number of loaded commands
+ */
+int plugin_count(void);
+
+#endif // PLUGINS_H
@@ -0,0 +1,68 @@
+#ifndef PROCSUB_H
+#define PROCSUB_H
+
+#include "environment.h"
+
+/**
+ * @file procsub.h
+ * @brief Process substitution: <(cmd) and >(cmd) as /dev/fd/N paths
+ *
+ * Expansion replaces the word with "/dev/fd/N", where N is the shell's
+ * end of a pipe to the inner command, which is already running:
+ *   - <(builtin) runs to completion first, its output held in a memfd
+ *   - an integrated tool runs on a pool worker, streaming through a pipe
+ *   - anything else is a forked child
+ * N is inherited by the command that names it and closed in every other
+ * child. The descriptors and helpers belong to the innermost scope
+ * opened with procsub_mark(); a background job takes them over.
+ */
+
+/**
+ * @brief Open a scope for the substitutions of one command
+ * @return Token for procsub_finish()
+ */
+int procsub_mark(void);
+
+/**
+ * @brief Start cmd and return the shell's end of its pipe
+ * @param cmd Command text between the parentheses
+ * @param output 1 for >(cmd) (the shell end is for writing), 0 for <(cmd)
+ * @param env Environment to run cmd in
+ * @return Descriptor N (not close-on-exec), or -1 on error (message printed)
+ */
+int procsub_start(const char *cmd, int output, Env *env);
+
+/**
+ * @brief Close the scope's descriptors and collect its helpers
+ *
+ * >(cmd) readers see end of input and are waited for. <(cmd) writers
+ * have nobody left to read their output: finished ones are reaped, the
+ * rest are left to the job table (and stopped if Ctrl+C was pressed).
+ * @param mark Token from procsub_mark()
+ */
+void procsub_finish(int mark);
+
+/**
+ * @brief In a forked child: close descriptors that argv does not name
+ * @param argv Command about to run, or NULL to close them all
+ */
+void procsub_child_close(char **argv);
+
+/**
+ * @brief Hand the current scope's helpers to a background job
+ *
+ * Closes the shell's descriptors (the job's processes hold their own
+ * copies); helper processes are reaped with the job, tool threads finish
+ * on their own.
+ * @param job_id Job that uses the substitutions, or -1 if none was created
+ */
+void procsub_detach(int job_id);
+
+/**
+ * @brief Whether the shell has substitutions open
+ * @param threads_only 1 to count only tools running on pool workers
+ * @return 1 if there are, 0 otherwise
+ */
+int procsub_active(int threads_only);
+
+#endif // PROCSUB_H
@@ -0,0 +1,83 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+/**
+ * @file profile.h
+ * @brief Per-line script profiler (ushell --profile)
+ *
+ * The script interpreter brackets every simple command and function call
+ * with profile_enter/profile_leave (a no-op unless profiling is on). Each
+ * script line accumulates:
+ *   - wall time, inclusive ("total") and exclusive ("self")
+ *   - CPU time of reaped child processes (RUSAGE_CHILDREN)
+ *   - number of fork()s and external programs exec'd
+ * A table sorted by self time is printed to stderr at exit, and folded
+ * stacks ("stdin:3;deploy();lib.sh:12 4711") can be written for flame
+ * graph tools.
+ *
+ * Hooks cost about one vDSO clock read per command (consecutive commands
+ * share the boundary reading) and a cached pointer per script line;
+ * getrusage() is only called for commands that actually forked.
+ */
+
+extern int profile_enabled;
+
+/* Incremented by the executor at every fork and external exec */
+extern unsigned long profile_forks;
+extern unsigned long profile_execs;
+
+/**
+ * Bracket for one timed region (lives on the caller's stack)
+ */
+typedef struct ProfileMark {
+    struct ProfileMark *parent;
+    void *stat;                 // LineStat or FuncStat being timed
+    void *fold;                 // Folded-stack node, when enabled
+    int is_function;
+    uint64_t start_ns;
+    uint64_t child_ns;          // Wall time of nested marks
+    uint64_t child_cpu_start;   // Children CPU (us) when entered
+    unsigned long forks_start;
+    unsigned long execs_start;
+} ProfileMark;
+
+/**
+ * @brief Turn profiling on and register the exit report
+ * @param folded_path File for folded stacks, or NULL
+ */
+void profile_start(const char *folded_path);
+
+/**
+ * @brief Start timing a command on a script line
+ * @param cache Per-node slot (NULL initially) remembering the line's stats
+ * @param origin Script name ("stdin" or a sourced file)
+ * @param line Line number within origin
+ * @param text Command text (first use only, for the report)
+ */
+void profile_enter(ProfileMark *mark, void **cache, const char *origin, int line,
+                   const char *text);
+
+/**
+ * @brief Start timing a shell function call
+ */
+void profile_enter_function(ProfileMark *mark, const char *name);
+
+/**
+ * @brief Forget the last clock reading (call before running new input,
+ * so time spent waiting for it is not charged to the next command)
+ */
+void profile_sync_clock(void);
+
+/**
+ * @brief Stop timing the innermost region started with profile_enter*
+ */
+void profile_leave(ProfileMark *mark);
+
+/**
+ * @brief Print the report (and write folded stacks); called at exit
+ */
+void profile_report(void);
+
+#endif // PROFILE_H
@@ -0,0 +1,51 @@
+#ifndef READBUF_H
+#define READBUF_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * @file readbuf.h
+ * @brief Shared, record-oriented reads from file descriptors
+ *
+ * Used by the read and mapfile builtins. Instead of one read(2) per byte,
+ * each descriptor gets a strategy that never consumes past the record
+ * being returned, so commands run afterwards see the right data:
+ *
+ *   - Regular files: large pread(2) chunks kept in a per-fd buffer; the
+ *     file offset is moved (lseek) to just after the returned record.
+ *   - Pipes/FIFOs: the pending data is peeked with tee(2) and exactly one
+ *     record is then consumed.
+ *   - The shell's own command input (non-tty stdin): the stdio stream the
+ *     command reader already uses, so script lines and data stay in order.
+ *   - Terminals and anything else: line reads / one byte at a time.
+ */
+
+/**
+ * @brief Record the identity of stdin when it carries shell commands
+ *
+ * Call once at startup, before any redirection.
+ */
+void readbuf_init(void);
+
+/**
+ * @brief Read one record terminated by delim (getdelim-style)
+ * @param fd Descriptor to read from
+ * @param delim Record delimiter
+ * @param line In/out malloc'd buffer (may be NULL)
+ * @param cap In/out buffer capacity
+ * @return Bytes stored including the delimiter when present,
+ *         0 at end of input, -1 on error or interrupt
+ */
+ssize_t readbuf_getdelim(int fd, int delim, char **line, size_t *cap);
+
+/**
+ * @brief Read everything up to end of input
+ * @param fd Descriptor to read from
+ * @param data Output: malloc'd, NUL-terminated contents
+ * @param len Output: number of bytes read
+ * @return 0 on success, -1 on error or interrupt
+ */
+int readbuf_slurp(int fd, char **data, size_t *len);
+
+#endif // READBUF_H
@@ -0,0 +1,87 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include <stdint.h>
+#include "builtins.h"
+#include "tools.h"
+
+/**
+ * @file registry.h
+ * @brief Command registry generated from src/registry/commands.def
+ *
+ * The build runs gen_registry over commands.def and compiles the result
+ * (registry_gen.c): the entry table, a perfect hash over the names, and
+ * the listings derived from them. Name lookup is one hash, one table read
+ * and one strcmp, whatever the number of commands.
+ *
+ * Lookup uses hash-and-displace: the seed-0 hash picks a bucket, the
+ * bucket's displacement seeds a second hash that picks the slot.
+ */
+
+typedef enum {
+    REG_BUILTIN,    // builtin_func, listed with the builtins
+    REG_JOB,        // builtin_func, listed under "Job Control"
+    REG_TOOL,       // tool_func
+    REG_SUBCMD,     // Catalog entry only ("apt install")
+    REG_ALIAS,      // Dispatched but not listed ([, [[)
+    REG_KIND_COUNT
+} RegistryKind;
+
+typedef struct {
+    const char *name;
+    RegistryKind kind;
+    builtin_func builtin;       // REG_BUILTIN, REG_JOB, REG_ALIAS
+    tool_func tool;             // REG_TOOL
+    const char *usage;
+    const char *summary;
+    const char *description;
+} RegistryEntry;
+
+/* Generated tables (registry_gen.c) */
+extern const RegistryEntry registry_entries[];
+extern const int registry_count;
+extern const uint16_t registry_displace[];
+extern const int16_t registry_slots[];
+extern const uint32_t registry_bucket_mask;
+extern const uint32_t registry_slot_mask;
+
+/* NULL-terminated names offered by tab completion */
+extern const char *const registry_completion_names[];
+
+/* `commands --json` / `ushell --commands-json` catalog */
+extern const char registry_json[];
+
+/* `commands` listing */
+extern const char registry_text[];
+
+/* `help` lines for each kind ("  usage   summary\n"...) */
+extern const char *const registry_help_lines[REG_KIND_COUNT];
+
+/**
+ * @brief Seeded FNV-1a with a final avalanche (shared with the generator)
+ */
+static inline uint32_t registry_hash(uint32_t seed, const char *name) {
+    uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return h;
+}
+
+/**
+ * @brief Find a command by name
+ * @return Entry, or NULL if name is not a registered command
+ */
+const RegistryEntry *registry_lookup(const char *name);
+
+/**
+ * @brief Position of a command in registry_entries
+ * @return Index, or -1 if name is not registered
+ */
+int registry_index(const char *name);
+
+#endif // REGISTRY_H
@@ -0,0 +1,188 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <stdio.h>
+#include "environment.h"
+
+/**
+ * @file script.h
+ * @brief Shell language front end: lists, control flow and functions
+ *
+ * A command line (or script) is parsed once into an AST that is kept in
+ * an arena owned by a ScriptUnit. Loop bodies, case arms and function
+ * bodies are executed straight from that AST, and simple commands are
+ * pre-split into words whose $variables resolve through cached EnvSlots,
+ * so re-running a body does no parsing and, for builtins, no allocation.
+ *
+ * Supported constructs:
+ *   a; b   a && b   a || b   ! a   a &
+ *   if list; then list; [elif list; then list;] [else list;] fi
+ *   if cond then cmd [else cmd] fi            (legacy one-line form)
+ *   for NAME [in words]; do list; done
+ *   while list; do list; done   until list; do list; done
+ *   case word in pattern[|pattern]) list;; ... esac
+ *   name() { list; }   function name { list; }
+ *   { list; }   NAME=value
+ *   compound | cmd   cmd | compound            (stages are forked)
+ */
+
+typedef struct ScriptUnit ScriptUnit;
+
+#define SCRIPT_OK 0
+#define SCRIPT_INCOMPLETE 1     // Input ended inside a construct or quote
+#define SCRIPT_SYNTAX_ERROR -1
+
+// Bump whenever parsing or the serialized format changes; cached
+// compiled scripts from other versions are ignored
+#define SCRIPT_PARSER_VERSION 4
+
+/**
+ * @brief Parse text into a unit
+ * @param text Source text (may contain newlines)
+ * @param status Output: SCRIPT_OK, SCRIPT_INCOMPLETE or SCRIPT_SYNTAX_ERROR
+ * @return Unit with one reference (release with script_release), or NULL
+ */
+ScriptUnit *script_parse(const char *text, int *status);
+
+/**
+ * @brief Allow the last command of the top-level unit to replace the
+ * shell (exec) instead of being forked; for -c and script mode
+ */
+void script_set_tail_exec(int enabled);
+
+/**
+ * @brief Make a failed expansion such as ${var:?message} end the shell
+ *
+ * For commands read from input that is not a terminal. A script or -c
+ * string stops anyway, as the whole unit is abandoned; at a prompt only
+ * the current command line is.
+ */
+void script_set_abort_exits(int enabled);
+
+/**
+ * @brief Set the origin and line number of the next text passed to
+ * script_parse (reported by the profiler; the REPL passes "stdin")
+ * @param origin Name with static lifetime
+ */
+void script_set_input_position(const char *origin, int line);
+
+/**
+ * @brief Mark a unit as parsed from a script file starting at line 1
+ */
+void script_set_origin(ScriptUnit *unit, const char *origin);
+
+/**
+ * @brief Execute a parsed unit
+ * @return Exit status of the last command (also stored in last_exit_status)
+ */
+int script_execute(ScriptUnit *unit, Env *env);
+
+/**
+ * @brief Drop a reference; the unit is freed once no function uses it
+ */
+void script_release(ScriptUnit *unit);
+
+/**
+ * @brief Add a reference to a unit (e.g. for a cache)
+ */
+void script_retain(ScriptUnit *unit);
+
+/**
+ * @brief Execute a unit as a sourced file
+ * 'return' at top level ends the file; argv[1..], when present, become
+ * the positional parameters while it runs.
+ * @param argv File name followed by arguments, or NULL
+ * @return Exit status of the last command
+ */
+int script_execute_source(ScriptUnit *unit, Env *env, char **argv);
+
+/**
+ * @brief Write a unit's parsed form (see script_deserialize)
+ * @return 0 on success, -1 on write error
+ */
+int script_serialize(ScriptUnit *unit, FILE *out);
+
+/**
+ * @brief Rebuild a unit from script_serialize output
+ * @return Unit with one reference, or NULL if the data is malformed
+ */
+ScriptUnit *script_deserialize(const void *data, size_t len);
+
+/**
+ * @brief Check whether text needs more lines (unterminated if/for/quote...)
+ * @return 1 if incomplete, 0 otherwise
+ */
+int script_is_incomplete(const char *text);
+
+/**
+ * @brief Check whether name is a defined shell function
+ */
+int script_has_function(const char *name);
+
+/**
+ * @brief Call a shell function with argv[1..] as positional parameters
+ * @return Exit status, or -1 if name is not a function
+ */
+int script_call_function(char **argv, Env *env);
+
+/**
+ * @brief Number of positional parameters in the current function call
+ * @return Count, or -1 outside of a function
+ */
+int script_positional_count(void);
+
+/**
+ * @brief Positional parameter n (1-based) of the current function call
+ * @return Argument text, "" if out of range, or NULL outside of a function
+ */
+const char *script_positional(int n);
+
+/**
+ * @brief Check whether this process is the child of a forked ( ... )
+ * @return 1 in the child, 0 in the shell itself
+ */
+int script_in_forked_subshell(void);
+
+/**
+ * @brief Mark this process as a forked child running shell code
+ *
+ * exit then ends only the child, as in a forked ( ... ).
+ */
+void script_enter_forked_subshell(void);
+
+/**
+ * @brief Whether a unit would run in this process as a subshell
+ *
+ * True when every command is a builtin, tool or such function and none
+ * leaves the subshell early; script_execute_subshell() forks otherwise.
+ */
+int script_subshell_in_process(const ScriptUnit *unit);
+
+/**
+ * @brief Run a unit as a subshell, as for ( list ) and $(...)
+ *
+ * Variables, the working directory, umask and the process environment
+ * are put back afterwards, and exit or exec only end the subshell.
+ * The unit's own reference is not consumed.
+ * @return Exit status of the unit, also stored as $?
+ */
+int script_execute_subshell(ScriptUnit *unit, Env *env);
+
+/**
+ * @brief Control flow requests from the break/continue/return builtins
+ * @return 0 on success, -1 when not inside a loop (or function for return)
+ */
+int script_request_break(int levels);
+int script_request_continue(int levels);
+int script_request_return(int status);
+
+/**
+ * @brief Abandon the running command line after a failed expansion
+ *
+ * Called by the expander; subshells stop at their own boundary. The
+ * top-level unit returns status 1, or the shell exits with it when
+ * script_set_abort_exits is on.
+ */
+void script_request_abort(void);
+
+#endif // SCRIPT_H
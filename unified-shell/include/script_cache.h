@@ -0,0 +1,31 @@
+#ifndef SCRIPT_CACHE_H
+#define SCRIPT_CACHE_H
+
+#include "script.h"
+
+/**
+ * @file script_cache.h
+ * @brief Parsed-script cache for source / .
+ *
+ * Scripts are read with mmap and parsed once. The resulting unit is kept
+ * in memory keyed by file identity (device, inode) and validated against
+ * size and mtime, so re-sourcing an unchanged file costs one stat().
+ * Pipes and other non-regular files are read to EOF and never cached.
+ *
+ * With USHELL_SCRIPT_CACHE=1 the parsed form is also written to
+ * $XDG_CACHE_HOME/ushell (default ~/.cache/ushell) as NAME.ushc and
+ * reused by later shells while path, size, mtime and
+ * SCRIPT_PARSER_VERSION still match.
+ */
+
+#define SCRIPT_CACHE_IO_ERROR -2    // File could not be read; errno is set
+
+/**
+ * @brief Get the parsed form of a script file
+ * @param path Script path
+ * @param status Output: SCRIPT_OK, SCRIPT_SYNTAX_ERROR or SCRIPT_CACHE_IO_ERROR
+ * @return Unit with a reference for the caller (script_release), or NULL
+ */
+ScriptUnit *script_cache_load(const char *path, int *status);
+
+#endif // SCRIPT_CACHE_H
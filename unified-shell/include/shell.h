@@ -1,10 +1,18 @@
 #ifndef SHELL_H
 #define SHELL_H
 
+#include "environment.h"
+
 // Constants
 #define MAX_LINE 1024
 #define PROMPT "unified-shell> "
 
+/*
+ * shell_env - The shell's global variable environment (defined in main.c)
+ * Used by integrated tools that need to run command lines themselves
+ */
+extern Env *shell_env;
+
 /*
  * get_shell_state_json - Gather current shell state as JSON
  * 
@@ -10,7 +10,11 @@
  * - SIGINT (Ctrl+C): Terminates foreground jobs, not shell
  * - SIGTSTP (Ctrl+Z): Stops foreground jobs, returns to shell prompt
  * - SIGCHLD: Reaps zombie processes, updates job status
+ * - SIGWINCH: Terminal resized, the line being edited is redrawn
  * - SIGTTOU/SIGTTIN: Handles terminal control issues
+ *
+ * Handlers only set flags (and wake the event loop, see eventloop.h);
+ * the work happens in the main loop.
  */
 
 /**
@@ -19,6 +23,31 @@
  */
 extern volatile sig_atomic_t child_exited;
 
+/**
+ * Global flag set by SIGINT handler when Ctrl+C is pressed while the
+ * shell itself (not a child) is in the foreground. Long-running in-process
+ * tools poll this to stop cooperatively. Tools clear it before they start.
+ */
+extern volatile sig_atomic_t sigint_received;
+
+/**
+ * Global flag set when the SIGINT handler forwards Ctrl+C to the foreground
+ * job; loops and && / || lists stop on it as they do on sigint_received.
+ * Cleared once the outermost loop or list running at the time has stopped.
+ */
+extern volatile sig_atomic_t foreground_interrupted;
+
+/**
+ * Global flag set by SIGTSTP handler when Ctrl+Z is pressed while no child
+ * is in the foreground; a thread job waited on by fg pauses when it is set
+ */
+extern volatile sig_atomic_t sigtstp_received;
+
+/**
+ * Global flag set by SIGWINCH handler when the terminal size changes
+ */
+extern volatile sig_atomic_t window_resized;
+
 /**
  * Global variable to track current foreground job PID
  * When 0, no foreground job is running (shell is in foreground)
@@ -50,4 +79,10 @@ void sigtstp_handler(int sig);
  */
 void sigint_handler(int sig);
 
+/**
+ * Signal handler for SIGWINCH (terminal resized)
+ * Sets window_resized so the prompt line is redrawn
+ */
+void sigwinch_handler(int sig);
+
 #endif /* SIGNALS_H */
@@ -19,6 +19,13 @@ int terminal_normal_mode(void);
 // Returns NULL on EOF, allocated string otherwise (caller must free)
 char* terminal_readline(const char *prompt);
 
+// Print complete lines above the line being edited and redraw it
+// (used for job and MCP notices; plain write outside terminal_readline)
+void terminal_print_above(const char *text, size_t len);
+
+// Redraw the line being edited (after the terminal was resized)
+void terminal_refresh(void);
+
 // Set completion function callback
 void terminal_set_completion_callback(char** (*callback)(const char *text, int *count));
 
@@ -28,4 +35,8 @@ void terminal_set_history_callbacks(
     const char* (*get_next)(void)
 );
 
+// Set fuzzy picker callback for Ctrl-T (files) and Alt-C (directories)
+// The callback returns an allocated path or NULL if the user cancelled
+void terminal_set_picker_callback(char* (*picker)(int want_dirs));
+
 #endif // TERMINAL_H
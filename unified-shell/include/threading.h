@@ -2,8 +2,11 @@
 #define THREADING_H
 
 #include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
 #include "builtins.h"
 #include "environment.h"
+#include "jobsched.h"
 
 /**
  * Thread context structure for executing built-in commands
@@ -24,6 +27,9 @@ typedef struct {
     int completed;           /* 1 when thread finishes, 0 otherwise */
     pthread_t thread_id;     /* Thread identifier */
     pthread_mutex_t lock;    /* Mutex for status access synchronization */
+    void (*task)(void *arg); /* Generic task run instead of func, or NULL */
+    void *task_arg;          /* Argument passed to task */
+    uint64_t queued_ns;      /* When it entered the pool queue (monotonic) */
 } BuiltinThreadContext;
 
 /**
@@ -101,22 +107,64 @@ int execute_builtin_threaded(builtin_func func, char **argv, Env *env);
  * THREAD POOL IMPLEMENTATION
  * ======================================================================== */
 
+/* Upper bound for any pool's worker count (size of the worker table) */
+#define THREAD_POOL_MAX_WORKERS 64
+
+/* Default limits of the shared pool */
+#define THREAD_POOL_DEFAULT_MAX 16        /* USHELL_THREAD_POOL_MAX */
+#define THREAD_POOL_DEFAULT_IDLE_MS 30000 /* USHELL_THREAD_POOL_IDLE (seconds) */
+#define THREAD_POOL_DEFAULT_GROW_MS 10    /* Queue wait that adds a worker */
+
+/* PoolWorker states */
+#define POOL_WORKER_FREE 0               /* Slot unused */
+#define POOL_WORKER_IDLE 1
+#define POOL_WORKER_BUSY 2
+
+/**
+ * Per-worker slot and counters
+ * 
+ * Times are nanoseconds. busy_ns and idle_ns cover the worker's life
+ * up to since_ns, the start of its current busy or idle period;
+ * wait_ns is how long the tasks it ran sat in the queue first.
+ */
+typedef struct {
+    struct ThreadPool *pool;         /* Owning pool */
+    pthread_t thread;
+    pid_t tid;                       /* Kernel thread ID, 0 until started */
+    int state;                       /* POOL_WORKER_* */
+    unsigned long tasks;             /* Tasks run */
+    uint64_t busy_ns;                /* Time running tasks */
+    uint64_t idle_ns;                /* Time waiting for work */
+    uint64_t wait_ns;                /* Queue wait of the tasks it ran */
+    uint64_t since_ns;               /* Start of the current period */
+} PoolWorker;
+
 /**
  * Thread pool structure for managing worker threads
  * 
- * A thread pool maintains a fixed number of worker threads that process
- * tasks from a queue. This is more efficient than creating a new thread
- * for each task, especially when tasks are short-lived.
+ * A thread pool keeps worker threads that process tasks from a queue.
+ * This is more efficient than creating a new thread for each task,
+ * especially when tasks are short-lived.
  * 
  * Features:
- * - Fixed number of worker threads (configurable at creation)
+ * - Elastic: starts with min_threads, adds workers (up to max_threads)
+ *   when a task has waited grow_wait_ms in the queue or a background
+ *   task finds no idle worker, and retires workers idle for
+ *   idle_timeout_ms while more than min_threads are left
  * - Work queue with mutex protection
  * - Condition variables for signaling work availability
+ * - Per-worker counters (thread_pool_stats, the pool builtin)
  * - Graceful shutdown mechanism
  */
-typedef struct {
-    pthread_t *threads;              /* Array of worker thread IDs */
-    int num_threads;                 /* Number of worker threads */
+typedef struct ThreadPool {
+    PoolWorker *workers;             /* THREAD_POOL_MAX_WORKERS slots */
+    int num_threads;                 /* Live workers */
+    int min_threads;                 /* Never shrink below */
+    int max_threads;                 /* Never grow above */
+    int idle_timeout_ms;             /* Retire a worker idle this long */
+    int grow_wait_ms;                /* Queue wait that adds a worker */
+    unsigned long grown;             /* Workers added after creation */
+    unsigned long shrunk;            /* Workers retired when idle */
     
     BuiltinThreadContext **queue;    /* Work queue (array of contexts) */
     int queue_size;                  /* Current number of items in queue */
@@ -125,18 +173,38 @@ typedef struct {
     int queue_rear;                  /* Rear index for enqueue */
     
     int shutdown;                    /* Shutdown flag (1 = shutting down) */
+    int busy_threads;                /* Workers running a task */
+    pid_t owner;                     /* Process the workers live in */
+    JobSched sched;                  /* jobctl --pool settings for new workers */
     
     pthread_mutex_t queue_mutex;     /* Protects queue access */
     pthread_cond_t work_available;   /* Signals work in queue */
     pthread_cond_t work_done;        /* Signals task completion */
 } ThreadPool;
 
+/**
+ * Pool-wide figures reported with the per-worker counters
+ */
+typedef struct {
+    int num_threads;
+    int min_threads;
+    int max_threads;
+    int busy_threads;
+    int queue_size;
+    int queue_capacity;
+    int idle_timeout_ms;
+    int grow_wait_ms;
+    unsigned long grown;
+    unsigned long shrunk;
+} ThreadPoolStats;
+
 /**
  * thread_pool_create - Create and initialize a thread pool
  * 
  * Allocates a thread pool, creates worker threads, and initializes
  * all synchronization primitives. Worker threads start immediately
- * and wait for work to be submitted.
+ * and wait for work to be submitted. The pool starts fixed-size
+ * (min = max = num_threads); thread_pool_set_limits makes it elastic.
  * 
  * @param num_threads: Number of worker threads to create
  * @param queue_capacity: Maximum number of pending tasks in queue
@@ -171,7 +239,9 @@ void thread_pool_destroy(ThreadPool *pool);
  * 4. Signals completion
  * 5. Repeats until shutdown flag is set
  * 
- * @param arg: Pointer to ThreadPool structure (cast from void*)
+ * An idle worker above min_threads exits after idle_timeout_ms.
+ * 
+ * @param arg: Pointer to the worker's PoolWorker slot (cast from void*)
  * @return: NULL (pthread convention)
  * 
  * Thread safety: Uses mutex and condition variables for safe access
@@ -183,8 +253,9 @@ void* thread_pool_worker(void *arg);
  * thread_pool_submit - Submit work to thread pool
  * 
  * Adds a task to the work queue. If queue is full, this function
- * waits (blocks) until space becomes available. A worker thread
- * will eventually pick up and execute this task.
+ * waits (blocks) until space becomes available, adding a worker if
+ * the wait reaches grow_wait_ms. A worker thread will eventually pick
+ * up and execute this task.
  * 
  * @param pool: Thread pool to submit work to
  * @param ctx: Thread context with built-in to execute
@@ -195,6 +266,95 @@ void* thread_pool_worker(void *arg);
  */
 int thread_pool_submit(ThreadPool *pool, BuiltinThreadContext *ctx);
 
+/**
+ * thread_pool_try_run - Run a task on an idle worker
+ * 
+ * Queues task(arg) only if a worker is free to start it right away, so a
+ * long-running task (a background job) never waits behind other work;
+ * when every worker is busy a new one is added, up to max_threads.
+ * Fails in a forked child, which has no copies of the workers. The pool
+ * owns the queue entry; the task owns arg.
+ * 
+ * @param pool: Thread pool to run on
+ * @param task: Function to call on the worker thread
+ * @param arg: Argument for task
+ * @return: 0 if the task was queued, -1 if no worker is idle and the
+ *          pool is at max_threads
+ */
+int thread_pool_try_run(ThreadPool *pool, void (*task)(void *arg), void *arg);
+
+/**
+ * thread_pool_shared - The shell's worker pool, created on first use
+ * 
+ * Returns g_thread_pool, creating it (USHELL_THREAD_POOL_SIZE workers,
+ * default 4) when USHELL_THREAD_BUILTINS did not already do so. It grows
+ * up to USHELL_THREAD_POOL_MAX workers (default 16) and shrinks back
+ * after USHELL_THREAD_POOL_IDLE seconds (default 30) idle. Call from the
+ * main thread only.
+ * 
+ * @return: Thread pool, or NULL if it could not be created
+ */
+ThreadPool* thread_pool_shared(void);
+
+/**
+ * thread_pool_tids - Kernel thread IDs of the pool's workers
+ * 
+ * Used to give the workers CPU affinity, scheduling class and I/O
+ * priority (jobctl --pool). Waits for workers still starting up.
+ * 
+ * @param pool: Thread pool
+ * @param tids: Array to fill
+ * @param max: Capacity of tids
+ * @return: Number of IDs stored, or -1 in a forked child
+ */
+int thread_pool_tids(ThreadPool *pool, pid_t *tids, int max);
+
+/**
+ * thread_pool_set_sched - Apply jobctl settings to every worker
+ * 
+ * Workers added later start with the same settings.
+ * 
+ * @return: 0 on success, -1 if any worker could not be changed (errno)
+ */
+int thread_pool_set_sched(ThreadPool *pool, const JobSched *sched);
+
+/**
+ * thread_pool_set_limits - Change the pool's elastic sizing
+ * 
+ * Values below 0 are left unchanged. Raising min starts workers at once;
+ * workers above a lowered max retire as soon as they are idle.
+ * 
+ * @param pool: Thread pool
+ * @param min: Minimum workers (1 - THREAD_POOL_MAX_WORKERS)
+ * @param max: Maximum workers (min - THREAD_POOL_MAX_WORKERS)
+ * @param idle_timeout_ms: Idle time before a worker above min retires
+ * @param grow_wait_ms: Queue wait that adds a worker
+ * @return: 0 on success, -1 if the values are out of range
+ */
+int thread_pool_set_limits(ThreadPool *pool, int min, int max, int idle_timeout_ms,
+                           int grow_wait_ms);
+
+/**
+ * thread_pool_stats - Snapshot of the pool and its live workers
+ * 
+ * Busy and idle times include the period in progress.
+ * 
+ * @param pool: Thread pool
+ * @param stats: Filled with pool-wide figures
+ * @param workers: Filled with up to max live workers (may be NULL)
+ * @param max: Capacity of workers
+ * @return: Number of workers stored, or -1 in a forked child
+ */
+int thread_pool_stats(ThreadPool *pool, ThreadPoolStats *stats, PoolWorker *workers, int max);
+
+/**
+ * thread_pool_reset_stats - Zero the per-worker and grow/shrink counters
+ */
+void thread_pool_reset_stats(ThreadPool *pool);
+
+/* Global pool (main.c); NULL until created */
+extern ThreadPool *g_thread_pool;
+
 /**
  * thread_pool_wait - Wait for all pending tasks to complete
  * 
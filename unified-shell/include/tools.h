@@ -9,20 +9,94 @@
  * into the shell as built-in commands.
  */
 
+#include <stdio.h>
+#include <signal.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include "environment.h"
+
+/**
+ * @brief Pause point shared between a tool and the job running it
+ *
+ * While paused is set, tool_cancelled() blocks until the job is resumed
+ * or cancelled, so stopping a thread job takes effect at the tool's next
+ * check.
+ */
+typedef struct tool_gate {
+    pthread_mutex_t lock;
+    pthread_cond_t resume;
+    int paused;
+} tool_gate;
+
+/**
+ * @brief Per-invocation state handed to every tool
+ *
+ * Tools keep no process-global state: they read from in, write to out and
+ * err, resolve relative paths against cwd_fd and poll tool_cancelled() in
+ * their loops. Each concurrent run (pipeline stage, MCP client thread,
+ * background job) gets its own context, so two tools can run in-process
+ * at the same time.
+ */
+typedef struct tool_ctx {
+    FILE *in;
+    FILE *out;
+    FILE *err;
+    int cwd_fd;                         // AT_FDCWD for the shell's directory
+    Env *env;                           // May be NULL
+    volatile sig_atomic_t *cancel;      // Non-zero asks the tool to stop
+    int cancel_fd;                      // Readable once cancelled, or -1
+    tool_gate *gate;                    // Pause point of a thread job, or NULL
+} tool_ctx;
+
 // Tool main function declarations
-int tool_myls_main(int argc, char **argv);
-int tool_mycat_main(int argc, char **argv);
-int tool_mycp_main(int argc, char **argv);
-int tool_mymv_main(int argc, char **argv);
-int tool_myrm_main(int argc, char **argv);
-int tool_mymkdir_main(int argc, char **argv);
-int tool_myrmdir_main(int argc, char **argv);
-int tool_mytouch_main(int argc, char **argv);
-int tool_mystat_main(int argc, char **argv);
-int tool_myfd_main(int argc, char **argv);
+int tool_myls_main(tool_ctx *ctx, int argc, char **argv);
+int tool_mycat_main(tool_ctx *ctx, int argc, char **argv);
+int tool_mycp_main(tool_ctx *ctx, int argc, char **argv);
+int tool_mymv_main(tool_ctx *ctx, int argc, char **argv);
+int tool_myrm_main(tool_ctx *ctx, int argc, char **argv);
+int tool_mymkdir_main(tool_ctx *ctx, int argc, char **argv);
+int tool_myrmdir_main(tool_ctx *ctx, int argc, char **argv);
+int tool_mytouch_main(tool_ctx *ctx, int argc, char **argv);
+int tool_mystat_main(tool_ctx *ctx, int argc, char **argv);
+int tool_myfd_main(tool_ctx *ctx, int argc, char **argv);
+int tool_mywatch_main(tool_ctx *ctx, int argc, char **argv);
+int tool_mytee_main(tool_ctx *ctx, int argc, char **argv);
 
 // Tool dispatch system
-typedef int (*tool_func)(int argc, char **argv);
+typedef int (*tool_func)(tool_ctx *ctx, int argc, char **argv);
 tool_func find_tool(const char *name);
 
+/**
+ * @brief Context for a run in the shell itself: stdio, the shell's
+ * directory, and Ctrl+C (sigint_received) as the cancellation flag
+ */
+void tool_ctx_init(tool_ctx *ctx, Env *env);
+
+/**
+ * @brief Run a tool in the foreground of the shell
+ * @return Tool status, or 130 if it was cancelled with Ctrl+C
+ */
+int tool_run(tool_func tool, char **argv, Env *env);
+
+/**
+ * @brief Non-zero once the tool has been asked to stop
+ *
+ * Also the point where a stopped thread job waits to be resumed.
+ */
+int tool_cancelled(const tool_ctx *ctx);
+
+// Path helpers resolving relative paths against ctx->cwd_fd
+int tool_open(const tool_ctx *ctx, const char *path, int flags, mode_t mode);
+FILE *tool_fopen_read(const tool_ctx *ctx, const char *path);
+DIR *tool_opendir(const tool_ctx *ctx, const char *path);
+char *tool_realpath(const tool_ctx *ctx, const char *path, char *resolved);
+
+// Directory traversal shared with other tools (see myfd.c)
+// Callback returns non-zero to stop the walk early
+typedef int (*myfd_dir_callback)(const char *dir_path, void *arg);
+int myfd_walk_dirs(const char *root, int show_hidden, myfd_dir_callback cb, void *arg);
+typedef int (*myfd_entry_callback)(const char *path, int is_dir, void *arg);
+int myfd_walk_entries(const char *root, int show_hidden, myfd_entry_callback cb, void *arg);
+
 #endif // TOOLS_H
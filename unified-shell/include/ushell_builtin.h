@@ -0,0 +1,44 @@
+#ifndef USHELL_BUILTIN_H
+#define USHELL_BUILTIN_H
+
+/**
+ * @file ushell_builtin.h
+ * @brief Interface for loadable builtins (enable -f lib.so name)
+ *
+ * A plugin is a shared object exporting one descriptor per command, named
+ * NAME_ushell_builtin (or plain ushell_builtin for a single command):
+ *
+ *   #include "ushell_builtin.h"
+ *
+ *   static int hello(int argc, char **argv) {
+ *       printf("hello %s\n", argc > 1 ? argv[1] : "world");
+ *       return 0;
+ *   }
+ *
+ *   const struct ushell_builtin hello_ushell_builtin = {
+ *       .abi_version = USHELL_BUILTIN_ABI,
+ *       .name = "hello",
+ *       .summary = "Print a greeting",
+ *       .func = hello,
+ *   };
+ *
+ * Build with: gcc -shared -fPIC -Iinclude -o hello.so hello.c
+ *
+ * The command runs inside the shell process (in a forked child when it is
+ * a pipeline stage), so it must not call exit() and should leave global
+ * state such as the current directory and signal handlers alone.
+ */
+
+// Bumped whenever struct ushell_builtin changes incompatibly
+#define USHELL_BUILTIN_ABI 1
+
+struct ushell_builtin {
+    unsigned int abi_version;       // USHELL_BUILTIN_ABI at build time
+    const char *name;               // Command name
+    const char *summary;            // One line for 'enable' listings, or NULL
+    int (*func)(int argc, char **argv);     // Returns the exit status
+    int (*load)(void);              // Optional: non-zero refuses the load
+    void (*unload)(void);           // Optional: called before dlclose
+};
+
+#endif // USHELL_BUILTIN_H
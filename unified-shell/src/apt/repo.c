@@ -32,6 +32,8 @@
  */
 
 #include "apt.h"
+#include "intern.h"
+#include "memstats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -51,8 +53,9 @@
  * Initialized by apt_load_index()
  */
 PackageIndex g_package_index = {
-    .packages = {{0}},
-    .count = 0
+    .packages = NULL,
+    .count = 0,
+    .capacity = 0
 };
 
 /*
@@ -407,6 +410,14 @@ int apt_is_initialized(void) {
  * Index Management Functions
  * ============================================================================ */
 
+/*
+ * apt_intern_field - Intern at most limit - 1 bytes of value
+ */
+static const char *apt_intern_field(const char *value, size_t limit) {
+    const char *interned = intern_n(value, strnlen(value, limit - 1));
+    return interned ? interned : "";
+}
+
 /**
  * apt_parse_package_entry - Parse a single package entry from index file
  * 
@@ -424,6 +435,8 @@ int apt_parse_package_entry(FILE *fp, Package *pkg) {
     
     /* Initialize package structure */
     memset(pkg, 0, sizeof(Package));
+    pkg->name = pkg->version = pkg->description = "";
+    pkg->filename = pkg->dependencies = "";
     
     /* Read lines until blank line or EOF */
     while (fgets(line, sizeof(line), fp) != NULL) {
@@ -455,16 +468,16 @@ int apt_parse_package_entry(FILE *fp, Package *pkg) {
         
         /* Store value based on key */
         if (strcmp(key, "PackageName") == 0) {
-            strncpy(pkg->name, value, APT_NAME_LEN - 1);
+            pkg->name = apt_intern_field(value, APT_NAME_LEN);
             found_data = 1;
         } else if (strcmp(key, "Version") == 0) {
-            strncpy(pkg->version, value, APT_VERSION_LEN - 1);
+            pkg->version = apt_intern_field(value, APT_VERSION_LEN);
         } else if (strcmp(key, "Description") == 0) {
-            strncpy(pkg->description, value, APT_DESC_LEN - 1);
+            pkg->description = apt_intern_field(value, APT_DESC_LEN);
         } else if (strcmp(key, "Filename") == 0) {
-            strncpy(pkg->filename, value, APT_FILENAME_LEN - 1);
+            pkg->filename = apt_intern_field(value, APT_FILENAME_LEN);
         } else if (strcmp(key, "Depends") == 0) {
-            strncpy(pkg->dependencies, value, APT_DEPS_LEN - 1);
+            pkg->dependencies = apt_intern_field(value, APT_DEPS_LEN);
         }
     }
     
@@ -539,6 +552,22 @@ int apt_load_index(void) {
             break;
         }
         
+        /* Grow the index (kept across reloads) */
+        if (g_package_index.count == g_package_index.capacity) {
+            int cap = g_package_index.capacity ? g_package_index.capacity * 2 : 16;
+            if (cap > APT_MAX_PACKAGES) {
+                cap = APT_MAX_PACKAGES;
+            }
+            Package *grown = mem_realloc(MEM_APT, g_package_index.packages,
+                                         cap * sizeof(Package));
+            if (grown == NULL) {
+                fprintf(stderr, "apt: out of memory loading index\n");
+                break;
+            }
+            g_package_index.packages = grown;
+            g_package_index.capacity = cap;
+        }
+        
         /* Copy package to index */
         memcpy(&g_package_index.packages[g_package_index.count], &pkg, sizeof(Package));
         g_package_index.count++;
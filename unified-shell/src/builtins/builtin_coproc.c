@@ -0,0 +1,196 @@
+/**
+ * builtin_coproc.c - coproc (start a command with two-way pipes)
+ *
+ * Usage: coproc [NAME] COMMAND [ARG...]
+ *
+ * The command runs as a background job with its stdin and stdout
+ * connected to the shell through two pipes. ${NAME[0]} is the descriptor
+ * to read its output from, ${NAME[1]} the one to write its input to, and
+ * NAME_PID its process ID (NAME defaults to COPROC). One long-lived
+ * filter can then answer any number of requests:
+ *
+ *   coproc CALC bc -l
+ *   echo "2^64" >&${CALC[1]}
+ *   read -u ${CALC[0]} answer
+ *
+ * Both descriptors are close-on-exec: redirections (>&N, <&N) and
+ * read -u reach them, while unrelated commands do not keep the pipes
+ * open. Closing ${NAME[1]} (exec N>&-) sends the coprocess end of input.
+ */
+
+#define _GNU_SOURCE // pipe2
+
+#include "builtins.h"
+#include "help.h"
+#include "jobs.h"
+#include "script.h"
+#include "tools.h"
+#include "procsub.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+
+#define COPROC_DEFAULT_NAME "COPROC"
+
+static int is_name(const char *s) {
+    if (!(isalpha((unsigned char)*s) || *s == '_')) {
+        return 0;
+    }
+    for (; *s; s++) {
+        if (!(isalnum((unsigned char)*s) || *s == '_')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Whether word runs something: function, builtin, tool or program in PATH
+ */
+static int is_command(const char *word) {
+    if (script_has_function(word) || find_builtin(word) != NULL || find_tool(word) != NULL) {
+        return 1;
+    }
+    const char *path = getenv("PATH");
+    while (path != NULL && *path) {
+        const char *colon = strchr(path, ':');
+        size_t len = colon ? (size_t)(colon - path) : strlen(path);
+        char candidate[PATH_MAX];
+        if (snprintf(candidate, sizeof(candidate), "%.*s/%s",
+                     (int)len, len ? path : ".", word) < (int)sizeof(candidate) &&
+            access(candidate, X_OK) == 0) {
+            return 1;
+        }
+        path = colon ? colon + 1 : NULL;
+    }
+    return 0;
+}
+
+/**
+ * Child side: stdin/stdout are the pipes; run the command, never return
+ */
+static void coproc_child(char **argv, Env *env) {
+    setpgid(0, 0);  // A background job of its own
+
+    if (script_has_function(argv[0])) {
+        script_enter_forked_subshell();
+        int ret = script_call_function(argv, env);
+        fflush(NULL);
+        _exit(ret < 0 ? 1 : ret);
+    }
+    builtin_func builtin = find_builtin(argv[0]);
+    if (builtin != NULL) {
+        script_enter_forked_subshell();
+        int ret = builtin(argv, env);
+        fflush(NULL);
+        _exit(ret);
+    }
+    tool_func tool = find_tool(argv[0]);
+    if (tool != NULL) {
+        int ret = tool_run(tool, argv, env);
+        fflush(NULL);
+        _exit(ret);
+    }
+    execvp(argv[0], argv);
+    fprintf(stderr, "coproc: %s: %s\n", argv[0],
+            errno == ENOENT ? "command not found" : strerror(errno));
+    _exit(127);
+}
+
+/**
+ * coproc - Start a command connected to the shell by two pipes
+ */
+int builtin_coproc(char **argv, Env *env) {
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+
+    if (check_help_flag(argc, argv)) {
+        const HelpEntry *help = get_help_entry("coproc");
+        if (help) {
+            print_help(help);
+            return 0;
+        }
+    }
+
+    // coproc NAME CMD... names it; a single word is always the command
+    const char *name = COPROC_DEFAULT_NAME;
+    int first = 1;
+    if (argc > 2 && is_name(argv[1]) && !is_command(argv[1])) {
+        name = argv[1];
+        first = 2;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "Usage: coproc [NAME] COMMAND [ARG...]\n");
+        return 2;
+    }
+
+    int to_co[2], from_co[2];
+    if (pipe2(to_co, O_CLOEXEC) < 0) {
+        perror("coproc: pipe");
+        return 1;
+    }
+    if (pipe2(from_co, O_CLOEXEC) < 0) {
+        perror("coproc: pipe");
+        close(to_co[0]);
+        close(to_co[1]);
+        return 1;
+    }
+
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("coproc: fork");
+        close(to_co[0]);
+        close(to_co[1]);
+        close(from_co[0]);
+        close(from_co[1]);
+        return 1;
+    }
+    if (pid == 0) {
+        dup2(to_co[0], STDIN_FILENO);
+        dup2(from_co[1], STDOUT_FILENO);
+        close(to_co[0]);
+        close(to_co[1]);
+        close(from_co[0]);
+        close(from_co[1]);
+        procsub_child_close(argv + first);
+        coproc_child(argv + first, env);
+    }
+    setpgid(pid, pid);
+    close(to_co[0]);
+    close(from_co[1]);
+
+    // ${NAME[0]} reads from the coprocess, ${NAME[1]} writes to it
+    char **fds = malloc(2 * sizeof(char *));
+    if (fds != NULL) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%d", from_co[0]);
+        fds[0] = strdup(buf);
+        snprintf(buf, sizeof(buf), "%d", to_co[1]);
+        fds[1] = strdup(buf);
+        env_array_assign(env, name, fds, 2);
+    }
+    char pid_var[256];
+    char pid_str[16];
+    snprintf(pid_var, sizeof(pid_var), "%s_PID", name);
+    snprintf(pid_str, sizeof(pid_str), "%d", (int)pid);
+    env_set(env, pid_var, pid_str);
+
+    char cmd_line[MAX_CMD_LEN];
+    int offset = snprintf(cmd_line, sizeof(cmd_line), "coproc %s", name);
+    for (int i = first; argv[i] != NULL && offset < (int)sizeof(cmd_line); i++) {
+        offset += snprintf(cmd_line + offset, sizeof(cmd_line) - offset, " %s", argv[i]);
+    }
+    int job_id = jobs_add(pid, cmd_line, 1);
+    if (job_id > 0) {
+        printf("[%d] %d\n", job_id, (int)pid);
+        fflush(stdout);
+        jobs_apply_policy(job_id, env_get(env, "USHELL_BG_POLICY"));
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+/**
+ * builtin_enable.c - enable (load builtins from shared objects)
+ *
+ * Usage: enable -f FILE NAME...
+ *        enable -d NAME...
+ *        enable [-p]
+ *
+ * -f loads each NAME from FILE (see ushell_builtin.h); from then on NAME
+ * runs inside the shell like a compiled-in builtin. -d unloads. With no
+ * options the loaded commands are listed with call counts and timing.
+ */
+
+#include "builtins.h"
+#include "plugins.h"
+#include "help.h"
+#include <stdio.h>
+#include <string.h>
+
+#define ENABLE_USAGE "Usage: enable -f FILE NAME... | enable -d NAME... | enable [-p]\n"
+
+/**
+ * enable - Load or unload builtins
+ */
+int builtin_enable(char **argv, Env *env) {
+    (void)env;  // Unused
+
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+
+    if (check_help_flag(argc, argv)) {
+        const HelpEntry *help = get_help_entry("enable");
+        if (help) {
+            print_help(help);
+            return 0;
+        }
+    }
+
+    if (argc == 1 || (argc == 2 && strcmp(argv[1], "-p") == 0)) {
+        plugin_print(stdout);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "-f") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, "enable: -f needs a file and at least one name\n");
+            fprintf(stderr, ENABLE_USAGE);
+            return 2;
+        }
+        int status = 0;
+        for (int i = 3; i < argc; i++) {
+            char err[512];
+            if (plugin_load(argv[2], argv[i], err, sizeof(err)) < 0) {
+                fprintf(stderr, "enable: %s\n", err);
+                status = 1;
+            }
+        }
+        return status;
+    }
+
+    if (strcmp(argv[1], "-d") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, ENABLE_USAGE);
+            return 2;
+        }
+        int status = 0;
+        for (int i = 2; i < argc; i++) {
+            if (plugin_unload(argv[i]) < 0) {
+                fprintf(stderr, "enable: %s: not a loaded builtin\n", argv[i]);
+                status = 1;
+            }
+        }
+        return status;
+    }
+
+    fprintf(stderr, "enable: %s: invalid option\n", argv[1]);
+    fprintf(stderr, ENABLE_USAGE);
+    return 2;
+}
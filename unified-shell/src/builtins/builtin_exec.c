@@ -0,0 +1,78 @@
+/**
+ * builtin_exec.c - exec (replace the shell with a command)
+ *
+ * Usage: exec [-c] [-a NAME] [COMMAND [ARG...]]
+ *
+ * With a command, the shell process becomes that program; redirections
+ * on the line are already in place when it starts. Without a command,
+ * the redirections themselves stay in effect for the rest of the session
+ * (exec 2>errors.log, exec 3<input) - execute_pipeline applies those before
+ * this builtin is reached.
+ */
+
+#define _GNU_SOURCE
+#include "builtins.h"
+#include "help.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+extern char **environ;
+
+/**
+ * exec - Replace the shell with a command
+ */
+int builtin_exec(char **argv, Env *env) {
+    (void)env;  // Exported variables are already in the process environment
+
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+
+    if (check_help_flag(argc, argv)) {
+        const HelpEntry *help = get_help_entry("exec");
+        if (help) {
+            print_help(help);
+            return 0;
+        }
+    }
+
+    int clear_env = 0;
+    const char *name = NULL;
+    int i = 1;
+    for (; argv[i] != NULL && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        if (strcmp(argv[i], "--") == 0) {
+            i++;
+            break;
+        } else if (strcmp(argv[i], "-c") == 0) {
+            clear_env = 1;
+        } else if (strcmp(argv[i], "-a") == 0 && argv[i + 1] != NULL) {
+            name = argv[++i];
+        } else {
+            fprintf(stderr, "exec: %s: invalid option\n", argv[i]);
+            fprintf(stderr, "Usage: exec [-c] [-a NAME] [COMMAND [ARG...]]\n");
+            return 2;
+        }
+    }
+
+    // Redirection-only form: nothing left to run
+    if (argv[i] == NULL) {
+        return 0;
+    }
+
+    char **args = argv + i;
+    const char *path = args[0];
+    if (name != NULL) {
+        args[0] = (char *)name;
+    }
+
+    static char *empty_env[] = { NULL };
+    fflush(NULL);
+    execvpe(path, args, clear_env ? empty_env : environ);
+
+    int err = errno;
+    args[0] = (char *)path;
+    fprintf(stderr, "exec: %s: %s\n", path, err == ENOENT ? "not found" : strerror(err));
+    return err == ENOENT ? 127 : 126;
+}
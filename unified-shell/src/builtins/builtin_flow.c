@@ -0,0 +1,122 @@
+/**
+ * builtin_flow.c - break, continue and return
+ *
+ * These only record a request with the script interpreter (script.c);
+ * the enclosing loop or function call acts on it once the current
+ * command returns.
+ */
+
+#include "builtins.h"
+#include "script.h"
+#include "conditional.h"
+#include "help.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+/**
+ * Show help for "NAME --help"; returns 1 if help was printed
+ */
+static int flow_help(char **argv) {
+    if (argv[1] != NULL && argv[2] == NULL && strcmp(argv[1], "--help") == 0) {
+        const HelpEntry *help = get_help_entry(argv[0]);
+        if (help) {
+            print_help(help);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Parse the optional numeric argument; returns -1 if it is not a number
+ */
+static int flow_count(const char *name, const char *arg, int fallback) {
+    if (arg == NULL) {
+        return fallback;
+    }
+    const char *p = arg;
+    if (*p == '-') {
+        p++;
+    }
+    if (*p == '\0') {
+        fprintf(stderr, "%s: %s: numeric argument required\n", name, arg);
+        return -1;
+    }
+    for (; *p; p++) {
+        if (!isdigit((unsigned char)*p)) {
+            fprintf(stderr, "%s: %s: numeric argument required\n", name, arg);
+            return -1;
+        }
+    }
+    return atoi(arg);
+}
+
+/**
+ * break - Exit from a for, while or until loop
+ * Usage: break [N]
+ */
+int builtin_break(char **argv, Env *env) {
+    (void)env;  // Unused
+
+    if (flow_help(argv)) {
+        return 0;
+    }
+    int levels = flow_count("break", argv[1], 1);
+    if (levels < 1) {
+        if (levels == 0) {
+            fprintf(stderr, "break: loop count out of range\n");
+        }
+        return 1;
+    }
+    if (script_request_break(levels) < 0) {
+        fprintf(stderr, "break: only meaningful in a for, while or until loop\n");
+    }
+    return 0;
+}
+
+/**
+ * continue - Resume the next iteration of a for, while or until loop
+ * Usage: continue [N]
+ */
+int builtin_continue(char **argv, Env *env) {
+    (void)env;  // Unused
+
+    if (flow_help(argv)) {
+        return 0;
+    }
+    int levels = flow_count("continue", argv[1], 1);
+    if (levels < 1) {
+        if (levels == 0) {
+            fprintf(stderr, "continue: loop count out of range\n");
+        }
+        return 1;
+    }
+    if (script_request_continue(levels) < 0) {
+        fprintf(stderr, "continue: only meaningful in a for, while or until loop\n");
+    }
+    return 0;
+}
+
+/**
+ * return - Return from a shell function
+ * Usage: return [N]
+ */
+int builtin_return(char **argv, Env *env) {
+    (void)env;  // Unused
+
+    if (flow_help(argv)) {
+        return 0;
+    }
+    int status = flow_count("return", argv[1], last_exit_status);
+    if (argv[1] != NULL && status == -1 && strcmp(argv[1], "-1") != 0) {
+        return 2;
+    }
+    status &= 0xff;
+    if (script_request_return(status) < 0) {
+        fprintf(stderr, "return: can only `return' from a function\n");
+        return 1;
+    }
+    return status;
+}
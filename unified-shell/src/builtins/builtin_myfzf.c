@@ -0,0 +1,778 @@
+/**
+ * builtin_myfzf.c - Interactive fuzzy finder built-in
+ *
+ * myfzf reads candidate lines from stdin, a myfd directory walk, the
+ * command history or the completion command list, stores them in an
+ * arena (see fuzzy.h) and lets the user narrow them down interactively.
+ * The selected line is printed to stdout.
+ *
+ * Input streams in while the user types: the candidate source is polled
+ * together with the terminal, new candidates are scored as they arrive
+ * and the visible list (the top-K heap) is redrawn on every keystroke.
+ * Directory walks run in a producer thread that writes paths into a
+ * socketpair, so a huge tree never blocks the UI.
+ *
+ * The UI is drawn directly below the cursor on /dev/tty, so myfzf works
+ * at the end of a pipeline (myfd | myfzf) and from inside
+ * terminal_readline (Ctrl-T / Alt-C via myfzf_pick()).
+ *
+ * Exit status: 0 = selection printed, 1 = no match, 2 = error,
+ * 130 = cancelled with Esc or Ctrl+C.
+ */
+
+#include "builtins.h"
+#include "fuzzy.h"
+#include "tools.h"
+#include "history.h"
+#include "completion.h"
+#include "terminal.h"
+#include "help.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#define MYFZF_READ_CHUNK (256 * 1024)
+#define MYFZF_DEFAULT_HEIGHT 15
+#define MYFZF_REDRAW_MS 50
+
+typedef enum {
+    FZF_SOURCE_STDIN,
+    FZF_SOURCE_FILES,
+    FZF_SOURCE_DIRS,
+    FZF_SOURCE_HISTORY,
+    FZF_SOURCE_COMMANDS
+} FzfSource;
+
+// Producer thread state for directory walks
+typedef struct {
+    char root[1024];
+    int dirs_only;
+    int show_hidden;
+    int fd;                 // Write end of the socketpair
+    char buf[64 * 1024];
+    size_t used;
+    int failed;
+} FzfProducer;
+
+// One finder session
+typedef struct {
+    FuzzySet set;
+    FuzzyResult res;
+    char query[FUZZY_MAX_QUERY + 1];
+    size_t query_len;
+    int selected;
+
+    int in_fd;              // Streaming candidate source, -1 when done
+    int close_in_fd;        // Whether in_fd belongs to us
+    char *carry;            // Partial line from the previous read
+    size_t carry_len;
+    size_t carry_cap;
+
+    FzfProducer *producer;
+    pthread_t producer_thread;
+    int producer_running;
+
+    int tty_fd;
+    int height;
+    int cols;
+} Finder;
+
+// --- Candidate Ingestion ---
+
+static void finder_add_line(Finder *f, const char *line, size_t len) {
+    if (len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+    if (len > 0) {
+        fuzzy_set_add(&f->set, line, len);
+    }
+}
+
+/**
+ * Split a chunk of input into lines, keeping any unterminated tail.
+ */
+static void finder_feed(Finder *f, const char *data, size_t n) {
+    const char *p = data;
+    const char *end = data + n;
+
+    while (p < end) {
+        const char *nl = memchr(p, '\n', end - p);
+        if (nl == NULL) {
+            size_t tail = end - p;
+            if (f->carry_len + tail > f->carry_cap) {
+                size_t cap = (f->carry_len + tail) * 2;
+                char *grown = realloc(f->carry, cap);
+                if (grown == NULL) {
+                    return;
+                }
+                f->carry = grown;
+                f->carry_cap = cap;
+            }
+            memcpy(f->carry + f->carry_len, p, tail);
+            f->carry_len += tail;
+            return;
+        }
+
+        if (f->carry_len > 0) {
+            size_t part = nl - p;
+            if (f->carry_len + part > f->carry_cap) {
+                size_t cap = (f->carry_len + part) * 2;
+                char *grown = realloc(f->carry, cap);
+                if (grown == NULL) {
+                    return;
+                }
+                f->carry = grown;
+                f->carry_cap = cap;
+            }
+            memcpy(f->carry + f->carry_len, p, part);
+            finder_add_line(f, f->carry, f->carry_len + part);
+            f->carry_len = 0;
+        } else {
+            finder_add_line(f, p, nl - p);
+        }
+        p = nl + 1;
+    }
+}
+
+/**
+ * Read whatever is available from the source.
+ * Returns 1 if candidates were added, 0 otherwise.
+ */
+static int finder_read_input(Finder *f, int blocking) {
+    static char chunk[MYFZF_READ_CHUNK];
+    size_t before = f->set.count;
+
+    while (f->in_fd >= 0) {
+        ssize_t n = read(f->in_fd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            // EOF: flush the last unterminated line
+            if (f->carry_len > 0) {
+                finder_add_line(f, f->carry, f->carry_len);
+                f->carry_len = 0;
+            }
+            if (f->close_in_fd) {
+                close(f->in_fd);
+            }
+            f->in_fd = -1;
+            break;
+        }
+        finder_feed(f, chunk, (size_t)n);
+        if (!blocking) {
+            break;  // Give the UI a chance to respond between chunks
+        }
+    }
+    return f->set.count != before;
+}
+
+static int producer_flush(FzfProducer *p) {
+    size_t off = 0;
+    while (off < p->used) {
+        // send() with MSG_NOSIGNAL: a closed finder must not SIGPIPE the shell
+        ssize_t n = send(p->fd, p->buf + off, p->used - off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            p->failed = 1;
+            return -1;
+        }
+        off += n;
+    }
+    p->used = 0;
+    return 0;
+}
+
+static int producer_entry(const char *path, int is_dir, void *arg) {
+    FzfProducer *p = (FzfProducer *)arg;
+    if (p->dirs_only && !is_dir) {
+        return 0;
+    }
+
+    // Show paths relative to "." without the leading "./"
+    if (strcmp(p->root, ".") == 0 && strncmp(path, "./", 2) == 0) {
+        path += 2;
+    }
+
+    size_t len = strlen(path);
+    if (p->used + len + 1 > sizeof(p->buf) && producer_flush(p) != 0) {
+        return 1;
+    }
+    if (len + 1 > sizeof(p->buf)) {
+        return 0;
+    }
+    memcpy(p->buf + p->used, path, len);
+    p->buf[p->used + len] = '\n';
+    p->used += len + 1;
+    return 0;
+}
+
+static void *producer_main(void *arg) {
+    FzfProducer *p = (FzfProducer *)arg;
+    myfd_walk_entries(p->root, p->show_hidden, producer_entry, p);
+    if (!p->failed) {
+        producer_flush(p);
+    }
+    close(p->fd);
+    return NULL;
+}
+
+/**
+ * Start the candidate source. Streaming sources set f->in_fd.
+ */
+static int finder_open_source(Finder *f, FzfSource source, const char *root, int show_hidden) {
+    f->in_fd = -1;
+
+    switch (source) {
+        case FZF_SOURCE_STDIN:
+            f->in_fd = STDIN_FILENO;
+            f->close_in_fd = 0;
+            return 0;
+
+        case FZF_SOURCE_FILES:
+        case FZF_SOURCE_DIRS: {
+            int sv[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0) {
+                perror("myfzf: socketpair");
+                return -1;
+            }
+            FzfProducer *p = calloc(1, sizeof(FzfProducer));
+            if (p == NULL) {
+                close(sv[0]);
+                close(sv[1]);
+                return -1;
+            }
+            snprintf(p->root, sizeof(p->root), "%s", root);
+            p->dirs_only = (source == FZF_SOURCE_DIRS);
+            p->show_hidden = show_hidden;
+            p->fd = sv[1];
+            if (pthread_create(&f->producer_thread, NULL, producer_main, p) != 0) {
+                close(sv[0]);
+                close(sv[1]);
+                free(p);
+                return -1;
+            }
+            f->producer = p;
+            f->producer_running = 1;
+            f->in_fd = sv[0];
+            f->close_in_fd = 1;
+            return 0;
+        }
+
+        case FZF_SOURCE_HISTORY: {
+            // Most recent first
+            int count = history_count();
+            for (int i = 0; i < count; i++) {
+                const char *entry = history_get(i);
+                if (entry != NULL) {
+                    fuzzy_set_add(&f->set, entry, strlen(entry));
+                }
+            }
+            return 0;
+        }
+
+        case FZF_SOURCE_COMMANDS: {
+            int count = 0;
+            char **commands = completion_get_commands(&count);
+            for (int i = 0; i < count; i++) {
+                fuzzy_set_add(&f->set, commands[i], strlen(commands[i]));
+            }
+            completion_free(commands);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static void finder_close_source(Finder *f) {
+    if (f->in_fd >= 0 && f->close_in_fd) {
+        close(f->in_fd);  // Producer's next send() fails and the walk stops
+    }
+    f->in_fd = -1;
+    if (f->producer_running) {
+        pthread_join(f->producer_thread, NULL);
+        free(f->producer);
+        f->producer = NULL;
+        f->producer_running = 0;
+    }
+}
+
+static void finder_init(Finder *f, size_t k) {
+    memset(f, 0, sizeof(*f));
+    fuzzy_set_init(&f->set);
+    fuzzy_result_init(&f->res, k);
+    f->in_fd = -1;
+    f->tty_fd = -1;
+}
+
+static void finder_free(Finder *f) {
+    finder_close_source(f);
+    fuzzy_result_free(&f->res);
+    fuzzy_set_free(&f->set);
+    free(f->carry);
+}
+
+static void finder_search(Finder *f) {
+    fuzzy_search(&f->set, f->query, &f->res, 0);
+    fuzzy_result_sort(&f->set, &f->res);
+    if (f->selected >= (int)f->res.top_count) {
+        f->selected = f->res.top_count > 0 ? (int)f->res.top_count - 1 : 0;
+    }
+}
+
+// --- Terminal UI ---
+
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} OutBuf;
+
+static void out_append(OutBuf *b, const char *s, size_t n) {
+    if (b->len + n > b->cap) {
+        size_t cap = (b->len + n) * 2;
+        char *grown = realloc(b->data, cap);
+        if (grown == NULL) {
+            return;
+        }
+        b->data = grown;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+}
+
+static void out_str(OutBuf *b, const char *s) {
+    out_append(b, s, strlen(s));
+}
+
+/**
+ * Redraw the finder below the saved cursor position in one write().
+ */
+static void finder_render(Finder *f) {
+    OutBuf b = {0};
+    char tmp[64];
+
+    out_str(&b, "\x1b" "8\x1b[J");
+    out_str(&b, "> ");
+    out_append(&b, f->query, f->query_len);
+    out_str(&b, "\r\n");
+
+    snprintf(tmp, sizeof(tmp), "\x1b[2m  %zu/%zu%s\x1b[0m", f->res.total_matches, f->set.count,
+             f->in_fd >= 0 ? " ..." : "");
+    out_str(&b, tmp);
+
+    int rows = f->height - 2;
+    for (int i = 0; i < rows && i < (int)f->res.top_count; i++) {
+        const FuzzyCandidate *cand = &f->set.items[f->res.top[i].index];
+        size_t width = f->cols > 3 ? (size_t)f->cols - 3 : 1;
+        size_t len = cand->len < width ? cand->len : width;
+
+        out_str(&b, "\r\n");
+        out_str(&b, i == f->selected ? "\x1b[7m> " : "  ");
+        out_append(&b, cand->text, len);
+        if (i == f->selected) {
+            out_str(&b, "\x1b[0m");
+        }
+    }
+
+    // Leave the cursor after the query
+    out_str(&b, "\x1b" "8");
+    snprintf(tmp, sizeof(tmp), "\x1b[%zuC", f->query_len + 2);
+    out_str(&b, tmp);
+
+    if (b.data != NULL) {
+        ssize_t ignored = write(f->tty_fd, b.data, b.len);
+        (void)ignored;
+        free(b.data);
+    }
+}
+
+/**
+ * Make room for the UI below the cursor and remember where it starts.
+ */
+static void finder_reserve(Finder *f) {
+    char seq[64];
+    for (int i = 0; i < f->height - 1; i++) {
+        ssize_t ignored = write(f->tty_fd, "\n", 1);
+        (void)ignored;
+    }
+    int n = snprintf(seq, sizeof(seq), "\x1b[%dA\r\x1b" "7", f->height - 1);
+    ssize_t ignored = write(f->tty_fd, seq, n);
+    (void)ignored;
+}
+
+static void finder_clear(Finder *f) {
+    ssize_t ignored = write(f->tty_fd, "\x1b" "8\x1b[J", 5);
+    (void)ignored;
+}
+
+// Key results
+#define KEY_NONE    0
+#define KEY_ACCEPT  1
+#define KEY_CANCEL  2
+#define KEY_CHANGED 3   // Query changed
+#define KEY_MOVED   4   // Selection changed
+
+static int finder_key(Finder *f) {
+    unsigned char c;
+    if (read(f->tty_fd, &c, 1) != 1) {
+        return KEY_CANCEL;
+    }
+
+    switch (c) {
+        case '\r':
+        case '\n':
+            return KEY_ACCEPT;
+        case 3:     // Ctrl+C
+        case 7:     // Ctrl+G
+            return KEY_CANCEL;
+        case 4:     // Ctrl+D
+            return f->query_len == 0 ? KEY_CANCEL : KEY_NONE;
+        case 127:
+        case 8:
+            if (f->query_len == 0) {
+                return KEY_NONE;
+            }
+            f->query[--f->query_len] = '\0';
+            return KEY_CHANGED;
+        case 21:    // Ctrl+U
+            f->query_len = 0;
+            f->query[0] = '\0';
+            return KEY_CHANGED;
+        case 23:    // Ctrl+W
+            while (f->query_len > 0 && f->query[f->query_len - 1] == ' ') {
+                f->query_len--;
+            }
+            while (f->query_len > 0 && f->query[f->query_len - 1] != ' ') {
+                f->query_len--;
+            }
+            f->query[f->query_len] = '\0';
+            return KEY_CHANGED;
+        case 14:    // Ctrl+N
+            f->selected++;
+            return KEY_MOVED;
+        case 16:    // Ctrl+P
+        case 11:    // Ctrl+K
+            f->selected--;
+            return KEY_MOVED;
+        case 27: {
+            // Lone Esc cancels; arrow keys arrive as ESC [ A/B
+            struct pollfd pfd = { .fd = f->tty_fd, .events = POLLIN };
+            if (poll(&pfd, 1, 30) <= 0) {
+                return KEY_CANCEL;
+            }
+            unsigned char seq[2];
+            if (read(f->tty_fd, &seq[0], 1) != 1 || seq[0] != '[') {
+                return KEY_NONE;
+            }
+            if (read(f->tty_fd, &seq[1], 1) != 1) {
+                return KEY_NONE;
+            }
+            if (seq[1] == 'A') {
+                f->selected--;
+                return KEY_MOVED;
+            }
+            if (seq[1] == 'B') {
+                f->selected++;
+                return KEY_MOVED;
+            }
+            return KEY_NONE;
+        }
+        default:
+            if (c >= 32 && f->query_len < FUZZY_MAX_QUERY) {
+                f->query[f->query_len++] = (char)c;
+                f->query[f->query_len] = '\0';
+                return KEY_CHANGED;
+            }
+            return KEY_NONE;
+    }
+}
+
+/**
+ * Run the interactive loop on f->tty_fd.
+ * @return Selected candidate (points into the set) or NULL if cancelled.
+ */
+static const char *finder_interactive(Finder *f) {
+    struct termios saved, raw;
+    if (tcgetattr(f->tty_fd, &saved) != 0) {
+        return NULL;
+    }
+    raw = saved;
+    raw.c_lflag &= ~(ECHO | ICANON | ISIG);
+    raw.c_iflag &= ~(IXON | ICRNL);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(f->tty_fd, TCSANOW, &raw);
+
+    struct winsize ws;
+    int term_rows = 24;
+    f->cols = 80;
+    if (ioctl(f->tty_fd, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0) {
+        term_rows = ws.ws_row;
+        f->cols = ws.ws_col;
+    }
+    if (f->height <= 0) {
+        f->height = MYFZF_DEFAULT_HEIGHT;
+    }
+    if (f->height > term_rows) {
+        f->height = term_rows;
+    }
+    if (f->height < 3) {
+        f->height = 3;
+    }
+
+    // A borrowed fd (stdin) gets its flags back when the finder exits
+    int shared_fd = (f->in_fd >= 0 && !f->close_in_fd) ? f->in_fd : -1;
+    int shared_flags = shared_fd >= 0 ? fcntl(shared_fd, F_GETFL) : -1;
+    if (f->in_fd >= 0) {
+        int flags = fcntl(f->in_fd, F_GETFL);
+        fcntl(f->in_fd, F_SETFL, flags | O_NONBLOCK);
+    }
+
+    finder_reserve(f);
+    finder_search(f);
+    finder_render(f);
+
+    const char *choice = NULL;
+    long last_draw = now_ms();
+    int dirty = 0;
+
+    while (1) {
+        struct pollfd fds[2];
+        int nfds = 1;
+        fds[0].fd = f->tty_fd;
+        fds[0].events = POLLIN;
+        if (f->in_fd >= 0) {
+            fds[1].fd = f->in_fd;
+            fds[1].events = POLLIN;
+            nfds = 2;
+        }
+
+        int timeout = dirty ? MYFZF_REDRAW_MS : -1;
+        int ready = poll(fds, nfds, timeout);
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+
+        if (ready > 0 && (fds[0].revents & (POLLIN | POLLHUP))) {
+            int key = finder_key(f);
+            if (key == KEY_ACCEPT) {
+                if (f->res.top_count > 0) {
+                    choice = f->set.items[f->res.top[f->selected].index].text;
+                }
+                break;
+            }
+            if (key == KEY_CANCEL) {
+                break;
+            }
+            if (key == KEY_CHANGED) {
+                f->selected = 0;
+                finder_search(f);
+            }
+            if (f->selected < 0) {
+                f->selected = 0;
+            }
+            if (f->selected >= (int)f->res.top_count) {
+                f->selected = f->res.top_count > 0 ? (int)f->res.top_count - 1 : 0;
+            }
+            if (key != KEY_NONE) {
+                dirty = 1;
+                last_draw = 0;  // Keystrokes redraw immediately
+            }
+        }
+
+        if (nfds == 2 && ready > 0 && (fds[1].revents & (POLLIN | POLLHUP | POLLERR))) {
+            int had_input = f->in_fd >= 0;
+            if (finder_read_input(f, 0)) {
+                finder_search(f);
+                dirty = 1;
+            } else if (had_input && f->in_fd < 0) {
+                dirty = 1;  // Source finished: drop the "..." marker
+            }
+        }
+
+        // Streaming updates are throttled; keystrokes are not
+        if (dirty && now_ms() - last_draw >= MYFZF_REDRAW_MS) {
+            finder_render(f);
+            last_draw = now_ms();
+            dirty = 0;
+        }
+    }
+
+    finder_clear(f);
+    tcsetattr(f->tty_fd, TCSANOW, &saved);
+    if (shared_flags >= 0) {
+        fcntl(shared_fd, F_SETFL, shared_flags);
+    }
+    return choice;
+}
+
+/**
+ * myfzf_pick - Let the user pick a path below the current directory
+ * @want_dirs: Non-zero to list directories only
+ *
+ * Used by terminal_readline for Ctrl-T (files) and Alt-C (directories).
+ * Returns: Allocated path (caller must free) or NULL if cancelled
+ */
+char *myfzf_pick(int want_dirs) {
+    Finder f;
+    finder_init(&f, MYFZF_DEFAULT_HEIGHT);
+    f.tty_fd = open("/dev/tty", O_RDWR | O_CLOEXEC);
+    if (f.tty_fd < 0) {
+        finder_free(&f);
+        return NULL;
+    }
+    f.height = MYFZF_DEFAULT_HEIGHT;
+
+    char *result = NULL;
+    if (finder_open_source(&f, want_dirs ? FZF_SOURCE_DIRS : FZF_SOURCE_FILES, ".", 0) == 0) {
+        const char *choice = finder_interactive(&f);
+        if (choice != NULL) {
+            result = strdup(choice);
+        }
+    }
+
+    close(f.tty_fd);
+    finder_free(&f);
+    return result;
+}
+
+/**
+ * myfzf - Interactive fuzzy finder
+ * Usage: myfzf [-q query] [-f query] [--files [dir]] [--dirs [dir]]
+ *              [--history] [--commands] [-H] [-n limit] [--height rows]
+ */
+int builtin_myfzf(char **argv, Env *env) {
+    (void)env;  // Unused
+
+    // Count arguments
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+
+    // Check for --help flag
+    if (check_help_flag(argc, argv)) {
+        const HelpEntry *help = get_help_entry("myfzf");
+        if (help) {
+            print_help(help);
+            return 0;
+        }
+    }
+
+    FzfSource source = isatty(STDIN_FILENO) ? FZF_SOURCE_FILES : FZF_SOURCE_STDIN;
+    const char *root = ".";
+    const char *initial_query = "";
+    const char *filter = NULL;
+    int show_hidden = 0;
+    long limit = 0;
+    int height = MYFZF_DEFAULT_HEIGHT;
+
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--query") == 0) && i + 1 < argc) {
+            initial_query = argv[++i];
+        } else if ((strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--filter") == 0) && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--files") == 0 || strcmp(argv[i], "--dirs") == 0) {
+            source = (argv[i][2] == 'f') ? FZF_SOURCE_FILES : FZF_SOURCE_DIRS;
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                root = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--history") == 0) {
+            source = FZF_SOURCE_HISTORY;
+        } else if (strcmp(argv[i], "--commands") == 0) {
+            source = FZF_SOURCE_COMMANDS;
+        } else if (strcmp(argv[i], "-H") == 0 || strcmp(argv[i], "--hidden") == 0) {
+            show_hidden = 1;
+        } else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--limit") == 0) && i + 1 < argc) {
+            limit = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--height") == 0 && i + 1 < argc) {
+            height = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "myfzf: unknown option '%s'\n", argv[i]);
+            fprintf(stderr, "Try 'myfzf --help' for more information.\n");
+            return 2;
+        }
+    }
+
+    // Interactive mode needs a terminal; otherwise behave like a filter
+    int tty_fd = -1;
+    if (filter == NULL) {
+        tty_fd = open("/dev/tty", O_RDWR | O_CLOEXEC);
+        if (tty_fd < 0) {
+            filter = initial_query;
+        }
+    }
+
+    Finder f;
+    finder_init(&f, 0);
+
+    if (finder_open_source(&f, source, root, show_hidden) != 0) {
+        if (tty_fd >= 0) {
+            close(tty_fd);
+        }
+        finder_free(&f);
+        return 2;
+    }
+
+    int status;
+    if (filter != NULL) {
+        // Filter mode: read everything, print all matches best-first
+        finder_read_input(&f, 1);
+        size_t k = (limit > 0) ? (size_t)limit : f.set.count;
+        fuzzy_result_free(&f.res);
+        fuzzy_result_init(&f.res, k);
+        fuzzy_search(&f.set, filter, &f.res, 0);
+        fuzzy_result_sort(&f.set, &f.res);
+
+        for (size_t i = 0; i < f.res.top_count; i++) {
+            const FuzzyCandidate *cand = &f.set.items[f.res.top[i].index];
+            fwrite(cand->text, 1, cand->len, stdout);
+            fputc('\n', stdout);
+        }
+        fflush(stdout);
+        status = f.res.top_count > 0 ? 0 : 1;
+    } else {
+        f.tty_fd = tty_fd;
+        f.height = height;
+        fuzzy_result_free(&f.res);
+        fuzzy_result_init(&f.res, height > 2 ? (size_t)height - 2 : 1);
+
+        snprintf(f.query, sizeof(f.query), "%s", initial_query);
+        f.query_len = strlen(f.query);
+
+        const char *choice = finder_interactive(&f);
+        if (choice != NULL) {
+            printf("%s\n", choice);
+            fflush(stdout);
+            status = 0;
+        } else {
+            status = (f.res.top_count == 0 && f.query_len > 0) ? 1 : 130;
+        }
+    }
+
+    if (tty_fd >= 0) {
+        close(tty_fd);
+    }
+    finder_free(&f);
+    return status;
+}
@@ -0,0 +1,388 @@
+/**
+ * builtin_read.c - read, mapfile and readarray
+ *
+ * read splits one record into variables using IFS:
+ *
+ *   read [-r] [-d DELIM] [-a ARRAY] [-p PROMPT] [-u FD] [NAME...]
+ *
+ * mapfile (alias readarray) stores every record of its input in an array:
+ *
+ *   mapfile [-t] [-d DELIM] [-n COUNT] [-s SKIP] [-u FD] [ARRAY]
+ *
+ * Input comes through readbuf.c, which reads whole chunks where it can
+ * without consuming data past the record, so `while read line` loops do
+ * not pay one system call per byte.
+ */
+
+#include "builtins.h"
+#include "readbuf.h"
+#include "help.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DEFAULT_IFS " \t\n"
+
+/**
+ * Parse the argument of -u; returns -1 if it is not a descriptor number
+ */
+static int parse_fd(const char *name, const char *arg) {
+    char *end;
+    long fd = strtol(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0' || fd < 0 || fd > 1023) {
+        fprintf(stderr, "%s: %s: invalid file descriptor\n", name, arg);
+        return -1;
+    }
+    return (int)fd;
+}
+
+/**
+ * Split a record into fields following the POSIX IFS rules
+ *
+ * IFS whitespace runs separate fields and are trimmed at both ends; any
+ * other IFS character separates exactly one field. Characters marked in
+ * escaped[] (backslash-quoted without -r) never split. When max_fields
+ * is reached the last field receives the rest of the record.
+ * Returns the number of fields; field text is written into out (which
+ * must be as large as rec) and fields[] points into it.
+ */
+static int split_fields(const char *rec, const char *escaped, size_t len, const char *ifs,
+                        int max_fields, char *out, char ***fields, int *field_cap) {
+    int count = 0;
+    size_t i = 0;
+
+    #define IS_IFS(k) (!escaped[k] && rec[k] != '\0' && strchr(ifs, rec[k]) != NULL)
+    #define IS_IFS_WS(k) (IS_IFS(k) && (rec[k] == ' ' || rec[k] == '\t' || rec[k] == '\n'))
+
+    // Trailing IFS whitespace never forms a field
+    while (len > 0 && IS_IFS_WS(len - 1)) {
+        len--;
+    }
+    while (i < len && IS_IFS_WS(i)) {
+        i++;
+    }
+
+    char *o = out;
+    while (i < len) {
+        if (count == *field_cap) {
+            int cap = *field_cap ? *field_cap * 2 : 8;
+            char **grown = realloc(*fields, cap * sizeof(char *));
+            if (grown == NULL) {
+                return count;
+            }
+            *fields = grown;
+            *field_cap = cap;
+        }
+        (*fields)[count++] = o;
+
+        int last = max_fields > 0 && count == max_fields;
+        while (i < len && (last || !IS_IFS(i))) {
+            *o++ = rec[i++];
+        }
+        *o++ = '\0';
+        if (i >= len) {
+            break;
+        }
+
+        // Consume one delimiter: whitespace, then at most one non-space IFS char
+        while (i < len && IS_IFS_WS(i)) {
+            i++;
+        }
+        if (i < len && IS_IFS(i) && !IS_IFS_WS(i)) {
+            i++;
+            while (i < len && IS_IFS_WS(i)) {
+                i++;
+            }
+            if (i >= len && (max_fields <= 0 || count < max_fields)) {
+                // "a:" yields a trailing empty field only when it is the last one read
+                break;
+            }
+        }
+    }
+
+    #undef IS_IFS
+    #undef IS_IFS_WS
+    return count;
+}
+
+/**
+ * read - Read one record and split it into variables
+ */
+int builtin_read(char **argv, Env *env) {
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+
+    if (check_help_flag(argc, argv)) {
+        const HelpEntry *help = get_help_entry("read");
+        if (help) {
+            print_help(help);
+            return 0;
+        }
+    }
+
+    int raw = 0;
+    int delim = '\n';
+    int fd = STDIN_FILENO;
+    const char *array = NULL;
+    const char *prompt = NULL;
+    int i = 1;
+
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        if (strcmp(argv[i], "--") == 0) {
+            i++;
+            break;
+        }
+        if (strcmp(argv[i], "-r") == 0) {
+            raw = 1;
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            delim = (unsigned char)argv[++i][0];
+        } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+            array = argv[++i];
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            prompt = argv[++i];
+        } else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc) {
+            fd = parse_fd("read", argv[++i]);
+            if (fd < 0) {
+                return 2;
+            }
+        } else {
+            fprintf(stderr, "read: invalid option: %s\n", argv[i]);
+            fprintf(stderr, "Usage: read [-r] [-d delim] [-a array] [-p prompt] [-u fd] [name...]\n");
+            return 2;
+        }
+    }
+
+    if (prompt != NULL && isatty(fd)) {
+        fputs(prompt, stderr);
+        fflush(stderr);
+    }
+
+    // Read the record; without -r a backslash-newline continues it
+    char *chunk = NULL;
+    size_t chunk_cap = 0;
+    char *rec = NULL;
+    char *escaped = NULL;
+    size_t len = 0;
+    size_t rec_cap = 0;
+    int status = 1;
+
+    for (;;) {
+        ssize_t n = readbuf_getdelim(fd, delim, &chunk, &chunk_cap);
+        if (n <= 0) {
+            break;
+        }
+        int terminated = chunk[n - 1] == (char)delim;
+        size_t body = (size_t)n - (terminated ? 1 : 0);
+
+        if (len + body + 1 > rec_cap) {
+            rec_cap = (len + body + 1) * 2;
+            char *grown_rec = realloc(rec, rec_cap);
+            char *grown_esc = realloc(escaped, rec_cap);
+            if (grown_rec) rec = grown_rec;
+            if (grown_esc) escaped = grown_esc;
+            if (!grown_rec || !grown_esc) {
+                perror("read");
+                break;
+            }
+        }
+
+        int continued = 0;
+        for (size_t k = 0; k < body; k++) {
+            if (!raw && chunk[k] == '\\') {
+                if (k + 1 < body) {
+                    k++;
+                    rec[len] = chunk[k];
+                    escaped[len++] = 1;
+                    continue;
+                }
+                continued = terminated && delim == '\n';
+                break;
+            }
+            rec[len] = chunk[k];
+            escaped[len++] = 0;
+        }
+
+        if (terminated) {
+            status = 0;
+            if (continued) {
+                status = 1;
+                continue;
+            }
+        }
+        break;
+    }
+    free(chunk);
+
+    if (rec == NULL) {
+        rec = malloc(1);
+        escaped = malloc(1);
+        if (!rec || !escaped) {
+            free(rec);
+            free(escaped);
+            return 1;
+        }
+    }
+    rec[len] = '\0';
+
+    const char *ifs = env_get(env, "IFS");
+    if (ifs == NULL) {
+        ifs = DEFAULT_IFS;
+    }
+
+    char *out = malloc(len + 1 > 1 ? len * 2 + 2 : 2);
+    char **fields = NULL;
+    int field_cap = 0;
+    if (out == NULL) {
+        free(rec);
+        free(escaped);
+        return 1;
+    }
+
+    if (array != NULL) {
+        int count = split_fields(rec, escaped, len, ifs, 0, out, &fields, &field_cap);
+        char **items = malloc((count > 0 ? count : 1) * sizeof(char *));
+        if (items != NULL) {
+            for (int k = 0; k < count; k++) {
+                items[k] = strdup(fields[k]);
+            }
+            env_array_assign(env, array, items, count);
+        }
+    } else {
+        int names = argc - i;
+        char *reply[] = { "REPLY", NULL };
+        char **targets = names > 0 ? argv + i : reply;
+        if (names == 0) {
+            names = 1;
+            // REPLY keeps the whole line, including surrounding blanks
+            ifs = "";
+        }
+        int count = split_fields(rec, escaped, len, ifs, names, out, &fields, &field_cap);
+        for (int k = 0; k < names; k++) {
+            env_set(env, targets[k], k < count && fields ? fields[k] : "");
+        }
+    }
+
+    free(fields);
+    free(out);
+    free(rec);
+    free(escaped);
+    return status;
+}
+
+/**
+ * mapfile / readarray - Read all records into an array
+ */
+int builtin_mapfile(char **argv, Env *env) {
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+
+    if (check_help_flag(argc, argv)) {
+        const HelpEntry *help = get_help_entry(argv[0]);
+        if (help) {
+            print_help(help);
+            return 0;
+        }
+    }
+
+    int trim = 0;
+    int delim = '\n';
+    int fd = STDIN_FILENO;
+    long limit = 0;
+    long skip = 0;
+    const char *array = "MAPFILE";
+    int i = 1;
+
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        if (strcmp(argv[i], "-t") == 0) {
+            trim = 1;
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            delim = (unsigned char)argv[++i][0];
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            limit = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            skip = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc) {
+            fd = parse_fd(argv[0], argv[++i]);
+            if (fd < 0) {
+                return 2;
+            }
+        } else {
+            fprintf(stderr, "%s: invalid option: %s\n", argv[0], argv[i]);
+            fprintf(stderr, "Usage: %s [-t] [-d delim] [-n count] [-s skip] [-u fd] [array]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (i < argc) {
+        array = argv[i];
+    }
+
+    int count = 0;
+    int cap = 64;
+    char **items = malloc(cap * sizeof(char *));
+    if (items == NULL) {
+        perror(argv[0]);
+        return 1;
+    }
+
+    if (limit <= 0) {
+        // Everything is consumed: one pass over a single large read
+        char *data;
+        size_t len;
+        if (readbuf_slurp(fd, &data, &len) < 0) {
+            free(items);
+            return 1;
+        }
+        size_t pos = 0;
+        while (pos < len) {
+            char *hit = memchr(data + pos, delim, len - pos);
+            size_t end = hit ? (size_t)(hit - data) + 1 : len;
+            size_t item_len = end - pos;
+            if (trim && hit) {
+                item_len--;
+            }
+            if (skip > 0) {
+                skip--;
+            } else {
+                if (count == cap) {
+                    cap *= 2;
+                    char **grown = realloc(items, cap * sizeof(char *));
+                    if (grown == NULL) {
+                        break;
+                    }
+                    items = grown;
+                }
+                items[count++] = strndup(data + pos, item_len);
+            }
+            pos = end;
+        }
+        free(data);
+    } else {
+        // Stop after COUNT records, leaving the rest for the next reader
+        char *line = NULL;
+        size_t line_cap = 0;
+        ssize_t n;
+        while (count < limit && (n = readbuf_getdelim(fd, delim, &line, &line_cap)) > 0) {
+            if (trim && line[n - 1] == (char)delim) {
+                line[--n] = '\0';
+            }
+            if (skip > 0) {
+                skip--;
+                continue;
+            }
+            if (count == cap) {
+                cap *= 2;
+                char **grown = realloc(items, cap * sizeof(char *));
+                if (grown == NULL) {
+                    break;
+                }
+                items = grown;
+            }
+            items[count++] = strndup(line, (size_t)n);
+        }
+        free(line);
+    }
+
+    env_array_assign(env, array, items, count);
+    return 0;
+}
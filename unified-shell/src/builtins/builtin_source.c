@@ -0,0 +1,81 @@
+/**
+ * builtin_source.c - source and . (run a script in the current shell)
+ *
+ * Usage: source FILE [ARG...]
+ *        . FILE [ARG...]
+ *
+ * The file runs in the current shell, so variables and functions it
+ * defines stay defined. Parsing goes through script_cache.c, so sourcing
+ * an unchanged file again does not re-read or re-parse it.
+ */
+
+#include "builtins.h"
+#include "script.h"
+#include "script_cache.h"
+#include "help.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+/**
+ * Resolve a file name without '/': $PATH first, then the current directory
+ */
+static const char *find_script(const char *name, char *buf, size_t size) {
+    if (strchr(name, '/') != NULL) {
+        return name;
+    }
+    const char *path = getenv("PATH");
+    while (path != NULL && *path) {
+        const char *colon = strchr(path, ':');
+        size_t len = colon ? (size_t)(colon - path) : strlen(path);
+        if (len > 0 && (size_t)snprintf(buf, size, "%.*s/%s", (int)len, path, name) < size &&
+            access(buf, R_OK) == 0) {
+            return buf;
+        }
+        path = colon ? colon + 1 : NULL;
+    }
+    return name;
+}
+
+/**
+ * source / . - Execute commands from a file in the current shell
+ */
+int builtin_source(char **argv, Env *env) {
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+
+    if (check_help_flag(argc, argv)) {
+        const HelpEntry *help = get_help_entry(argv[0]);
+        if (help) {
+            print_help(help);
+            return 0;
+        }
+    }
+
+    if (argc < 2) {
+        fprintf(stderr, "%s: filename argument required\n", argv[0]);
+        fprintf(stderr, "Usage: %s FILE [ARG...]\n", argv[0]);
+        return 2;
+    }
+
+    char resolved[PATH_MAX];
+    const char *path = find_script(argv[1], resolved, sizeof(resolved));
+
+    int status;
+    ScriptUnit *unit = script_cache_load(path, &status);
+    if (unit == NULL) {
+        if (status == SCRIPT_CACHE_IO_ERROR) {
+            fprintf(stderr, "%s: %s: %s\n", argv[0], argv[1], strerror(errno));
+            return 1;
+        }
+        fprintf(stderr, "%s: %s: syntax error\n", argv[0], argv[1]);
+        return 2;
+    }
+
+    int ret = script_execute_source(unit, env, argv + 1);
+    script_release(unit);
+    return ret;
+}
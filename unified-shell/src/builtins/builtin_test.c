@@ -0,0 +1,516 @@
+/**
+ * builtin_test.c - In-process test, [, [[, true and false
+ *
+ * Conditionals are the most frequently executed commands in scripts, so
+ * evaluating them without fork/exec of /usr/bin/[ matters. This module
+ * implements the POSIX test grammar plus the bash [[ ]] extensions:
+ *
+ *   File tests:    -e -f -d -r -w -x -s -L/-h -b -c -p -S -u -g -k -O -G
+ *                  FILE1 -nt FILE2, FILE1 -ot FILE2, FILE1 -ef FILE2
+ *   Strings:       -n STR, -z STR, STR, S1 = S2, S1 == S2, S1 != S2,
+ *                  S1 < S2, S1 > S2
+ *   Integers:      -eq -ne -lt -le -gt -ge
+ *   Logic:         ! EXPR, ( EXPR ), EXPR -a EXPR, EXPR -o EXPR
+ *   [[ ]] only:    && and || for logic, == / != match a glob pattern on
+ *                  the right, STR =~ REGEX matches an extended regex
+ *
+ * Compiled regular expressions are cached so a loop testing the same
+ * pattern compiles it once. The match of the last successful =~ is
+ * stored in BASH_REMATCH.
+ *
+ * Exit status: 0 = true, 1 = false, 2 = usage error (like test(1)).
+ */
+
+#include "builtins.h"
+#include "glob.h"
+#include "help.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <regex.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define TEST_TRUE  0
+#define TEST_FALSE 1
+#define TEST_ERROR 2
+
+#define REGEX_CACHE_SIZE 16
+
+/* ============================================================================
+ * Compiled Regex Cache
+ * ============================================================================ */
+
+typedef struct {
+    char *pattern;
+    regex_t regex;
+    unsigned long last_used;
+} RegexCacheEntry;
+
+static RegexCacheEntry regex_cache[REGEX_CACHE_SIZE];
+static unsigned long regex_clock = 0;
+static pthread_mutex_t regex_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * regex_cache_match - Match subject against an extended regex
+ * @pattern: POSIX extended regular expression
+ * @subject: String to match
+ * @match: Output for the whole-match offsets (may be NULL)
+ *
+ * Compiles the pattern on first use and keeps it in a small LRU cache.
+ *
+ * Returns: 1 on match, 0 on no match, -1 if the pattern is invalid
+ */
+static int regex_cache_match(const char *pattern, const char *subject, regmatch_t *match) {
+    pthread_mutex_lock(&regex_mutex);
+
+    RegexCacheEntry *entry = NULL;
+    RegexCacheEntry *victim = &regex_cache[0];
+    for (int i = 0; i < REGEX_CACHE_SIZE; i++) {
+        if (regex_cache[i].pattern != NULL && strcmp(regex_cache[i].pattern, pattern) == 0) {
+            entry = &regex_cache[i];
+            break;
+        }
+        if (regex_cache[i].pattern == NULL ||
+            (victim->pattern != NULL && regex_cache[i].last_used < victim->last_used)) {
+            victim = &regex_cache[i];
+        }
+    }
+
+    if (entry == NULL) {
+        // Evict the least recently used pattern
+        if (victim->pattern != NULL) {
+            regfree(&victim->regex);
+            free(victim->pattern);
+            victim->pattern = NULL;
+        }
+        if (regcomp(&victim->regex, pattern, REG_EXTENDED) != 0) {
+            pthread_mutex_unlock(&regex_mutex);
+            return -1;
+        }
+        victim->pattern = strdup(pattern);
+        entry = victim;
+    }
+    entry->last_used = ++regex_clock;
+
+    regmatch_t m[1];
+    int rc = regexec(&entry->regex, subject, 1, m, 0);
+    pthread_mutex_unlock(&regex_mutex);
+
+    if (rc == 0 && match != NULL) {
+        *match = m[0];
+    }
+    return rc == 0 ? 1 : 0;
+}
+
+/* ============================================================================
+ * Expression Evaluator
+ * ============================================================================ */
+
+typedef struct {
+    char **args;    // Operands (without the command name and closing bracket)
+    int count;
+    int pos;
+    int extended;   // 1 for [[ ]] semantics
+    int error;
+    const char *name;
+    Env *env;
+} TestParser;
+
+static int test_or(TestParser *tp);
+
+static const char *peek(TestParser *tp, int offset) {
+    int i = tp->pos + offset;
+    return (i < tp->count) ? tp->args[i] : NULL;
+}
+
+static void test_error(TestParser *tp, const char *msg, const char *arg) {
+    if (!tp->error) {
+        if (arg != NULL) {
+            fprintf(stderr, "%s: %s: %s\n", tp->name, arg, msg);
+        } else {
+            fprintf(stderr, "%s: %s\n", tp->name, msg);
+        }
+    }
+    tp->error = 1;
+}
+
+static int is_unary_op(const char *s) {
+    static const char *ops = "efdrwxsLhbcpSugkOGnzt";
+    return s != NULL && s[0] == '-' && s[1] != '\0' && s[2] == '\0' && strchr(ops, s[1]) != NULL;
+}
+
+static int is_binary_op(TestParser *tp, const char *s) {
+    static const char *ops[] = {
+        "=", "==", "!=", "<", ">", "-eq", "-ne", "-lt", "-le", "-gt", "-ge",
+        "-nt", "-ot", "-ef", NULL
+    };
+    if (s == NULL) {
+        return 0;
+    }
+    if (tp->extended && strcmp(s, "=~") == 0) {
+        return 1;
+    }
+    for (int i = 0; ops[i] != NULL; i++) {
+        if (strcmp(s, ops[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int parse_integer(TestParser *tp, const char *s, long long *out) {
+    char *end;
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    errno = 0;
+    *out = strtoll(s, &end, 10);
+    while (*end == ' ' || *end == '\t') {
+        end++;
+    }
+    if (*s == '\0' || *end != '\0' || errno == ERANGE) {
+        test_error(tp, "integer expression expected", s);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Evaluate a unary file or string test. Returns 1 for true, 0 for false.
+ */
+static int eval_unary(TestParser *tp, char op, const char *arg) {
+    struct stat st;
+
+    switch (op) {
+        case 'n': return arg[0] != '\0';
+        case 'z': return arg[0] == '\0';
+        case 't': {
+            long long fd;
+            if (parse_integer(tp, arg, &fd) != 0) {
+                return 0;
+            }
+            return isatty((int)fd);
+        }
+        case 'L':
+        case 'h':
+            return lstat(arg, &st) == 0 && S_ISLNK(st.st_mode);
+        case 'r': return faccessat(AT_FDCWD, arg, R_OK, AT_EACCESS) == 0;
+        case 'w': return faccessat(AT_FDCWD, arg, W_OK, AT_EACCESS) == 0;
+        case 'x': return faccessat(AT_FDCWD, arg, X_OK, AT_EACCESS) == 0;
+        default:
+            break;
+    }
+
+    if (stat(arg, &st) != 0) {
+        return 0;
+    }
+
+    switch (op) {
+        case 'e': return 1;
+        case 'f': return S_ISREG(st.st_mode);
+        case 'd': return S_ISDIR(st.st_mode);
+        case 's': return st.st_size > 0;
+        case 'b': return S_ISBLK(st.st_mode);
+        case 'c': return S_ISCHR(st.st_mode);
+        case 'p': return S_ISFIFO(st.st_mode);
+        case 'S': return S_ISSOCK(st.st_mode);
+        case 'u': return (st.st_mode & S_ISUID) != 0;
+        case 'g': return (st.st_mode & S_ISGID) != 0;
+        case 'k': return (st.st_mode & S_ISVTX) != 0;
+        case 'O': return st.st_uid == geteuid();
+        case 'G': return st.st_gid == getegid();
+        default:  return 0;
+    }
+}
+
+/**
+ * Compare modification times; a missing file is older than any file.
+ */
+static int compare_mtime(const char *a, const char *b) {
+    struct stat sa, sb;
+    int ha = stat(a, &sa) == 0;
+    int hb = stat(b, &sb) == 0;
+    if (!ha || !hb) {
+        return ha - hb;
+    }
+    if (sa.st_mtim.tv_sec != sb.st_mtim.tv_sec) {
+        return sa.st_mtim.tv_sec < sb.st_mtim.tv_sec ? -1 : 1;
+    }
+    if (sa.st_mtim.tv_nsec != sb.st_mtim.tv_nsec) {
+        return sa.st_mtim.tv_nsec < sb.st_mtim.tv_nsec ? -1 : 1;
+    }
+    return 0;
+}
+
+/**
+ * Evaluate a binary operator. Returns 1 for true, 0 for false.
+ */
+static int eval_binary(TestParser *tp, const char *lhs, const char *op, const char *rhs) {
+    if (strcmp(op, "=") == 0 || strcmp(op, "==") == 0) {
+        return tp->extended ? match_pattern(rhs, lhs) : strcmp(lhs, rhs) == 0;
+    }
+    if (strcmp(op, "!=") == 0) {
+        return tp->extended ? !match_pattern(rhs, lhs) : strcmp(lhs, rhs) != 0;
+    }
+    if (strcmp(op, "<") == 0) {
+        return strcmp(lhs, rhs) < 0;
+    }
+    if (strcmp(op, ">") == 0) {
+        return strcmp(lhs, rhs) > 0;
+    }
+    if (strcmp(op, "=~") == 0) {
+        regmatch_t m;
+        int rc = regex_cache_match(rhs, lhs, &m);
+        if (rc < 0) {
+            test_error(tp, "invalid regular expression", rhs);
+            return 0;
+        }
+        if (rc == 1 && tp->env != NULL) {
+            char matched[VAR_VALUE_MAX];
+            int len = (int)(m.rm_eo - m.rm_so);
+            if (len >= VAR_VALUE_MAX) {
+                len = VAR_VALUE_MAX - 1;
+            }
+            memcpy(matched, lhs + m.rm_so, len);
+            matched[len] = '\0';
+            env_set(tp->env, "BASH_REMATCH", matched);
+        }
+        return rc;
+    }
+    if (strcmp(op, "-nt") == 0) {
+        return compare_mtime(lhs, rhs) > 0;
+    }
+    if (strcmp(op, "-ot") == 0) {
+        return compare_mtime(lhs, rhs) < 0;
+    }
+    if (strcmp(op, "-ef") == 0) {
+        struct stat sa, sb;
+        return stat(lhs, &sa) == 0 && stat(rhs, &sb) == 0 &&
+               sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+    }
+
+    // Integer comparisons
+    long long a, b;
+    if (parse_integer(tp, lhs, &a) != 0 || parse_integer(tp, rhs, &b) != 0) {
+        return 0;
+    }
+    if (strcmp(op, "-eq") == 0) return a == b;
+    if (strcmp(op, "-ne") == 0) return a != b;
+    if (strcmp(op, "-lt") == 0) return a < b;
+    if (strcmp(op, "-le") == 0) return a <= b;
+    if (strcmp(op, "-gt") == 0) return a > b;
+    if (strcmp(op, "-ge") == 0) return a >= b;
+
+    test_error(tp, "unknown binary operator", op);
+    return 0;
+}
+
+static int is_and(TestParser *tp, const char *s) {
+    return s != NULL && strcmp(s, tp->extended ? "&&" : "-a") == 0;
+}
+
+static int is_or(TestParser *tp, const char *s) {
+    return s != NULL && strcmp(s, tp->extended ? "||" : "-o") == 0;
+}
+
+/**
+ * primary := '(' expr ')' | UNARY arg | arg BINARY arg | arg
+ */
+static int test_primary(TestParser *tp) {
+    const char *tok = peek(tp, 0);
+    if (tok == NULL) {
+        test_error(tp, "argument expected", NULL);
+        return 0;
+    }
+
+    // A binary operator in second position wins (POSIX 3-argument rule),
+    // so "[ -f = -f ]" compares strings
+    if (is_binary_op(tp, peek(tp, 1)) && peek(tp, 2) != NULL) {
+        const char *op = peek(tp, 1);
+        const char *rhs = peek(tp, 2);
+        tp->pos += 3;
+        return eval_binary(tp, tok, op, rhs);
+    }
+
+    if (strcmp(tok, "(") == 0 && peek(tp, 1) != NULL) {
+        tp->pos++;
+        int value = test_or(tp);
+        if (peek(tp, 0) == NULL || strcmp(peek(tp, 0), ")") != 0) {
+            test_error(tp, "missing ')'", NULL);
+            return 0;
+        }
+        tp->pos++;
+        return value;
+    }
+
+    if (is_unary_op(tok) && peek(tp, 1) != NULL) {
+        const char *arg = peek(tp, 1);
+        tp->pos += 2;
+        return eval_unary(tp, tok[1], arg);
+    }
+
+    // Lone string: true if non-empty
+    tp->pos++;
+    return tok[0] != '\0';
+}
+
+static int test_not(TestParser *tp) {
+    const char *tok = peek(tp, 0);
+    if (tok != NULL && strcmp(tok, "!") == 0 && peek(tp, 1) != NULL) {
+        tp->pos++;
+        return !test_not(tp);
+    }
+    return test_primary(tp);
+}
+
+static int test_and(TestParser *tp) {
+    int value = test_not(tp);
+    while (!tp->error && is_and(tp, peek(tp, 0))) {
+        tp->pos++;
+        int rhs = test_not(tp);
+        value = value && rhs;
+    }
+    return value;
+}
+
+static int test_or(TestParser *tp) {
+    int value = test_and(tp);
+    while (!tp->error && is_or(tp, peek(tp, 0))) {
+        tp->pos++;
+        int rhs = test_and(tp);
+        value = value || rhs;
+    }
+    return value;
+}
+
+/**
+ * Evaluate operands args[0..count) and return a test exit status.
+ */
+static int test_evaluate(const char *name, char **args, int count, int extended, Env *env) {
+    if (count == 0) {
+        return TEST_FALSE;  // "test" with no arguments is false
+    }
+
+    TestParser tp = { args, count, 0, extended, 0, name, env };
+    int value = test_or(&tp);
+
+    if (!tp.error && tp.pos < tp.count) {
+        test_error(&tp, "too many arguments", NULL);
+    }
+    if (tp.error) {
+        return TEST_ERROR;
+    }
+    return value ? TEST_TRUE : TEST_FALSE;
+}
+
+/**
+ * Show help only for an exact "NAME --help"; "-h" is a file test here
+ */
+static int test_wants_help(int argc, char **argv) {
+    if (argc == 2 && strcmp(argv[1], "--help") == 0) {
+        const HelpEntry *help = get_help_entry("test");
+        if (help) {
+            print_help(help);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * Built-in Commands
+ * ============================================================================ */
+
+/**
+ * test - Evaluate a conditional expression
+ * Usage: test EXPRESSION
+ */
+int builtin_test(char **argv, Env *env) {
+    // Count arguments
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+
+    if (test_wants_help(argc, argv)) {
+        return 0;
+    }
+
+    return test_evaluate("test", argv + 1, argc - 1, 0, env);
+}
+
+/**
+ * [ - Evaluate a conditional expression
+ * Usage: [ EXPRESSION ]
+ */
+int builtin_bracket(char **argv, Env *env) {
+    // Count arguments
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+
+    if (test_wants_help(argc, argv)) {
+        return 0;
+    }
+
+    if (argc < 2 || strcmp(argv[argc - 1], "]") != 0) {
+        fprintf(stderr, "[: missing ']'\n");
+        return TEST_ERROR;
+    }
+
+    return test_evaluate("[", argv + 1, argc - 2, 0, env);
+}
+
+/**
+ * [[ - Evaluate an extended conditional expression
+ * Usage: [[ EXPRESSION ]]
+ */
+int builtin_dbracket(char **argv, Env *env) {
+    // Count arguments
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+
+    if (test_wants_help(argc, argv)) {
+        return 0;
+    }
+
+    if (argc < 2 || strcmp(argv[argc - 1], "]]") != 0) {
+        fprintf(stderr, "[[: missing ']]'\n");
+        return TEST_ERROR;
+    }
+
+    return test_evaluate("[[", argv + 1, argc - 2, 1, env);
+}
+
+/**
+ * true - Do nothing, successfully
+ * Usage: true
+ */
+int builtin_true(char **argv, Env *env) {
+    (void)env;  // Unused
+
+    if (argv[1] != NULL && argv[2] == NULL && strcmp(argv[1], "--help") == 0) {
+        const HelpEntry *help = get_help_entry("true");
+        if (help) {
+            print_help(help);
+        }
+    }
+    return 0;
+}
+
+/**
+ * false - Do nothing, unsuccessfully
+ * Usage: false
+ */
+int builtin_false(char **argv, Env *env) {
+    (void)env;  // Unused
+
+    if (argv[1] != NULL && argv[2] == NULL && strcmp(argv[1], "--help") == 0) {
+        const HelpEntry *help = get_help_entry("false");
+        if (help) {
+            print_help(help);
+        }
+    }
+    return 1;
+}
@@ -2,41 +2,26 @@
 #include "history.h"
 #include "apt.h"
 #include "jobs.h"
+#include "pipemon.h"
+#include "jobsched.h"
+#include "threading.h"
 #include "signals.h"
 #include "help.h"
+#include "plugins.h"
+#include "registry.h"
+#include "script.h"
+#include "memstats.h"
+#include "intern.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 #include <signal.h>
 #include <errno.h>
 #include <sys/wait.h>
 #include <termios.h>
 
-/**
- * Built-in commands table
- */
-static Builtin builtins[] = {
-    {"cd", builtin_cd},
-    {"pwd", builtin_pwd},
-    {"echo", builtin_echo},
-    {"export", builtin_export},
-    {"exit", builtin_exit},
-    {"set", builtin_set},
-    {"unset", builtin_unset},
-    {"env", builtin_env},
-    {"help", builtin_help},
-    {"version", builtin_version},
-    {"history", builtin_history},
-    {"edi", builtin_edi},
-    {"apt", builtin_apt},
-    {"jobs", builtin_jobs},
-    {"fg", builtin_fg},
-    {"bg", builtin_bg},
-    {"commands", builtin_commands},
-    {NULL, NULL}  // Sentinel
-};
-
 /**
  * Find a built-in command
  */
@@ -45,13 +30,14 @@ builtin_func find_builtin(const char *name) {
         return NULL;
     }
     
-    for (int i = 0; builtins[i].name != NULL; i++) {
-        if (strcmp(name, builtins[i].name) == 0) {
-            return builtins[i].func;
-        }
+    // Commands loaded with enable -f replace compiled-in ones
+    builtin_func loaded = plugin_find(name);
+    if (loaded != NULL) {
+        return loaded;
     }
     
-    return NULL;
+    const RegistryEntry *e = registry_lookup(name);
+    return e != NULL ? e->builtin : NULL;
 }
 
 /**
@@ -260,6 +246,13 @@ int builtin_exit(char **argv, Env *env) {
         code = atoi(argv[1]);
     }
     
+    // A forked ( ... ) only ends itself; exit() would also run the
+    // shell's atexit cleanup and rewind its shared stdin offset
+    if (script_in_forked_subshell()) {
+        fflush(NULL);
+        _exit(code & 0xff);
+    }
+    
     exit(code);
 }
 
@@ -296,13 +289,13 @@ int builtin_set(char **argv, Env *env) {
     
     // Split into name and value
     size_t name_len = eq - argv[1];
-    char *name = malloc(name_len + 1);
-    if (name == NULL) {
-        perror("malloc");
+    char name[VAR_NAME_MAX];
+    if (name_len == 0 || name_len >= sizeof(name)) {
+        fprintf(stderr, "set: invalid variable name\n");
         return 1;
     }
     
-    strncpy(name, argv[1], name_len);
+    memcpy(name, argv[1], name_len);
     name[name_len] = '\0';
     
     char *value = eq + 1;
@@ -310,7 +303,6 @@ int builtin_set(char **argv, Env *env) {
     // Set in environment (shell-local only)
     env_set(env, name, value);
     
-    free(name);
     return 0;
 }
 
@@ -401,33 +393,16 @@ int builtin_help(char **argv, Env *env) {
     }
     
     // No command specified - show general help and command list
+    // Command lines come from the registry (commands.def)
     printf("Unified Shell (ushell) - Built-in Commands:\n\n");
-    printf("  cd [dir]           Change directory (default: $HOME)\n");
-    printf("  pwd                Print working directory\n");
-    printf("  echo [args...]     Display arguments\n");
-    printf("  export VAR=value   Set and export environment variable\n");
-    printf("  set VAR=value      Set variable (shell only)\n");
-    printf("  unset VAR          Remove variable\n");
-    printf("  env                Display all environment variables\n");
-    printf("  edi [file]         Vi-like text editor (modes: normal, insert, command)\n");
-    printf("  help [command]     Display help (general or for specific command)\n");
-    printf("  version            Display version information\n");
-    printf("  history            Display command history\n");
-    printf("  commands [--json]  List all available commands\n");
-    printf("  exit [status]      Exit the shell\n");
+    fputs(registry_help_lines[REG_BUILTIN], stdout);
     printf("\nJob Control:\n");
-    printf("  jobs [-l|-p|-r|-s] List background jobs\n");
-    printf("  fg [%%n]            Bring job to foreground (default: most recent)\n");
-    printf("  bg [%%n]            Resume stopped job in background\n");
-    printf("  cmd &              Run command in background\n");
+    fputs(registry_help_lines[REG_JOB], stdout);
+    printf("  cmd &                Run command in background\n");
     printf("\nPackage Manager:\n");
-    printf("  apt init           Initialize package repository\n");
-    printf("  apt update         Update package index\n");
-    printf("  apt list           List available packages\n");
-    printf("  apt install PKG    Install a package\n");
-    printf("  apt remove PKG     Remove a package\n");
+    fputs(registry_help_lines[REG_SUBCMD], stdout);
     printf("\nIntegrated Tools:\n");
-    printf("  myls, mycat, mycp, mymv, myrm, mymkdir, myrmdir, mytouch, mystat, myfd\n");
+    fputs(registry_help_lines[REG_TOOL], stdout);
     printf("\nAI Integration:\n");
     printf("  @<query>           Ask AI for command suggestions\n");
     printf("                     Example: @list all python files\n");
@@ -437,10 +412,14 @@ int builtin_help(char **argv, Env *env) {
     printf("  See aiIntegr/README.md for detailed AI configuration\n");
     printf("\nFeatures:\n");
     printf("  - Variables: $VAR or ${VAR}\n");
+    printf("  - Parameter ops: ${#v} ${v:-w} ${v:=w} ${v:?w} ${v:+w} ${v:off:len}\n");
+    printf("                   ${v#p} ${v%%p} ${v/p/r} ${v//p/r} ${v^^} ${v,,}\n");
+    printf("  - Command substitution: $(command) or `command`\n");
     printf("  - Arithmetic: $((expression))\n");
     printf("  - Pipelines: cmd1 | cmd2\n");
     printf("  - Redirection: < > >>\n");
-    printf("  - Conditionals: if cmd then ... fi\n");
+    printf("  - Conditionals: if cmd then ... fi, case ... esac\n");
+    printf("  - Loops and functions: for/while/until, name() { ... }\n");
     printf("  - Glob expansion: * ? [abc] [a-z] [!abc]\n");
     printf("  - Job Control: & (background), Ctrl+Z (stop), Ctrl+C (interrupt)\n");
     
@@ -612,6 +591,8 @@ int builtin_jobs(char **argv, Env *env) {
                 // Apply filters
                 if (running_only && job->status != JOB_RUNNING) continue;
                 if (stopped_only && job->status != JOB_STOPPED) continue;
+                // Thread jobs have no process; kill %N reaches them
+                if (job->thread != NULL) continue;
                 
                 printf("%d\n", job->pid);
             }
@@ -636,13 +617,20 @@ int builtin_jobs(char **argv, Env *env) {
             }
             
             // Get status string
-            const char *status = job_status_to_string(job->status);
+            const char *status = job_state_to_string(job);
             
             // Print based on format
             if (long_format) {
                 // Long format: [N]+ PID Status Command
-                printf("[%d]%c  %-7d %-20s %s\n", 
-                       job->job_id, marker, job->pid, status, job->command);
+                if (job->thread != NULL) {
+                    printf("[%d]%c  %-7s %-20s %s\n",
+                           job->job_id, marker, "thread", status, job->command);
+                } else {
+                    printf("[%d]%c  %-7d %-20s %s\n", 
+                           job->job_id, marker, job->pid, status, job->command);
+                }
+                // Pipe throughput, when the job was started with USHELL_PIPE_MONITOR=1
+                pipe_monitor_print(job->monitor, stdout, "        ");
             } else {
                 // Default format: [N]+ Status Command
                 printf("[%d]%c  %-20s %s\n", 
@@ -740,6 +728,22 @@ int builtin_fg(char **argv, Env *env) {
     printf("%s\n", job->command);
     fflush(stdout);
     
+    // Thread job: wait in the shell; Ctrl+C cancels it, Ctrl+Z pauses it
+    if (job->thread != NULL) {
+        jobs_signal(job_id, SIGCONT);
+        job->background = 0;
+        int status = jobs_wait(job_id, 1);
+        job = jobs_get(job_id);
+        if (job != NULL && job->status == JOB_STOPPED) {
+            job->background = 1;
+            job->notified = JOB_STOPPED;
+            printf("\n[%d]+  Stopped                 %s\n", job->job_id, job->command);
+        } else {
+            jobs_remove(job_id);
+        }
+        return status;
+    }
+    
     // If job is stopped, send SIGCONT to resume it
     if (job->status == JOB_STOPPED) {
         if (kill(job->pid, SIGCONT) < 0) {
@@ -897,8 +901,8 @@ int builtin_bg(char **argv, Env *env) {
         return 0;
     }
     
-    // Send SIGCONT to resume the stopped job
-    if (kill(job->pid, SIGCONT) < 0) {
+    // Send SIGCONT to resume the stopped job (thread jobs leave their pause)
+    if (jobs_signal(job_id, SIGCONT) < 0) {
         perror("bg: kill");
         return 1;
     }
@@ -913,6 +917,418 @@ int builtin_bg(char **argv, Env *env) {
     return 0;
 }
 
+/**
+ * parse_job_spec - Turn %N, %%, %+ or N into a job ID
+ * 
+ * Returns: Job ID, or -1 if spec is not a job specification
+ */
+static int parse_job_spec(const char *spec) {
+    if (spec[0] != '%') {
+        return -1;
+    }
+    if (strcmp(spec, "%%") == 0 || strcmp(spec, "%+") == 0) {
+        int count = jobs_count();
+        Job *job = count > 0 ? jobs_get_by_index(count - 1) : NULL;
+        return job != NULL ? job->job_id : 0;
+    }
+    char *endptr;
+    long id = strtol(spec + 1, &endptr, 10);
+    return (spec[1] != '\0' && *endptr == '\0' && id > 0) ? (int)id : 0;
+}
+
+/* Signal names accepted by kill (without the SIG prefix) */
+static const struct {
+    const char *name;
+    int number;
+} kill_signals[] = {
+    { "HUP", SIGHUP },   { "INT", SIGINT },   { "QUIT", SIGQUIT }, { "KILL", SIGKILL },
+    { "USR1", SIGUSR1 }, { "USR2", SIGUSR2 }, { "PIPE", SIGPIPE }, { "ALRM", SIGALRM },
+    { "TERM", SIGTERM }, { "CHLD", SIGCHLD }, { "CONT", SIGCONT }, { "STOP", SIGSTOP },
+    { "TSTP", SIGTSTP }, { "TTIN", SIGTTIN }, { "TTOU", SIGTTOU }, { "WINCH", SIGWINCH },
+};
+
+static int parse_signal(const char *name) {
+    char *endptr;
+    long number = strtol(name, &endptr, 10);
+    if (name[0] != '\0' && *endptr == '\0') {
+        return (number >= 0 && number < NSIG) ? (int)number : -1;
+    }
+    if (strncasecmp(name, "SIG", 3) == 0) {
+        name += 3;
+    }
+    for (size_t i = 0; i < sizeof(kill_signals) / sizeof(kill_signals[0]); i++) {
+        if (strcasecmp(name, kill_signals[i].name) == 0) {
+            return kill_signals[i].number;
+        }
+    }
+    return -1;
+}
+
+/**
+ * kill - Send a signal to jobs or processes
+ * Usage: kill [-s SIG | -SIG] %job|pid...   kill -l
+ * 
+ * Jobs are addressed as %N. Process jobs receive the signal on their whole
+ * process group; thread jobs (integrated tools run with &) are cancelled,
+ * or paused and resumed with STOP/TSTP and CONT.
+ */
+int builtin_kill(char **argv, Env *env) {
+    (void)env;  // Unused
+    
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+    
+    if (check_help_flag(argc, argv)) {
+        const HelpEntry *help = get_help_entry("kill");
+        if (help) {
+            print_help(help);
+            return 0;
+        }
+    }
+    
+    int sig = SIGTERM;
+    int i = 1;
+    if (argv[i] != NULL && strcmp(argv[i], "-l") == 0) {
+        for (size_t k = 0; k < sizeof(kill_signals) / sizeof(kill_signals[0]); k++) {
+            printf("%2d) SIG%s\n", kill_signals[k].number, kill_signals[k].name);
+        }
+        return 0;
+    }
+    if (argv[i] != NULL && (strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "-n") == 0)) {
+        if (argv[i + 1] == NULL || (sig = parse_signal(argv[i + 1])) < 0) {
+            fprintf(stderr, "kill: %s: invalid signal specification\n",
+                    argv[i + 1] ? argv[i + 1] : "");
+            return 1;
+        }
+        i += 2;
+    } else if (argv[i] != NULL && argv[i][0] == '-' && argv[i][1] != '\0') {
+        if ((sig = parse_signal(argv[i] + 1)) < 0) {
+            fprintf(stderr, "kill: %s: invalid signal specification\n", argv[i] + 1);
+            return 1;
+        }
+        i++;
+    }
+    if (argv[i] == NULL) {
+        fprintf(stderr, "Usage: kill [-s SIG | -SIG] %%job|pid...\n");
+        return 1;
+    }
+    
+    int ret = 0;
+    for (; argv[i] != NULL; i++) {
+        int job_id = parse_job_spec(argv[i]);
+        if (job_id >= 0) {
+            if (job_id == 0 || jobs_signal(job_id, sig) < 0) {
+                fprintf(stderr, "kill: %s: no such job\n", argv[i]);
+                ret = 1;
+            }
+            continue;
+        }
+        
+        char *endptr;
+        long pid = strtol(argv[i], &endptr, 10);
+        if (*endptr != '\0' || endptr == argv[i]) {
+            fprintf(stderr, "kill: %s: arguments must be process or job IDs\n", argv[i]);
+            ret = 1;
+        } else if (kill((pid_t)pid, sig) < 0) {
+            fprintf(stderr, "kill: (%ld) - %s\n", pid, strerror(errno));
+            ret = 1;
+        }
+    }
+    
+    // A stopped or cancelled thread job shows its new state right away
+    jobs_update_status();
+    return ret;
+}
+
+/**
+ * wait - Wait for background jobs to finish
+ * Usage: wait [%job|pid...]
+ * 
+ * Without arguments waits for every running job and returns 0. Otherwise
+ * returns the exit status of the last job named. Ctrl+C stops waiting
+ * (status 130) and leaves the jobs running.
+ */
+int builtin_wait(char **argv, Env *env) {
+    (void)env;  // Unused
+    
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+    
+    if (check_help_flag(argc, argv)) {
+        const HelpEntry *help = get_help_entry("wait");
+        if (help) {
+            print_help(help);
+            return 0;
+        }
+    }
+    
+    jobs_update_status();
+    
+    if (argv[1] == NULL) {
+        // Snapshot the IDs: waiting reaps and may reorder the table
+        int ids[MAX_JOBS];
+        int count = 0;
+        for (int i = 0; i < jobs_count() && count < MAX_JOBS; i++) {
+            Job *job = jobs_get_by_index(i);
+            if (job != NULL && job->status == JOB_RUNNING) {
+                ids[count++] = job->job_id;
+            }
+        }
+        for (int i = 0; i < count; i++) {
+            jobs_wait(ids[i], 0);
+            Job *job = jobs_get(ids[i]);
+            if (job != NULL && job->status != JOB_DONE) {
+                return 130;     // Ctrl+C stopped the wait
+            }
+        }
+        return 0;
+    }
+    
+    int status = 0;
+    for (int i = 1; argv[i] != NULL; i++) {
+        int job_id = parse_job_spec(argv[i]);
+        if (job_id < 0) {
+            char *endptr;
+            long pid = strtol(argv[i], &endptr, 10);
+            Job *job = (*endptr == '\0' && endptr != argv[i]) ? jobs_get_by_pid((pid_t)pid) : NULL;
+            if (job == NULL) {
+                fprintf(stderr, "wait: pid %s is not a child of this shell\n", argv[i]);
+                status = 127;
+                continue;
+            }
+            job_id = job->job_id;
+        }
+        
+        status = jobs_wait(job_id, 0);
+        if (status < 0) {
+            fprintf(stderr, "wait: %s: no such job\n", argv[i]);
+            status = 127;
+        }
+    }
+    return status;
+}
+
+/**
+ * jobctl - Set a job's CPUs, scheduling class, nice and I/O priority
+ * Usage: jobctl [%job... | --pool] [--cpus LIST] [--sched CLASS]
+ *               [--nice N] [--ionice CLASS[:LEVEL]]
+ * 
+ * Process jobs change on every thread of their process group, thread jobs
+ * on the worker running them, --pool on every worker thread. Without
+ * options the current settings are shown (all jobs if none is named).
+ */
+int builtin_jobctl(char **argv, Env *env) {
+    (void)env;  // Unused
+    
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+    
+    if (check_help_flag(argc, argv)) {
+        const HelpEntry *help = get_help_entry("jobctl");
+        if (help) {
+            print_help(help);
+            return 0;
+        }
+    }
+    
+    JobSched sched;
+    jobsched_init(&sched);
+    int ids[MAX_JOBS];
+    int count = 0;
+    int pool = 0;
+    for (int i = 1; argv[i] != NULL; ) {
+        int parsed = jobsched_parse_option(argv, &i, &sched, "jobctl");
+        if (parsed < 0) {
+            return 2;
+        }
+        if (parsed > 0) {
+            continue;
+        }
+        if (strcmp(argv[i], "--pool") == 0) {
+            pool = 1;
+        } else {
+            int job_id = parse_job_spec(argv[i]);
+            if (job_id <= 0 || jobs_get(job_id) == NULL) {
+                fprintf(stderr, "jobctl: %s: no such job\n", argv[i]);
+                return 1;
+            }
+            if (count < MAX_JOBS) {
+                ids[count++] = job_id;
+            }
+        }
+        i++;
+    }
+    
+    int changing = !jobsched_empty(&sched);
+    if (changing && count == 0 && !pool) {
+        fprintf(stderr, "Usage: jobctl %%job|--pool [--cpus LIST] [--sched CLASS] "
+                        "[--nice N] [--ionice CLASS[:LEVEL]]\n");
+        return 2;
+    }
+    jobs_update_status();
+    if (count == 0 && !pool) {
+        for (int i = 0; i < jobs_count() && count < MAX_JOBS; i++) {
+            Job *job = jobs_get_by_index(i);
+            if (job != NULL && job->status != JOB_DONE) {
+                ids[count++] = job->job_id;
+            }
+        }
+    }
+    
+    int ret = 0;
+    for (int i = 0; i < count; i++) {
+        JobSched current;
+        if (changing && jobs_sched(ids[i], &sched) < 0) {
+            fprintf(stderr, "jobctl: %%%d: %s\n", ids[i], strerror(errno));
+            ret = 1;
+        } else if (!changing && jobs_sched_get(ids[i], &current) == 0) {
+            printf("[%d]  ", ids[i]);
+            if (jobsched_empty(&current)) {
+                printf("(thread job not started)");   // Nothing pending either
+            }
+            jobsched_print(stdout, &current);
+            printf("\n");
+        }
+    }
+    
+    // The pool is created here if needed; workers it adds later
+    // start with the same settings
+    if (pool) {
+        pid_t tids[THREAD_POOL_MAX_WORKERS];
+        int workers = thread_pool_tids(thread_pool_shared(), tids, THREAD_POOL_MAX_WORKERS);
+        if (workers < 0) {
+            fprintf(stderr, "jobctl: --pool: no worker pool\n");
+            return 1;
+        }
+        if (changing && thread_pool_set_sched(g_thread_pool, &sched) < 0) {
+            fprintf(stderr, "jobctl: --pool: %s\n", strerror(errno));
+            ret = 1;
+        }
+        for (int i = 0; i < workers && !changing; i++) {
+            JobSched current;
+            if (jobsched_get(tids[i], &current) == 0) {
+                printf("worker %d  ", (int)tids[i]);
+                jobsched_print(stdout, &current);
+                printf("\n");
+            }
+        }
+    }
+    return ret;
+}
+
+/**
+ * pool - Show or resize the worker thread pool
+ * Usage: pool [--min N] [--max N] [--idle SEC] [--grow-wait MS] [--reset]
+ * 
+ * Prints the pool's size and limits, then one line per worker: tasks
+ * run, time busy, time its tasks waited in the queue and time idle.
+ * The options change the limits; --reset zeroes the counters.
+ */
+int builtin_pool(char **argv, Env *env) {
+    (void)env;  // Unused
+    
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+    
+    if (check_help_flag(argc, argv)) {
+        const HelpEntry *help = get_help_entry("pool");
+        if (help) {
+            print_help(help);
+            return 0;
+        }
+    }
+    
+    int limits[4] = { -1, -1, -1, -1 };   // min, max, idle ms, grow wait ms
+    static const char *limit_opts[4] = { "--min", "--max", "--idle", "--grow-wait" };
+    int reset = 0;
+    for (int i = 1; argv[i] != NULL; i++) {
+        if (strcmp(argv[i], "--reset") == 0) {
+            reset = 1;
+            continue;
+        }
+        int k = 0;
+        while (k < 4 && strcmp(argv[i], limit_opts[k]) != 0) {
+            k++;
+        }
+        char *endptr = NULL;
+        long value = (k < 4 && argv[i + 1] != NULL) ? strtol(argv[i + 1], &endptr, 10) : -1;
+        if (k == 4 || endptr == NULL || *endptr != '\0' || endptr == argv[i + 1] || value < 0 ||
+            value > 86400000) {
+            fprintf(stderr, "Usage: pool [--min N] [--max N] [--idle SEC] [--grow-wait MS] [--reset]\n");
+            return 2;
+        }
+        limits[k] = (int)(k == 2 ? value * 1000 : value);
+        i++;
+    }
+    
+    ThreadPool *shared = thread_pool_shared();
+    ThreadPoolStats stats;
+    PoolWorker workers[THREAD_POOL_MAX_WORKERS];
+    if (thread_pool_stats(shared, &stats, NULL, 0) < 0) {
+        fprintf(stderr, "pool: no worker pool in this process\n");
+        return 1;
+    }
+    if ((limits[0] >= 0 || limits[1] >= 0 || limits[2] >= 0 || limits[3] >= 0) &&
+        thread_pool_set_limits(shared, limits[0], limits[1], limits[2], limits[3]) < 0) {
+        fprintf(stderr, "pool: limits must satisfy 1 <= min <= max <= %d\n",
+                THREAD_POOL_MAX_WORKERS);
+        return 1;
+    }
+    if (reset) {
+        thread_pool_reset_stats(shared);
+    }
+    if (reset || limits[0] >= 0 || limits[1] >= 0 || limits[2] >= 0 || limits[3] >= 0) {
+        return 0;
+    }
+    
+    int count = thread_pool_stats(shared, &stats, workers, THREAD_POOL_MAX_WORKERS);
+    printf("workers %d (min %d, max %d), busy %d, queued %d/%d\n",
+           stats.num_threads, stats.min_threads, stats.max_threads,
+           stats.busy_threads, stats.queue_size, stats.queue_capacity);
+    printf("grown %lu, shrunk %lu; grow after %d ms queue wait, retire after %d s idle\n",
+           stats.grown, stats.shrunk, stats.grow_wait_ms, stats.idle_timeout_ms / 1000);
+    printf("%8s %8s %12s %12s %12s  %s\n", "TID", "TASKS", "BUSY(ms)", "WAIT(ms)", "IDLE(ms)", "STATE");
+    for (int i = 0; i < count; i++) {
+        printf("%8d %8lu %12.1f %12.1f %12.1f  %s\n", (int)workers[i].tid, workers[i].tasks,
+               workers[i].busy_ns / 1e6, workers[i].wait_ns / 1e6, workers[i].idle_ns / 1e6,
+               workers[i].state == POOL_WORKER_BUSY ? "busy" : "idle");
+    }
+    return 0;
+}
+
+/**
+ * memstats - Show memory use by subsystem
+ * Usage: memstats
+ * 
+ * Prints allocations, frees, live and peak bytes counted by the mem_*
+ * wrappers for each subsystem, the interned strings, the process RSS
+ * and the malloc heap totals.
+ */
+int builtin_memstats(char **argv, Env *env) {
+    (void)env;  // Unused
+    
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+    
+    if (check_help_flag(argc, argv)) {
+        const HelpEntry *help = get_help_entry("memstats");
+        if (help) {
+            print_help(help);
+            return 0;
+        }
+    }
+    if (argc > 1) {
+        fprintf(stderr, "Usage: memstats\n");
+        return 1;
+    }
+    
+    size_t strings, bytes;
+    intern_stats(&strings, &bytes);
+    mem_print_stats(stdout);
+    printf("interned %zu strings, %zu B\n", strings, bytes);
+    return 0;
+}
+
 /**
  * builtin_commands - List all available commands
  * 
@@ -945,96 +1361,8 @@ int builtin_commands(char **argv, Env *env) {
         json_mode = 1;
     }
     
-    if (json_mode) {
-        // Output JSON catalog for AI helper
-        printf("{\n");
-        printf("  \"commands\": [\n");
-        
-        // Built-in commands
-        printf("    {\"name\": \"cd\", \"summary\": \"Change directory\", \"description\": \"Change the current working directory\", \"usage\": \"cd [directory]\", \"options\": []},\n");
-        printf("    {\"name\": \"pwd\", \"summary\": \"Print working directory\", \"description\": \"Display the current working directory\", \"usage\": \"pwd\", \"options\": []},\n");
-        printf("    {\"name\": \"echo\", \"summary\": \"Print text\", \"description\": \"Print arguments to standard output\", \"usage\": \"echo [text...]\", \"options\": []},\n");
-        printf("    {\"name\": \"export\", \"summary\": \"Set environment variable\", \"description\": \"Set or export environment variables\", \"usage\": \"export VAR=value\", \"options\": []},\n");
-        printf("    {\"name\": \"exit\", \"summary\": \"Exit shell\", \"description\": \"Exit the shell with optional status code\", \"usage\": \"exit [status]\", \"options\": []},\n");
-        printf("    {\"name\": \"set\", \"summary\": \"Set shell variable\", \"description\": \"Set shell variables (key=value pairs)\", \"usage\": \"set\", \"options\": []},\n");
-        printf("    {\"name\": \"unset\", \"summary\": \"Unset variable\", \"description\": \"Remove shell or environment variable\", \"usage\": \"unset VAR\", \"options\": []},\n");
-        printf("    {\"name\": \"env\", \"summary\": \"Show environment\", \"description\": \"Display all environment variables\", \"usage\": \"env\", \"options\": []},\n");
-        printf("    {\"name\": \"help\", \"summary\": \"Show help\", \"description\": \"Display help information\", \"usage\": \"help\", \"options\": []},\n");
-        printf("    {\"name\": \"version\", \"summary\": \"Show version\", \"description\": \"Display shell version information\", \"usage\": \"version\", \"options\": []},\n");
-        printf("    {\"name\": \"history\", \"summary\": \"Command history\", \"description\": \"Display command history\", \"usage\": \"history\", \"options\": []},\n");
-        printf("    {\"name\": \"edi\", \"summary\": \"Text editor\", \"description\": \"Simple built-in text editor\", \"usage\": \"edi [file]\", \"options\": []},\n");
-        printf("    {\"name\": \"apt\", \"summary\": \"Package manager\", \"description\": \"APT-like package manager for shell\", \"usage\": \"apt <subcommand>\", \"options\": []},\n");
-        printf("    {\"name\": \"jobs\", \"summary\": \"List jobs\", \"description\": \"Display background and stopped jobs\", \"usage\": \"jobs\", \"options\": []},\n");
-        printf("    {\"name\": \"fg\", \"summary\": \"Foreground job\", \"description\": \"Bring job to foreground\", \"usage\": \"fg [job_id]\", \"options\": []},\n");
-        printf("    {\"name\": \"bg\", \"summary\": \"Background job\", \"description\": \"Resume job in background\", \"usage\": \"bg [job_id]\", \"options\": []},\n");
-        printf("    {\"name\": \"commands\", \"summary\": \"List commands\", \"description\": \"List all available commands\", \"usage\": \"commands [--json]\", \"options\": []},\n");
-        
-        // APT subcommands
-        printf("    {\"name\": \"apt install\", \"summary\": \"Install package\", \"description\": \"Install a package from repository\", \"usage\": \"apt install <package>\", \"options\": []},\n");
-        printf("    {\"name\": \"apt remove\", \"summary\": \"Remove package\", \"description\": \"Remove an installed package\", \"usage\": \"apt remove <package>\", \"options\": []},\n");
-        printf("    {\"name\": \"apt list\", \"summary\": \"List packages\", \"description\": \"List installed packages\", \"usage\": \"apt list\", \"options\": []},\n");
-        printf("    {\"name\": \"apt search\", \"summary\": \"Search packages\", \"description\": \"Search for available packages\", \"usage\": \"apt search <term>\", \"options\": []},\n");
-        printf("    {\"name\": \"apt show\", \"summary\": \"Show package info\", \"description\": \"Show package information\", \"usage\": \"apt show <package>\", \"options\": []},\n");
-        printf("    {\"name\": \"apt update\", \"summary\": \"Update index\", \"description\": \"Update package index\", \"usage\": \"apt update\", \"options\": []},\n");
-        printf("    {\"name\": \"apt depends\", \"summary\": \"Show dependencies\", \"description\": \"Show package dependencies\", \"usage\": \"apt depends <package>\", \"options\": []},\n");
-        printf("    {\"name\": \"apt clean\", \"summary\": \"Clean cache\", \"description\": \"Clean package cache\", \"usage\": \"apt clean\", \"options\": []},\n");
-        
-        // Tool commands
-        printf("    {\"name\": \"myls\", \"summary\": \"List files\", \"description\": \"List directory contents\", \"usage\": \"myls [directory]\", \"options\": []},\n");
-        printf("    {\"name\": \"mycat\", \"summary\": \"Show file\", \"description\": \"Display file contents\", \"usage\": \"mycat <file>\", \"options\": []},\n");
-        printf("    {\"name\": \"mycp\", \"summary\": \"Copy files\", \"description\": \"Copy files or directories\", \"usage\": \"mycp <source> <dest>\", \"options\": []},\n");
-        printf("    {\"name\": \"mymv\", \"summary\": \"Move files\", \"description\": \"Move or rename files\", \"usage\": \"mymv <source> <dest>\", \"options\": []},\n");
-        printf("    {\"name\": \"myrm\", \"summary\": \"Remove files\", \"description\": \"Remove files or directories\", \"usage\": \"myrm <file>\", \"options\": []},\n");
-        printf("    {\"name\": \"mymkdir\", \"summary\": \"Make directory\", \"description\": \"Create directories\", \"usage\": \"mymkdir <directory>\", \"options\": []},\n");
-        printf("    {\"name\": \"myrmdir\", \"summary\": \"Remove directory\", \"description\": \"Remove empty directories\", \"usage\": \"myrmdir <directory>\", \"options\": []},\n");
-        printf("    {\"name\": \"mytouch\", \"summary\": \"Create file\", \"description\": \"Create empty file or update timestamp\", \"usage\": \"mytouch <file>\", \"options\": []},\n");
-        printf("    {\"name\": \"mystat\", \"summary\": \"File status\", \"description\": \"Display file status information\", \"usage\": \"mystat <file>\", \"options\": []},\n");
-        printf("    {\"name\": \"myfd\", \"summary\": \"Find files\", \"description\": \"Search for files by name\", \"usage\": \"myfd <pattern>\", \"options\": []}\n");
-        
-        printf("  ]\n");
-        printf("}\n");
-    } else {
-        // Human-readable output
-        printf("Available commands:\n\n");
-        printf("Built-in Commands:\n");
-        printf("  cd          - Change directory\n");
-        printf("  pwd         - Print working directory\n");
-        printf("  echo        - Print text\n");
-        printf("  export      - Set environment variable\n");
-        printf("  exit        - Exit shell\n");
-        printf("  set         - Set shell variable\n");
-        printf("  unset       - Unset variable\n");
-        printf("  env         - Show environment\n");
-        printf("  help        - Show help\n");
-        printf("  version     - Show version\n");
-        printf("  history     - Command history\n");
-        printf("  edi         - Text editor\n");
-        printf("  apt         - Package manager\n");
-        printf("  jobs        - List jobs\n");
-        printf("  fg          - Foreground job\n");
-        printf("  bg          - Background job\n");
-        printf("  commands    - List commands\n");
-        printf("\nAPT Subcommands:\n");
-        printf("  apt install - Install package\n");
-        printf("  apt remove  - Remove package\n");
-        printf("  apt list    - List packages\n");
-        printf("  apt search  - Search packages\n");
-        printf("  apt show    - Show package info\n");
-        printf("  apt update  - Update index\n");
-        printf("  apt depends - Show dependencies\n");
-        printf("  apt clean   - Clean cache\n");
-        printf("\nTool Commands:\n");
-        printf("  myls        - List files\n");
-        printf("  mycat       - Show file\n");
-        printf("  mycp        - Copy files\n");
-        printf("  mymv        - Move files\n");
-        printf("  myrm        - Remove files\n");
-        printf("  mymkdir     - Make directory\n");
-        printf("  myrmdir     - Remove directory\n");
-        printf("  mytouch     - Create file\n");
-        printf("  mystat      - File status\n");
-        printf("  myfd        - Find files\n");
-    }
+    // Both listings are rendered from commands.def at build time
+    fputs(json_mode ? registry_json : registry_text, stdout);
     
     return 0;
 }
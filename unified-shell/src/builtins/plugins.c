@@ -0,0 +1,195 @@
+/**
+ * plugins.c - Loadable builtins (enable -f)
+ *
+ * Each loaded command holds a dlopen() handle; libraries loaded for
+ * several commands are opened once per command (dlopen reference counts
+ * them), so unloading one command never pulls code out from under another.
+ */
+
+#include "plugins.h"
+#include "ushell_builtin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <dlfcn.h>
+
+#define MAX_PLUGINS 64
+
+typedef struct {
+    char *name;
+    char *path;
+    void *handle;
+    const struct ushell_builtin *desc;
+    unsigned long calls;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} Plugin;
+
+static Plugin plugins[MAX_PLUGINS];
+static int plugin_total = 0;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static Plugin *lookup(const char *name) {
+    for (int i = 0; i < plugin_total; i++) {
+        if (strcmp(plugins[i].name, name) == 0) {
+            return &plugins[i];
+        }
+    }
+    return NULL;
+}
+
+int plugin_count(void) {
+    return plugin_total;
+}
+
+/**
+ * Find the descriptor for name: NAME_ushell_builtin first, then a plain
+ * ushell_builtin describing that command
+ */
+static const struct ushell_builtin *find_descriptor(void *handle, const char *name) {
+    char symbol[256];
+    snprintf(symbol, sizeof(symbol), "%s_ushell_builtin", name);
+    const struct ushell_builtin *desc = dlsym(handle, symbol);
+    if (desc == NULL) {
+        desc = dlsym(handle, "ushell_builtin");
+        if (desc != NULL && (desc->name == NULL || strcmp(desc->name, name) != 0)) {
+            desc = NULL;
+        }
+    }
+    return desc;
+}
+
+int plugin_load(const char *path, const char *name, char *err, size_t err_size) {
+    if (lookup(name) != NULL) {
+        snprintf(err, err_size, "%s: already loaded (enable -d %s first)", name, name);
+        return -1;
+    }
+    if (plugin_total >= MAX_PLUGINS) {
+        snprintf(err, err_size, "too many loaded builtins (max %d)", MAX_PLUGINS);
+        return -1;
+    }
+
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (handle == NULL) {
+        snprintf(err, err_size, "%s", dlerror());
+        return -1;
+    }
+
+    const struct ushell_builtin *desc = find_descriptor(handle, name);
+    if (desc == NULL) {
+        snprintf(err, err_size, "%s: %s: no %s_ushell_builtin descriptor", path, name, name);
+        dlclose(handle);
+        return -1;
+    }
+    if (desc->abi_version != USHELL_BUILTIN_ABI) {
+        snprintf(err, err_size, "%s: %s: built for plugin ABI %u, shell supports %d",
+                 path, name, desc->abi_version, USHELL_BUILTIN_ABI);
+        dlclose(handle);
+        return -1;
+    }
+    if (desc->func == NULL) {
+        snprintf(err, err_size, "%s: %s: descriptor has no function", path, name);
+        dlclose(handle);
+        return -1;
+    }
+    if (desc->load != NULL && desc->load() != 0) {
+        snprintf(err, err_size, "%s: %s: plugin refused to load", path, name);
+        dlclose(handle);
+        return -1;
+    }
+
+    Plugin *p = &plugins[plugin_total];
+    memset(p, 0, sizeof(*p));
+    p->name = strdup(name);
+    p->path = strdup(path);
+    p->handle = handle;
+    p->desc = desc;
+    if (p->name == NULL || p->path == NULL) {
+        free(p->name);
+        free(p->path);
+        if (desc->unload != NULL) desc->unload();
+        dlclose(handle);
+        snprintf(err, err_size, "out of memory");
+        return -1;
+    }
+    plugin_total++;
+    return 0;
+}
+
+int plugin_unload(const char *name) {
+    Plugin *p = lookup(name);
+    if (p == NULL) {
+        return -1;
+    }
+    if (p->desc->unload != NULL) {
+        p->desc->unload();
+    }
+    dlclose(p->handle);
+    free(p->name);
+    free(p->path);
+
+    int index = (int)(p - plugins);
+    memmove(&plugins[index], &plugins[index + 1],
+            (size_t)(plugin_total - index - 1) * sizeof(Plugin));
+    plugin_total--;
+    return 0;
+}
+
+/**
+ * Shared builtin_func for every loaded command
+ */
+static int plugin_dispatch(char **argv, Env *env) {
+    (void)env;  // Plugins see their arguments and the process environment
+    Plugin *p = lookup(argv[0]);
+    if (p == NULL) {
+        return 127;
+    }
+
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+
+    uint64_t start = now_ns();
+    int status = p->desc->func(argc, argv);
+    uint64_t elapsed = now_ns() - start;
+    fflush(stdout);
+
+    p->calls++;
+    p->total_ns += elapsed;
+    if (elapsed > p->max_ns) {
+        p->max_ns = elapsed;
+    }
+    return status;
+}
+
+builtin_func plugin_find(const char *name) {
+    if (plugin_total == 0 || name == NULL) {
+        return NULL;
+    }
+    return lookup(name) != NULL ? plugin_dispatch : NULL;
+}
+
+void plugin_print(FILE *out) {
+    if (plugin_total == 0) {
+        fprintf(out, "No loaded builtins.\n");
+        return;
+    }
+    fprintf(out, "%-14s %8s %10s %9s %9s  %s\n",
+            "NAME", "CALLS", "TOTAL ms", "AVG us", "MAX us", "LIBRARY");
+    for (int i = 0; i < plugin_total; i++) {
+        Plugin *p = &plugins[i];
+        double avg_us = p->calls ? (double)p->total_ns / p->calls / 1000.0 : 0.0;
+        fprintf(out, "%-14s %8lu %10.3f %9.2f %9.2f  %s\n",
+                p->name, p->calls, (double)p->total_ns / 1e6, avg_us,
+                (double)p->max_ns / 1000.0, p->path);
+        if (p->desc->summary != NULL) {
+            fprintf(out, "%-14s %s\n", "", p->desc->summary);
+        }
+    }
+}
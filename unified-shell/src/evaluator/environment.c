@@ -2,6 +2,99 @@
 #include <stdlib.h>
 #include <string.h>
 #include "environment.h"
+#include "intern.h"
+#include "memstats.h"
+
+/**
+ * binding_store - Copy value into a binding, reusing its buffer if it fits
+ * Caller must hold env_mutex.
+ */
+static void binding_store(Binding *binding, const char *value) {
+    size_t len = strlen(value);
+    
+    if (binding->value == NULL || len + 1 > binding->value_cap) {
+        // Round up so slowly growing values (counters) rarely reallocate
+        size_t cap = (len + 16) & ~(size_t)15;
+        char *fresh = mem_malloc(MEM_ENV, cap);
+        if (!fresh) {
+            fprintf(stderr, "env_set: malloc failed\n");
+            exit(1);
+        }
+        mem_free(MEM_ENV, binding->value);
+        binding->value = fresh;
+        binding->value_cap = cap;
+    }
+    memcpy(binding->value, value, len + 1);
+}
+
+/*
+ * One variable's state before its first change inside a snapshot
+ */
+typedef struct {
+    char *name;
+    char *value;        /* NULL if the variable was not bound */
+    char **items;       /* Saved array elements */
+    int count;
+    int had_array;
+} EnvUndo;
+
+struct EnvSnapshot {
+    EnvUndo *undo;
+    int count;
+    int capacity;
+    EnvSnapshot *outer;
+};
+
+static void array_free_items(char **items, int count);
+static ArrayBinding *array_find(Env *env, const char *name);
+
+/**
+ * snapshot_save - Record name's current state in the open snapshot
+ * Only the first change to a name is recorded: that is the state the
+ * snapshot restores. Caller must hold env_mutex.
+ */
+static void snapshot_save(Env *env, const char *name) {
+    EnvSnapshot *snap = env->snapshot;
+    
+    if (!snap) {
+        return;
+    }
+    for (int i = 0; i < snap->count; i++) {
+        if (strcmp(snap->undo[i].name, name) == 0) {
+            return;
+        }
+    }
+    
+    if (snap->count == snap->capacity) {
+        int cap = snap->capacity ? snap->capacity * 2 : 8;
+        EnvUndo *grown = realloc(snap->undo, cap * sizeof(EnvUndo));
+        if (!grown) {
+            fprintf(stderr, "env_snapshot: realloc failed\n");
+            exit(1);
+        }
+        snap->undo = grown;
+        snap->capacity = cap;
+    }
+    
+    EnvUndo *undo = &snap->undo[snap->count++];
+    memset(undo, 0, sizeof(*undo));
+    undo->name = strdup(name);
+    for (int i = 0; i < env->count; i++) {
+        if (env->bindings[i].name && strcmp(env->bindings[i].name, name) == 0) {
+            undo->value = strdup(env->bindings[i].value);
+            break;
+        }
+    }
+    ArrayBinding *arr = array_find(env, name);
+    if (arr) {
+        undo->had_array = 1;
+        undo->count = arr->count;
+        undo->items = malloc((arr->count + 1) * sizeof(char *));
+        for (int i = 0; undo->items && i < arr->count; i++) {
+            undo->items[i] = strdup(arr->items[i]);
+        }
+    }
+}
 
 /**
  * env_new - Allocate and initialize an empty environment
@@ -11,32 +104,70 @@
  */
 Env* env_new(void) {
     Env *env;
-    int i;
     
-    env = (Env *)malloc(sizeof(Env));
+    env = (Env *)mem_malloc(MEM_ENV, sizeof(Env));
     if (!env) {
         fprintf(stderr, "env_new: malloc failed\n");
         exit(1);
     }
     
+    // The binding table is allocated by the first env_set
+    env->bindings = NULL;
     env->count = 0;
+    env->capacity = 0;
+    env->generation = 1;
+    env->arrays = NULL;
+    env->array_count = 0;
+    env->array_capacity = 0;
+    env->snapshot = NULL;
     
     // Initialize mutex for thread-safe access
     if (pthread_mutex_init(&env->env_mutex, NULL) != 0) {
         fprintf(stderr, "env_new: mutex initialization failed\n");
-        free(env);
+        mem_free(MEM_ENV, env);
         exit(1);
     }
     
-    // Initialize all bindings to NULL for safety
-    for (i = 0; i < MAX_VARS; i++) {
-        env->bindings[i].name = NULL;
-        env->bindings[i].value = NULL;
-    }
-    
     return env;
 }
 
+/**
+ * array_free_items - Free an array's element strings and vector
+ */
+static void array_free_items(char **items, int count) {
+    for (int i = 0; i < count; i++) {
+        free(items[i]);
+    }
+    free(items);
+}
+
+/**
+ * array_find - Locate an array binding by name
+ * Caller must hold env_mutex.
+ */
+static ArrayBinding *array_find(Env *env, const char *name) {
+    for (int i = 0; i < env->array_count; i++) {
+        if (strcmp(env->arrays[i].name, name) == 0) {
+            return &env->arrays[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * array_remove - Drop an array binding if present
+ * Caller must hold env_mutex.
+ */
+static void array_remove(Env *env, const char *name) {
+    ArrayBinding *arr = array_find(env, name);
+    if (!arr) {
+        return;
+    }
+    free(arr->name);
+    array_free_items(arr->items, arr->count);
+    *arr = env->arrays[--env->array_count];
+}
+
 /**
  * env_free - Free environment and all allocated strings
  * @env: Environment to free
@@ -50,20 +181,22 @@ void env_free(Env *env) {
         return;
     }
     
-    // Free all name and value strings
+    // Free all values (names are interned)
     for (i = 0; i < env->count; i++) {
-        if (env->bindings[i].name) {
-            free(env->bindings[i].name);
-        }
-        if (env->bindings[i].value) {
-            free(env->bindings[i].value);
-        }
+        mem_free(MEM_ENV, env->bindings[i].value);
+    }
+    mem_free(MEM_ENV, env->bindings);
+    
+    for (i = 0; i < env->array_count; i++) {
+        free(env->arrays[i].name);
+        array_free_items(env->arrays[i].items, env->arrays[i].count);
     }
+    free(env->arrays);
     
     // Destroy mutex before freeing environment
     pthread_mutex_destroy(&env->env_mutex);
     
-    free(env);
+    mem_free(MEM_ENV, env);
 }
 
 /**
@@ -120,40 +253,42 @@ void env_set(Env *env, const char *name, const char *value) {
     
     // Lock mutex for thread-safe access
     pthread_mutex_lock(&env->env_mutex);
+    snapshot_save(env, name);
     
     // Check if variable already exists - update it
     for (i = 0; i < env->count; i++) {
         if (env->bindings[i].name && strcmp(env->bindings[i].name, name) == 0) {
-            // Free old value and set new one
-            free(env->bindings[i].value);
-            env->bindings[i].value = strdup(value);
-            if (!env->bindings[i].value) {
-                fprintf(stderr, "env_set: strdup failed\n");
-                pthread_mutex_unlock(&env->env_mutex);
-                exit(1);
-            }
+            binding_store(&env->bindings[i], value);
             pthread_mutex_unlock(&env->env_mutex);
             return;
         }
     }
     
     // Variable doesn't exist - create new binding
-    if (env->count >= MAX_VARS) {
-        fprintf(stderr, "env_set: maximum number of variables (%d) reached\n", MAX_VARS);
-        pthread_mutex_unlock(&env->env_mutex);
-        return;
+    if (env->count == env->capacity) {
+        int cap = env->capacity ? env->capacity * 2 : ENV_INITIAL_BINDINGS;
+        Binding *grown = mem_realloc(MEM_ENV, env->bindings, cap * sizeof(Binding));
+        if (!grown) {
+            fprintf(stderr, "env_set: realloc failed\n");
+            pthread_mutex_unlock(&env->env_mutex);
+            exit(1);
+        }
+        env->bindings = grown;
+        env->capacity = cap;
     }
     
-    env->bindings[env->count].name = strdup(name);
-    env->bindings[env->count].value = strdup(value);
-    
-    if (!env->bindings[env->count].name || !env->bindings[env->count].value) {
-        fprintf(stderr, "env_set: strdup failed\n");
+    env->bindings[env->count].name = intern(name);
+    if (!env->bindings[env->count].name) {
+        fprintf(stderr, "env_set: intern failed\n");
         pthread_mutex_unlock(&env->env_mutex);
         exit(1);
     }
+    env->bindings[env->count].value = NULL;
+    env->bindings[env->count].value_cap = 0;
+    binding_store(&env->bindings[env->count], value);
     
     env->count++;
+    env->generation++;
     
     pthread_mutex_unlock(&env->env_mutex);
 }
@@ -174,13 +309,15 @@ void env_unset(Env *env, const char *name) {
     
     // Lock mutex for thread-safe access
     pthread_mutex_lock(&env->env_mutex);
+    snapshot_save(env, name);
+    
+    array_remove(env, name);
     
     // Find the variable
     for (i = 0; i < env->count; i++) {
         if (env->bindings[i].name && strcmp(env->bindings[i].name, name) == 0) {
-            // Free the strings
-            free(env->bindings[i].name);
-            free(env->bindings[i].value);
+            // Free the value (names are interned)
+            mem_free(MEM_ENV, env->bindings[i].value);
             
             // Shift remaining bindings down
             for (j = i; j < env->count - 1; j++) {
@@ -190,8 +327,10 @@ void env_unset(Env *env, const char *name) {
             // Clear the last binding
             env->bindings[env->count - 1].name = NULL;
             env->bindings[env->count - 1].value = NULL;
+            env->bindings[env->count - 1].value_cap = 0;
             
             env->count--;
+            env->generation++;
             pthread_mutex_unlock(&env->env_mutex);
             return;
         }
@@ -200,6 +339,250 @@ void env_unset(Env *env, const char *name) {
     pthread_mutex_unlock(&env->env_mutex);
 }
 
+/**
+ * env_resolve_slot - Refresh a slot's cached index if env changed
+ * Caller must hold env_mutex.
+ */
+static void env_resolve_slot(Env *env, EnvSlot *slot) {
+    if (slot->generation == env->generation) {
+        return;
+    }
+    
+    slot->index = -1;
+    for (int i = 0; i < env->count; i++) {
+        if (env->bindings[i].name && strcmp(env->bindings[i].name, slot->name) == 0) {
+            slot->index = i;
+            break;
+        }
+    }
+    slot->generation = env->generation;
+}
+
+/**
+ * env_get_slot - env_get() through a cached slot
+ * @env: Environment to search
+ * @slot: Slot naming the variable (updated in place)
+ * Returns: Variable value or NULL, with the same getenv() fallback as env_get
+ */
+char* env_get_slot(Env *env, EnvSlot *slot) {
+    char *result = NULL;
+    
+    if (!env || !slot) {
+        return NULL;
+    }
+    
+    pthread_mutex_lock(&env->env_mutex);
+    env_resolve_slot(env, slot);
+    if (slot->index >= 0) {
+        result = env->bindings[slot->index].value;
+    }
+    pthread_mutex_unlock(&env->env_mutex);
+    
+    return result ? result : getenv(slot->name);
+}
+
+/**
+ * env_set_slot - env_set() through a cached slot
+ * @env: Environment to modify
+ * @slot: Slot naming the variable (updated in place)
+ * @value: Variable value
+ */
+void env_set_slot(Env *env, EnvSlot *slot, const char *value) {
+    if (!env || !slot || !value) {
+        return;
+    }
+    
+    pthread_mutex_lock(&env->env_mutex);
+    env_resolve_slot(env, slot);
+    if (slot->index >= 0) {
+        snapshot_save(env, slot->name);
+        binding_store(&env->bindings[slot->index], value);
+        pthread_mutex_unlock(&env->env_mutex);
+        return;
+    }
+    pthread_mutex_unlock(&env->env_mutex);
+    
+    // First assignment creates the binding (and bumps the generation)
+    env_set(env, slot->name, value);
+}
+
+/**
+ * env_array_assign - Replace (or create) an indexed array
+ * @env: Environment to modify
+ * @name: Array name
+ * @items: malloc'd vector of malloc'd strings; ownership passes to env
+ * @count: Number of elements
+ */
+void env_array_assign(Env *env, const char *name, char **items, int count) {
+    if (!env || !name) {
+        array_free_items(items, count);
+        return;
+    }
+    
+    pthread_mutex_lock(&env->env_mutex);
+    snapshot_save(env, name);
+    
+    ArrayBinding *arr = array_find(env, name);
+    if (arr) {
+        array_free_items(arr->items, arr->count);
+    } else {
+        if (env->array_count == env->array_capacity) {
+            int cap = env->array_capacity ? env->array_capacity * 2 : 4;
+            ArrayBinding *grown = realloc(env->arrays, cap * sizeof(ArrayBinding));
+            if (!grown) {
+                fprintf(stderr, "env_array_assign: realloc failed\n");
+                pthread_mutex_unlock(&env->env_mutex);
+                exit(1);
+            }
+            env->arrays = grown;
+            env->array_capacity = cap;
+        }
+        arr = &env->arrays[env->array_count++];
+        arr->name = strdup(name);
+        if (!arr->name) {
+            fprintf(stderr, "env_array_assign: strdup failed\n");
+            pthread_mutex_unlock(&env->env_mutex);
+            exit(1);
+        }
+    }
+    arr->items = items;
+    arr->count = count;
+    
+    pthread_mutex_unlock(&env->env_mutex);
+}
+
+/**
+ * env_array_count - Number of elements in an array
+ * Returns: Element count, or -1 if name is not an array
+ */
+int env_array_count(Env *env, const char *name) {
+    int count = -1;
+    
+    if (!env || !name) {
+        return -1;
+    }
+    
+    pthread_mutex_lock(&env->env_mutex);
+    ArrayBinding *arr = array_find(env, name);
+    if (arr) {
+        count = arr->count;
+    }
+    pthread_mutex_unlock(&env->env_mutex);
+    
+    return count;
+}
+
+/**
+ * env_array_get - Element of an array
+ * Returns: Element string, or NULL if the array or index does not exist
+ */
+const char* env_array_get(Env *env, const char *name, int index) {
+    const char *result = NULL;
+    
+    if (!env || !name || index < 0) {
+        return NULL;
+    }
+    
+    pthread_mutex_lock(&env->env_mutex);
+    ArrayBinding *arr = array_find(env, name);
+    if (arr && index < arr->count) {
+        result = arr->items[index];
+    }
+    pthread_mutex_unlock(&env->env_mutex);
+    
+    return result;
+}
+
+/**
+ * env_array_items - All elements of an array
+ * @count: Output: number of elements
+ * Returns: Internal element vector (valid until the array is reassigned), or NULL
+ */
+char** env_array_items(Env *env, const char *name, int *count) {
+    char **items = NULL;
+    
+    *count = 0;
+    if (!env || !name) {
+        return NULL;
+    }
+    
+    pthread_mutex_lock(&env->env_mutex);
+    ArrayBinding *arr = array_find(env, name);
+    if (arr) {
+        items = arr->items;
+        *count = arr->count;
+    }
+    pthread_mutex_unlock(&env->env_mutex);
+    
+    return items;
+}
+
+/**
+ * env_snapshot_begin - Start recording changes so they can be undone
+ * @env: Environment to snapshot
+ * Returns: Snapshot to pass to env_snapshot_discard
+ *
+ * Nothing is copied up front; variables are saved as they are first
+ * changed, so a subshell that touches two variables costs two copies.
+ */
+EnvSnapshot* env_snapshot_begin(Env *env) {
+    EnvSnapshot *snap = calloc(1, sizeof(EnvSnapshot));
+    if (!snap) {
+        fprintf(stderr, "env_snapshot_begin: calloc failed\n");
+        exit(1);
+    }
+    
+    pthread_mutex_lock(&env->env_mutex);
+    snap->outer = env->snapshot;
+    env->snapshot = snap;
+    pthread_mutex_unlock(&env->env_mutex);
+    
+    return snap;
+}
+
+/**
+ * env_snapshot_discard - Undo every change made since env_snapshot_begin
+ * @env: Environment the snapshot was taken of
+ * @snap: Innermost open snapshot (freed)
+ */
+void env_snapshot_discard(Env *env, EnvSnapshot *snap) {
+    if (!env || !snap) {
+        return;
+    }
+    
+    // Restoring must not be recorded by the enclosing snapshot: its own
+    // journal already holds anything it needs from before this one
+    pthread_mutex_lock(&env->env_mutex);
+    env->snapshot = NULL;
+    pthread_mutex_unlock(&env->env_mutex);
+    
+    for (int i = snap->count - 1; i >= 0; i--) {
+        EnvUndo *undo = &snap->undo[i];
+        if (undo->value) {
+            env_set(env, undo->name, undo->value);
+        } else {
+            env_unset(env, undo->name);
+        }
+        if (undo->had_array) {
+            env_array_assign(env, undo->name, undo->items, undo->count);
+            undo->items = NULL;
+        } else {
+            pthread_mutex_lock(&env->env_mutex);
+            array_remove(env, undo->name);
+            pthread_mutex_unlock(&env->env_mutex);
+        }
+        free(undo->name);
+        free(undo->value);
+    }
+    
+    pthread_mutex_lock(&env->env_mutex);
+    env->snapshot = snap->outer;
+    pthread_mutex_unlock(&env->env_mutex);
+    
+    free(snap->undo);
+    free(snap);
+}
+
 /**
  * env_print - Print all variables in the environment (for debugging)
  * @env: Environment to print
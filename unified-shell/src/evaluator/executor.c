@@ -5,6 +5,13 @@
 #include "jobs.h"
 #include "signals.h"
 #include "threading.h"
+#include "conditional.h"
+#include "expansion.h"
+#include "script.h"
+#include "profile.h"
+#include "pipemon.h"
+#include "procsub.h"
+#include "lexscan.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,6 +25,21 @@
 
 #define MAX_EXPANDED_ARGS 1024
 
+int exec_tail_call = 0;
+
+/**
+ * Print why execvp failed (the caller exits with 127)
+ */
+static void report_exec_error(const char *name) {
+    if (errno == ENOENT) {
+        fprintf(stderr, "ushell: command not found: %s\n", name);
+    } else if (errno == EACCES) {
+        fprintf(stderr, "ushell: permission denied: %s\n", name);
+    } else {
+        perror("ushell");
+    }
+}
+
 /**
  * Execute a command with fork/exec (or threading for built-ins)
  * 
@@ -28,10 +50,19 @@
  * External commands continue to use fork/exec as before.
  */
 int execute_command(char **argv, Env *env) {
+    // Consumed here so functions and builtins never pass it on
+    int tail = exec_tail_call;
+    exec_tail_call = 0;
+
     if (argv == NULL || argv[0] == NULL) {
         return -1;
     }
 
+    // Shell functions take precedence over builtins and tools
+    if (script_has_function(argv[0])) {
+        return script_call_function(argv, env);
+    }
+
     // Check if it's a built-in command
     builtin_func builtin = find_builtin(argv[0]);
     if (builtin != NULL) {
@@ -50,17 +81,29 @@ int execute_command(char **argv, Env *env) {
     // Check if it's an integrated tool
     tool_func tool = find_tool(argv[0]);
     if (tool != NULL) {
-        // Count argc
-        int argc = 0;
-        while (argv[argc] != NULL) {
-            argc++;
+        // Execute tool in parent process; Ctrl+C cancels it cooperatively
+        return tool_run(tool, argv, env);
+    }
+
+    // Last command of a -c string or script: nothing is left for the shell
+    // to do once it finishes, so become the command instead of waiting
+    if (tail) {
+        jobs_update_status();
+        jobs_cleanup();
+        if (jobs_count() == 0) {
+            fflush(NULL);
+            execvp(argv[0], argv);
+            report_exec_error(argv[0]);
+            exit(127);
         }
-        // Execute tool in parent process (tools handle their own output)
-        return tool(argc, argv);
     }
 
-    // Not a built-in or tool, fork/exec
+    // Not a built-in or tool, fork/exec; builtin output still buffered
+    // in stdout must come out before the child's
+    fflush(NULL);
     pid_t pid = fork();
+    profile_forks++;
+    profile_execs++;
     
     if (pid < 0) {
         perror("fork");
@@ -69,15 +112,10 @@ int execute_command(char **argv, Env *env) {
     
     if (pid == 0) {
         // Child process
+        procsub_child_close(argv);
         execvp(argv[0], argv);
         // If execvp returns, it failed - provide detailed error
-        if (errno == ENOENT) {
-            fprintf(stderr, "ushell: command not found: %s\n", argv[0]);
-        } else if (errno == EACCES) {
-            fprintf(stderr, "ushell: permission denied: %s\n", argv[0]);
-        } else {
-            perror("ushell");
-        }
+        report_exec_error(argv[0]);
         exit(127);
     } else {
         // Parent process - this is a foreground job
@@ -135,30 +173,45 @@ static int is_delimiter(char c) {
 /**
  * Tokenize command line into arguments
  * Handles basic quoted strings for space preservation
+ *
+ * Delimiters and quotes are found through the line's class masks
+ * (lexscan.h), so each token costs a few mask scans instead of a test
+ * per byte.
+ *
+ * When quoted is non-NULL, *quoted receives a malloc'd flag per token
+ * that is 1 for tokens written in quotes.
  */
-char** tokenize_command(char *line) {
+static char **tokenize_words(char *line, char **quoted) {
     if (line == NULL) {
         return NULL;
     }
 
+    LexScan scan;
+    size_t len = strlen(line);
+    if (lexscan_init(&scan, line, len) < 0) {
+        perror("malloc");
+        return NULL;
+    }
+
     // Initial allocation for tokens
     int capacity = 16;
     int count = 0;
     char **tokens = malloc(capacity * sizeof(char*));
-    if (tokens == NULL) {
+    char *flags = quoted != NULL ? malloc(capacity) : NULL;
+    if (tokens == NULL || (quoted != NULL && flags == NULL)) {
         perror("malloc");
+        free(tokens);
+        free(flags);
+        lexscan_free(&scan);
         return NULL;
     }
 
-    char *ptr = line;
+    size_t pos = 0;
     
-    while (*ptr != '\0') {
+    for (;;) {
         // Skip leading whitespace
-        while (is_delimiter(*ptr)) {
-            ptr++;
-        }
-        
-        if (*ptr == '\0') {
+        pos = lexscan_next_not(&scan, LEX_SPACE, pos);
+        if (pos >= len) {
             break;
         }
         
@@ -168,62 +221,119 @@ char** tokenize_command(char *line) {
             char **new_tokens = realloc(tokens, capacity * sizeof(char*));
             if (new_tokens == NULL) {
                 perror("realloc");
+                tokens[count] = NULL;
                 free_tokens(tokens);
+                free(flags);
+                lexscan_free(&scan);
                 return NULL;
             }
             tokens = new_tokens;
+            if (flags != NULL) {
+                char *new_flags = realloc(flags, capacity);
+                if (new_flags == NULL) {
+                    perror("realloc");
+                    tokens[count] = NULL;
+                    free_tokens(tokens);
+                    free(flags);
+                    lexscan_free(&scan);
+                    return NULL;
+                }
+                flags = new_flags;
+            }
         }
         
-        // Handle quoted strings
-        if (*ptr == '"' || *ptr == '\'') {
-            char quote = *ptr;
-            ptr++; // Skip opening quote
-            
-            char *start = ptr;
-            while (*ptr != '\0' && *ptr != quote) {
-                ptr++;
-            }
-            
-            int len = ptr - start;
-            tokens[count] = malloc(len + 1);
-            if (tokens[count] == NULL) {
-                perror("malloc");
-                free_tokens(tokens);
-                return NULL;
-            }
-            strncpy(tokens[count], start, len);
-            tokens[count][len] = '\0';
-            count++;
-            
-            if (*ptr == quote) {
-                ptr++; // Skip closing quote
+        size_t start, end;
+        if (flags != NULL) {
+            flags[count] = (line[pos] == '"' || line[pos] == '\'');
+        }
+        if (line[pos] == '"' || line[pos] == '\'') {
+            // Quoted string: runs to the matching quote (other quotes are text)
+            char quote = line[pos];
+            start = pos + 1;
+            end = lexscan_next(&scan, LEX_QUOTE, start);
+            while (end < len && line[end] != quote) {
+                end = lexscan_next(&scan, LEX_QUOTE, end + 1);
             }
+            pos = end < len ? end + 1 : end;  // Skip closing quote
         } else {
             // Regular token
-            char *start = ptr;
-            while (*ptr != '\0' && !is_delimiter(*ptr)) {
-                ptr++;
-            }
-            
-            int len = ptr - start;
-            tokens[count] = malloc(len + 1);
-            if (tokens[count] == NULL) {
-                perror("malloc");
-                free_tokens(tokens);
-                return NULL;
-            }
-            strncpy(tokens[count], start, len);
-            tokens[count][len] = '\0';
-            count++;
+            start = pos;
+            end = lexscan_next(&scan, LEX_SPACE, start);
+            pos = end;
         }
+        
+        tokens[count] = malloc(end - start + 1);
+        if (tokens[count] == NULL) {
+            perror("malloc");
+            free_tokens(tokens);
+            free(flags);
+            lexscan_free(&scan);
+            return NULL;
+        }
+        memcpy(tokens[count], line + start, end - start);
+        tokens[count][end - start] = '\0';
+        count++;
     }
     
     // NULL-terminate the array
     tokens[count] = NULL;
+    lexscan_free(&scan);
+    if (quoted != NULL) {
+        *quoted = flags;
+    }
     
     return tokens;
 }
 
+char** tokenize_command(char *line) {
+    return tokenize_words(line, NULL);
+}
+
+/**
+ * Make the quoted pattern operands of a [[ ]] command literal
+ *
+ * Quotes are gone by the time builtin_dbracket sees its words, so a
+ * quoted right-hand side of = == != (glob) or =~ (regex) has its special
+ * characters backslash-escaped here: [[ abc == "a*" ]] is false, as in
+ * bash, while [[ abc == a* ]] still matches.
+ *
+ * Returns: 0 on success, -1 on allocation failure
+ */
+int escape_test_operands(char **argv, const char *quoted) {
+    for (int i = 2; argv[i] != NULL; i++) {
+        const char *op = argv[i - 1];
+        const char *special;
+        if (!quoted[i] || quoted[i - 1]) {
+            continue;
+        }
+        if (strcmp(op, "=") == 0 || strcmp(op, "==") == 0 || strcmp(op, "!=") == 0) {
+            special = "\\*?[]";
+        } else if (strcmp(op, "=~") == 0) {
+            special = "\\.[]()*+?{}|^$";
+        } else {
+            continue;
+        }
+
+        size_t len = strlen(argv[i]);
+        char *escaped = malloc(2 * len + 1);
+        if (escaped == NULL) {
+            perror("malloc");
+            return -1;
+        }
+        char *out = escaped;
+        for (const char *p = argv[i]; *p; p++) {
+            if (strchr(special, *p) != NULL) {
+                *out++ = '\\';
+            }
+            *out++ = *p;
+        }
+        *out = '\0';
+        free(argv[i]);
+        argv[i] = escaped;
+    }
+    return 0;
+}
+
 /**
  * Free tokens array
  */
@@ -280,6 +390,60 @@ char **expand_globs_in_argv(char **argv) {
     return new_argv;
 }
 
+/**
+ * Helper: Mark which characters of line are live shell operators
+ *
+ * Operators (|, <, >) inside single/double quotes or between [[ and ]]
+ * are literal: [[ ]] uses < and > for string comparison and regexes may
+ * contain |. ops[i] is set to 1 when line[i] is a real operator.
+ *
+ * line holds len bytes starting at offset base of the text scan
+ * classified; only quotes, operators and brackets are visited.
+ */
+static void mark_operators(const char *line, size_t len, const LexScan *scan,
+                           size_t base, char *ops) {
+    char quote = 0;
+    int in_test = 0;
+
+    memset(ops, 0, len);
+    for (size_t i = 0; ; i++) {
+        unsigned want = quote ? LEX_QUOTE : (LEX_QUOTE | LEX_OPER | LEX_GLOB | LEX_CLOSE);
+        i = lexscan_next(scan, want, base + i) - base;
+        if (i >= len) {
+            break;
+        }
+        char c = line[i];
+        int word_start = (i == 0 || is_delimiter(line[i - 1]));
+
+        if (quote) {
+            if (c == quote) {
+                quote = 0;
+            }
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '[' && line[i + 1] == '[' && word_start) {
+            in_test = 1;
+        } else if (in_test && c == ']' && line[i + 1] == ']' && word_start) {
+            in_test = 0;
+        } else if (!in_test && (c == '|' || c == '<' || c == '>')) {
+            ops[i] = 1;
+        }
+    }
+}
+
+/**
+ * Helper: Position of the next live operator at or after from, or len
+ * With pipes_only set, < and > are passed over.
+ */
+static size_t next_operator(const char *line, size_t len, const LexScan *scan,
+                            size_t base, const char *ops, size_t from, int pipes_only) {
+    size_t i = lexscan_next(scan, LEX_OPER, base + from) - base;
+    while (i < len && !(ops[i] && (!pipes_only || line[i] == '|'))) {
+        i = lexscan_next(scan, LEX_OPER, base + i + 1) - base;
+    }
+    return i < len ? i : len;
+}
+
 /**
  * Parse a command line into a pipeline
  * Splits by | and handles < > >> redirections
@@ -317,26 +481,45 @@ int parse_pipeline(char *line, Command **commands, int *count) {
         }
     }
 
+    // Classify the line once; every scan below works on its masks
+    size_t line_len = strlen(line_copy);
+    LexScan scan;
+    char *ops = malloc(line_len + 1);
+    if (ops == NULL || lexscan_init(&scan, line_copy, line_len) < 0) {
+        perror("malloc");
+        free(ops);
+        free(line_copy);
+        return -1;
+    }
+
+    // Find the operators that are not quoted or inside [[ ]]
+    mark_operators(line_copy, line_len, &scan, 0, ops);
+
     // Count pipes to allocate command array
     int pipe_count = 0;
-    for (char *p = line_copy; *p; p++) {
-        if (*p == '|') pipe_count++;
+    for (size_t i = next_operator(line_copy, line_len, &scan, 0, ops, 0, 1); i < line_len;
+         i = next_operator(line_copy, line_len, &scan, 0, ops, i + 1, 1)) {
+        pipe_count++;
     }
     int cmd_count = pipe_count + 1;
 
     Command *cmds = calloc(cmd_count, sizeof(Command));
     if (cmds == NULL) {
         perror("calloc");
+        lexscan_free(&scan);
+        free(ops);
         free(line_copy);
         return -1;
     }
 
-    // Parse each command segment
+    // Parse each command segment (p jumps from one live | to the next)
     char *cmd_start = line_copy;
     int cmd_idx = 0;
 
-    for (char *p = line_copy; ; p++) {
-        if (*p == '|' || *p == '\0') {
+    for (char *p = line_copy + next_operator(line_copy, line_len, &scan, 0, ops, 0, 1); ;
+         p = line_copy + next_operator(line_copy, line_len, &scan, 0, ops,
+                                       (size_t)(p - line_copy) + 1, 1)) {
+        if ((*p == '|' && ops[p - line_copy]) || *p == '\0') {
             char end_char = *p;
             *p = '\0';  // Null-terminate this segment
 
@@ -355,19 +538,34 @@ int parse_pipeline(char *line, Command **commands, int *count) {
             char *infile = NULL;
             char *outfile = NULL;
             int append = 0;
+            int in_fd = STDIN_FILENO;
+            int out_fd = STDOUT_FILENO;
             
             // Simple tokenization for redirection detection
             char segment_copy[1024];
             strncpy(segment_copy, segment, sizeof(segment_copy) - 1);
             segment_copy[sizeof(segment_copy) - 1] = '\0';
 
-            // Look for < > >>
+            // Look for < > >> (outside quotes and [[ ]])
+            size_t seg_base = (size_t)(segment - line_copy);
+            size_t seg_len = strlen(segment_copy);
+            char seg_ops[1024];
+            mark_operators(segment_copy, seg_len, &scan, seg_base, seg_ops);
             char *redir_ptr = segment_copy;
             char cmd_part[1024];
             int cmd_len = 0;
 
             while (*redir_ptr) {
-                if (*redir_ptr == '<') {
+                int is_op = seg_ops[redir_ptr - segment_copy];
+                // A single digit word right before < or > names the descriptor
+                int fd_num = -1;
+                if (is_op && (*redir_ptr == '<' || *redir_ptr == '>') && cmd_len > 0 &&
+                    isdigit((unsigned char)cmd_part[cmd_len - 1]) &&
+                    (cmd_len == 1 || is_delimiter(cmd_part[cmd_len - 2]))) {
+                    fd_num = cmd_part[--cmd_len] - '0';
+                }
+                if (*redir_ptr == '<' && is_op) {
+                    in_fd = fd_num >= 0 ? fd_num : STDIN_FILENO;
                     *redir_ptr++ = '\0';
                     while (*redir_ptr && is_delimiter(*redir_ptr)) redir_ptr++;
                     char *filename_start = redir_ptr;
@@ -379,7 +577,8 @@ int parse_pipeline(char *line, Command **commands, int *count) {
                     if (infile) free(infile);
                     infile = strdup(filename_start);
                     *redir_ptr = saved;
-                } else if (*redir_ptr == '>') {
+                } else if (*redir_ptr == '>' && is_op) {
+                    out_fd = fd_num >= 0 ? fd_num : STDOUT_FILENO;
                     if (*(redir_ptr + 1) == '>') {
                         append = 1;
                         *redir_ptr++ = '\0';
@@ -399,28 +598,52 @@ int parse_pipeline(char *line, Command **commands, int *count) {
                     outfile = strdup(filename_start);
                     *redir_ptr = saved;
                 } else {
-                    cmd_part[cmd_len++] = *redir_ptr++;
+                    // Copy the run of text up to the next live < or >
+                    size_t at = (size_t)(redir_ptr - segment_copy);
+                    size_t stop = next_operator(segment_copy, seg_len, &scan, seg_base,
+                                                seg_ops, at + 1, 0);
+                    memcpy(cmd_part + cmd_len, redir_ptr, stop - at);
+                    cmd_len += (int)(stop - at);
+                    redir_ptr += stop - at;
                 }
             }
             cmd_part[cmd_len] = '\0';
 
-            // Tokenize the command part (without redirections)
-            char **argv = tokenize_command(cmd_part);
+            // Tokenize the command part (without redirections); [[ ]]
+            // needs to know which of its words were quoted
+            char *quoted = NULL;
+            int want_quoted = lexscan_any(&scan, LEX_QUOTE, seg_base, seg_base + seg_len);
+            char **argv = tokenize_words(cmd_part, want_quoted ? &quoted : NULL);
+            if (argv != NULL && quoted != NULL && argv[0] != NULL &&
+                strcmp(argv[0], "[[") == 0 && escape_test_operands(argv, quoted) < 0) {
+                free_tokens(argv);
+                argv = NULL;
+            }
+            free(quoted);
             if (argv == NULL) {
                 free(infile);
                 free(outfile);
                 free_pipeline(cmds, cmd_idx);
+                lexscan_free(&scan);
+                free(ops);
                 free(line_copy);
                 return -1;
             }
             
-            // Expand glob patterns in arguments
-            char **expanded_argv = expand_globs_in_argv(argv);
-            free_tokens(argv);  // Free original argv
+            // Expand glob patterns in arguments ([[ ]] matches patterns itself);
+            // a segment without * ? [ keeps its words as they are
+            char **expanded_argv = argv;
+            if ((argv[0] == NULL || strcmp(argv[0], "[[") != 0) &&
+                lexscan_any(&scan, LEX_GLOB, seg_base, seg_base + seg_len)) {
+                expanded_argv = expand_globs_in_argv(argv);
+                free_tokens(argv);  // Free original argv
+            }
             if (expanded_argv == NULL) {
                 free(infile);
                 free(outfile);
                 free_pipeline(cmds, cmd_idx);
+                lexscan_free(&scan);
+                free(ops);
                 free(line_copy);
                 return -1;
             }
@@ -429,6 +652,8 @@ int parse_pipeline(char *line, Command **commands, int *count) {
             cmds[cmd_idx].infile = infile;
             cmds[cmd_idx].outfile = outfile;
             cmds[cmd_idx].append = append;
+            cmds[cmd_idx].in_fd = in_fd;
+            cmds[cmd_idx].out_fd = out_fd;
             cmds[cmd_idx].background = background;  // Set background flag from line parse
             cmd_idx++;
 
@@ -437,16 +662,258 @@ int parse_pipeline(char *line, Command **commands, int *count) {
         }
     }
 
+    lexscan_free(&scan);
+    free(ops);
     free(line_copy);
     *commands = cmds;
     *count = cmd_count;
     return 0;
 }
 
+/**
+ * Open the file (or duplicate the descriptor) named by a redirection
+ * target; "&-" yields -2. The result is close-on-exec.
+ */
+static int open_target(const char *target, int output, int append) {
+    if (target[0] == '&') {
+        if (strcmp(target, "&-") == 0) {
+            return -2;
+        }
+        char *end;
+        long fd = strtol(target + 1, &end, 10);
+        int dup = (end == target + 1 || *end != '\0') ? -1 :
+                  fcntl((int)fd, F_DUPFD_CLOEXEC, 10);
+        if (dup < 0) {
+            fprintf(stderr, "ushell: %s: bad file descriptor\n", target + 1);
+        }
+        return dup;
+    }
+    int flags = output ? O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC) : O_RDONLY;
+    int fd = open(target, flags | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror(target);
+    }
+    return fd;
+}
+
+/**
+ * Point fd at an opened target (from open_target) and close the original
+ */
+static void install_target(int fd, int opened) {
+    if (opened == -2) {
+        close(fd);
+    } else if (opened == fd) {
+        // fd was closed and open() reused it: just make it inheritable
+        fcntl(fd, F_SETFD, 0);
+    } else {
+        dup2(opened, fd);
+        close(opened);
+    }
+}
+
+int redirect_apply(int fd, const char *target, int output, int append) {
+    int opened = open_target(target, output, append);
+    if (opened == -1) {
+        return -1;
+    }
+    if (output && fd == STDOUT_FILENO) {
+        fflush(stdout);
+    }
+    install_target(fd, opened);
+    return 0;
+}
+
+/**
+ * Save fd before a temporary redirection; -2 records that it was closed
+ */
+static int save_fd(int fd) {
+    int saved = fcntl(fd, F_DUPFD_CLOEXEC, 10);
+    return saved >= 0 ? saved : -2;
+}
+
+/**
+ * Apply redirections to the shell process itself
+ */
+int redirect_push(const char *infile, const char *outfile, int append, RedirectSave *save) {
+    return redirect_push_fds(STDIN_FILENO, infile, STDOUT_FILENO, outfile, append, save);
+}
+
+int redirect_push_fds(int in_fd, const char *infile, int out_fd, const char *outfile,
+                      int append, RedirectSave *save) {
+    int in_opened = -1;
+    int out_opened = -1;
+
+    save->in_fd = in_fd;
+    save->out_fd = out_fd;
+    save->saved_in = -1;
+    save->saved_out = -1;
+
+    // Open both targets first so a failure leaves the shell untouched
+    if (infile != NULL) {
+        in_opened = open_target(infile, 0, 0);
+        if (in_opened == -1) {
+            return -1;
+        }
+    }
+    if (outfile != NULL) {
+        out_opened = open_target(outfile, 1, append);
+        if (out_opened == -1) {
+            if (in_opened >= 0) {
+                close(in_opened);
+            }
+            return -1;
+        }
+    }
+
+    if (infile != NULL) {
+        save->saved_in = save_fd(in_fd);
+        install_target(in_fd, in_opened);
+    }
+    if (outfile != NULL) {
+        fflush(stdout);
+        save->saved_out = save_fd(out_fd);
+        install_target(out_fd, out_opened);
+    }
+    return 0;
+}
+
+static void restore_fd(int fd, int *saved) {
+    if (*saved >= 0) {
+        dup2(*saved, fd);
+        close(*saved);
+    } else if (*saved == -2) {
+        close(fd);
+    }
+    *saved = -1;
+}
+
+/**
+ * Restore descriptors saved by redirect_push
+ */
+void redirect_pop(RedirectSave *save) {
+    if (save->saved_out != -1) {
+        fflush(stdout);
+        restore_fd(save->out_fd, &save->saved_out);
+    }
+    restore_fd(save->in_fd, &save->saved_in);
+}
+
+/**
+ * Apply a command's redirections to the shell for good
+ */
+static int apply_redirects(const Command *cmd) {
+    if (cmd->infile != NULL && redirect_apply(cmd->in_fd, cmd->infile, 0, 0) < 0) {
+        return -1;
+    }
+    if (cmd->outfile != NULL && redirect_apply(cmd->out_fd, cmd->outfile, 1, cmd->append) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Format a pipeline for the job list ("a | b &")
+ */
+static void format_job_command(const Command *commands, int count, int background,
+                               char cmd_line[MAX_CMD_LEN]) {
+    int offset = 0;
+    for (int i = 0; i < count && offset < MAX_CMD_LEN - 10; i++) {
+        if (i > 0) {
+            offset += snprintf(cmd_line + offset, MAX_CMD_LEN - offset, " | ");
+        }
+        for (int j = 0; commands[i].argv[j] != NULL && offset < MAX_CMD_LEN - 10; j++) {
+            if (j > 0) {
+                cmd_line[offset++] = ' ';
+            }
+            offset += snprintf(cmd_line + offset, MAX_CMD_LEN - offset, "%s", commands[i].argv[j]);
+        }
+    }
+    if (background && offset < MAX_CMD_LEN - 2) {
+        cmd_line[offset++] = ' ';
+        cmd_line[offset++] = '&';
+    }
+    cmd_line[offset] = '\0';
+}
+
+/**
+ * Open a redirection target as a stream for a thread job
+ */
+static FILE *open_job_stream(const char *target, int output, int append) {
+    int fd = open_target(target, output, append);
+    if (fd < 0) {
+        return NULL;
+    }
+    FILE *f = fdopen(fd, output ? "w" : "r");
+    if (f == NULL) {
+        close(fd);
+    }
+    return f;
+}
+
+/**
+ * Start a backgrounded integrated tool on the worker pool
+ *
+ * The tool is already in the shell, so forking a copy of the shell just to
+ * call it is wasted work. Redirections of stdin, stdout and stderr become
+ * the tool's streams; input defaults to /dev/null so the job never reads
+ * the terminal. Anything else (N>file, >&N, mywatch -- CMD, which runs
+ * commands that only the main thread may start) keeps the fork.
+ *
+ * @return Job ID, -1 to fall back to a forked job, -2 if a redirection failed
+ */
+static int start_tool_job(const Command *cmd, tool_func tool) {
+    if ((cmd->infile != NULL && (cmd->in_fd != STDIN_FILENO || cmd->infile[0] == '&')) ||
+        (cmd->outfile != NULL && cmd->outfile[0] == '&') ||
+        (cmd->outfile != NULL && cmd->out_fd != STDOUT_FILENO && cmd->out_fd != STDERR_FILENO)) {
+        return -1;
+    }
+    if (strcmp(cmd->argv[0], "mywatch") == 0) {
+        for (int i = 1; cmd->argv[i] != NULL; i++) {
+            if (strcmp(cmd->argv[i], "--") == 0) {
+                return -1;
+            }
+        }
+    }
+
+    FILE *in = cmd->infile != NULL ? open_job_stream(cmd->infile, 0, 0)
+                                   : fopen("/dev/null", "re");
+    if (in == NULL) {
+        return -2;
+    }
+    FILE *out = stdout;
+    FILE *err = stderr;
+    if (cmd->outfile != NULL) {
+        FILE *f = open_job_stream(cmd->outfile, 1, cmd->append);
+        if (f == NULL) {
+            fclose(in);
+            return -2;
+        }
+        if (cmd->out_fd == STDERR_FILENO) {
+            err = f;
+        } else {
+            out = f;
+        }
+    }
+
+    char cmd_line[MAX_CMD_LEN];
+    format_job_command(cmd, 1, 1, cmd_line);
+    int job_id = jobs_add_thread(tool, cmd->argv, in, out, err, cmd_line);
+    if (job_id < 0) {
+        fclose(in);
+        if (out != stdout) fclose(out);
+        if (err != stderr) fclose(err);
+        return -1;
+    }
+    return job_id;
+}
+
 /**
  * Execute a pipeline of commands
  */
 int execute_pipeline(Command *commands, int count, Env *env) {
+    int tail = exec_tail_call;
+    exec_tail_call = 0;
+
     if (commands == NULL || count <= 0) {
         return -1;
     }
@@ -454,23 +921,95 @@ int execute_pipeline(Command *commands, int count, Env *env) {
     // Single command without redirection or background - check if it's a built-in
     // Background jobs must go through full pipeline execution to handle job tracking
     if (count == 1 && commands[0].infile == NULL && commands[0].outfile == NULL && !commands[0].background) {
+        exec_tail_call = tail;
         return execute_command(commands[0].argv, env);
     }
 
+    // exec with only redirections changes the shell's own descriptors
+    if (count == 1 && !commands[0].background && commands[0].argv[0] != NULL &&
+        strcmp(commands[0].argv[0], "exec") == 0 && commands[0].argv[1] == NULL) {
+        if (apply_redirects(&commands[0]) < 0) {
+            return 1;
+        }
+        return 0;
+    }
+
+    // A redirected last command: the shell exits next, so its descriptors
+    // can be redirected for good and the command exec'd with them
+    if (tail && count == 1 && !commands[0].background) {
+        if (apply_redirects(&commands[0]) < 0) {
+            return 1;
+        }
+        exec_tail_call = 1;
+        return execute_command(commands[0].argv, env);
+    }
+
+    // Redirected builtins and functions still run in the shell (read x < file)
+    if (count == 1 && !commands[0].background && commands[0].argv[0] != NULL &&
+        (find_builtin(commands[0].argv[0]) != NULL || script_has_function(commands[0].argv[0]))) {
+        RedirectSave save;
+        if (redirect_push_fds(commands[0].in_fd, commands[0].infile, commands[0].out_fd,
+                              commands[0].outfile, commands[0].append, &save) < 0) {
+            return 1;
+        }
+        int ret = execute_command(commands[0].argv, env);
+        redirect_pop(&save);
+        return ret;
+    }
+
+    // A backgrounded integrated tool becomes a thread job instead of a fork
+    // (not with <(...) arguments: their descriptors stay with a process)
+    if (count == 1 && commands[0].background && commands[0].argv[0] != NULL &&
+        !procsub_active(0) &&
+        !script_has_function(commands[0].argv[0]) && find_builtin(commands[0].argv[0]) == NULL) {
+        tool_func tool = find_tool(commands[0].argv[0]);
+        if (tool != NULL) {
+            int job_id = start_tool_job(&commands[0], tool);
+            jobs_apply_policy(job_id, env_get(env, "USHELL_BG_POLICY"));
+            if (job_id != -1) {
+                return job_id > 0 ? 0 : 1;
+            }
+        }
+    }
+
     int pipes[count - 1][2];
     pid_t pids[count];
 
+    // USHELL_PIPE_SIZE enlarges the pipes; USHELL_PIPE_MONITOR=1 routes
+    // them through relay threads that measure throughput
+    long pipe_size = pipe_size_parse(env_get(env, "USHELL_PIPE_SIZE"));
+    PipeMonitor *monitor = NULL;
+    if (count > 1 && pipe_monitor_requested(env_get(env, "USHELL_PIPE_MONITOR"))) {
+        char *names[count];
+        for (int i = 0; i < count; i++) {
+            names[i] = commands[i].argv[0];
+        }
+        monitor = pipe_monitor_new(count, names);
+    }
+
     // Create pipes
     for (int i = 0; i < count - 1; i++) {
-        if (pipe(pipes[i]) < 0) {
+        int ret = monitor ? pipe_monitor_open(monitor, i, pipes[i], pipe_size)
+                          : pipe_open_sized(pipes[i], pipe_size);
+        if (ret < 0) {
             perror("pipe");
             return -1;
         }
     }
 
-    // Fork and execute each command
+    // Fork and execute each command (children must not inherit buffered
+    // builtin output: stages that run builtins flush it again)
+    fflush(NULL);
     for (int i = 0; i < count; i++) {
         pids[i] = fork();
+        if (profile_enabled && pids[i] > 0) {
+            profile_forks++;
+            if (!script_has_function(commands[i].argv[0]) &&
+                find_builtin(commands[i].argv[0]) == NULL &&
+                find_tool(commands[i].argv[0]) == NULL) {
+                profile_execs++;
+            }
+        }
 
         if (pids[i] < 0) {
             perror("fork");
@@ -503,64 +1042,63 @@ int execute_pipeline(Command *commands, int count, Env *env) {
                 setpgid(0, pids[0]);
             }
 
-            // Set up input redirection
-            if (i == 0) {
+            // Set up input redirection (N<file applies to any stage)
+            if (i == 0 || commands[i].in_fd != STDIN_FILENO) {
                 // First command - check for input file
-                if (commands[i].infile != NULL) {
-                    int fd = open(commands[i].infile, O_RDONLY);
-                    if (fd < 0) {
-                        perror(commands[i].infile);
-                        exit(1);
-                    }
-                    dup2(fd, STDIN_FILENO);
-                    close(fd);
+                if (commands[i].infile != NULL &&
+                    redirect_apply(commands[i].in_fd, commands[i].infile, 0, 0) < 0) {
+                    exit(1);
                 }
-            } else {
+            }
+            if (i > 0) {
                 // Not first - read from previous pipe
                 dup2(pipes[i - 1][0], STDIN_FILENO);
             }
 
             // Set up output redirection
-            if (i == count - 1) {
-                // Last command - check for output file
-                if (commands[i].outfile != NULL) {
-                    int flags = O_WRONLY | O_CREAT;
-                    flags |= commands[i].append ? O_APPEND : O_TRUNC;
-                    int fd = open(commands[i].outfile, flags, 0644);
-                    if (fd < 0) {
-                        perror(commands[i].outfile);
-                        exit(1);
-                    }
-                    dup2(fd, STDOUT_FILENO);
-                    close(fd);
-                }
-            } else {
+            if (i < count - 1) {
                 // Not last - write to next pipe
                 dup2(pipes[i][1], STDOUT_FILENO);
             }
+            if (i == count - 1 || commands[i].out_fd != STDOUT_FILENO) {
+                // Last command (or N>file on any stage) - check for output file
+                if (commands[i].outfile != NULL &&
+                    redirect_apply(commands[i].out_fd, commands[i].outfile, 1,
+                                   commands[i].append) < 0) {
+                    exit(1);
+                }
+            }
 
             // Close all pipe fds in child
             for (int j = 0; j < count - 1; j++) {
                 close(pipes[j][0]);
                 close(pipes[j][1]);
             }
+            pipe_monitor_close_child(monitor);
+            procsub_child_close(commands[i].argv);
+
+            // Shell functions run in the child as well
+            if (script_has_function(commands[i].argv[0])) {
+                int ret = script_call_function(commands[i].argv, env);
+                fflush(NULL);
+                _exit(ret < 0 ? 1 : ret);
+            }
 
             // Check for built-in commands (run in child for pipelines)
             builtin_func builtin = find_builtin(commands[i].argv[0]);
             if (builtin != NULL) {
                 int ret = builtin(commands[i].argv, env);
-                exit(ret);
+                // _exit: exit() would rewind the shell's shared stdin offset
+                fflush(NULL);
+                _exit(ret);
             }
 
             // Check for integrated tools
             tool_func tool = find_tool(commands[i].argv[0]);
             if (tool != NULL) {
-                int argc = 0;
-                while (commands[i].argv[argc] != NULL) {
-                    argc++;
-                }
-                int ret = tool(argc, commands[i].argv);
-                exit(ret);
+                int ret = tool_run(tool, commands[i].argv, env);
+                fflush(NULL);
+                _exit(ret);
             }
 
             // Execute external command
@@ -575,6 +1113,7 @@ int execute_pipeline(Command *commands, int count, Env *env) {
         close(pipes[i][0]);
         close(pipes[i][1]);
     }
+    pipe_monitor_start(monitor);
 
     // Check if this is a background job
     int is_background = commands[0].background;
@@ -586,30 +1125,19 @@ int execute_pipeline(Command *commands, int count, Env *env) {
         
         // Reconstruct full command line for job display
         char cmd_line[MAX_CMD_LEN];
-        int offset = 0;
-        for (int i = 0; i < count && offset < MAX_CMD_LEN - 10; i++) {
-            if (i > 0) {
-                offset += snprintf(cmd_line + offset, MAX_CMD_LEN - offset, " | ");
-            }
-            for (int j = 0; commands[i].argv[j] != NULL && offset < MAX_CMD_LEN - 10; j++) {
-                if (j > 0) {
-                    cmd_line[offset++] = ' ';
-                }
-                offset += snprintf(cmd_line + offset, MAX_CMD_LEN - offset, "%s", commands[i].argv[j]);
-            }
-        }
-        if (offset < MAX_CMD_LEN - 2) {
-            cmd_line[offset++] = ' ';
-            cmd_line[offset++] = '&';
-            cmd_line[offset] = '\0';
-        }
+        format_job_command(commands, count, 1, cmd_line);
         
         // Add job to tracking system
         int job_id = jobs_add(job_pid, cmd_line, 1);
         if (job_id > 0) {
             printf("[%d] %d\n", job_id, job_pid);
             fflush(stdout);  // Make sure it prints immediately
+            jobs_get(job_id)->monitor = monitor;  // Shown by jobs -l
+            jobs_apply_policy(job_id, env_get(env, "USHELL_BG_POLICY"));
+        } else {
+            pipe_monitor_release(monitor);
         }
+        procsub_detach(job_id);
         
         return 0;  // Background jobs always return success to shell
     } else {
@@ -628,28 +1156,19 @@ int execute_pipeline(Command *commands, int count, Env *env) {
             if (WIFSTOPPED(status)) {
                 // Job was stopped - add to job list
                 char cmd_line[MAX_CMD_LEN];
-                int offset = 0;
-                for (int j = 0; j < count && offset < MAX_CMD_LEN - 10; j++) {
-                    if (j > 0) {
-                        offset += snprintf(cmd_line + offset, MAX_CMD_LEN - offset, " | ");
-                    }
-                    for (int k = 0; commands[j].argv[k] != NULL && offset < MAX_CMD_LEN - 10; k++) {
-                        if (k > 0) {
-                            cmd_line[offset++] = ' ';
-                        }
-                        offset += snprintf(cmd_line + offset, MAX_CMD_LEN - offset, "%s", commands[j].argv[k]);
-                    }
-                }
-                cmd_line[offset] = '\0';
+                format_job_command(commands, count, 0, cmd_line);
                 
                 int job_id = jobs_add(pids[count - 1], cmd_line, 0);
                 if (job_id > 0) {
                     Job *job = jobs_get(job_id);
                     if (job) {
                         job->status = JOB_STOPPED;
+                        job->monitor = monitor;
+                        monitor = NULL;
                         printf("\n[%d]+  Stopped                 %s\n", job_id, cmd_line);
                     }
                 }
+                pipe_monitor_release(monitor);
                 foreground_job_pid = 0;  // Clear foreground job
                 return 0;
             }
@@ -661,6 +1180,12 @@ int execute_pipeline(Command *commands, int count, Env *env) {
         
         // Clear foreground job when done
         foreground_job_pid = 0;
+
+        if (monitor != NULL) {
+            pipe_monitor_wait(monitor);
+            pipe_monitor_print(monitor, stderr, "ushell: ");
+            pipe_monitor_release(monitor);
+        }
         
         return last_status;
     }
@@ -681,3 +1206,31 @@ void free_pipeline(Command *commands, int count) {
     }
     free(commands);
 }
+
+/**
+ * Parse and execute one command line (or script text)
+ *
+ * This is the same sequence the REPL runs for every line it reads, so
+ * anything that needs to run a user-supplied command line (tools such as
+ * mywatch, AI suggestions) behaves exactly like typed input. Expansion
+ * happens per simple command as the parsed text runs.
+ */
+int execute_line(const char *line, Env *env) {
+    if (line == NULL) {
+        return -1;
+    }
+
+    int parse_status;
+    ScriptUnit *unit = script_parse(line, &parse_status);
+    if (unit == NULL) {
+        if (parse_status == SCRIPT_INCOMPLETE) {
+            fprintf(stderr, "ushell: syntax error: unexpected end of input\n");
+        }
+        last_exit_status = 2;
+        return -1;
+    }
+
+    int status = script_execute(unit, env);
+    script_release(unit);
+    return status;
+}
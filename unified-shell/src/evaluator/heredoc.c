@@ -0,0 +1,170 @@
+/**
+ * heredoc.c - Here-document and here-string bodies
+ *
+ * The body goes into a pipe while it fits: the pipe's write end is
+ * non-blocking, so a write that would wait for a reader reports EAGAIN
+ * instead. At that point what is already queued is read back into a
+ * memfd, the rest of the body follows it, and the memfd is sealed and
+ * rewound. Unquoted bodies are expanded line by line as they are
+ * written, so a large body is never held expanded in memory as a whole.
+ */
+
+#define _GNU_SOURCE // memfd_create, F_ADD_SEALS
+#include "heredoc.h"
+#include "expansion.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define SPILL_COPY_BUF 65536
+
+typedef struct {
+    int rd;             // Pipe holding the body while it fits
+    int wr;
+    size_t queued;      // Bytes written to the pipe
+    int memfd;          // -1 until the body outgrows the pipe
+} HereSink;
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * Move the queued part of the body from the pipe into a new memfd
+ */
+static int sink_spill(HereSink *sink) {
+    int fd = memfd_create("ushell-heredoc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        perror("ushell: here-document: memfd_create");
+        return -1;
+    }
+
+    char *buf = malloc(SPILL_COPY_BUF);
+    if (buf == NULL) {
+        close(fd);
+        return -1;
+    }
+    while (sink->queued > 0) {
+        size_t want = sink->queued < SPILL_COPY_BUF ? sink->queued : SPILL_COPY_BUF;
+        ssize_t n = read(sink->rd, buf, want);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0 || write_all(fd, buf, (size_t)n) < 0) {
+            perror("ushell: here-document");
+            free(buf);
+            close(fd);
+            return -1;
+        }
+        sink->queued -= (size_t)n;
+    }
+    free(buf);
+
+    close(sink->rd);
+    close(sink->wr);
+    sink->rd = sink->wr = -1;
+    sink->memfd = fd;
+    return 0;
+}
+
+static int sink_write(HereSink *sink, const char *data, size_t len) {
+    while (len > 0 && sink->memfd < 0) {
+        ssize_t n = write(sink->wr, data, len);
+        if (n > 0) {
+            data += n;
+            len -= (size_t)n;
+            sink->queued += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && errno != EAGAIN) {
+            perror("ushell: here-document");
+            return -1;
+        } else if (sink_spill(sink) < 0) {
+            return -1;
+        }
+    }
+    if (len > 0 && write_all(sink->memfd, data, len) < 0) {
+        perror("ushell: here-document");
+        return -1;
+    }
+    return 0;
+}
+
+static void sink_abort(HereSink *sink) {
+    if (sink->memfd >= 0) {
+        close(sink->memfd);
+    } else {
+        close(sink->rd);
+        close(sink->wr);
+    }
+}
+
+/**
+ * Hand back the read side: the pipe's read end, or the sealed memfd
+ */
+static int sink_finish(HereSink *sink) {
+    if (sink->memfd < 0) {
+        close(sink->wr);
+        return sink->rd;
+    }
+    fcntl(sink->memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+    if (lseek(sink->memfd, 0, SEEK_SET) < 0) {
+        perror("ushell: here-document");
+        close(sink->memfd);
+        return -1;
+    }
+    return sink->memfd;
+}
+
+int heredoc_open(const char *text, size_t len, int expand, Env *env) {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) < 0) {
+        perror("ushell: here-document: pipe");
+        return -1;
+    }
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    HereSink sink = { fds[0], fds[1], 0, -1 };
+
+    if (!expand) {
+        if (sink_write(&sink, text, len) < 0) {
+            sink_abort(&sink);
+            return -1;
+        }
+        return sink_finish(&sink);
+    }
+
+    const char *end = text + len;
+    while (text < end) {
+        const char *nl = memchr(text, '\n', (size_t)(end - text));
+        size_t line_len = nl ? (size_t)(nl - text) : (size_t)(end - text);
+        char *line = expand_here_line(text, line_len, env);
+        if (line == NULL) {
+            sink_abort(&sink);
+            return -1;  // ${var:?message} failed; the message has been printed
+        }
+        int failed = sink_write(&sink, line, strlen(line)) < 0 ||
+                     (nl && sink_write(&sink, "\n", 1) < 0);
+        free(line);
+        if (failed) {
+            sink_abort(&sink);
+            return -1;
+        }
+        text += line_len + (nl ? 1 : 0);
+    }
+    return sink_finish(&sink);
+}
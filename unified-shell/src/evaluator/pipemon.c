@@ -0,0 +1,375 @@
+/**
+ * pipemon.c - Pipeline pipe sizing and throughput monitor
+ *
+ * A monitored pipe is two kernel pipes with a relay thread between them:
+ *
+ *   producer -> [outer write | inner read] -relay-> [inner write | outer read] -> consumer
+ *
+ * The relay polls for input (time counted as "reader starved"), then for
+ * room on the output side ("writer blocked"), then moves whatever is
+ * queued with a non-blocking splice(2); pipes that splice refuses fall
+ * back to read/write through a buffer.
+ */
+
+#define _GNU_SOURCE
+#include "pipemon.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RELAY_CHUNK (1 << 20)
+#define RELAY_COPY_BUF 65536
+
+typedef struct {
+    PipeMonitor *mon;
+    int in_fd;              // Inner read end (producer side)
+    int out_fd;             // Inner write end (consumer side)
+    uint64_t bytes;         // Updated with __atomic, read by jobs -l
+    uint64_t blocked_ns;
+    uint64_t starved_ns;
+    uint64_t start_ns;
+    uint64_t end_ns;        // 0 while running
+    uint64_t wait_start;    // Start of the wait in progress, 0 if none
+    int waiting_for_input;  // Which counter that wait belongs to
+} PipeRelay;
+
+struct PipeMonitor {
+    int refs;               // Owner + running relays
+    int npipes;
+    PipeRelay *relays;
+    char **names;           // Stage names (npipes + 1)
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    int running;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+long pipe_size_parse(const char *value) {
+    if (value == NULL || *value == '\0') {
+        return 0;
+    }
+    char *end;
+    long size = strtol(value, &end, 10);
+    if (end == value || size <= 0) {
+        return 0;
+    }
+    switch (*end) {
+        case 'k': case 'K': size <<= 10; end++; break;
+        case 'm': case 'M': size <<= 20; end++; break;
+        default: break;
+    }
+    return *end == '\0' ? size : 0;
+}
+
+/**
+ * Grow a pipe; the kernel rounds up to a power-of-two number of pages.
+ * Sizes above /proc/sys/fs/pipe-max-size fail for unprivileged users,
+ * in which case the default size is kept.
+ */
+static void set_pipe_size(int fd, long size) {
+    if (size > 0) {
+        fcntl(fd, F_SETPIPE_SZ, (int)size);
+    }
+}
+
+int pipe_open_sized(int fds[2], long size) {
+    if (pipe(fds) < 0) {
+        return -1;
+    }
+    set_pipe_size(fds[1], size);
+    return 0;
+}
+
+int pipe_monitor_requested(const char *value) {
+    return value != NULL && strcmp(value, "1") == 0;
+}
+
+PipeMonitor *pipe_monitor_new(int stages, char *const *stage_names) {
+    if (stages < 2) {
+        return NULL;
+    }
+    PipeMonitor *mon = calloc(1, sizeof(PipeMonitor));
+    if (mon == NULL) {
+        return NULL;
+    }
+    mon->refs = 1;
+    mon->npipes = stages - 1;
+    mon->relays = calloc((size_t)mon->npipes, sizeof(PipeRelay));
+    mon->names = calloc((size_t)stages, sizeof(char *));
+    if (mon->relays == NULL || mon->names == NULL) {
+        free(mon->relays);
+        free(mon->names);
+        free(mon);
+        return NULL;
+    }
+    for (int i = 0; i < stages; i++) {
+        mon->names[i] = strdup(stage_names[i] ? stage_names[i] : "?");
+    }
+    for (int i = 0; i < mon->npipes; i++) {
+        mon->relays[i].mon = mon;
+        mon->relays[i].in_fd = -1;
+        mon->relays[i].out_fd = -1;
+    }
+    pthread_mutex_init(&mon->lock, NULL);
+    pthread_cond_init(&mon->done, NULL);
+    return mon;
+}
+
+int pipe_monitor_open(PipeMonitor *mon, int index, int fds[2], long size) {
+    int outer[2], inner[2];
+    if (pipe_open_sized(outer, size) < 0) {
+        return -1;
+    }
+    if (pipe_open_sized(inner, size) < 0) {
+        close(outer[0]);
+        close(outer[1]);
+        return -1;
+    }
+    PipeRelay *relay = &mon->relays[index];
+    relay->in_fd = outer[0];
+    relay->out_fd = inner[1];
+    fds[0] = inner[0];
+    fds[1] = outer[1];
+    return 0;
+}
+
+void pipe_monitor_close_child(PipeMonitor *mon) {
+    for (int i = 0; mon != NULL && i < mon->npipes; i++) {
+        if (mon->relays[i].in_fd >= 0) {
+            close(mon->relays[i].in_fd);
+        }
+        if (mon->relays[i].out_fd >= 0) {
+            close(mon->relays[i].out_fd);
+        }
+    }
+}
+
+static void monitor_unref(PipeMonitor *mon) {
+    pthread_mutex_lock(&mon->lock);
+    int refs = --mon->refs;
+    pthread_mutex_unlock(&mon->lock);
+    if (refs > 0) {
+        return;
+    }
+    for (int i = 0; i <= mon->npipes; i++) {
+        free(mon->names[i]);
+    }
+    free(mon->names);
+    free(mon->relays);
+    pthread_mutex_destroy(&mon->lock);
+    pthread_cond_destroy(&mon->done);
+    free(mon);
+}
+
+/**
+ * Wait for fd to become ready; returns 1 ready, 0 if the other side of
+ * the relay went away (reader closed), -1 on end of input or error
+ *
+ * While waiting for output the input end is left out of the poll set: a
+ * producer that exits would otherwise wake poll() with POLLHUP before the
+ * data already read from it has been passed on.
+ */
+static int relay_wait(PipeRelay *relay, int want_input, uint64_t *waited) {
+    struct pollfd pfd[2] = {
+        { want_input ? relay->in_fd : -1, POLLIN, 0 },
+        { relay->out_fd, want_input ? 0 : POLLOUT, 0 },
+    };
+    uint64_t start = now_ns();
+    __atomic_store_n(&relay->waiting_for_input, want_input, __ATOMIC_RELAXED);
+    __atomic_store_n(&relay->wait_start, start, __ATOMIC_RELEASE);
+    int n;
+    do {
+        n = poll(pfd, 2, -1);
+    } while ((n < 0 && errno == EINTR) ||
+             (n > 0 && !want_input && !(pfd[1].revents & (POLLOUT | POLLERR | POLLHUP))));
+    __atomic_store_n(&relay->wait_start, 0, __ATOMIC_RELAXED);
+    __atomic_add_fetch(waited, now_ns() - start, __ATOMIC_RELAXED);
+
+    if (n < 0 || (pfd[1].revents & (POLLERR | POLLHUP))) {
+        return 0;   // Consumer gone
+    }
+    if (want_input) {
+        if (pfd[0].revents & POLLIN) {
+            return 1;
+        }
+        return (pfd[0].revents & (POLLHUP | POLLERR)) ? -1 : 1;
+    }
+    return 1;
+}
+
+static void *relay_main(void *arg) {
+    PipeRelay *relay = arg;
+    char *copy_buf = NULL;
+    int use_splice = 1;
+
+    __atomic_store_n(&relay->start_ns, now_ns(), __ATOMIC_RELAXED);
+    for (;;) {
+        if (relay_wait(relay, 1, &relay->starved_ns) <= 0) {
+            break;
+        }
+        if (relay_wait(relay, 0, &relay->blocked_ns) <= 0) {
+            break;
+        }
+
+        ssize_t n;
+        if (use_splice) {
+            n = splice(relay->in_fd, NULL, relay->out_fd, NULL, RELAY_CHUNK,
+                       SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n < 0 && errno == EINVAL) {
+                use_splice = 0;
+                continue;
+            }
+        } else {
+            if (copy_buf == NULL && (copy_buf = malloc(RELAY_COPY_BUF)) == NULL) {
+                break;
+            }
+            n = read(relay->in_fd, copy_buf, RELAY_COPY_BUF);
+            for (ssize_t off = 0; n > 0 && off < n;) {
+                ssize_t w = write(relay->out_fd, copy_buf + off, (size_t)(n - off));
+                if (w < 0 && errno == EAGAIN) {
+                    continue;
+                }
+                if (w <= 0) {
+                    n = -1;
+                    errno = EPIPE;
+                    break;
+                }
+                off += w;
+            }
+        }
+
+        if (n == 0) {
+            break;  // Producer closed its end
+        }
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                continue;
+            }
+            break;  // EPIPE: consumer exited
+        }
+        __atomic_add_fetch(&relay->bytes, (uint64_t)n, __ATOMIC_RELAXED);
+    }
+
+    // Closing both ends passes EOF downstream and SIGPIPE upstream
+    close(relay->in_fd);
+    close(relay->out_fd);
+    free(copy_buf);
+    __atomic_store_n(&relay->end_ns, now_ns(), __ATOMIC_RELAXED);
+
+    PipeMonitor *mon = relay->mon;
+    pthread_mutex_lock(&mon->lock);
+    mon->running--;
+    pthread_cond_broadcast(&mon->done);
+    pthread_mutex_unlock(&mon->lock);
+    monitor_unref(mon);
+    return NULL;
+}
+
+void pipe_monitor_start(PipeMonitor *mon) {
+    if (mon == NULL) {
+        return;
+    }
+
+    // Relays never take the shell's signals (SIGINT, SIGCHLD...) and get
+    // EPIPE instead of SIGPIPE when a consumer exits
+    sigset_t all, saved;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &saved);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    for (int i = 0; i < mon->npipes; i++) {
+        PipeRelay *relay = &mon->relays[i];
+        pthread_t thread;
+        pthread_mutex_lock(&mon->lock);
+        mon->refs++;
+        mon->running++;
+        pthread_mutex_unlock(&mon->lock);
+        if (pthread_create(&thread, &attr, relay_main, relay) != 0) {
+            // Without a relay the pipeline would hang; cut this pipe
+            close(relay->in_fd);
+            close(relay->out_fd);
+            relay->end_ns = relay->start_ns = now_ns();
+            pthread_mutex_lock(&mon->lock);
+            mon->refs--;
+            mon->running--;
+            pthread_mutex_unlock(&mon->lock);
+        }
+    }
+    pthread_attr_destroy(&attr);
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+}
+
+void pipe_monitor_wait(PipeMonitor *mon) {
+    if (mon == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&mon->lock);
+    while (mon->running > 0) {
+        pthread_cond_wait(&mon->done, &mon->lock);
+    }
+    pthread_mutex_unlock(&mon->lock);
+}
+
+static void format_bytes(char *buf, size_t size, double bytes) {
+    const char *units[] = { "B", "KB", "MB", "GB", "TB" };
+    int u = 0;
+    while (bytes >= 1024.0 && u < 4) {
+        bytes /= 1024.0;
+        u++;
+    }
+    snprintf(buf, size, u == 0 ? "%.0f %s" : "%.1f %s", bytes, units[u]);
+}
+
+void pipe_monitor_print(PipeMonitor *mon, FILE *out, const char *indent) {
+    if (mon == NULL) {
+        return;
+    }
+    uint64_t now = now_ns();
+    for (int i = 0; i < mon->npipes; i++) {
+        PipeRelay *relay = &mon->relays[i];
+        uint64_t bytes = __atomic_load_n(&relay->bytes, __ATOMIC_RELAXED);
+        uint64_t start = __atomic_load_n(&relay->start_ns, __ATOMIC_RELAXED);
+        uint64_t end = __atomic_load_n(&relay->end_ns, __ATOMIC_RELAXED);
+        double secs = start ? (double)((end ? end : now) - start) / 1e9 : 0.0;
+
+        // Include a wait that is still in progress
+        uint64_t blocked = __atomic_load_n(&relay->blocked_ns, __ATOMIC_RELAXED);
+        uint64_t starved = __atomic_load_n(&relay->starved_ns, __ATOMIC_RELAXED);
+        uint64_t wait_start = __atomic_load_n(&relay->wait_start, __ATOMIC_ACQUIRE);
+        if (wait_start != 0 && now > wait_start) {
+            if (__atomic_load_n(&relay->waiting_for_input, __ATOMIC_RELAXED)) {
+                starved += now - wait_start;
+            } else {
+                blocked += now - wait_start;
+            }
+        }
+
+        char total[32], rate[32];
+        format_bytes(total, sizeof(total), (double)bytes);
+        format_bytes(rate, sizeof(rate), secs > 0 ? (double)bytes / secs : 0.0);
+        fprintf(out, "%spipe %d (%s -> %s): %s in %.2fs, %s/s, writer blocked %.2fs, "
+                     "reader starved %.2fs%s\n",
+                indent, i + 1, mon->names[i], mon->names[i + 1], total, secs, rate,
+                (double)blocked / 1e9, (double)starved / 1e9, end ? "" : " (running)");
+    }
+}
+
+void pipe_monitor_release(PipeMonitor *mon) {
+    if (mon != NULL) {
+        monitor_unref(mon);
+    }
+}
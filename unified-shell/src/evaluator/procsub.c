@@ -0,0 +1,387 @@
+/**
+ * procsub.c - Process substitution (<(cmd) and >(cmd))
+ *
+ * Each substitution is a pipe whose shell end is moved to descriptor 63
+ * or above without close-on-exec, so the command that names /dev/fd/N
+ * inherits it. The other end goes to the inner command: a pool worker
+ * for an integrated tool, a forked child for anything else. <(builtin)
+ * cannot stream from a worker (builtins write to the shell's own fd 1),
+ * so it runs first and its output is served from a memfd.
+ *
+ * The table is a stack of scopes: procsub_mark() opens one per command
+ * node, procsub_finish() closes whatever that node started.
+ */
+
+#define _GNU_SOURCE // memfd_create, pipe2
+#include "procsub.h"
+#include "executor.h"
+#include "builtins.h"
+#include "tools.h"
+#include "expansion.h"
+#include "conditional.h"
+#include "script.h"
+#include "jobs.h"
+#include "signals.h"
+#include "threading.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#define PROCSUB_FD_MIN 63
+
+/**
+ * A tool running on a pool worker for one substitution
+ * lock guards finished and detached; whoever sees both set frees it.
+ */
+typedef struct {
+    tool_func tool;
+    Command *cmds;                   // Parsed command (one stage)
+    int argc;
+    int output;                      // >(tool): ctx.in is the pipe
+    tool_ctx ctx;
+    volatile sig_atomic_t cancel;
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    int finished;
+    int detached;                    // No one will wait: the worker frees it
+} SubThread;
+
+typedef struct {
+    int fd;                          // Shell end, named by /dev/fd/N
+    int output;                      // >(cmd)
+    pid_t pid;                       // Forked helper, or 0
+    SubThread *thread;               // Tool on a worker, or NULL
+} ProcSub;
+
+static ProcSub *subs = NULL;
+static int sub_count = 0;
+static int sub_cap = 0;
+static int scope_base = 0;          // First entry of the innermost scope
+
+/**
+ * First word of cmd if cmd is one simple command (no pipes, redirections
+ * or lists), else an empty string
+ */
+static void simple_command_name(const char *cmd, char *name, size_t size) {
+    name[0] = '\0';
+    if (strpbrk(cmd, "|&<>;\n") != NULL) {
+        return;
+    }
+    while (*cmd == ' ' || *cmd == '\t') {
+        cmd++;
+    }
+    size_t n = 0;
+    while (cmd[n] && !isspace((unsigned char)cmd[n]) && n < size - 1) {
+        name[n] = cmd[n];
+        n++;
+    }
+    name[n] = '\0';
+}
+
+/**
+ * Move fd to PROCSUB_FD_MIN or above, without close-on-exec
+ */
+static int move_high(int fd) {
+    int high = fcntl(fd, F_DUPFD, PROCSUB_FD_MIN);
+    close(fd);
+    return high;
+}
+
+static int track(int fd, int output, pid_t pid, SubThread *thread) {
+    if (sub_count == sub_cap) {
+        int cap = sub_cap ? sub_cap * 2 : 8;
+        ProcSub *grown = realloc(subs, cap * sizeof(ProcSub));
+        if (grown == NULL) {
+            return -1;
+        }
+        subs = grown;
+        sub_cap = cap;
+    }
+    subs[sub_count++] = (ProcSub){ fd, output, pid, thread };
+    return 0;
+}
+
+/**
+ * <(builtin): run it now with stdout in a memfd
+ */
+static int start_builtin(const char *cmd, Env *env) {
+    int mfd = memfd_create("ushell-procsub", MFD_CLOEXEC);
+    int saved_stdout = dup(STDOUT_FILENO);
+    if (mfd < 0 || saved_stdout < 0) {
+        perror("ushell: process substitution");
+        if (mfd >= 0) close(mfd);
+        if (saved_stdout >= 0) close(saved_stdout);
+        return -1;
+    }
+    fflush(stdout);
+    dup2(mfd, STDOUT_FILENO);
+    execute_line(cmd, env);
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    lseek(mfd, 0, SEEK_SET);
+    return move_high(mfd);
+}
+
+static void sub_thread_free(SubThread *st) {
+    free_pipeline(st->cmds, 1);
+    pthread_cond_destroy(&st->done);
+    pthread_mutex_destroy(&st->lock);
+    free(st);
+}
+
+/**
+ * Pool task: run the tool, close its streams, report
+ */
+static void sub_thread_main(void *arg) {
+    SubThread *st = arg;
+    st->tool(&st->ctx, st->argc, st->cmds[0].argv);
+    fflush(st->ctx.out);
+
+    // >(tool): keep reading until the writers are done. Closing early
+    // would raise SIGPIPE in the shell itself when a builtin writes.
+    if (st->output) {
+        char discard[4096];
+        while (fread(discard, 1, sizeof(discard), st->ctx.in) > 0) {
+            continue;
+        }
+    }
+    fclose(st->ctx.in);
+    fclose(st->ctx.out);
+    close(st->ctx.cwd_fd);
+
+    pthread_mutex_lock(&st->lock);
+    st->finished = 1;
+    int detached = st->detached;
+    pthread_cond_broadcast(&st->done);
+    pthread_mutex_unlock(&st->lock);
+    if (detached) {
+        sub_thread_free(st);
+    }
+}
+
+/**
+ * Integrated tool: run it on a pool worker, reading or writing a copy of end
+ * @return Thread, or NULL to fork instead
+ */
+static SubThread *start_tool(const char *cmd, int output, int end, Env *env) {
+    char name[64];
+    simple_command_name(cmd, name, sizeof(name));
+    if (name[0] == '\0' || find_tool(name) == NULL ||
+        find_builtin(name) != NULL || script_has_function(name)) {
+        return NULL;
+    }
+    ThreadPool *pool = thread_pool_shared();
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    char *expanded = expand_variables(cmd, env);
+    Command *cmds = NULL;
+    int count = 0;
+    if (expanded == NULL || parse_pipeline(expanded, &cmds, &count) < 0 ||
+        count != 1 || cmds[0].argv == NULL || cmds[0].argv[0] == NULL ||
+        find_tool(cmds[0].argv[0]) == NULL) {
+        free(expanded);
+        free_pipeline(cmds, count);
+        return NULL;
+    }
+    free(expanded);
+
+    SubThread *st = calloc(1, sizeof(SubThread));
+    if (st == NULL) {
+        free_pipeline(cmds, count);
+        return NULL;
+    }
+    st->tool = find_tool(cmds[0].argv[0]);
+    st->cmds = cmds;
+    st->output = output;
+    while (cmds[0].argv[st->argc] != NULL) {
+        st->argc++;
+    }
+    pthread_mutex_init(&st->lock, NULL);
+    pthread_cond_init(&st->done, NULL);
+
+    // Own streams: the shell's fd 0/1 may be redirected while it runs,
+    // and end stays the caller's (it is closed or handed to a fork)
+    tool_ctx_init(&st->ctx, NULL);
+    st->ctx.cancel = &st->cancel;
+    st->ctx.cwd_fd = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    int other = output ? fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0)
+                       : open("/dev/null", O_RDONLY | O_CLOEXEC);
+    int copy = fcntl(end, F_DUPFD_CLOEXEC, 0);
+    FILE *mine = other >= 0 ? fdopen(other, output ? "w" : "r") : NULL;
+    FILE *pipe_end = copy >= 0 ? fdopen(copy, output ? "r" : "w") : NULL;
+    if (mine == NULL && other >= 0) close(other);
+    if (pipe_end == NULL && copy >= 0) close(copy);
+    st->ctx.in = output ? pipe_end : mine;
+    st->ctx.out = output ? mine : pipe_end;
+
+    if (st->ctx.cwd_fd < 0 || mine == NULL || pipe_end == NULL ||
+        thread_pool_try_run(pool, sub_thread_main, st) < 0) {
+        // No idle worker (or no descriptors): the caller forks
+        if (st->ctx.cwd_fd >= 0) close(st->ctx.cwd_fd);
+        if (mine != NULL) fclose(mine);
+        if (pipe_end != NULL) fclose(pipe_end);
+        sub_thread_free(st);
+        return NULL;
+    }
+    return st;
+}
+
+int procsub_mark(void) {
+    int mark = scope_base;
+    scope_base = sub_count;
+    return mark;
+}
+
+int procsub_start(const char *cmd, int output, Env *env) {
+    char name[64];
+    simple_command_name(cmd, name, sizeof(name));
+    if (!output && name[0] != '\0' && find_builtin(name) != NULL &&
+        !script_has_function(name)) {
+        int fd = start_builtin(cmd, env);
+        if (fd >= 0 && track(fd, 0, 0, NULL) < 0) {
+            close(fd);
+            fd = -1;
+        }
+        return fd;
+    }
+
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) < 0) {
+        perror("ushell: process substitution");
+        return -1;
+    }
+    int fd = move_high(output ? fds[1] : fds[0]);
+    int end = output ? fds[0] : fds[1];
+    if (fd < 0) {
+        perror("ushell: process substitution");
+        close(end);
+        return -1;
+    }
+
+    SubThread *st = start_tool(cmd, output, end, env);
+    pid_t pid = 0;
+    if (st != NULL) {
+        close(end);
+    } else {
+        fflush(NULL);
+        pid = fork();
+        if (pid < 0) {
+            perror("ushell: fork");
+            close(fd);
+            close(end);
+            return -1;
+        }
+        if (pid == 0) {
+            dup2(end, output ? STDIN_FILENO : STDOUT_FILENO);
+            close(end);
+            close(fd);
+            procsub_child_close(NULL);
+            script_enter_forked_subshell();
+            execute_line(cmd, env);
+            // _exit: exit() would rewind the shell's shared stdin offset
+            fflush(NULL);
+            _exit(last_exit_status & 0xff);
+        }
+        close(end);
+    }
+
+    if (track(fd, output, pid, st) < 0) {
+        close(fd);
+        procsub_detach(-1);
+        return -1;
+    }
+    return fd;
+}
+
+void procsub_finish(int mark) {
+    for (int i = scope_base; i < sub_count; i++) {
+        ProcSub *ps = &subs[i];
+        close(ps->fd);
+
+        if (ps->thread != NULL) {
+            SubThread *st = ps->thread;
+            if (!ps->output || sigint_received) {
+                // Its output has no reader left
+                __atomic_store_n(&st->cancel, 1, __ATOMIC_RELEASE);
+            }
+            pthread_mutex_lock(&st->lock);
+            while (!st->finished) {
+                pthread_cond_wait(&st->done, &st->lock);
+            }
+            pthread_mutex_unlock(&st->lock);
+            sub_thread_free(st);
+        } else if (ps->pid > 0) {
+            if (sigint_received) {
+                kill(ps->pid, SIGTERM);
+            }
+            int wstatus;
+            pid_t r;
+            do {
+                // Readers (>(cmd)) finish on end of input; writers may not
+                r = waitpid(ps->pid, &wstatus, ps->output ? 0 : WNOHANG);
+            } while (r < 0 && errno == EINTR);
+            if (r == 0) {
+                jobs_add_helper(-1, ps->pid);
+            }
+        }
+    }
+    sub_count = scope_base;
+    scope_base = mark;
+}
+
+void procsub_child_close(char **argv) {
+    for (int i = 0; i < sub_count; i++) {
+        char path[32];
+        snprintf(path, sizeof(path), "/dev/fd/%d", subs[i].fd);
+        int named = 0;
+        for (int a = 0; argv != NULL && argv[a] != NULL && !named; a++) {
+            named = strstr(argv[a], path) != NULL;
+        }
+        if (!named) {
+            close(subs[i].fd);
+        }
+    }
+    // The child's copy of the table: its helpers are the shell's to collect
+    sub_count = 0;
+    scope_base = 0;
+}
+
+void procsub_detach(int job_id) {
+    for (int i = scope_base; i < sub_count; i++) {
+        close(subs[i].fd);
+        if (subs[i].pid > 0) {
+            jobs_add_helper(job_id, subs[i].pid);
+        }
+        SubThread *st = subs[i].thread;
+        if (st != NULL) {
+            pthread_mutex_lock(&st->lock);
+            int finished = st->finished;
+            st->detached = 1;
+            pthread_mutex_unlock(&st->lock);
+            if (finished) {
+                sub_thread_free(st);
+            }
+        }
+    }
+    sub_count = scope_base;
+}
+
+int procsub_active(int threads_only) {
+    for (int i = 0; i < sub_count; i++) {
+        if (!threads_only || subs[i].thread != NULL) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,482 @@
+/**
+ * profile.c - Per-line script profiler (ushell --profile)
+ *
+ * Statistics live in two hash tables: script lines keyed by (origin,
+ * line) and functions keyed by name. Records are allocated individually
+ * so marks on the interpreter's stack can point at them while the tables
+ * grow. Recursive regions add to "total" only at their outermost level,
+ * so recursion is not double counted; "self" excludes nested regions.
+ */
+
+#include "profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#define PROFILE_REPORT_ROWS 40
+#define PROFILE_TEXT_MAX 40
+
+int profile_enabled = 0;
+unsigned long profile_forks = 0;
+unsigned long profile_execs = 0;
+
+typedef struct {
+    const char *origin;     // Interned
+    int line;
+    char *text;
+    uint64_t calls;
+    uint64_t total_ns;
+    uint64_t self_ns;
+    uint64_t child_cpu_us;
+    unsigned long forks;
+    unsigned long execs;
+    int active;             // Nesting depth (recursion)
+} LineStat;
+
+typedef struct {
+    char *name;
+    uint64_t calls;
+    uint64_t total_ns;
+    uint64_t self_ns;
+    int active;
+} FuncStat;
+
+/**
+ * Call tree node for folded stacks; the path from the root names the
+ * stack, so recording a sample needs no string building
+ */
+typedef struct FoldNode {
+    struct FoldNode *parent;
+    void *stat;
+    int is_function;
+    uint64_t self_ns;
+} FoldNode;
+
+/**
+ * Open-addressing table of record pointers
+ */
+typedef struct {
+    void **slots;
+    size_t capacity;
+    size_t count;
+} PtrTable;
+
+static PtrTable lines;
+static PtrTable funcs;
+static PtrTable folded;
+
+static char **origins = NULL;
+static int origin_count = 0;
+static const char *last_origin = NULL;
+
+static ProfileMark *current = NULL;
+static uint64_t last_stamp = 0;     // Clock at the latest enter/leave
+static uint64_t last_children_cpu = 0;
+static uint64_t profile_start_ns = 0;
+static char *folded_path = NULL;
+static pid_t profile_pid = 0;  // Forked children never report
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t children_cpu_us(void) {
+    struct rusage ru;
+    if (getrusage(RUSAGE_CHILDREN, &ru) < 0) {
+        return last_children_cpu;
+    }
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ULL +
+           (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
+
+static uint64_t hash_string(const char *s) {
+    uint64_t h = 1469598103934665603ULL;
+    for (; *s; s++) {
+        h = (h ^ (unsigned char)*s) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static uint64_t hash_line(const char *origin, int line) {
+    uint64_t h = (uint64_t)(uintptr_t)origin * 0x9e3779b97f4a7c15ULL;
+    return h ^ ((uint64_t)(unsigned)line * 0xff51afd7ed558ccdULL);
+}
+
+/**
+ * Find the slot for a key; match() decides equality with a stored record
+ */
+static void **table_find(PtrTable *t, uint64_t hash, int (*match)(const void *, const void *),
+                         const void *key) {
+    if (t->capacity == 0 || (t->count + 1) * 10 > t->capacity * 7) {
+        return NULL;
+    }
+    size_t i = (size_t)hash & (t->capacity - 1);
+    while (t->slots[i] != NULL && !match(t->slots[i], key)) {
+        i = (i + 1) & (t->capacity - 1);
+    }
+    return &t->slots[i];
+}
+
+static void table_grow(PtrTable *t, uint64_t (*rehash)(const void *)) {
+    size_t capacity = t->capacity ? t->capacity * 2 : 256;
+    void **slots = calloc(capacity, sizeof(void *));
+    if (slots == NULL) {
+        fprintf(stderr, "ushell: profile: out of memory\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < t->capacity; i++) {
+        if (t->slots[i] != NULL) {
+            size_t j = (size_t)rehash(t->slots[i]) & (capacity - 1);
+            while (slots[j] != NULL) {
+                j = (j + 1) & (capacity - 1);
+            }
+            slots[j] = t->slots[i];
+        }
+    }
+    free(t->slots);
+    t->slots = slots;
+    t->capacity = capacity;
+}
+
+typedef struct {
+    const char *origin;
+    int line;
+} LineKey;
+
+static int line_match(const void *rec, const void *key) {
+    const LineStat *s = rec;
+    const LineKey *k = key;
+    return s->origin == k->origin && s->line == k->line;
+}
+
+static uint64_t line_rehash(const void *rec) {
+    const LineStat *s = rec;
+    return hash_line(s->origin, s->line);
+}
+
+static int func_match(const void *rec, const void *key) {
+    return strcmp(((const FuncStat *)rec)->name, key) == 0;
+}
+
+static uint64_t func_rehash(const void *rec) {
+    return hash_string(((const FuncStat *)rec)->name);
+}
+
+static uint64_t hash_fold(const FoldNode *parent, const void *stat) {
+    return ((uint64_t)(uintptr_t)parent * 0x9e3779b97f4a7c15ULL) ^
+           ((uint64_t)(uintptr_t)stat * 0xff51afd7ed558ccdULL);
+}
+
+static int fold_match(const void *rec, const void *key) {
+    const FoldNode *n = rec;
+    const FoldNode *k = key;
+    return n->parent == k->parent && n->stat == k->stat;
+}
+
+static uint64_t fold_rehash(const void *rec) {
+    const FoldNode *n = rec;
+    return hash_fold(n->parent, n->stat);
+}
+
+/**
+ * Intern an origin name so stats never point into freed script units
+ */
+static const char *intern_origin(const char *origin) {
+    if (last_origin != NULL && strcmp(last_origin, origin) == 0) {
+        return last_origin;
+    }
+    for (int i = 0; i < origin_count; i++) {
+        if (strcmp(origins[i], origin) == 0) {
+            return last_origin = origins[i];
+        }
+    }
+    char **grown = realloc(origins, sizeof(char *) * (origin_count + 1));
+    char *copy = strdup(origin);
+    if (grown == NULL || copy == NULL) {
+        fprintf(stderr, "ushell: profile: out of memory\n");
+        exit(1);
+    }
+    origins = grown;
+    origins[origin_count++] = copy;
+    return last_origin = copy;
+}
+
+/**
+ * Call tree node for stat under parent, created on first use
+ */
+static FoldNode *fold_child(FoldNode *parent, void *stat, int is_function) {
+    FoldNode key = { parent, stat, is_function, 0 };
+    uint64_t hash = hash_fold(parent, stat);
+    void **slot = table_find(&folded, hash, fold_match, &key);
+    if (slot == NULL) {
+        table_grow(&folded, fold_rehash);
+        slot = table_find(&folded, hash, fold_match, &key);
+    }
+    if (*slot == NULL) {
+        FoldNode *n = malloc(sizeof(FoldNode));
+        if (n == NULL) {
+            fprintf(stderr, "ushell: profile: out of memory\n");
+            exit(1);
+        }
+        *n = key;
+        *slot = n;
+        folded.count++;
+    }
+    return *slot;
+}
+
+static void mark_begin(ProfileMark *mark, void *stat, int is_function) {
+    mark->parent = current;
+    mark->stat = stat;
+    mark->is_function = is_function;
+    mark->child_ns = 0;
+    mark->child_cpu_start = last_children_cpu;
+    mark->forks_start = profile_forks;
+    mark->execs_start = profile_execs;
+    mark->fold = folded_path == NULL ? NULL :
+        fold_child(current ? current->fold : NULL, stat, is_function);
+    current = mark;
+    // Back-to-back commands share one clock read: the gap since the last
+    // boundary is interpreter work leading up to this command
+    mark->start_ns = last_stamp ? last_stamp : now_ns();
+}
+
+void profile_sync_clock(void) {
+    last_stamp = 0;
+}
+
+void profile_enter(ProfileMark *mark, void **cache, const char *origin, int line,
+                   const char *text) {
+    if (*cache != NULL) {
+        LineStat *s = *cache;
+        s->active++;
+        mark_begin(mark, s, 0);
+        return;
+    }
+
+    LineKey key = { intern_origin(origin ? origin : "stdin"), line };
+    uint64_t hash = hash_line(key.origin, key.line);
+
+    void **slot = table_find(&lines, hash, line_match, &key);
+    if (slot == NULL) {
+        table_grow(&lines, line_rehash);
+        slot = table_find(&lines, hash, line_match, &key);
+    }
+    if (*slot == NULL) {
+        LineStat *s = calloc(1, sizeof(LineStat));
+        if (s == NULL) {
+            fprintf(stderr, "ushell: profile: out of memory\n");
+            exit(1);
+        }
+        s->origin = key.origin;
+        s->line = line;
+        s->text = strndup(text ? text : "", PROFILE_TEXT_MAX);
+        if (s->text != NULL) {
+            for (char *c = s->text; *c; c++) {
+                if (*c == '\n' || *c == '\t') {
+                    *c = ' ';
+                }
+            }
+        }
+        *slot = s;
+        lines.count++;
+    }
+    LineStat *s = *slot;
+    *cache = s;
+    s->active++;
+    mark_begin(mark, s, 0);
+}
+
+void profile_enter_function(ProfileMark *mark, const char *name) {
+    uint64_t hash = hash_string(name);
+    void **slot = table_find(&funcs, hash, func_match, name);
+    if (slot == NULL) {
+        table_grow(&funcs, func_rehash);
+        slot = table_find(&funcs, hash, func_match, name);
+    }
+    if (*slot == NULL) {
+        FuncStat *f = calloc(1, sizeof(FuncStat));
+        if (f == NULL || (f->name = strdup(name)) == NULL) {
+            fprintf(stderr, "ushell: profile: out of memory\n");
+            exit(1);
+        }
+        *slot = f;
+        funcs.count++;
+    }
+    FuncStat *f = *slot;
+    f->active++;
+    mark_begin(mark, f, 1);
+}
+
+void profile_leave(ProfileMark *mark) {
+    last_stamp = now_ns();
+    uint64_t elapsed = last_stamp - mark->start_ns;
+    uint64_t self = elapsed > mark->child_ns ? elapsed - mark->child_ns : 0;
+
+    // Child CPU only changes when children are reaped, i.e. after a fork
+    uint64_t child_cpu = 0;
+    if (profile_forks != mark->forks_start) {
+        last_children_cpu = children_cpu_us();
+        child_cpu = last_children_cpu - mark->child_cpu_start;
+    }
+
+    if (mark->fold != NULL) {
+        ((FoldNode *)mark->fold)->self_ns += self;
+    }
+
+    if (mark->is_function) {
+        FuncStat *f = mark->stat;
+        f->calls++;
+        f->self_ns += self;
+        if (--f->active == 0) {
+            f->total_ns += elapsed;
+        }
+    } else {
+        LineStat *s = mark->stat;
+        s->calls++;
+        s->self_ns += self;
+        if (--s->active == 0) {
+            s->total_ns += elapsed;
+            s->child_cpu_us += child_cpu;
+            s->forks += profile_forks - mark->forks_start;
+            s->execs += profile_execs - mark->execs_start;
+        }
+    }
+
+    current = mark->parent;
+    if (current != NULL) {
+        current->child_ns += elapsed;
+    }
+}
+
+void profile_start(const char *path) {
+    if (path != NULL) {
+        free(folded_path);
+        folded_path = strdup(path);
+    }
+    if (profile_enabled) {
+        return;
+    }
+    profile_enabled = 1;
+    profile_pid = getpid();
+    last_children_cpu = children_cpu_us();
+    profile_start_ns = now_ns();
+    atexit(profile_report);
+}
+
+static int by_self_line(const void *a, const void *b) {
+    const LineStat *x = *(LineStat *const *)a;
+    const LineStat *y = *(LineStat *const *)b;
+    return (x->self_ns < y->self_ns) - (x->self_ns > y->self_ns);
+}
+
+static int by_total_func(const void *a, const void *b) {
+    const FuncStat *x = *(FuncStat *const *)a;
+    const FuncStat *y = *(FuncStat *const *)b;
+    return (x->total_ns < y->total_ns) - (x->total_ns > y->total_ns);
+}
+
+/**
+ * Copy the non-empty slots of a table into a new array
+ */
+static void **table_items(PtrTable *t) {
+    void **items = malloc(sizeof(void *) * (t->count + 1));
+    size_t n = 0;
+    for (size_t i = 0; items != NULL && i < t->capacity; i++) {
+        if (t->slots[i] != NULL) {
+            items[n++] = t->slots[i];
+        }
+    }
+    return items;
+}
+
+/**
+ * Print the frames from the root down to n, separated by ';'
+ */
+static void write_stack(FILE *out, const FoldNode *n) {
+    if (n->parent != NULL) {
+        write_stack(out, n->parent);
+        fputc(';', out);
+    }
+    if (n->is_function) {
+        fprintf(out, "%s()", ((FuncStat *)n->stat)->name);
+    } else {
+        const LineStat *s = n->stat;
+        fprintf(out, "%s:%d", s->origin, s->line);
+    }
+}
+
+void profile_report(void) {
+    if (!profile_enabled || getpid() != profile_pid) {
+        return;
+    }
+    profile_enabled = 0;  // Commands run by atexit handlers are not profiled
+    double wall_ms = (double)(now_ns() - profile_start_ns) / 1e6;
+
+    uint64_t commands = 0;
+    LineStat **rows = (LineStat **)table_items(&lines);
+    if (rows == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < lines.count; i++) {
+        commands += rows[i]->calls;
+    }
+    qsort(rows, lines.count, sizeof(LineStat *), by_self_line);
+
+    fflush(stdout);
+    fprintf(stderr, "\n=== ushell profile: %zu lines, %llu commands, %.1f ms wall, "
+                    "%lu forks, %lu execs ===\n",
+            lines.count, (unsigned long long)commands, wall_ms, profile_forks, profile_execs);
+    fprintf(stderr, "%10s %10s %10s %8s %6s %6s  %-20s %s\n",
+            "self ms", "total ms", "child cpu", "calls", "forks", "execs", "location", "command");
+    for (size_t i = 0; i < lines.count && i < PROFILE_REPORT_ROWS; i++) {
+        LineStat *s = rows[i];
+        char location[64];
+        snprintf(location, sizeof(location), "%s:%d", s->origin, s->line);
+        fprintf(stderr, "%10.3f %10.3f %10.3f %8llu %6lu %6lu  %-20s %s\n",
+                (double)s->self_ns / 1e6, (double)s->total_ns / 1e6,
+                (double)s->child_cpu_us / 1e3, (unsigned long long)s->calls,
+                s->forks, s->execs, location, s->text ? s->text : "");
+    }
+    if (lines.count > PROFILE_REPORT_ROWS) {
+        fprintf(stderr, "(%zu more lines)\n", lines.count - PROFILE_REPORT_ROWS);
+    }
+    free(rows);
+
+    if (funcs.count > 0) {
+        FuncStat **frows = (FuncStat **)table_items(&funcs);
+        if (frows != NULL) {
+            qsort(frows, funcs.count, sizeof(FuncStat *), by_total_func);
+            fprintf(stderr, "--- functions ---\n");
+            fprintf(stderr, "%10s %10s %8s  %s\n", "total ms", "self ms", "calls", "function");
+            for (size_t i = 0; i < funcs.count; i++) {
+                fprintf(stderr, "%10.3f %10.3f %8llu  %s\n",
+                        (double)frows[i]->total_ns / 1e6, (double)frows[i]->self_ns / 1e6,
+                        (unsigned long long)frows[i]->calls, frows[i]->name);
+            }
+            free(frows);
+        }
+    }
+
+    if (folded_path != NULL) {
+        FILE *out = fopen(folded_path, "w");
+        if (out == NULL) {
+            perror(folded_path);
+            return;
+        }
+        for (size_t i = 0; i < folded.capacity; i++) {
+            FoldNode *n = folded.slots[i];
+            if (n != NULL && n->self_ns >= 1000) {
+                write_stack(out, n);
+                fprintf(out, " %llu\n", (unsigned long long)(n->self_ns / 1000));
+            }
+        }
+        fclose(out);
+        fprintf(stderr, "Folded stacks written to %s\n", folded_path);
+    }
+}
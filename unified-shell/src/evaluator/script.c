@@ -0,0 +1,3168 @@
+/**
+ * script.c - Shell language parser and AST interpreter
+ *
+ * Text is parsed once into Nodes allocated from the ScriptUnit's arena.
+ * Simple commands keep their raw text for the general path (expand the
+ * text, then parse_pipeline/execute_pipeline exactly as before) and, when
+ * the command only uses plain words, literal text, $NAME, $?, $N and
+ * $((expr)), a pre-split word list that is re-assembled in place on every
+ * execution. That fast path resolves variables through EnvSlots and
+ * reuses per-word buffers, so a loop body that calls builtins performs
+ * no parsing and no allocation per iteration.
+ */
+
+#include "script.h"
+#include "executor.h"
+#include "expansion.h"
+#include "arithmetic.h"
+#include "conditional.h"
+#include "signals.h"
+#include "arena.h"
+#include "glob.h"
+#include "profile.h"
+#include "builtins.h"
+#include "tools.h"
+#include "heredoc.h"
+#include "procsub.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+#define UNIT_CHUNK_SIZE 4096
+
+/* Characters that make an unquoted $var unsafe for the fast path: the
+ * general path would split, re-quote, glob or re-parse the value. */
+#define UNQUOTED_UNSAFE " \t\n'\"*?[|<>&;"
+#define QUOTED_UNSAFE "\"*?[&"
+
+typedef enum {
+    N_SIMPLE,
+    N_AND,
+    N_OR,
+    N_NOT,
+    N_IF,
+    N_WHILE,
+    N_UNTIL,
+    N_FOR,
+    N_CASE,
+    N_FUNCDEF,
+    N_GROUP,
+    N_SUBSHELL,
+    N_PIPE          // left | right with a compound stage (left may be N_PIPE)
+} NodeType;
+
+typedef enum {
+    HERE_NONE,
+    HERE_DOC,       // <<EOF: body expanded as it is written
+    HERE_LITERAL,   // <<'EOF': body used as is
+    HERE_STRING     // <<<word: expanded word plus a newline
+} HereKind;
+
+typedef enum {
+    PART_LITERAL,
+    PART_VAR,       // $NAME / ${NAME} / $N
+    PART_STATUS,    // $?
+    PART_ARITH      // $((expr))
+} PartType;
+
+typedef struct {
+    PartType type;
+    const char *text;   // Literal text or arithmetic expression
+    size_t len;
+    int position;       // >0 for $N
+    EnvSlot slot;
+} WordPart;
+
+/**
+ * A pre-split word, assembled into buf on each execution
+ */
+typedef struct {
+    WordPart *parts;
+    int nparts;
+    int quoted;         // Whole word was "..."
+    int assign;         // Value of NAME=value (never split)
+    const char *literal;  // Set when the word has no expansions
+    char *buf;
+    size_t cap;
+} Word;
+
+typedef struct {
+    const char *text;   // Raw command text for the general path
+    int fast;
+    Word *words;
+    int nwords;
+    char **argv;
+    const char *assign_name;
+    EnvSlot assign_slot;
+    int busy;           // Re-entered (recursive function): use general path
+} Simple;
+
+typedef struct CaseArm {
+    const char **patterns;      // Raw text (expanded at run time)
+    GlobPattern **compiled;     // Pre-compiled when the text is constant
+    int npatterns;
+    struct Node *body;
+    struct CaseArm *next;
+} CaseArm;
+
+typedef struct Node {
+    NodeType type;
+    struct Node *next;          // Next command in a list
+
+    struct Node *left;          // &&, ||, !, |
+    struct Node *right;
+
+    struct Node *cond;          // if / while / until
+    struct Node *body;          // if / loops / functions / groups / ( )
+    struct Node *else_part;
+
+    Simple simple;
+
+    const char *name;           // for variable / function name
+    EnvSlot var_slot;
+    const char *list_text;      // for ... in <list_text>
+    int has_list;
+
+    const char *case_text;
+    Word case_word;
+    int case_fast;
+    CaseArm *arms;
+
+    const char *redir_in;       // compound < file
+    const char *redir_out;      // compound > file / >> file
+    int redir_append;
+    HereKind here_kind;         // Here-document / here-string on stdin
+    const char *here_text;      // Body (or the <<< word)
+
+    int line;                   // Source line, relative to the unit
+    void *profile_stat;         // Profiler record for this line
+} Node;
+
+struct ScriptUnit {
+    Arena arena;
+    int refs;
+    Node *root;
+    GlobPattern **patterns;
+    int pattern_count;
+    int pattern_capacity;
+    const char *origin;         // "stdin" or script path (profiler)
+    int line_base;              // Line number of the unit's first line
+};
+
+typedef struct {
+    const char *src;
+    size_t pos;
+    ScriptUnit *unit;
+    int status;
+    int quiet;
+    size_t line_pos;            // Position up to which lines are counted
+    int line;
+    size_t here_nl;             // Newline followed by here-document bodies (0: none)
+    size_t here_resume;         // Where parsing continues after those bodies
+} Parser;
+
+typedef struct {
+    char *name;
+    Node *body;
+    ScriptUnit *unit;
+} ShellFunction;
+
+typedef struct {
+    int argc;
+    char **argv;    // argv[0] is the function name
+} Frame;
+
+static ShellFunction *functions = NULL;
+static int function_count = 0;
+static int function_capacity = 0;
+
+static Frame *current_frame = NULL;
+static ScriptUnit *current_unit = NULL;
+static int exec_depth = 0;
+static int loop_depth = 0;
+static int func_depth = 0;
+static int pending_break = 0;
+static int pending_continue = 0;
+static int pending_return = 0;
+static int pending_abort = 0;      // A failed ${var:?message} unwinds everything
+static int return_status = 0;
+static int abort_exits = 0;
+
+static int tail_exec_enabled = 0;  // -c / script mode
+static int tail_position = 0;      // Nothing runs after the current command
+
+static const char *input_origin = "stdin";
+static int input_line = 1;
+
+static const char *const if_then_terms[] = { "then", NULL };
+static const char *const if_body_terms[] = { "elif", "else", "fi", NULL };
+static const char *const fi_terms[] = { "fi", NULL };
+static const char *const do_terms[] = { "do", NULL };
+static const char *const done_terms[] = { "done", NULL };
+static const char *const esac_terms[] = { "esac", NULL };
+static const char *const brace_terms[] = { "}", NULL };
+static const char *const paren_terms[] = { NULL };  // Only ')' ends ( list )
+static const char *const closers[] = {
+    "then", "elif", "else", "fi", "do", "done", "esac", "}", NULL
+};
+
+static Node *parse_list(Parser *p, const char *const *terms, const char *const *stops);
+static Node *parse_command(Parser *p, const char *const *stops);
+static int exec_list(Node *node, Env *env);
+static int exec_node(Node *node, Env *env);
+
+// ============================================================================
+// Lexical helpers
+// ============================================================================
+
+static int is_name_start(char c) {
+    return isalpha((unsigned char)c) || c == '_';
+}
+
+static int is_name_char(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+static int word_equals(const char *s, size_t len, const char *kw) {
+    return strlen(kw) == len && strncmp(s, kw, len) == 0;
+}
+
+static int word_in(const char *s, size_t len, const char *const *set) {
+    for (; set && *set; set++) {
+        if (word_equals(s, len, *set)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Skip a quoted or bracketed region; i points just past the opener.
+ * Returns the index after the closer, or strlen(s) with *open set.
+ */
+static size_t skip_region(const char *s, size_t i, char closer, int *open) {
+    int depth = 0;
+    while (s[i]) {
+        char c = s[i];
+        if (c == '\\' && closer != '\'' && s[i + 1]) {
+            i += 2;
+            continue;
+        }
+        if (c == closer && depth == 0) {
+            return i + 1;
+        }
+        if (closer == '\'') {
+            i++;
+            continue;
+        }
+        if (closer == ')' || closer == '}') {
+            if (c == '\'' || c == '"' || c == '`') {
+                i = skip_region(s, i + 1, c, open);
+                continue;
+            }
+            if (c == (closer == ')' ? '(' : '{')) {
+                depth++;
+            } else if (c == closer) {
+                depth--;
+            }
+        } else if (closer == '"' && c == '$' && s[i + 1] == '(') {
+            i = skip_region(s, i + 2, ')', open);
+            continue;
+        }
+        i++;
+    }
+    *open = 1;
+    return i;
+}
+
+/**
+ * Find the end of the word starting at i
+ */
+static size_t scan_word_end(const char *s, size_t i, int *open) {
+    while (s[i]) {
+        char c = s[i];
+        if (c == ' ' || c == '\t' || c == '\n' || c == ';' || c == '&' ||
+            c == '|' || c == '<' || c == '>' || c == '(' || c == ')') {
+            break;
+        }
+        if (c == '\\') {
+            i += s[i + 1] ? 2 : 1;
+        } else if (c == '\'' || c == '"' || c == '`') {
+            i = skip_region(s, i + 1, c, open);
+        } else if (c == '$' && s[i + 1] == '(') {
+            i = skip_region(s, i + 2, ')', open);
+        } else if (c == '$' && s[i + 1] == '{') {
+            i = skip_region(s, i + 2, '}', open);
+        } else {
+            i++;
+        }
+    }
+    return i;
+}
+
+/**
+ * Skip blanks, backslash-newlines and comments (not newlines)
+ */
+static void skip_blanks(Parser *p) {
+    const char *s = p->src;
+    for (;;) {
+        char c = s[p->pos];
+        if (c == ' ' || c == '\t' || c == '\r') {
+            p->pos++;
+        } else if (c == '\\' && s[p->pos + 1] == '\n') {
+            p->pos += 2;
+        } else if (c == '#') {
+            while (s[p->pos] && s[p->pos] != '\n') {
+                p->pos++;
+            }
+        } else {
+            return;
+        }
+    }
+}
+
+/**
+ * Skip blanks, newlines and single ';' separators (stops at ";;")
+ */
+/**
+ * Consume a newline, stepping over the here-document bodies that follow it
+ */
+static void skip_newline(Parser *p) {
+    if (p->here_nl != 0 && p->pos == p->here_nl) {
+        p->pos = p->here_resume;
+        p->here_nl = 0;
+    } else {
+        p->pos++;
+    }
+}
+
+static void skip_separators(Parser *p) {
+    for (;;) {
+        skip_blanks(p);
+        char c = p->src[p->pos];
+        if (c == '\n') {
+            skip_newline(p);
+        } else if (c == ';' && p->src[p->pos + 1] != ';') {
+            p->pos++;
+        } else {
+            return;
+        }
+    }
+}
+
+static void skip_newlines(Parser *p) {
+    for (;;) {
+        skip_blanks(p);
+        if (p->src[p->pos] != '\n') {
+            return;
+        }
+        skip_newline(p);
+    }
+}
+
+/**
+ * Peek the next word without consuming it; returns its length
+ */
+static size_t peek_word(Parser *p, size_t *start) {
+    int open = 0;
+    skip_blanks(p);
+    *start = p->pos;
+    return scan_word_end(p->src, p->pos, &open) - p->pos;
+}
+
+static int at_word(Parser *p, const char *kw) {
+    size_t start;
+    size_t len = peek_word(p, &start);
+    return word_equals(p->src + start, len, kw);
+}
+
+static void syntax_error(Parser *p, const char *fmt, const char *arg) {
+    if (p->status == SCRIPT_OK) {
+        p->status = SCRIPT_SYNTAX_ERROR;
+        if (!p->quiet) {
+            fprintf(stderr, "ushell: syntax error: ");
+            fprintf(stderr, fmt, arg);
+            fprintf(stderr, "\n");
+        }
+    }
+}
+
+/**
+ * Consume keyword kw or report it missing
+ */
+static int expect_word(Parser *p, const char *kw) {
+    skip_separators(p);
+    if (at_word(p, kw)) {
+        p->pos += strlen(kw);
+        return 1;
+    }
+    if (p->src[p->pos] == '\0') {
+        if (p->status == SCRIPT_OK) {
+            p->status = SCRIPT_INCOMPLETE;
+        }
+    } else {
+        syntax_error(p, "expected '%s'", kw);
+    }
+    return 0;
+}
+
+static Node *new_node(Parser *p, NodeType type) {
+    Node *node = arena_alloc(&p->unit->arena, sizeof(Node));
+    if (node == NULL) {
+        fprintf(stderr, "ushell: out of memory\n");
+        exit(1);
+    }
+    memset(node, 0, sizeof(*node));
+    node->type = type;
+    return node;
+}
+
+/**
+ * Line number (0-based) of a source position; positions mostly only
+ * move forward, so counting is incremental
+ */
+static int line_at(Parser *p, size_t pos) {
+    if (pos < p->line_pos) {
+        p->line_pos = 0;
+        p->line = 0;
+    }
+    for (; p->line_pos < pos; p->line_pos++) {
+        if (p->src[p->line_pos] == '\n') {
+            p->line++;
+        }
+    }
+    return p->line;
+}
+
+static char *unit_strndup(Parser *p, const char *s, size_t len) {
+    char *copy = arena_strndup(&p->unit->arena, s, len);
+    if (copy == NULL) {
+        fprintf(stderr, "ushell: out of memory\n");
+        exit(1);
+    }
+    return copy;
+}
+
+// ============================================================================
+// Word compilation (fast path)
+// ============================================================================
+
+/**
+ * Split content into parts; returns 0 if the fast path cannot model it
+ */
+static int compile_parts(Parser *p, Word *w, const char *s, size_t len) {
+    w->parts = arena_alloc(&p->unit->arena, sizeof(WordPart) * (len + 1));
+    w->nparts = 0;
+
+    size_t i = 0;
+    while (i < len) {
+        WordPart *part = &w->parts[w->nparts];
+        memset(part, 0, sizeof(*part));
+
+        if (s[i] != '$') {
+            size_t j = i;
+            while (j < len && s[j] != '$') {
+                j++;
+            }
+            part->type = PART_LITERAL;
+            part->text = s + i;
+            part->len = j - i;
+            w->nparts++;
+            i = j;
+            continue;
+        }
+
+        char next = i + 1 < len ? s[i + 1] : '\0';
+        if (next == '(' && i + 2 < len && s[i + 2] == '(') {
+            // $((expr)) without nested expansions
+            size_t j = i + 3;
+            int depth = 0;
+            while (j < len) {
+                if (s[j] == '(') {
+                    depth++;
+                } else if (s[j] == ')') {
+                    if (depth == 0 && j + 1 < len && s[j + 1] == ')') {
+                        break;
+                    }
+                    depth--;
+                }
+                j++;
+            }
+            if (j >= len || memchr(s + i + 3, '$', j - i - 3) != NULL) {
+                return 0;
+            }
+            part->type = PART_ARITH;
+            part->text = unit_strndup(p, s + i + 3, j - i - 3);
+            w->nparts++;
+            i = j + 2;
+        } else if (next == '{' || is_name_char(next)) {
+            size_t name_start = i + 1 + (next == '{');
+            size_t j = name_start;
+            while (j < len && is_name_char(s[j])) {
+                j++;
+            }
+            size_t name_len = j - name_start;
+            if (name_len == 0) {
+                return 0;
+            }
+            if (next == '{') {
+                if (j >= len || s[j] != '}') {
+                    return 0;  // ${v...} operators use the general path
+                }
+                j++;
+            }
+            const char *name = unit_strndup(p, s + name_start, name_len);
+            int digits = 1;
+            for (size_t k = 0; k < name_len; k++) {
+                digits &= isdigit((unsigned char)name[k]) != 0;
+            }
+            if (!digits && !is_name_start(name[0])) {
+                return 0;
+            }
+            part->type = PART_VAR;
+            part->position = digits ? atoi(name) : 0;
+            part->slot.name = name;
+            part->slot.index = -1;
+            part->slot.generation = 0;
+            w->nparts++;
+            i = j;
+        } else if (next == '?') {
+            part->type = PART_STATUS;
+            w->nparts++;
+            i += 2;
+        } else if (next == '(' || next == '#' || next == '@' || next == '*') {
+            return 0;
+        } else {
+            // A lone '$' stays literal
+            part->type = PART_LITERAL;
+            part->text = s + i;
+            part->len = 1;
+            w->nparts++;
+            i++;
+        }
+    }
+
+    if (w->nparts == 0 || (w->nparts == 1 && w->parts[0].type == PART_LITERAL)) {
+        w->literal = unit_strndup(p, s, len);
+    }
+    w->cap = len + 32;
+    w->buf = arena_alloc(&p->unit->arena, w->cap);
+    return 1;
+}
+
+static int has_glob_chars(const char *s, size_t len) {
+    // [ [[ ] ]] are test commands, not patterns
+    if ((len == 1 && (s[0] == '[' || s[0] == ']')) ||
+        (len == 2 && (strncmp(s, "[[", 2) == 0 || strncmp(s, "]]", 2) == 0))) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '*' || s[i] == '?' || s[i] == '[') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Decide whether a simple command can run from pre-split words
+ */
+static void compile_simple(Parser *p, Node *node) {
+    Simple *sc = &node->simple;
+    const char *t = sc->text;
+
+    // Pipes, redirections, background, quoting and command substitution
+    // are handled by the general path
+    if (strpbrk(t, "|<>&`\\'~\n") != NULL || strstr(t, "$(") != strstr(t, "$((")) {
+        return;
+    }
+
+    int max_words = 1;
+    for (const char *c = t; *c; c++) {
+        max_words += (*c == ' ' || *c == '\t');
+    }
+    sc->words = arena_alloc(&p->unit->arena, sizeof(Word) * max_words);
+    sc->nwords = 0;
+
+    const char *c = t;
+    while (*c) {
+        while (*c == ' ' || *c == '\t') {
+            c++;
+        }
+        if (*c == '\0') {
+            break;
+        }
+        const char *start = c;
+        while (*c && *c != ' ' && *c != '\t') {
+            c++;
+        }
+        size_t len = (size_t)(c - start);
+
+        Word *w = &sc->words[sc->nwords];
+        memset(w, 0, sizeof(*w));
+        const char *content = start;
+        size_t content_len = len;
+        if (start[0] == '"') {
+            if (len < 2 || start[len - 1] != '"' || memchr(start + 1, '"', len - 2) != NULL) {
+                return;
+            }
+            w->quoted = 1;
+            content = start + 1;
+            content_len = len - 2;
+        } else if (memchr(start, '"', len) != NULL) {
+            return;
+        }
+        if (has_glob_chars(content, content_len)) {
+            return;
+        }
+
+        // NAME=value as the only word is an assignment
+        if (sc->nwords == 0 && !w->quoted && is_name_start(content[0])) {
+            const char *eq = content;
+            while (eq < content + content_len && is_name_char(*eq)) {
+                eq++;
+            }
+            if (eq < content + content_len && *eq == '=') {
+                const char *rest = c;
+                while (*rest == ' ' || *rest == '\t') {
+                    rest++;
+                }
+                if (*rest != '\0') {
+                    return;
+                }
+                sc->assign_name = unit_strndup(p, content, (size_t)(eq - content));
+                sc->assign_slot.name = sc->assign_name;
+                sc->assign_slot.index = -1;
+                w->assign = 1;
+                content_len -= (size_t)(eq + 1 - content);
+                content = eq + 1;
+            }
+        }
+
+        if (!compile_parts(p, w, content, content_len)) {
+            return;
+        }
+        sc->nwords++;
+    }
+
+    if (sc->nwords == 0 || (!sc->assign_name && sc->words[0].literal == NULL)) {
+        return;  // Command names from variables use the general path
+    }
+    sc->argv = arena_alloc(&p->unit->arena, sizeof(char *) * (sc->nwords + 1));
+    sc->argv[sc->nwords] = NULL;
+    sc->fast = 1;
+}
+
+/**
+ * Assemble a compiled word; NULL means "use the general path this time"
+ */
+static const char *assemble_word(ScriptUnit *unit, Word *w, Env *env) {
+    if (w->literal) {
+        return w->literal;
+    }
+
+    size_t len = 0;
+    for (int i = 0; i < w->nparts; i++) {
+        WordPart *part = &w->parts[i];
+        const char *v = NULL;
+        size_t vlen = 0;
+        char num[32];
+
+        switch (part->type) {
+            case PART_LITERAL:
+                v = part->text;
+                vlen = part->len;
+                break;
+            case PART_VAR:
+                v = part->position > 0 ? script_positional(part->position) : NULL;
+                if (v == NULL) {
+                    v = env_get_slot(env, &part->slot);
+                }
+                if (v == NULL) {
+                    v = env_array_get(env, part->slot.name, 0);
+                }
+                if (v == NULL) {
+                    v = "";
+                }
+                if (!w->assign && strpbrk(v, w->quoted ? QUOTED_UNSAFE : UNQUOTED_UNSAFE)) {
+                    return NULL;
+                }
+                vlen = strlen(v);
+                break;
+            case PART_STATUS:
+                vlen = (size_t)snprintf(num, sizeof(num), "%d", last_exit_status);
+                v = num;
+                break;
+            case PART_ARITH:
+                vlen = (size_t)snprintf(num, sizeof(num), "%d", eval_arithmetic(part->text, env));
+                v = num;
+                break;
+        }
+
+        if (len + vlen + 1 > w->cap) {
+            size_t cap = w->cap * 2;
+            while (cap < len + vlen + 1) {
+                cap *= 2;
+            }
+            char *grown = arena_alloc(&unit->arena, cap);
+            if (grown == NULL) {
+                return NULL;
+            }
+            memcpy(grown, w->buf, len);
+            w->buf = grown;
+            w->cap = cap;
+        }
+        memcpy(w->buf + len, v, vlen);
+        len += vlen;
+    }
+    w->buf[len] = '\0';
+
+    // An unquoted word that expands to nothing disappears
+    if (len == 0 && !w->quoted && !w->assign) {
+        return NULL;
+    }
+    return w->buf;
+}
+
+// ============================================================================
+// Parser
+// ============================================================================
+
+/**
+ * Parse <<WORD, <<-WORD or <<<WORD at p->pos
+ *
+ * A here-document body is taken from the lines after the current one (or
+ * after the bodies of earlier here-documents on it) up to the delimiter
+ * line; skip_newline() steps over it later. Quoting any part of the
+ * delimiter turns expansion of the body off; <<- strips leading tabs.
+ * @return 1 on success, 0 on error or incomplete input (p->status set)
+ */
+static int parse_here(Parser *p, HereKind *kind, const char **text) {
+    const char *s = p->src;
+    int string = s[p->pos + 2] == '<';
+    int strip = !string && s[p->pos + 2] == '-';
+    p->pos += 2 + (string || strip);
+
+    size_t start;
+    size_t len = peek_word(p, &start);
+    if (len == 0) {
+        syntax_error(p, "expected word after '%s'", string ? "<<<" : strip ? "<<-" : "<<");
+        return 0;
+    }
+    p->pos = start + len;
+    if (string) {
+        *kind = HERE_STRING;
+        *text = unit_strndup(p, s + start, len);
+        return 1;
+    }
+
+    char *delim = unit_strndup(p, s + start, len);
+    *kind = strpbrk(delim, "'\"\\") ? HERE_LITERAL : HERE_DOC;
+    size_t dlen = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (delim[i] == '\\' && i + 1 < len) {
+            delim[dlen++] = delim[++i];
+        } else if (delim[i] != '\'' && delim[i] != '"') {
+            delim[dlen++] = delim[i];
+        }
+    }
+    delim[dlen] = '\0';
+
+    size_t nl;
+    size_t body;
+    if (p->here_nl != 0) {
+        nl = p->here_nl;
+        body = p->here_resume;
+    } else {
+        const char *eol = strchr(s + p->pos, '\n');
+        if (eol == NULL) {
+            p->status = SCRIPT_INCOMPLETE;
+            return 0;
+        }
+        nl = (size_t)(eol - s);
+        body = nl + 1;
+    }
+
+    // Find the delimiter line; the body is everything before it
+    size_t i = body;
+    size_t resume;
+    for (;;) {
+        if (s[i] == '\0') {
+            p->status = SCRIPT_INCOMPLETE;
+            return 0;
+        }
+        size_t line_end = i;
+        while (s[line_end] && s[line_end] != '\n') {
+            line_end++;
+        }
+        size_t text_start = i;
+        while (strip && s[text_start] == '\t') {
+            text_start++;
+        }
+        if (line_end - text_start == dlen && strncmp(s + text_start, delim, dlen) == 0) {
+            resume = s[line_end] ? line_end + 1 : line_end;
+            break;
+        }
+        i = s[line_end] ? line_end + 1 : line_end;
+    }
+
+    char *out = arena_alloc(&p->unit->arena, i - body + 1);
+    if (out == NULL) {
+        fprintf(stderr, "ushell: out of memory\n");
+        exit(1);
+    }
+    size_t n = 0;
+    for (size_t j = body; j < i; j++) {
+        if (strip && s[j] == '\t' && (j == body || s[j - 1] == '\n')) {
+            while (s[j] == '\t') {
+                j++;
+            }
+        }
+        out[n++] = s[j];
+    }
+    out[n] = '\0';
+    *text = out;
+
+    p->here_nl = nl;
+    p->here_resume = resume;
+    return 1;
+}
+
+/**
+ * Parse one simple command: everything up to ; newline && || & or )
+ */
+/**
+ * Whether a word starts a compound command: if, while, until, for,
+ * case, { or ( (but not (( arithmetic ))
+ */
+static int starts_compound(const char *w, size_t len) {
+    return word_equals(w, len, "if") || word_equals(w, len, "while") ||
+           word_equals(w, len, "until") || word_equals(w, len, "for") ||
+           word_equals(w, len, "case") || word_equals(w, len, "{") ||
+           (w[0] == '(' && w[1] != '(');
+}
+
+/**
+ * Whether the '|' at the parser's position feeds a compound command
+ */
+static int pipes_to_compound(Parser *p) {
+    Parser look = *p;   // Peek only: newlines may skip here-documents
+    size_t start;
+    look.pos++;
+    skip_newlines(&look);
+    size_t len = peek_word(&look, &start);
+    return starts_compound(look.src + start, len);
+}
+
+static Node *parse_simple(Parser *p, const char *const *stops) {
+    const char *s = p->src;
+    int in_test = 0;
+    int first = 1;
+
+    skip_blanks(p);
+    size_t start = p->pos;
+    size_t end = start;
+    HereKind here_kind = HERE_NONE;
+    const char *here_text = NULL;
+    size_t cut_start = 0;       // <<WORD is taken out of the command text
+    size_t cut_end = 0;
+
+    for (;;) {
+        skip_blanks(p);
+        char c = s[p->pos];
+        if (c == '\0' || c == '\n') {
+            break;
+        }
+        if (in_test && strchr("&|<>()", c)) {
+            // [[ ]] uses these as operators of its own
+            p->pos++;
+            end = p->pos;
+            continue;
+        }
+        if (c == ';' || c == ')') {
+            break;
+        }
+        if (c == '&') {
+            if (s[p->pos + 1] == '&') {
+                break;
+            }
+            p->pos++;  // Background marker stays in the text
+            end = p->pos;
+            break;
+        }
+        if (c == '|') {
+            if (s[p->pos + 1] == '|' || pipes_to_compound(p)) {
+                break;  // cmd | while ...: parse_pipeline_node takes over
+            }
+            p->pos++;
+            end = p->pos;
+            skip_newlines(p);
+            if (s[p->pos] == '\0') {
+                p->status = SCRIPT_INCOMPLETE;
+                return NULL;
+            }
+            continue;
+        }
+        if (c == '<' && s[p->pos + 1] == '<') {
+            if (here_kind != HERE_NONE) {
+                syntax_error(p, "only one here-document per command%s", "");
+                return NULL;
+            }
+            cut_start = p->pos;
+            if (!parse_here(p, &here_kind, &here_text)) {
+                return NULL;
+            }
+            cut_end = p->pos;
+            end = p->pos;
+            continue;
+        }
+        if ((c == '<' || c == '>') && s[p->pos + 1] == '(') {
+            int open = 0;
+            p->pos = skip_region(s, p->pos + 2, ')', &open);  // <(cmd) >(cmd)
+            if (open) {
+                p->status = SCRIPT_INCOMPLETE;
+                return NULL;
+            }
+            end = p->pos;
+            first = 0;
+            continue;
+        }
+        if (c == '<' || c == '>' || c == '(') {
+            p->pos++;
+            if (c != '(' && s[p->pos] == '&') {
+                p->pos++;  // >&2, <&3, >&- stay part of the command
+            }
+            end = p->pos;
+            continue;
+        }
+
+        int open = 0;
+        size_t word_start = p->pos;
+        size_t word_end = scan_word_end(s, word_start, &open);
+        if (open) {
+            p->status = SCRIPT_INCOMPLETE;
+            return NULL;
+        }
+        size_t word_len = word_end - word_start;
+        if (!first && word_in(s + word_start, word_len, stops)) {
+            break;  // Legacy "if cmd then cmd fi" keyword
+        }
+        if (word_equals(s + word_start, word_len, "[[")) {
+            in_test = 1;
+        } else if (word_equals(s + word_start, word_len, "]]")) {
+            in_test = 0;
+        }
+        p->pos = word_end;
+        end = word_end;
+        first = 0;
+    }
+
+    if (end == start) {
+        char tok[3] = { s[p->pos], s[p->pos] == s[p->pos + 1] ? s[p->pos] : '\0', '\0' };
+        syntax_error(p, "unexpected token '%s'", tok[0] ? tok : "newline");
+        return NULL;
+    }
+
+    Node *node = new_node(p, N_SIMPLE);
+    node->line = line_at(p, start);
+    if (here_kind != HERE_NONE) {
+        size_t head = cut_start - start;
+        size_t tail = end - cut_end;
+        char *text = arena_alloc(&p->unit->arena, head + tail + 2);
+        if (text == NULL) {
+            fprintf(stderr, "ushell: out of memory\n");
+            exit(1);
+        }
+        memcpy(text, s + start, head);
+        text[head] = ' ';
+        memcpy(text + head + 1, s + cut_end, tail);
+        text[head + 1 + tail] = '\0';
+        node->simple.text = text;
+        node->here_kind = here_kind;
+        node->here_text = here_text;
+    } else {
+        node->simple.text = unit_strndup(p, s + start, end - start);
+    }
+    compile_simple(p, node);
+    return node;
+}
+
+/**
+ * if/elif tail: condition, then-branch and the rest up to fi
+ */
+static Node *parse_if_tail(Parser *p) {
+    Node *node = new_node(p, N_IF);
+
+    node->cond = parse_list(p, if_then_terms, if_then_terms);
+    if (p->status != SCRIPT_OK) {
+        return NULL;
+    }
+
+    // "if cond then cmd fi" without separators keeps working
+    size_t k = p->pos;
+    while (k > 0 && (p->src[k - 1] == ' ' || p->src[k - 1] == '\t')) {
+        k--;
+    }
+    int legacy = k > 0 && p->src[k - 1] != ';' && p->src[k - 1] != '\n';
+
+    if (!expect_word(p, "then")) {
+        return NULL;
+    }
+    node->body = parse_list(p, if_body_terms, legacy ? if_body_terms : NULL);
+    if (p->status != SCRIPT_OK) {
+        return NULL;
+    }
+
+    skip_separators(p);
+    if (at_word(p, "elif")) {
+        p->pos += 4;
+        node->else_part = parse_if_tail(p);
+        return p->status == SCRIPT_OK ? node : NULL;
+    }
+    if (at_word(p, "else")) {
+        p->pos += 4;
+        node->else_part = parse_list(p, fi_terms, legacy ? fi_terms : NULL);
+        if (p->status != SCRIPT_OK) {
+            return NULL;
+        }
+    }
+    return expect_word(p, "fi") ? node : NULL;
+}
+
+static Node *parse_loop(Parser *p, NodeType type) {
+    Node *node = new_node(p, type);
+    p->pos += 5;  // "while" / "until"
+
+    node->cond = parse_list(p, do_terms, NULL);
+    if (p->status != SCRIPT_OK || !expect_word(p, "do")) {
+        return NULL;
+    }
+    node->body = parse_list(p, done_terms, NULL);
+    if (p->status != SCRIPT_OK || !expect_word(p, "done")) {
+        return NULL;
+    }
+    return node;
+}
+
+static Node *parse_for(Parser *p) {
+    Node *node = new_node(p, N_FOR);
+    p->pos += 3;
+
+    size_t start;
+    size_t len = peek_word(p, &start);
+    if (len == 0 || !is_name_start(p->src[start])) {
+        syntax_error(p, "bad for loop variable%s", "");
+        return NULL;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (!is_name_char(p->src[start + i])) {
+            syntax_error(p, "bad for loop variable%s", "");
+            return NULL;
+        }
+    }
+    node->name = unit_strndup(p, p->src + start, len);
+    node->var_slot.name = node->name;
+    node->var_slot.index = -1;
+    p->pos = start + len;
+
+    skip_newlines(p);
+    if (at_word(p, "in")) {
+        p->pos += 2;
+        skip_blanks(p);
+        size_t list_start = p->pos;
+        size_t list_end = list_start;
+        for (;;) {
+            skip_blanks(p);
+            char c = p->src[p->pos];
+            if (c == '\0' || c == ';' || c == '\n') {
+                break;
+            }
+            int open = 0;
+            size_t word_end = scan_word_end(p->src, p->pos, &open);
+            if (open) {
+                p->status = SCRIPT_INCOMPLETE;
+                return NULL;
+            }
+            if (word_end == p->pos) {
+                syntax_error(p, "unexpected token in for list%s", "");
+                return NULL;
+            }
+            p->pos = word_end;
+            list_end = word_end;
+        }
+        node->list_text = unit_strndup(p, p->src + list_start, list_end - list_start);
+        node->has_list = 1;
+    }
+
+    if (!expect_word(p, "do")) {
+        return NULL;
+    }
+    node->body = parse_list(p, done_terms, NULL);
+    if (p->status != SCRIPT_OK || !expect_word(p, "done")) {
+        return NULL;
+    }
+    return node;
+}
+
+/**
+ * Remove quotes from a case pattern, escaping glob characters that were
+ * quoted so they match literally
+ */
+static char *unquote_pattern(Parser *p, const char *s, size_t len) {
+    char *out = arena_alloc(&p->unit->arena, len * 2 + 1);
+    size_t o = 0;
+    char quote = 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = s[i];
+        if (quote) {
+            if (c == quote) {
+                quote = 0;
+                continue;
+            }
+            if (c == '*' || c == '?' || c == '[' || c == '\\') {
+                out[o++] = '\\';
+            }
+            out[o++] = c;
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+        } else {
+            out[o++] = c;
+        }
+    }
+    out[o] = '\0';
+    return out;
+}
+
+static void unit_track_pattern(ScriptUnit *unit, GlobPattern *gp) {
+    if (unit->pattern_count == unit->pattern_capacity) {
+        int cap = unit->pattern_capacity ? unit->pattern_capacity * 2 : 8;
+        GlobPattern **grown = realloc(unit->patterns, sizeof(GlobPattern *) * cap);
+        if (grown == NULL) {
+            fprintf(stderr, "ushell: out of memory\n");
+            exit(1);
+        }
+        unit->patterns = grown;
+        unit->pattern_capacity = cap;
+    }
+    unit->patterns[unit->pattern_count++] = gp;
+}
+
+/**
+ * Pre-compile the subject word of a case node (fast path)
+ */
+static void compile_case_subject(Parser *p, Node *node) {
+    // Subject word: assembled like a command word, but never split
+    const char *subject = node->case_text;
+    size_t subject_len = strlen(subject);
+    int quoted = subject[0] == '"' && subject_len >= 2 && subject[subject_len - 1] == '"';
+    if (quoted) {
+        subject++;
+        subject_len -= 2;
+    }
+    if (strpbrk(node->case_text, "'`\\") == NULL &&
+        memchr(subject, '"', subject_len) == NULL &&
+        compile_parts(p, &node->case_word, subject, subject_len)) {
+        node->case_word.assign = 1;
+        node->case_fast = 1;
+    }
+}
+
+/**
+ * Pre-compile pattern i of a case arm when it contains no expansions
+ */
+static void compile_case_pattern(Parser *p, CaseArm *arm, int i) {
+    const char *raw = arm->patterns[i];
+    arm->compiled[i] = NULL;
+    if (strpbrk(raw, "$`") == NULL) {
+        GlobPattern *gp = arena_alloc(&p->unit->arena, sizeof(GlobPattern));
+        if (gp && glob_compile(gp, unquote_pattern(p, raw, strlen(raw))) == 0) {
+            unit_track_pattern(p->unit, gp);
+            arm->compiled[i] = gp;
+        }
+    }
+}
+
+static Node *parse_case(Parser *p) {
+    Node *node = new_node(p, N_CASE);
+    p->pos += 4;
+
+    skip_blanks(p);
+    int open = 0;
+    size_t word_start = p->pos;
+    size_t word_end = scan_word_end(p->src, word_start, &open);
+    if (open) {
+        p->status = SCRIPT_INCOMPLETE;
+        return NULL;
+    }
+    if (word_end == word_start) {
+        syntax_error(p, "expected word after 'case'%s", "");
+        return NULL;
+    }
+    node->case_text = unit_strndup(p, p->src + word_start, word_end - word_start);
+    p->pos = word_end;
+    compile_case_subject(p, node);
+
+    skip_newlines(p);
+    if (!expect_word(p, "in")) {
+        return NULL;
+    }
+
+    CaseArm **tail = &node->arms;
+    for (;;) {
+        skip_separators(p);
+        if (p->src[p->pos] == '\0') {
+            p->status = SCRIPT_INCOMPLETE;
+            return NULL;
+        }
+        if (at_word(p, "esac")) {
+            p->pos += 4;
+            break;
+        }
+
+        CaseArm *arm = arena_alloc(&p->unit->arena, sizeof(CaseArm));
+        memset(arm, 0, sizeof(*arm));
+        size_t max_patterns = 1;
+        for (size_t i = p->pos; p->src[i] && p->src[i] != ')'; i++) {
+            max_patterns += p->src[i] == '|';
+        }
+        arm->patterns = arena_alloc(&p->unit->arena, sizeof(char *) * max_patterns);
+        arm->compiled = arena_alloc(&p->unit->arena, sizeof(GlobPattern *) * max_patterns);
+
+        if (p->src[p->pos] == '(') {
+            p->pos++;
+        }
+        for (;;) {
+            skip_blanks(p);
+            size_t pat_start = p->pos;
+            size_t pat_end = scan_word_end(p->src, pat_start, &open);
+            if (open) {
+                p->status = SCRIPT_INCOMPLETE;
+                return NULL;
+            }
+            if (pat_end == pat_start) {
+                syntax_error(p, "bad case pattern%s", "");
+                return NULL;
+            }
+            arm->patterns[arm->npatterns] = unit_strndup(p, p->src + pat_start, pat_end - pat_start);
+            compile_case_pattern(p, arm, arm->npatterns);
+            arm->npatterns++;
+            p->pos = pat_end;
+
+            skip_blanks(p);
+            char c = p->src[p->pos];
+            if (c == '|') {
+                p->pos++;
+                continue;
+            }
+            if (c == ')') {
+                p->pos++;
+                break;
+            }
+            if (c == '\0') {
+                p->status = SCRIPT_INCOMPLETE;
+            } else {
+                syntax_error(p, "expected ')' in case pattern%s", "");
+            }
+            return NULL;
+        }
+
+        arm->body = parse_list(p, esac_terms, NULL);
+        if (p->status != SCRIPT_OK) {
+            return NULL;
+        }
+        skip_blanks(p);
+        if (p->src[p->pos] == ';' && p->src[p->pos + 1] == ';') {
+            p->pos += 2;
+        }
+        *tail = arm;
+        tail = &arm->next;
+    }
+    return node;
+}
+
+static Node *parse_function(Parser *p, size_t name_start, size_t name_len) {
+    Node *node = new_node(p, N_FUNCDEF);
+    node->name = unit_strndup(p, p->src + name_start, name_len);
+    p->pos = name_start + name_len;
+
+    skip_blanks(p);
+    if (p->src[p->pos] == '(') {
+        p->pos++;
+        skip_blanks(p);
+        if (p->src[p->pos] != ')') {
+            syntax_error(p, "expected ')' after '%s('", node->name);
+            return NULL;
+        }
+        p->pos++;
+    }
+
+    skip_newlines(p);
+    if (p->src[p->pos] == '\0') {
+        p->status = SCRIPT_INCOMPLETE;
+        return NULL;
+    }
+    node->body = parse_command(p, NULL);
+    return p->status == SCRIPT_OK ? node : NULL;
+}
+
+/**
+ * Redirections after a compound command: done < file, fi > file, } >> file
+ */
+static Node *parse_redirects(Parser *p, Node *node) {
+    if (node == NULL) {
+        return NULL;
+    }
+    for (;;) {
+        skip_blanks(p);
+        char c = p->src[p->pos];
+        if (c != '<' && c != '>') {
+            return node;
+        }
+        if (c == '<' && p->src[p->pos + 1] == '<') {
+            if (!parse_here(p, &node->here_kind, &node->here_text)) {
+                return NULL;
+            }
+            continue;
+        }
+        int append = 0;
+        p->pos++;
+        if (c == '>' && p->src[p->pos] == '>') {
+            append = 1;
+            p->pos++;
+        }
+        size_t start;
+        size_t len = peek_word(p, &start);
+        const char *w = p->src + start;
+        if (len == 0 && (*w == '<' || *w == '>') && w[1] == '(') {
+            int open = 0;
+            len = skip_region(p->src, start + 2, ')', &open) - start;  // done < <(cmd)
+            if (open) {
+                p->status = SCRIPT_INCOMPLETE;
+                return NULL;
+            }
+        }
+        if (len == 0) {
+            syntax_error(p, "expected file name after '%s'", c == '<' ? "<" : ">");
+            return NULL;
+        }
+        const char *target = unit_strndup(p, p->src + start, len);
+        p->pos = start + len;
+        if (c == '<') {
+            node->redir_in = target;
+        } else {
+            node->redir_out = target;
+            node->redir_append = append;
+        }
+    }
+}
+
+static Node *parse_compound(Parser *p, const char *const *stops);
+
+static Node *parse_command(Parser *p, const char *const *stops) {
+    size_t start;
+    size_t len = peek_word(p, &start);
+    const char *w = p->src + start;
+
+    if (starts_compound(w, len)) {
+        return parse_redirects(p, parse_compound(p, stops));
+    }
+    return parse_compound(p, stops);
+}
+
+static Node *parse_compound(Parser *p, const char *const *stops) {
+    size_t start;
+    size_t len = peek_word(p, &start);
+    const char *w = p->src + start;
+
+    if (word_equals(w, len, "if")) {
+        p->pos = start + 2;
+        return parse_if_tail(p);
+    }
+    if (word_equals(w, len, "while")) {
+        return parse_loop(p, N_WHILE);
+    }
+    if (word_equals(w, len, "until")) {
+        return parse_loop(p, N_UNTIL);
+    }
+    if (word_equals(w, len, "for")) {
+        return parse_for(p);
+    }
+    if (word_equals(w, len, "case")) {
+        return parse_case(p);
+    }
+    if (word_equals(w, len, "{")) {
+        Node *node = new_node(p, N_GROUP);
+        p->pos = start + 1;
+        node->body = parse_list(p, brace_terms, NULL);
+        if (p->status != SCRIPT_OK || !expect_word(p, "}")) {
+            return NULL;
+        }
+        return node;
+    }
+    if (w[0] == '(' && w[1] != '(') {
+        Node *node = new_node(p, N_SUBSHELL);
+        p->pos = start + 1;
+        node->body = parse_list(p, paren_terms, NULL);
+        if (p->status != SCRIPT_OK) {
+            return NULL;
+        }
+        if (node->body == NULL || p->src[p->pos] != ')') {
+            syntax_error(p, "unexpected token '%s'", p->src[p->pos] == ';' ? ";;" : ")");
+            return NULL;
+        }
+        p->pos++;
+        return node;
+    }
+    if (word_equals(w, len, "function")) {
+        p->pos = start + len;
+        size_t name_start;
+        size_t name_len = peek_word(p, &name_start);
+        if (name_len == 0) {
+            syntax_error(p, "expected function name%s", "");
+            return NULL;
+        }
+        return parse_function(p, name_start, name_len);
+    }
+
+    // name() compound-command
+    if (len > 0 && is_name_start(w[0])) {
+        size_t i = start + len;
+        while (p->src[i] == ' ' || p->src[i] == '\t') {
+            i++;
+        }
+        if (p->src[i] == '(') {
+            size_t j = i + 1;
+            while (p->src[j] == ' ' || p->src[j] == '\t') {
+                j++;
+            }
+            if (p->src[j] == ')') {
+                return parse_function(p, start, len);
+            }
+        }
+    }
+
+    return parse_simple(p, stops);
+}
+
+/**
+ * [!] command [| command]...
+ *
+ * Pipelines of simple commands stay inside one N_SIMPLE (the executor
+ * runs them); a '|' before or after a compound command builds N_PIPE.
+ */
+static Node *parse_pipeline_node(Parser *p, const char *const *stops) {
+    Node *negate = NULL;
+    if (at_word(p, "!")) {
+        size_t start;
+        peek_word(p, &start);
+        p->pos = start + 1;
+        negate = new_node(p, N_NOT);
+    }
+
+    Node *left = parse_command(p, stops);
+    while (left != NULL) {
+        skip_blanks(p);
+        if (p->src[p->pos] != '|' || p->src[p->pos + 1] == '|') {
+            break;
+        }
+        p->pos++;
+        skip_newlines(p);
+        if (p->src[p->pos] == '\0') {
+            p->status = SCRIPT_INCOMPLETE;
+            return NULL;
+        }
+        Node *node = new_node(p, N_PIPE);
+        node->left = left;
+        node->right = parse_command(p, stops);
+        left = node->right ? node : NULL;
+    }
+
+    if (negate != NULL) {
+        negate->left = left;
+        return left ? negate : NULL;
+    }
+    return left;
+}
+
+static Node *parse_and_or(Parser *p, const char *const *stops) {
+    Node *left = parse_pipeline_node(p, stops);
+    if (left == NULL) {
+        return NULL;
+    }
+
+    for (;;) {
+        skip_blanks(p);
+        const char *s = p->src + p->pos;
+        NodeType type;
+        if (s[0] == '&' && s[1] == '&') {
+            type = N_AND;
+        } else if (s[0] == '|' && s[1] == '|') {
+            type = N_OR;
+        } else {
+            return left;
+        }
+        p->pos += 2;
+        skip_newlines(p);
+        if (p->src[p->pos] == '\0') {
+            p->status = SCRIPT_INCOMPLETE;
+            return NULL;
+        }
+        Node *node = new_node(p, type);
+        node->left = left;
+        node->right = parse_pipeline_node(p, stops);
+        if (node->right == NULL) {
+            return NULL;
+        }
+        left = node;
+    }
+}
+
+/**
+ * Parse commands until EOF, ";;", ')' or a word in terms
+ *
+ * stops lists keywords that also end a command in the middle of a line
+ * (legacy one-line if/then/else/fi).
+ */
+static Node *parse_list(Parser *p, const char *const *terms, const char *const *stops) {
+    Node *head = NULL;
+    Node **tail = &head;
+
+    for (;;) {
+        skip_separators(p);
+        char c = p->src[p->pos];
+        if (c == '\0') {
+            if (terms != NULL && p->status == SCRIPT_OK) {
+                p->status = SCRIPT_INCOMPLETE;
+            }
+            break;
+        }
+        if (c == ';' || c == ')') {
+            if (terms == NULL) {
+                syntax_error(p, "unexpected token '%s'", c == ';' ? ";;" : ")");
+            }
+            break;
+        }
+
+        size_t start;
+        size_t len = peek_word(p, &start);
+        if (word_in(p->src + start, len, terms)) {
+            break;
+        }
+        if (word_in(p->src + start, len, closers)) {
+            syntax_error(p, "unexpected '%s'", unit_strndup(p, p->src + start, len));
+            break;
+        }
+
+        Node *node = parse_and_or(p, stops);
+        if (node == NULL) {
+            break;
+        }
+        *tail = node;
+        tail = &node->next;
+    }
+    return head;
+}
+
+static ScriptUnit *script_parse_internal(const char *text, int *status, int quiet) {
+    ScriptUnit *unit = calloc(1, sizeof(ScriptUnit));
+    if (unit == NULL) {
+        *status = SCRIPT_SYNTAX_ERROR;
+        return NULL;
+    }
+    arena_init(&unit->arena, UNIT_CHUNK_SIZE);
+    unit->refs = 1;
+    unit->origin = input_origin;
+    unit->line_base = input_line;
+
+    Parser p = { text, 0, unit, SCRIPT_OK, quiet, 0, 0, 0, 0 };
+    unit->root = parse_list(&p, NULL, NULL);
+
+    *status = p.status;
+    if (p.status != SCRIPT_OK) {
+        script_release(unit);
+        return NULL;
+    }
+    return unit;
+}
+
+ScriptUnit *script_parse(const char *text, int *status) {
+    return script_parse_internal(text, status, 0);
+}
+
+void script_set_tail_exec(int enabled) {
+    tail_exec_enabled = enabled;
+}
+
+void script_set_abort_exits(int enabled) {
+    abort_exits = enabled;
+}
+
+void script_set_input_position(const char *origin, int line) {
+    input_origin = origin;
+    input_line = line;
+}
+
+void script_set_origin(ScriptUnit *unit, const char *origin) {
+    if (unit != NULL) {
+        unit->origin = arena_strndup(&unit->arena, origin, strlen(origin));
+        unit->line_base = 1;
+    }
+}
+
+int script_is_incomplete(const char *text) {
+    int status;
+    ScriptUnit *unit = script_parse_internal(text, &status, 1);
+    if (unit != NULL) {
+        script_release(unit);
+    }
+    return status == SCRIPT_INCOMPLETE;
+}
+
+void script_release(ScriptUnit *unit) {
+    if (unit == NULL || --unit->refs > 0) {
+        return;
+    }
+    for (int i = 0; i < unit->pattern_count; i++) {
+        glob_free(unit->patterns[i]);
+    }
+    free(unit->patterns);
+    arena_free(&unit->arena);
+    free(unit);
+}
+
+// ============================================================================
+// Functions and positional parameters
+// ============================================================================
+
+static ShellFunction *find_function(const char *name) {
+    for (int i = 0; i < function_count; i++) {
+        if (strcmp(functions[i].name, name) == 0) {
+            return &functions[i];
+        }
+    }
+    return NULL;
+}
+
+static void define_function(const char *name, Node *body, ScriptUnit *unit) {
+    ShellFunction *fn = find_function(name);
+    if (fn == NULL) {
+        if (function_count == function_capacity) {
+            int cap = function_capacity ? function_capacity * 2 : 8;
+            ShellFunction *grown = realloc(functions, sizeof(ShellFunction) * cap);
+            if (grown == NULL) {
+                fprintf(stderr, "ushell: out of memory\n");
+                return;
+            }
+            functions = grown;
+            function_capacity = cap;
+        }
+        fn = &functions[function_count++];
+        fn->name = strdup(name);
+        fn->unit = NULL;
+    }
+    unit->refs++;
+    script_release(fn->unit);
+    fn->body = body;
+    fn->unit = unit;
+}
+
+int script_has_function(const char *name) {
+    return function_count > 0 && name != NULL && find_function(name) != NULL;
+}
+
+int script_call_function(char **argv, Env *env) {
+    ShellFunction *fn = find_function(argv[0]);
+    if (fn == NULL) {
+        return -1;
+    }
+
+    // The function may redefine itself while running
+    ScriptUnit *unit = fn->unit;
+    Node *body = fn->body;
+    unit->refs++;
+
+    Frame frame = { 0, argv };
+    while (argv[frame.argc + 1] != NULL) {
+        frame.argc++;
+    }
+    Frame *saved_frame = current_frame;
+    ScriptUnit *saved_unit = current_unit;
+    int saved_loops = loop_depth;
+    int saved_tail = tail_position;
+    tail_position = 0;  // The caller continues after the function returns
+    current_frame = &frame;
+    current_unit = unit;
+    loop_depth = 0;
+    func_depth++;
+
+    ProfileMark mark;
+    if (profile_enabled) {
+        profile_enter_function(&mark, argv[0]);
+    }
+    int status = exec_node(body, env);
+    if (pending_return) {
+        pending_return = 0;
+        status = return_status;
+    }
+    if (profile_enabled) {
+        profile_leave(&mark);
+    }
+
+    func_depth--;
+    loop_depth = saved_loops;
+    tail_position = saved_tail;
+    current_unit = saved_unit;
+    current_frame = saved_frame;
+    script_release(unit);
+
+    last_exit_status = status;
+    return status;
+}
+
+int script_positional_count(void) {
+    return current_frame ? current_frame->argc : -1;
+}
+
+const char *script_positional(int n) {
+    if (current_frame == NULL) {
+        return NULL;
+    }
+    if (n == 0) {
+        return current_frame->argv[0];
+    }
+    return (n > 0 && n <= current_frame->argc) ? current_frame->argv[n] : "";
+}
+
+int script_request_break(int levels) {
+    if (loop_depth == 0) {
+        return -1;
+    }
+    pending_break = levels < 1 ? 1 : (levels > loop_depth ? loop_depth : levels);
+    return 0;
+}
+
+int script_request_continue(int levels) {
+    if (loop_depth == 0) {
+        return -1;
+    }
+    pending_continue = levels < 1 ? 1 : (levels > loop_depth ? loop_depth : levels);
+    return 0;
+}
+
+int script_request_return(int status) {
+    if (func_depth == 0) {
+        return -1;
+    }
+    pending_return = 1;
+    return_status = status;
+    return 0;
+}
+
+void script_request_abort(void) {
+    pending_abort = 1;
+}
+
+// ============================================================================
+// Execution
+// ============================================================================
+
+#define CONTROL_PENDING() (pending_break || pending_continue || pending_return || pending_abort)
+
+/**
+ * Strip quote characters (the general path keeps them for tokenizing)
+ */
+static void remove_quotes(char *s) {
+    char *out = s;
+    char quote = 0;
+    for (; *s; s++) {
+        if (quote ? *s == quote : (*s == '\'' || *s == '"')) {
+            quote = quote ? 0 : *s;
+            continue;
+        }
+        *out++ = *s;
+    }
+    *out = '\0';
+}
+
+static int exec_simple_text(const char *text, Env *env, int tail);
+
+/**
+ * NAME=value as a whole command, or as a prefix of one (general path)
+ * A prefix assignment (IFS=: read a b) only lasts for that command; it is
+ * also placed in the process environment so external commands see it.
+ * Returns 1 if text started with an assignment.
+ */
+static int try_assignment(const char *text, Env *env, int *status, int tail) {
+    const char *c = text;
+    while (*c == ' ' || *c == '\t') {
+        c++;
+    }
+    if (!is_name_start(*c)) {
+        return 0;
+    }
+    const char *name = c;
+    while (is_name_char(*c)) {
+        c++;
+    }
+    if (*c != '=') {
+        return 0;
+    }
+    size_t name_len = (size_t)(c - name);
+    const char *value = c + 1;
+
+    int open = 0;
+    size_t end = scan_word_end(value, 0, &open);
+    const char *rest = value + end;
+    while (*rest == ' ' || *rest == '\t') {
+        rest++;
+    }
+    if (name_len >= VAR_NAME_MAX) {
+        return 0;
+    }
+
+    char var[VAR_NAME_MAX];
+    memcpy(var, name, name_len);
+    var[name_len] = '\0';
+
+    char *raw = strndup(value, end);
+    char *expanded = raw ? expand_variables(raw, env) : NULL;
+    free(raw);
+    if (expanded == NULL) {
+        *status = 1;
+        return 1;
+    }
+    remove_quotes(expanded);
+
+    if (*rest != '\0') {
+        const char *shell_old = env_get(env, var);
+        const char *proc_old = getenv(var);
+        char *saved_shell = shell_old ? strdup(shell_old) : NULL;
+        char *saved_proc = proc_old ? strdup(proc_old) : NULL;
+
+        env_set(env, var, expanded);
+        setenv(var, expanded, 1);
+        *status = exec_simple_text(rest, env, tail);
+
+        if (saved_shell) {
+            env_set(env, var, saved_shell);
+        } else {
+            env_unset(env, var);
+        }
+        if (saved_proc) {
+            setenv(var, saved_proc, 1);
+        } else {
+            unsetenv(var);
+        }
+        free(saved_shell);
+        free(saved_proc);
+        free(expanded);
+        return 1;
+    }
+
+    // An assignment alone takes the status of its last $(...)
+    int subst = expand_substitution_status();
+    env_set(env, var, expanded);
+    free(expanded);
+    *status = subst >= 0 ? subst : 0;
+    return 1;
+}
+
+/**
+ * [[ ... ]] as a whole command (general path)
+ * Each source word is expanded on its own into exactly one argument, with
+ * no word splitting, globbing or removal of empty words, so [[ -n $e ]]
+ * and [[ $x == "a b" ]] see their operands as written. Anything after the
+ * closing ]] (a redirection) leaves the command to the pipeline path.
+ * Returns 1 if text was run as a [[ ]] command.
+ */
+static int try_test_command(const char *text, Env *env, int *status) {
+    const char *s = text;
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    if (strncmp(s, "[[", 2) != 0 || (s[2] != ' ' && s[2] != '\t')) {
+        return 0;
+    }
+
+    // Find the words first: nothing is expanded unless ]] ends the text
+    size_t len = strlen(s);
+    size_t *starts = malloc(sizeof(size_t) * (len + 1));
+    size_t *ends = malloc(sizeof(size_t) * (len + 1));
+    char **argv = calloc(len + 1, sizeof(char *));
+    char *quoted = malloc(len + 1);
+    if (starts == NULL || ends == NULL || argv == NULL || quoted == NULL) {
+        free(starts);
+        free(ends);
+        free(argv);
+        free(quoted);
+        return 0;
+    }
+    int argc = 0;
+    size_t i = 0;
+    for (;;) {
+        while (s[i] == ' ' || s[i] == '\t' || s[i] == '\n') {
+            i++;
+        }
+        if (s[i] == '\0') {
+            break;
+        }
+        starts[argc] = i;
+        if (strchr("&|<>()", s[i]) != NULL) {
+            // Operators of the expression are words of their own
+            i += ((s[i] == '&' || s[i] == '|') && s[i + 1] == s[i]) ? 2 : 1;
+        } else {
+            int open = 0;
+            i = scan_word_end(s, i, &open);
+        }
+        ends[argc++] = i;
+    }
+
+    int ok = ends[argc - 1] - starts[argc - 1] == 2 && strncmp(s + starts[argc - 1], "]]", 2) == 0;
+    for (int w = 0; ok && w < argc; w++) {
+        const char *word = s + starts[w];
+        size_t word_len = ends[w] - starts[w];
+        quoted[w] = word[0] == '"' || word[0] == '\'';
+        if (w == 0 || w == argc - 1 || strchr("&|<>()", word[0]) != NULL) {
+            argv[w] = strndup(word, word_len);
+        } else {
+            argv[w] = expand_test_word(word, word_len, env);
+            if (argv[w] == NULL) {
+                *status = 1;  // ${var:?message} failed; the message has been printed
+                break;
+            }
+        }
+    }
+
+    if (ok && argv[argc - 1] != NULL) {
+        *status = escape_test_operands(argv, quoted) < 0 ? 1 : execute_command(argv, env);
+    }
+    free_tokens(argv);
+    free(starts);
+    free(ends);
+    free(quoted);
+    return ok;
+}
+
+/**
+ * General path: expand the whole text, then parse and run it as a pipeline
+ */
+static int exec_simple_text(const char *text, Env *env, int tail) {
+    int status;
+    if (try_assignment(text, env, &status, tail) || try_test_command(text, env, &status)) {
+        return status;
+    }
+
+    char *expanded = expand_variables(text, env);
+    if (expanded == NULL) {
+        return 1;  // ${var:?message} failed; the message has been printed
+    }
+
+    Command *commands = NULL;
+    int count = 0;
+    status = last_exit_status;
+
+    if (parse_pipeline(expanded, &commands, &count) < 0) {
+        fprintf(stderr, "ushell: parse error\n");
+        free(expanded);
+        return -1;
+    }
+    if (count > 0 && commands != NULL) {
+        // Set after expansion: $(...) never sees it. Tools feeding <(...)
+        // run on this process's threads, so it must not be replaced.
+        exec_tail_call = tail && !procsub_active(1);
+        status = execute_pipeline(commands, count, env);
+        exec_tail_call = 0;
+        if (status == -1) {
+            fprintf(stderr, "ushell: execution failed\n");
+        }
+        free_pipeline(commands, count);
+    }
+    free(expanded);
+    return status;
+}
+
+static int exec_simple(Node *node, Env *env, ScriptUnit *unit) {
+    Simple *sc = &node->simple;
+    int tail = tail_position && tail_exec_enabled && exec_depth == 1;
+
+    if (sc->fast && !sc->busy) {
+        sc->busy = 1;
+        int ok = 1;
+        for (int i = 0; i < sc->nwords && ok; i++) {
+            sc->argv[i] = (char *)assemble_word(unit, &sc->words[i], env);
+            ok = sc->argv[i] != NULL;
+        }
+        if (ok) {
+            int status = 0;
+            if (sc->assign_name) {
+                env_set_slot(env, &sc->assign_slot, sc->argv[0]);
+            } else {
+                exec_tail_call = tail;
+                status = execute_command(sc->argv, env);
+                exec_tail_call = 0;
+            }
+            sc->busy = 0;
+            return status;
+        }
+        sc->busy = 0;
+    }
+    return exec_simple_text(sc->text, env, tail);
+}
+
+static int interrupted(void) {
+    return sigint_received || foreground_interrupted;
+}
+
+/**
+ * Consume a pending break/continue at the end of one loop iteration
+ * Returns 1 if the loop must stop.
+ */
+static int loop_should_exit(void) {
+    if (pending_return || pending_abort) {
+        return 1;
+    }
+    if (pending_break) {
+        pending_break--;
+        return 1;
+    }
+    if (pending_continue) {
+        pending_continue--;
+        return pending_continue > 0;
+    }
+    return 0;
+}
+
+static int exec_loop(Node *node, Env *env) {
+    int status = 0;
+    loop_depth++;
+    for (;;) {
+        int cond = exec_list(node->cond, env);
+        if (CONTROL_PENDING()) {
+            if (loop_should_exit()) {
+                break;
+            }
+            continue;
+        }
+        if (interrupted() || (cond == 0) == (node->type == N_UNTIL)) {
+            break;
+        }
+        status = exec_list(node->body, env);
+        if (loop_should_exit() || interrupted()) {
+            break;
+        }
+    }
+    loop_depth--;
+    return status;
+}
+
+static int exec_for(Node *node, Env *env) {
+    char **values = NULL;
+    int count = 0;
+    int owned = 0;
+
+    if (node->has_list) {
+        // The word list is expanded once, before the first iteration
+        char *expanded = expand_variables(node->list_text, env);
+        if (expanded == NULL) {
+            return 1;
+        }
+        char **tokens = tokenize_command(expanded);
+        free(expanded);
+        if (tokens == NULL) {
+            return 1;
+        }
+
+        int capacity = 16;
+        values = malloc(sizeof(char *) * capacity);
+        for (int i = 0; values && tokens[i] != NULL; i++) {
+            int match_count = 0;
+            char **matches = has_glob_chars(tokens[i], strlen(tokens[i]))
+                ? expand_glob(tokens[i], &match_count) : NULL;
+            int add = matches ? match_count : 1;
+            if (count + add >= capacity) {
+                while (count + add >= capacity) {
+                    capacity *= 2;
+                }
+                char **grown = realloc(values, sizeof(char *) * capacity);
+                if (grown == NULL) {
+                    break;
+                }
+                values = grown;
+            }
+            if (matches) {
+                for (int j = 0; j < match_count; j++) {
+                    values[count++] = strdup(matches[j]);
+                }
+                free_glob_matches(matches, match_count);
+            } else {
+                values[count++] = strdup(tokens[i]);
+            }
+        }
+        free_tokens(tokens);
+        owned = 1;
+    } else if (current_frame != NULL) {
+        values = current_frame->argv + 1;
+        count = current_frame->argc;
+    }
+
+    int status = 0;
+    loop_depth++;
+    for (int i = 0; i < count; i++) {
+        env_set_slot(env, &node->var_slot, values[i]);
+        status = exec_list(node->body, env);
+        if (loop_should_exit() || interrupted()) {
+            break;
+        }
+    }
+    loop_depth--;
+
+    if (owned) {
+        for (int i = 0; i < count; i++) {
+            free(values[i]);
+        }
+        free(values);
+    }
+    return status;
+}
+
+static int exec_case(Node *node, Env *env, ScriptUnit *unit) {
+    const char *subject = node->case_fast ? assemble_word(unit, &node->case_word, env) : NULL;
+    char *expanded = NULL;
+    if (subject == NULL) {
+        expanded = expand_variables(node->case_text, env);
+        if (expanded == NULL) {
+            return 1;
+        }
+        remove_quotes(expanded);
+        subject = expanded;
+    }
+    size_t subject_len = strlen(subject);
+
+    int status = 0;
+    for (CaseArm *arm = node->arms; arm != NULL; arm = arm->next) {
+        int matched = 0;
+        for (int i = 0; i < arm->npatterns && !matched; i++) {
+            if (arm->compiled[i]) {
+                matched = glob_match(arm->compiled[i], subject, subject_len);
+                continue;
+            }
+            // Pattern contains expansions: expand and compile each time
+            char *pattern = expand_variables(arm->patterns[i], env);
+            GlobPattern gp;
+            if (pattern != NULL) {
+                remove_quotes(pattern);
+                if (glob_compile(&gp, pattern) == 0) {
+                    matched = glob_match(&gp, subject, subject_len);
+                    glob_free(&gp);
+                }
+                free(pattern);
+            }
+        }
+        if (matched) {
+            status = exec_list(arm->body, env);
+            break;
+        }
+    }
+
+    free(expanded);
+    return status;
+}
+
+/**
+ * Expand a redirection target (variables, quotes)
+ */
+static char *expand_target(const char *text, Env *env) {
+    char *expanded = expand_variables(text, env);
+    if (expanded != NULL) {
+        remove_quotes(expanded);
+    }
+    return expanded;
+}
+
+/**
+ * Open a node's here-document or here-string as a "&N" redirection target
+ * @fd: Output: the descriptor N, which the caller closes
+ */
+static char *here_target(Node *node, Env *env, int *fd) {
+    if (node->here_kind == HERE_STRING) {
+        char *word = expand_target(node->here_text, env);
+        if (word == NULL) {
+            return NULL;
+        }
+        size_t len = strlen(word);
+        word[len] = '\n';  // <<< adds a newline; the NUL is not needed
+        *fd = heredoc_open(word, len + 1, 0, env);
+        free(word);
+    } else {
+        *fd = heredoc_open(node->here_text, strlen(node->here_text),
+                           node->here_kind == HERE_DOC, env);
+    }
+    if (*fd < 0) {
+        return NULL;
+    }
+
+    char target[24];
+    snprintf(target, sizeof(target), "&%d", *fd);
+    return strdup(target);
+}
+
+// ============================================================================
+// Subshells
+// ============================================================================
+
+/*
+ * ( list ) normally costs a fork, but most subshells only scope a cd or a
+ * variable change around builtins. When every command in the body runs
+ * inside the shell anyway, the body runs in this process against a
+ * snapshot instead: variables are journaled copy-on-write (EnvSnapshot),
+ * the working directory is kept as a directory fd, and umask and the
+ * process environment are saved; all of it is put back afterwards.
+ * Bodies that run external commands, start background jobs, define
+ * functions or leave the subshell early (exit, exec, return) fork.
+ *
+ * Command substitutions $(...) run as subshells the same way.
+ */
+
+#define SUBSHELL_MAX_CALL_DEPTH 8   // Function bodies inspected before forking
+
+static int forked_subshell = 0;     // This process is a ( ... ) child
+
+static int subshell_list_ok(const Node *node, int loops, int depth);
+
+/**
+ * Whether the command word of a simple command runs inside the shell
+ */
+static int subshell_command_ok(const char *word, size_t len, int loops, int depth) {
+    char name[64];
+    if (len == 0 || len >= sizeof(name) || strcspn(word, "$`'\"\\*?~{") < len) {
+        return 0;  // Only known once expanded
+    }
+    memcpy(name, word, len);
+    name[len] = '\0';
+
+    // These leave the subshell, not the loop or function around it
+    static const char *const leaves[] = {
+        "exit", "exec", "return", "source", ".", "enable", NULL
+    };
+    if (word_in(name, len, leaves)) {
+        return 0;
+    }
+    if (word_equals(name, len, "break") || word_equals(name, len, "continue")) {
+        return loops > 0;
+    }
+
+    ShellFunction *fn = function_count > 0 ? find_function(name) : NULL;
+    if (fn != NULL) {
+        return depth < SUBSHELL_MAX_CALL_DEPTH && subshell_list_ok(fn->body, 0, depth + 1);
+    }
+    return find_builtin(name) != NULL || find_tool(name) != NULL;
+}
+
+/**
+ * Check every pipeline stage's command word of a simple command's text;
+ * assignments and redirection targets are skipped
+ */
+static int subshell_simple_ok(const char *s, int loops, int depth) {
+    int at_command = 1;
+    int target = 0;
+    size_t i = 0;
+
+    while (s[i]) {
+        char c = s[i];
+        if (c == ' ' || c == '\t' || c == '\n') {
+            i++;
+            continue;
+        }
+        if (c == '&') {
+            return 0;  // Background job: it would belong to the subshell
+        }
+        if (c == '|') {
+            at_command = 1;
+            i++;
+            continue;
+        }
+        if (c == '<' || c == '>') {
+            i++;
+            while (s[i] == '>' || s[i] == '&') {
+                i++;
+            }
+            target = 1;
+            continue;
+        }
+        if (c == ';' || c == '(' || c == ')') {
+            i++;
+            continue;
+        }
+
+        int open = 0;
+        size_t end = scan_word_end(s, i, &open);
+        const char *word = s + i;
+        size_t len = end - i;
+        i = end;
+        if (target) {
+            target = 0;
+        } else if (at_command) {
+            size_t n = 0;
+            while (n < len && isdigit((unsigned char)word[n])) {
+                n++;
+            }
+            if (n == len && (s[i] == '<' || s[i] == '>')) {
+                continue;  // 2>file
+            }
+            n = 0;
+            if (is_name_start(word[0])) {
+                while (n < len && is_name_char(word[n])) {
+                    n++;
+                }
+                if (n < len && word[n] == '=') {
+                    continue;  // NAME=value prefix
+                }
+            }
+            if (!subshell_command_ok(word, len, loops, depth)) {
+                return 0;
+            }
+            at_command = 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Whether a list can run in the shell process under a snapshot
+ * loops counts the loops around a node inside the body (break/continue)
+ */
+static int subshell_list_ok(const Node *node, int loops, int depth) {
+    for (; node != NULL; node = node->next) {
+        int ok = 1;
+        switch (node->type) {
+            case N_SIMPLE:
+                ok = subshell_simple_ok(node->simple.text, loops, depth);
+                break;
+            case N_AND:
+            case N_OR:
+                ok = subshell_list_ok(node->left, loops, depth) &&
+                     subshell_list_ok(node->right, loops, depth);
+                break;
+            case N_NOT:
+                ok = subshell_list_ok(node->left, loops, depth);
+                break;
+            case N_IF:
+                ok = subshell_list_ok(node->cond, loops, depth) &&
+                     subshell_list_ok(node->body, loops, depth) &&
+                     subshell_list_ok(node->else_part, loops, depth);
+                break;
+            case N_WHILE:
+            case N_UNTIL:
+                ok = subshell_list_ok(node->cond, loops + 1, depth) &&
+                     subshell_list_ok(node->body, loops + 1, depth);
+                break;
+            case N_FOR:
+                ok = subshell_list_ok(node->body, loops + 1, depth);
+                break;
+            case N_CASE:
+                for (const CaseArm *arm = node->arms; arm && ok; arm = arm->next) {
+                    ok = subshell_list_ok(arm->body, loops, depth);
+                }
+                break;
+            case N_FUNCDEF:
+                ok = 0;  // Would outlive the subshell
+                break;
+            case N_GROUP:
+                ok = subshell_list_ok(node->body, loops, depth);
+                break;
+            case N_SUBSHELL:
+                break;  // Decides for itself
+            case N_PIPE:
+                ok = 0;  // Every stage is a child
+                break;
+        }
+        if (!ok) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Shell state a fork-free subshell puts back when it ends
+ */
+typedef struct {
+    EnvSnapshot *vars;
+    char **environ_copy;    // "NAME=value" strings of the process environment
+    int cwd_fd;
+    mode_t mask;
+    int loop_depth;
+    int func_depth;
+} SubshellSave;
+
+static int subshell_save(SubshellSave *save, Env *env) {
+    save->cwd_fd = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (save->cwd_fd < 0) {
+        return -1;  // Unreadable cwd: fchdir could not come back
+    }
+
+    size_t n = 0;
+    while (environ[n] != NULL) {
+        n++;
+    }
+    save->environ_copy = malloc((n + 1) * sizeof(char *));
+    if (save->environ_copy == NULL) {
+        close(save->cwd_fd);
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        save->environ_copy[i] = strdup(environ[i]);
+    }
+    save->environ_copy[n] = NULL;
+
+    save->mask = umask(0);
+    umask(save->mask);
+    save->vars = env_snapshot_begin(env);
+    save->loop_depth = loop_depth;
+    save->func_depth = func_depth;
+    return 0;
+}
+
+/**
+ * Find "NAME=" in a NULL-terminated environment vector
+ */
+static const char *environ_lookup(char **vec, const char *entry, size_t name_len) {
+    for (; *vec != NULL; vec++) {
+        if (strncmp(*vec, entry, name_len + 1) == 0) {
+            return *vec + name_len + 1;
+        }
+    }
+    return NULL;
+}
+
+static void subshell_restore(SubshellSave *save, Env *env) {
+    loop_depth = save->loop_depth;
+    func_depth = save->func_depth;
+    pending_break = 0;
+    pending_continue = 0;
+    pending_return = 0;
+    pending_abort = 0;
+
+    env_snapshot_discard(env, save->vars);
+
+    if (fchdir(save->cwd_fd) < 0) {
+        perror("ushell: subshell: fchdir");
+    }
+    close(save->cwd_fd);
+    umask(save->mask);
+
+    // Drop variables exported inside, then put changed values back
+    for (size_t i = 0; environ[i] != NULL;) {
+        size_t len = strcspn(environ[i], "=");
+        if (environ_lookup(save->environ_copy, environ[i], len) == NULL) {
+            char *name = strndup(environ[i], len);
+            int removed = name != NULL && unsetenv(name) == 0;
+            free(name);
+            if (removed) {
+                continue;  // environ shifted down
+            }
+        }
+        i++;
+    }
+    for (char **e = save->environ_copy; *e != NULL; e++) {
+        size_t len = strcspn(*e, "=");
+        const char *now = environ_lookup(environ, *e, len);
+        if (now == NULL || strcmp(now, *e + len + 1) != 0) {
+            (*e)[len] = '\0';
+            setenv(*e, *e + len + 1, 1);
+        }
+        free(*e);
+    }
+    free(save->environ_copy);
+}
+
+/**
+ * Fallback: run the body in a child process
+ *
+ * A ( list ) child gets its own process group so Ctrl+C and Ctrl+Z reach
+ * it as a job; a command substitution's child stays in the shell's group
+ * (own_group 0) so what it runs can still use the terminal.
+ */
+static int exec_subshell_fork(Node *body, Env *env, int own_group) {
+    fflush(NULL);
+    pid_t pid = fork();
+    profile_forks++;
+    if (pid < 0) {
+        perror("ushell: fork");
+        return 1;
+    }
+    if (pid == 0) {
+        if (own_group) {
+            setpgid(0, 0);
+        }
+        forked_subshell = 1;
+        tail_position = 1;  // The last command can replace the child
+        int status = exec_list(body, env);
+        if (pending_return) {
+            status = return_status;  // return, break, continue end the child
+        }
+        // _exit: exit() would rewind the shell's shared stdin offset
+        fflush(NULL);
+        _exit(status & 0xff);
+    }
+
+    if (own_group) {
+        setpgid(pid, pid);
+        foreground_job_pid = pid;
+    }
+    int wstatus;
+    while (waitpid(pid, &wstatus, 0) < 0) {
+        if (errno != EINTR) {
+            perror("ushell: waitpid");
+            foreground_job_pid = 0;
+            return 1;
+        }
+    }
+    foreground_job_pid = 0;
+    if (WIFSIGNALED(wstatus)) {
+        return 128 + WTERMSIG(wstatus);
+    }
+    return WEXITSTATUS(wstatus);
+}
+
+static int exec_subshell(Node *body, Env *env, int own_group) {
+    SubshellSave save;
+    if (!subshell_list_ok(body, 0, 0) ||
+        subshell_save(&save, env) < 0) {
+        return exec_subshell_fork(body, env, own_group);
+    }
+
+    loop_depth = 0;
+    func_depth = 0;
+    int status = exec_list(body, env);
+    subshell_restore(&save, env);
+    return status;
+}
+
+int script_subshell_in_process(const ScriptUnit *unit) {
+    return unit != NULL && subshell_list_ok(unit->root, 0, 0);
+}
+
+int script_execute_subshell(ScriptUnit *unit, Env *env) {
+    if (unit == NULL) {
+        return -1;
+    }
+
+    exec_depth++;
+    unit->refs++;
+    ScriptUnit *saved_unit = current_unit;
+    int saved_tail = tail_position;
+    current_unit = unit;
+    tail_position = 0;  // The shell itself must not be replaced
+
+    int status = exec_subshell(unit->root, env, 0);
+
+    tail_position = saved_tail;
+    current_unit = saved_unit;
+    script_release(unit);
+    exec_depth--;
+
+    last_exit_status = status;
+    return status;
+}
+
+// ============================================================================
+// Pipelines with compound stages
+// ============================================================================
+
+/*
+ * for ... done | sort, cmd | while read ...; done, (a; b) | c: each stage
+ * runs in a forked child with the pipe ends on its stdin and stdout, all
+ * children in one process group as the executor does for pipelines of
+ * simple commands. The status is the last stage's.
+ */
+
+static int exec_pipe(Node *node, Env *env) {
+    int count = 1;
+    for (Node *n = node; n->type == N_PIPE; n = n->left) {
+        count++;
+    }
+    Node *stages[count];
+    pid_t pids[count];
+    Node *n = node;
+    for (int i = count - 1; i > 0; i--) {
+        stages[i] = n->right;
+        n = n->left;
+    }
+    stages[0] = n;
+
+    int started = 0;
+    int in_fd = -1;
+    fflush(NULL);   // Children must not inherit buffered output
+    for (int i = 0; i < count; i++) {
+        int fds[2] = { -1, -1 };
+        if (i < count - 1 && pipe(fds) < 0) {
+            perror("ushell: pipe");
+            break;
+        }
+        pids[i] = fork();
+        if (pids[i] < 0) {
+            perror("ushell: fork");
+            if (fds[0] >= 0) {
+                close(fds[0]);
+                close(fds[1]);
+            }
+            break;
+        }
+        profile_forks++;
+        if (pids[i] == 0) {
+            setpgid(0, i == 0 ? 0 : pids[0]);
+            if (in_fd >= 0) {
+                dup2(in_fd, STDIN_FILENO);
+                close(in_fd);
+            }
+            if (fds[1] >= 0) {
+                dup2(fds[1], STDOUT_FILENO);
+                close(fds[1]);
+                close(fds[0]);
+            }
+            forked_subshell = 1;
+            tail_position = 1;  // A simple last command can replace the child
+            int status = exec_node(stages[i], env);
+            if (pending_return) {
+                status = return_status;
+            }
+            // _exit: exit() would rewind the shell's shared stdin offset
+            fflush(NULL);
+            _exit(status & 0xff);
+        }
+        setpgid(pids[i], pids[0]);
+        started++;
+        if (in_fd >= 0) {
+            close(in_fd);
+        }
+        if (fds[1] >= 0) {
+            close(fds[1]);
+        }
+        in_fd = fds[0];
+    }
+    if (in_fd >= 0) {
+        close(in_fd);
+    }
+    if (started == 0) {
+        return 1;
+    }
+
+    foreground_job_pid = pids[0];
+    int status = 1;
+    for (int i = 0; i < started; i++) {
+        int wstatus;
+        while (waitpid(pids[i], &wstatus, 0) < 0) {
+            if (errno != EINTR) {
+                wstatus = 1 << 8;
+                break;
+            }
+        }
+        if (i == count - 1) {
+            status = WIFSIGNALED(wstatus) ? 128 + WTERMSIG(wstatus) : WEXITSTATUS(wstatus);
+        }
+    }
+    foreground_job_pid = 0;
+    return status;
+}
+
+int script_in_forked_subshell(void) {
+    return forked_subshell;
+}
+
+void script_enter_forked_subshell(void) {
+    forked_subshell = 1;
+}
+
+static int exec_command_node(Node *node, Env *env);
+static int exec_redirected_node(Node *node, Env *env);
+
+/**
+ * Run a node; compound commands with redirections run inside the shell
+ * with stdin/stdout temporarily replaced (while read ...; done < file)
+ */
+static int exec_node(Node *node, Env *env) {
+    // <(cmd) and >(cmd) started while this node runs end with it
+    int procsub = procsub_mark();
+    int status = exec_redirected_node(node, env);
+    procsub_finish(procsub);
+    return status;
+}
+
+static int exec_redirected_node(Node *node, Env *env) {
+    if (node->redir_in == NULL && node->redir_out == NULL && node->here_kind == HERE_NONE) {
+        return exec_command_node(node, env);
+    }
+
+    char *in;
+    int here_fd = -1;
+    if (node->here_kind != HERE_NONE) {
+        in = here_target(node, env, &here_fd);
+    } else {
+        in = node->redir_in ? expand_target(node->redir_in, env) : NULL;
+    }
+    char *out = node->redir_out ? expand_target(node->redir_out, env) : NULL;
+    RedirectSave save;
+    int status;
+    if (((node->redir_in || node->here_kind != HERE_NONE) && in == NULL) ||
+        (node->redir_out && out == NULL) ||
+        redirect_push(in, out, node->redir_append, &save) < 0) {
+        status = 1;
+    } else {
+        status = exec_command_node(node, env);
+        redirect_pop(&save);
+    }
+    if (here_fd >= 0) {
+        close(here_fd);
+    }
+    free(in);
+    free(out);
+    last_exit_status = status;
+    return status;
+}
+
+static int exec_command_node(Node *node, Env *env) {
+    ScriptUnit *unit = current_unit;
+    int status = last_exit_status;
+    int tail = tail_position;
+
+    switch (node->type) {
+        case N_SIMPLE:
+            if (profile_enabled) {
+                ProfileMark mark;
+                profile_enter(&mark, &node->profile_stat, unit->origin,
+                              unit->line_base + node->line, node->simple.text);
+                status = exec_simple(node, env, unit);
+                profile_leave(&mark);
+            } else {
+                status = exec_simple(node, env, unit);
+            }
+            break;
+        case N_AND:
+        case N_OR:
+            tail_position = 0;
+            status = exec_node(node->left, env);
+            tail_position = tail;
+            if (!CONTROL_PENDING() && !interrupted() &&
+                ((status == 0) == (node->type == N_AND))) {
+                status = exec_node(node->right, env);
+            }
+            break;
+        case N_NOT:
+            tail_position = 0;
+            status = exec_node(node->left, env) == 0 ? 1 : 0;
+            break;
+        case N_IF: {
+            tail_position = 0;
+            int cond = exec_list(node->cond, env);
+            tail_position = tail;
+            if (CONTROL_PENDING()) {
+                status = cond;
+            } else if (cond == 0) {
+                status = node->body ? exec_list(node->body, env) : 0;
+            } else if (node->else_part) {
+                status = exec_list(node->else_part, env);
+            } else {
+                status = 0;
+            }
+            break;
+        }
+        case N_WHILE:
+        case N_UNTIL:
+            tail_position = 0;  // Loop bodies run again
+            status = exec_loop(node, env);
+            break;
+        case N_FOR:
+            tail_position = 0;
+            status = exec_for(node, env);
+            break;
+        case N_CASE:
+            status = exec_case(node, env, unit);
+            break;
+        case N_FUNCDEF:
+            define_function(node->name, node->body, unit);
+            status = 0;
+            break;
+        case N_GROUP:
+            status = exec_list(node->body, env);
+            break;
+        case N_SUBSHELL:
+            tail_position = 0;
+            status = exec_subshell(node->body, env, 1);
+            break;
+        case N_PIPE:
+            tail_position = 0;
+            status = exec_pipe(node, env);
+            break;
+    }
+
+    tail_position = tail;
+    last_exit_status = status;
+    return status;
+}
+
+static int exec_list(Node *node, Env *env) {
+    int status = last_exit_status;
+    int tail = tail_position;
+    for (; node != NULL; node = node->next) {
+        tail_position = tail && node->next == NULL;
+        status = exec_node(node, env);
+        if (CONTROL_PENDING() || (interrupted() && loop_depth > 0)) {
+            break;
+        }
+        if (loop_depth == 0) {
+            // The loop or && / || list that saw the Ctrl+C has stopped
+            foreground_interrupted = 0;
+        }
+    }
+    tail_position = tail;
+    return status;
+}
+
+int script_execute(ScriptUnit *unit, Env *env) {
+    if (unit == NULL) {
+        return -1;
+    }
+
+    if (exec_depth == 0) {
+        sigint_received = 0;
+        foreground_interrupted = 0;
+        pending_abort = 0;
+        tail_position = tail_exec_enabled;
+        if (profile_enabled) {
+            profile_sync_clock();
+        }
+    }
+    exec_depth++;
+    unit->refs++;
+    ScriptUnit *saved_unit = current_unit;
+    current_unit = unit;
+
+    int status = exec_list(unit->root, env);
+
+    current_unit = saved_unit;
+    script_release(unit);
+    exec_depth--;
+
+    // A failed expansion abandons the whole unit (the script or -c string,
+    // or one line typed at the prompt); non-interactive input ends here
+    if (exec_depth == 0 && pending_abort) {
+        pending_abort = 0;
+        status = 1;
+        if (abort_exits && !forked_subshell) {
+            fflush(NULL);
+            exit(status);
+        }
+    }
+
+    // break/continue outside of any loop are ignored
+    if (loop_depth == 0) {
+        pending_break = 0;
+        pending_continue = 0;
+    }
+    return status;
+}
+
+int script_execute_source(ScriptUnit *unit, Env *env, char **argv) {
+    if (unit == NULL) {
+        return -1;
+    }
+
+    // Arguments after the file name replace $1.. for the duration
+    Frame frame = { 0, argv };
+    Frame *saved_frame = current_frame;
+    if (argv != NULL && argv[0] != NULL && argv[1] != NULL) {
+        while (argv[frame.argc + 1] != NULL) {
+            frame.argc++;
+        }
+        current_frame = &frame;
+    }
+
+    // 'return' ends the sourced file like it ends a function
+    func_depth++;
+    int status = script_execute(unit, env);
+    if (pending_return) {
+        pending_return = 0;
+        status = return_status;
+    }
+    func_depth--;
+    current_frame = saved_frame;
+
+    last_exit_status = status;
+    return status;
+}
+
+void script_retain(ScriptUnit *unit) {
+    if (unit != NULL) {
+        unit->refs++;
+    }
+}
+
+// ============================================================================
+// Serialized form (compiled script cache)
+// ============================================================================
+
+/*
+ * The tree is stored as nested lists of nodes holding only source-level
+ * data (command text, names, patterns, structure). Fast-path word tables
+ * and case globs are rebuilt from that text on load, which is cheap and
+ * keeps the format independent of in-memory layouts.
+ *
+ *   list   := u32 count, node*
+ *   node   := u8 type, str name, str list_text, str case_text, str text,
+ *             str redir_in, str redir_out, u8 has_list, u8 redir_append,
+ *             u8 here_kind, str here_text, u32 line,
+ *             list left, list right, list cond, list body, list else_part,
+ *             u32 arm_count, arm*
+ *   arm    := u32 npatterns, str*, list body
+ *   str    := u32 length (0xffffffff = none), bytes
+ */
+
+#define SERIAL_NO_STRING 0xffffffffu
+
+static void put_u32(FILE *out, uint32_t v) {
+    fwrite(&v, sizeof(v), 1, out);
+}
+
+static void put_str(FILE *out, const char *s) {
+    if (s == NULL) {
+        put_u32(out, SERIAL_NO_STRING);
+        return;
+    }
+    uint32_t len = (uint32_t)strlen(s);
+    put_u32(out, len);
+    fwrite(s, 1, len, out);
+}
+
+static void put_list(FILE *out, const Node *node);
+
+static void put_node(FILE *out, const Node *node) {
+    fputc((int)node->type, out);
+    put_str(out, node->name);
+    put_str(out, node->list_text);
+    put_str(out, node->case_text);
+    put_str(out, node->type == N_SIMPLE ? node->simple.text : NULL);
+    put_str(out, node->redir_in);
+    put_str(out, node->redir_out);
+    fputc(node->has_list, out);
+    fputc(node->redir_append, out);
+    fputc((int)node->here_kind, out);
+    put_str(out, node->here_text);
+    put_u32(out, (uint32_t)node->line);
+    put_list(out, node->left);
+    put_list(out, node->right);
+    put_list(out, node->cond);
+    put_list(out, node->body);
+    put_list(out, node->else_part);
+
+    uint32_t arms = 0;
+    for (const CaseArm *arm = node->arms; arm; arm = arm->next) {
+        arms++;
+    }
+    put_u32(out, arms);
+    for (const CaseArm *arm = node->arms; arm; arm = arm->next) {
+        put_u32(out, (uint32_t)arm->npatterns);
+        for (int i = 0; i < arm->npatterns; i++) {
+            put_str(out, arm->patterns[i]);
+        }
+        put_list(out, arm->body);
+    }
+}
+
+static void put_list(FILE *out, const Node *node) {
+    uint32_t count = 0;
+    for (const Node *n = node; n; n = n->next) {
+        count++;
+    }
+    put_u32(out, count);
+    for (const Node *n = node; n; n = n->next) {
+        put_node(out, n);
+    }
+}
+
+int script_serialize(ScriptUnit *unit, FILE *out) {
+    if (unit == NULL || out == NULL) {
+        return -1;
+    }
+    put_list(out, unit->root);
+    return ferror(out) ? -1 : 0;
+}
+
+/**
+ * Bounds-checked reader over a serialized buffer
+ */
+typedef struct {
+    const unsigned char *data;
+    size_t len;
+    size_t pos;
+    int bad;
+    int depth;
+} SerialReader;
+
+static uint32_t get_u32(SerialReader *r) {
+    uint32_t v = 0;
+    if (r->bad || r->len - r->pos < sizeof(v)) {
+        r->bad = 1;
+        return 0;
+    }
+    memcpy(&v, r->data + r->pos, sizeof(v));
+    r->pos += sizeof(v);
+    return v;
+}
+
+static int get_u8(SerialReader *r) {
+    if (r->bad || r->pos >= r->len) {
+        r->bad = 1;
+        return 0;
+    }
+    return r->data[r->pos++];
+}
+
+static const char *get_str(SerialReader *r, Parser *p) {
+    uint32_t len = get_u32(r);
+    if (r->bad || len == SERIAL_NO_STRING) {
+        return NULL;
+    }
+    if (r->len - r->pos < len) {
+        r->bad = 1;
+        return NULL;
+    }
+    const char *s = unit_strndup(p, (const char *)r->data + r->pos, len);
+    r->pos += len;
+    return s;
+}
+
+static Node *get_list(SerialReader *r, Parser *p);
+
+static Node *get_node(SerialReader *r, Parser *p) {
+    int type = get_u8(r);
+    if (type > N_PIPE) {
+        r->bad = 1;
+        return NULL;
+    }
+    Node *node = new_node(p, (NodeType)type);
+    node->name = get_str(r, p);
+    node->list_text = get_str(r, p);
+    node->case_text = get_str(r, p);
+    const char *text = get_str(r, p);
+    node->redir_in = get_str(r, p);
+    node->redir_out = get_str(r, p);
+    node->has_list = get_u8(r);
+    node->redir_append = get_u8(r);
+    int here_kind = get_u8(r);
+    if (here_kind > HERE_STRING) {
+        r->bad = 1;
+    }
+    node->here_kind = (HereKind)here_kind;
+    node->here_text = get_str(r, p);
+    if (node->here_kind != HERE_NONE && node->here_text == NULL) {
+        r->bad = 1;
+    }
+    node->line = (int)get_u32(r);
+    node->left = get_list(r, p);
+    node->right = get_list(r, p);
+    node->cond = get_list(r, p);
+    node->body = get_list(r, p);
+    node->else_part = get_list(r, p);
+
+    uint32_t arms = get_u32(r);
+    CaseArm **tail = &node->arms;
+    for (uint32_t a = 0; a < arms && !r->bad; a++) {
+        uint32_t npatterns = get_u32(r);
+        if (npatterns > r->len - r->pos) {
+            r->bad = 1;
+            break;
+        }
+        CaseArm *arm = arena_alloc(&p->unit->arena, sizeof(CaseArm));
+        memset(arm, 0, sizeof(*arm));
+        arm->patterns = arena_alloc(&p->unit->arena, sizeof(char *) * (npatterns + 1));
+        arm->compiled = arena_alloc(&p->unit->arena, sizeof(GlobPattern *) * (npatterns + 1));
+        for (uint32_t i = 0; i < npatterns && !r->bad; i++) {
+            arm->patterns[i] = get_str(r, p);
+            if (arm->patterns[i] == NULL) {
+                r->bad = 1;
+                break;
+            }
+            compile_case_pattern(p, arm, (int)i);
+            arm->npatterns++;
+        }
+        arm->body = get_list(r, p);
+        *tail = arm;
+        tail = &arm->next;
+    }
+    if (r->bad) {
+        return NULL;
+    }
+
+    // Rebuild the fast-path tables from the stored text
+    if (node->type == N_SIMPLE) {
+        if (text == NULL) {
+            r->bad = 1;
+            return NULL;
+        }
+        node->simple.text = text;
+        compile_simple(p, node);
+    } else if (node->type == N_CASE) {
+        if (node->case_text == NULL) {
+            r->bad = 1;
+            return NULL;
+        }
+        compile_case_subject(p, node);
+    } else if ((node->type == N_FUNCDEF && node->name == NULL) ||
+               (node->type == N_FOR && node->name == NULL)) {
+        r->bad = 1;
+        return NULL;
+    }
+    if (node->type == N_FOR) {
+        node->var_slot.name = node->name;
+        node->var_slot.index = -1;
+    }
+    return node;
+}
+
+static Node *get_list(SerialReader *r, Parser *p) {
+    uint32_t count = get_u32(r);
+    if (r->bad || count > r->len - r->pos || ++r->depth > 1000) {
+        r->bad = 1;
+        return NULL;
+    }
+    Node *head = NULL;
+    Node **tail = &head;
+    for (uint32_t i = 0; i < count && !r->bad; i++) {
+        Node *node = get_node(r, p);
+        if (node == NULL) {
+            break;
+        }
+        *tail = node;
+        tail = &node->next;
+    }
+    r->depth--;
+    return r->bad ? NULL : head;
+}
+
+ScriptUnit *script_deserialize(const void *data, size_t len) {
+    ScriptUnit *unit = calloc(1, sizeof(ScriptUnit));
+    if (unit == NULL) {
+        return NULL;
+    }
+    arena_init(&unit->arena, UNIT_CHUNK_SIZE);
+    unit->refs = 1;
+
+    Parser p = { "", 0, unit, SCRIPT_OK, 1, 0, 0, 0, 0 };
+    SerialReader r = { data, len, 0, 0, 0 };
+    unit->root = get_list(&r, &p);
+    if (r.bad || r.pos != len) {
+        script_release(unit);
+        return NULL;
+    }
+    return unit;
+}
@@ -0,0 +1,312 @@
+/**
+ * script_cache.c - Parsed-script cache for source / .
+ *
+ * Lookup order for a script path:
+ *   1. In-memory table keyed by (st_dev, st_ino), valid while size and
+ *      mtime are unchanged: no read, no parse.
+ *   2. On-disk cache (opt-in, USHELL_SCRIPT_CACHE=1): NAME.ushc holds a
+ *      header (magic, parser version, size, mtime, path) followed by the
+ *      serialized tree from script_serialize().
+ *   3. mmap the file and parse it, then fill both caches.
+ *
+ * Pipes, FIFOs and devices (source /dev/stdin, source <(cmd)) have no
+ * usable size or identity: they are read to EOF, parsed and not cached.
+ */
+
+#define _GNU_SOURCE
+#include "script_cache.h"
+#include "readbuf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SCRIPT_CACHE_SLOTS 32
+#define USHC_MAGIC "USHC"
+
+typedef struct {
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    ScriptUnit *unit;       // NULL when the slot is free
+    unsigned long used;     // LRU stamp
+} CacheSlot;
+
+/**
+ * On-disk header; the absolute script path follows it
+ */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    int64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint32_t path_len;
+} UshcHeader;
+
+static CacheSlot slots[SCRIPT_CACHE_SLOTS];
+static unsigned long use_clock = 0;
+
+static int same_file(const CacheSlot *slot, const struct stat *st) {
+    return slot->unit != NULL && slot->dev == st->st_dev && slot->ino == st->st_ino &&
+           slot->size == st->st_size && slot->mtime.tv_sec == st->st_mtim.tv_sec &&
+           slot->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+static ScriptUnit *memory_lookup(const struct stat *st) {
+    for (int i = 0; i < SCRIPT_CACHE_SLOTS; i++) {
+        if (same_file(&slots[i], st)) {
+            slots[i].used = ++use_clock;
+            script_retain(slots[i].unit);
+            return slots[i].unit;
+        }
+    }
+    return NULL;
+}
+
+static void memory_store(const struct stat *st, ScriptUnit *unit) {
+    CacheSlot *victim = &slots[0];
+    for (int i = 0; i < SCRIPT_CACHE_SLOTS; i++) {
+        // A stale entry for the same file is replaced in place
+        if (slots[i].unit != NULL && slots[i].dev == st->st_dev && slots[i].ino == st->st_ino) {
+            victim = &slots[i];
+            break;
+        }
+        if (slots[i].unit == NULL || slots[i].used < victim->used) {
+            victim = &slots[i];
+        }
+    }
+    script_release(victim->unit);
+    victim->dev = st->st_dev;
+    victim->ino = st->st_ino;
+    victim->size = st->st_size;
+    victim->mtime = st->st_mtim;
+    victim->used = ++use_clock;
+    victim->unit = unit;
+    script_retain(unit);
+}
+
+/**
+ * Cache file for an absolute script path, or -1 if disk caching is off
+ */
+static int disk_cache_path(const char *abs_path, char *out, size_t out_size, int create_dir) {
+    const char *enabled = getenv("USHELL_SCRIPT_CACHE");
+    if (enabled == NULL || strcmp(enabled, "1") != 0) {
+        return -1;
+    }
+
+    char dir[PATH_MAX];
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    if (xdg != NULL && xdg[0] == '/') {
+        snprintf(dir, sizeof(dir), "%s/ushell", xdg);
+    } else if (home != NULL) {
+        snprintf(dir, sizeof(dir), "%s/.cache/ushell", home);
+    } else {
+        return -1;
+    }
+    if (create_dir) {
+        char *slash = strrchr(dir, '/');
+        *slash = '\0';
+        mkdir(dir, 0700);
+        *slash = '/';
+        mkdir(dir, 0700);
+    }
+
+    // FNV-1a of the path keeps names short and filesystem-safe
+    uint64_t hash = 1469598103934665603ULL;
+    for (const char *c = abs_path; *c; c++) {
+        hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+    }
+    const char *base = strrchr(abs_path, '/');
+    base = base ? base + 1 : abs_path;
+    int n = snprintf(out, out_size, "%s/%.40s-%016llx.ushc", dir, base, (unsigned long long)hash);
+    return (n < 0 || (size_t)n >= out_size) ? -1 : 0;
+}
+
+static ScriptUnit *disk_lookup(const char *abs_path, const struct stat *st) {
+    char cache_path[PATH_MAX];
+    if (disk_cache_path(abs_path, cache_path, sizeof(cache_path), 0) < 0) {
+        return NULL;
+    }
+    int fd = open(cache_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat cst;
+    if (fstat(fd, &cst) < 0 || cst.st_size < (off_t)sizeof(UshcHeader)) {
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, (size_t)cst.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    ScriptUnit *unit = NULL;
+    UshcHeader hdr;
+    memcpy(&hdr, map, sizeof(hdr));
+    size_t path_len = strlen(abs_path);
+    size_t payload = sizeof(hdr) + hdr.path_len;
+    if (memcmp(hdr.magic, USHC_MAGIC, 4) == 0 &&
+        hdr.version == SCRIPT_PARSER_VERSION &&
+        hdr.size == (int64_t)st->st_size &&
+        hdr.mtime_sec == (int64_t)st->st_mtim.tv_sec &&
+        hdr.mtime_nsec == (int64_t)st->st_mtim.tv_nsec &&
+        hdr.path_len == path_len &&
+        payload <= (size_t)cst.st_size &&
+        memcmp((char *)map + sizeof(hdr), abs_path, path_len) == 0) {
+        unit = script_deserialize((char *)map + payload, (size_t)cst.st_size - payload);
+    }
+    munmap(map, (size_t)cst.st_size);
+    return unit;
+}
+
+static void disk_store(const char *abs_path, const struct stat *st, ScriptUnit *unit) {
+    char cache_path[PATH_MAX];
+    char tmp_path[PATH_MAX + 32];
+    if (disk_cache_path(abs_path, cache_path, sizeof(cache_path), 1) < 0) {
+        return;
+    }
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", cache_path, (long)getpid());
+
+    FILE *out = fopen(tmp_path, "wb");
+    if (out == NULL) {
+        return;
+    }
+    UshcHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, USHC_MAGIC, 4);
+    hdr.version = SCRIPT_PARSER_VERSION;
+    hdr.size = (int64_t)st->st_size;
+    hdr.mtime_sec = (int64_t)st->st_mtim.tv_sec;
+    hdr.mtime_nsec = (int64_t)st->st_mtim.tv_nsec;
+    hdr.path_len = (uint32_t)strlen(abs_path);
+    fwrite(&hdr, sizeof(hdr), 1, out);
+    fwrite(abs_path, 1, hdr.path_len, out);
+
+    int failed = script_serialize(unit, out) < 0;
+    failed |= fclose(out) != 0;
+    // Readers only ever see complete files
+    if (failed || rename(tmp_path, cache_path) < 0) {
+        unlink(tmp_path);
+    }
+}
+
+/**
+ * Read a non-regular file (pipe, FIFO, device) to EOF and parse it
+ */
+static ScriptUnit *parse_stream(int fd, int *status) {
+    char *text;
+    size_t len;
+    if (readbuf_slurp(fd, &text, &len) < 0) {
+        *status = SCRIPT_CACHE_IO_ERROR;
+        return NULL;
+    }
+    ScriptUnit *unit = script_parse(text, status);
+    free(text);
+    return unit;
+}
+
+/**
+ * Map the script and parse it; the text must be NUL-terminated for the
+ * parser, which the zero fill after EOF provides unless the file ends
+ * exactly on a page boundary
+ */
+static ScriptUnit *parse_file(int fd, const struct stat *st, int *status) {
+    size_t size = (size_t)st->st_size;
+    if (size == 0) {
+        return script_parse("", status);
+    }
+
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        *status = SCRIPT_CACHE_IO_ERROR;
+        return NULL;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    ScriptUnit *unit;
+    long page = sysconf(_SC_PAGESIZE);
+    if (page > 0 && size % (size_t)page != 0) {
+        unit = script_parse(map, status);
+    } else {
+        char *copy = malloc(size + 1);
+        if (copy == NULL) {
+            munmap(map, size);
+            *status = SCRIPT_CACHE_IO_ERROR;
+            errno = ENOMEM;
+            return NULL;
+        }
+        memcpy(copy, map, size);
+        copy[size] = '\0';
+        unit = script_parse(copy, status);
+        free(copy);
+    }
+    munmap(map, size);
+    return unit;
+}
+
+ScriptUnit *script_cache_load(const char *path, int *status) {
+    struct stat st;
+
+    *status = SCRIPT_CACHE_IO_ERROR;
+    if (stat(path, &st) < 0) {
+        return NULL;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        errno = EISDIR;
+        return NULL;
+    }
+
+    // Fast path: unchanged file already parsed by this shell
+    ScriptUnit *unit = memory_lookup(&st);
+    if (unit != NULL) {
+        *status = SCRIPT_OK;
+        return unit;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    if (!S_ISREG(st.st_mode)) {
+        unit = parse_stream(fd, status);
+        close(fd);
+        script_set_origin(unit, path);
+        return unit;
+    }
+
+    char abs_path[PATH_MAX];
+    int have_abs = realpath(path, abs_path) != NULL;
+
+    unit = have_abs ? disk_lookup(abs_path, &st) : NULL;
+    if (unit != NULL) {
+        *status = SCRIPT_OK;
+    } else {
+        unit = parse_file(fd, &st, status);
+        if (unit != NULL && have_abs) {
+            disk_store(abs_path, &st, unit);
+        }
+    }
+    close(fd);
+    script_set_origin(unit, path);
+
+    if (unit != NULL) {
+        memory_store(&st, unit);
+    }
+    return unit;
+}
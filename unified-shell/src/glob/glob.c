@@ -26,99 +26,186 @@ static bool has_wildcards(const char *pattern) {
 }
 
 /**
- * @brief Match a character class [abc] or [a-z] or [!abc]
- * 
+ * @brief Compile a [...] class starting after '[' into a bitmap
+ *
  * @param pattern Pointer to character after '['
- * @param ch Character to match
- * @param pattern_end Output: pointer to character after ']'
- * @return 1 if match, 0 otherwise
+ * @param bits Output 256-bit membership bitmap
+ * @return Pointer to character after ']' (or end of pattern)
  */
-static int match_char_class(const char *pattern, char ch, const char **pattern_end) {
+static const char *compile_char_class(const char *pattern, uint8_t bits[32]) {
     bool negate = false;
-    bool matched = false;
+    memset(bits, 0, 32);
     
-    if (*pattern == '!') {
+    if (*pattern == '!' || *pattern == '^') {
         negate = true;
         pattern++;
     }
     
-    while (*pattern && *pattern != ']') {
+    // A leading ']' is a literal member
+    bool first = true;
+    while (*pattern && (*pattern != ']' || first)) {
+        unsigned char lo = (unsigned char)*pattern;
         // Check for range like a-z
         if (pattern[1] == '-' && pattern[2] != ']' && pattern[2] != '\0') {
-            if (ch >= pattern[0] && ch <= pattern[2]) {
-                matched = true;
+            unsigned char hi = (unsigned char)pattern[2];
+            for (unsigned int c = lo; c <= hi; c++) {
+                bits[c >> 3] |= (uint8_t)(1u << (c & 7));
             }
             pattern += 3;
         } else {
             // Single character
-            if (ch == *pattern) {
-                matched = true;
-            }
+            bits[lo >> 3] |= (uint8_t)(1u << (lo & 7));
             pattern++;
         }
+        first = false;
     }
     
-    if (*pattern == ']') {
-        *pattern_end = pattern + 1;
-    } else {
-        *pattern_end = pattern;
+    if (negate) {
+        for (int i = 0; i < 32; i++) {
+            bits[i] = (uint8_t)~bits[i];
+        }
     }
     
-    return negate ? !matched : matched;
+    return (*pattern == ']') ? pattern + 1 : pattern;
 }
 
 /**
- * @brief Recursively match pattern against string
+ * @brief Compile a glob pattern into ops
  */
-int match_pattern(const char *pattern, const char *str) {
-    // Base cases
-    if (*pattern == '\0' && *str == '\0') {
-        return 1;  // Both exhausted - match
-    }
+int glob_compile(GlobPattern *gp, const char *pattern) {
+    size_t plen = strlen(pattern);
+    memset(gp, 0, sizeof(*gp));
     
-    if (*pattern == '\0') {
-        return 0;  // Pattern exhausted but string remains
+    gp->ops = malloc((plen + 1) * sizeof(GlobOp));
+    if (gp->ops == NULL) {
+        return -1;
     }
     
-    // Handle wildcards
-    if (*pattern == '*') {
-        // Try matching * with empty string
-        if (match_pattern(pattern + 1, str)) {
-            return 1;
+    int class_capacity = 0;
+    const char *p = pattern;
+    while (*p) {
+        GlobOp *op = &gp->ops[gp->count];
+        op->ch = 0;
+        op->class_idx = 0;
+        
+        if (*p == '*') {
+            // Collapse runs of stars
+            if (gp->count == 0 || gp->ops[gp->count - 1].type != GLOB_OP_STAR) {
+                op->type = GLOB_OP_STAR;
+                gp->count++;
+            }
+            gp->has_star = 1;
+            p++;
+            continue;
         }
-        // Try matching * with one or more characters
-        if (*str != '\0' && match_pattern(pattern, str + 1)) {
-            return 1;
+        
+        if (*p == '?') {
+            op->type = GLOB_OP_ANY;
+            p++;
+        } else if (*p == '[' && strchr(p + 1, ']') != NULL) {
+            if (gp->class_count == class_capacity) {
+                class_capacity = class_capacity ? class_capacity * 2 : 4;
+                uint8_t (*grown)[32] = realloc(gp->classes, class_capacity * 32);
+                if (grown == NULL) {
+                    glob_free(gp);
+                    return -1;
+                }
+                gp->classes = grown;
+            }
+            op->type = GLOB_OP_CLASS;
+            op->class_idx = (uint16_t)gp->class_count;
+            p = compile_char_class(p + 1, gp->classes[gp->class_count]);
+            gp->class_count++;
+        } else {
+            if (*p == '\\' && p[1] != '\0') {
+                p++;  // Escaped character is literal
+            }
+            op->type = GLOB_OP_LITERAL;
+            op->ch = (uint8_t)*p;
+            p++;
         }
-        return 0;
+        gp->count++;
+        gp->min_len++;
     }
     
-    if (*pattern == '?') {
-        // ? matches any single character
-        if (*str == '\0') {
-            return 0;  // No character to match
-        }
-        return match_pattern(pattern + 1, str + 1);
+    return 0;
+}
+
+/**
+ * @brief Test one non-star op against a character
+ */
+static inline bool glob_op_matches(const GlobPattern *gp, const GlobOp *op, unsigned char c) {
+    switch (op->type) {
+        case GLOB_OP_LITERAL:
+            return op->ch == c;
+        case GLOB_OP_ANY:
+            return true;
+        case GLOB_OP_CLASS:
+            return (gp->classes[op->class_idx][c >> 3] >> (c & 7)) & 1;
+        default:
+            return false;
     }
+}
+
+/**
+ * @brief Iterative match with a single star backtrack point
+ *
+ * When a later op fails, the most recent '*' absorbs one more character
+ * and matching resumes after it. This is sufficient for glob semantics
+ * and bounds the work to O(pattern * string).
+ */
+int glob_match(const GlobPattern *gp, const char *str, size_t len) {
+    if (len < gp->min_len || (!gp->has_star && len != gp->min_len)) {
+        return 0;
+    }
+    
+    int pi = 0;
+    size_t si = 0;
+    int star_pi = -1;
+    size_t star_si = 0;
     
-    if (*pattern == '[') {
-        // Character class
-        const char *pattern_end;
-        if (*str == '\0') {
+    while (si < len) {
+        if (pi < gp->count && gp->ops[pi].type == GLOB_OP_STAR) {
+            star_pi = pi++;
+            star_si = si;
+        } else if (pi < gp->count && glob_op_matches(gp, &gp->ops[pi], (unsigned char)str[si])) {
+            pi++;
+            si++;
+        } else if (star_pi >= 0) {
+            pi = star_pi + 1;
+            si = ++star_si;
+        } else {
             return 0;
         }
-        if (match_char_class(pattern + 1, *str, &pattern_end)) {
-            return match_pattern(pattern_end, str + 1);
-        }
-        return 0;
     }
     
-    // Regular character - must match exactly
-    if (*str == '\0' || *pattern != *str) {
+    // Remaining ops must all be stars
+    while (pi < gp->count && gp->ops[pi].type == GLOB_OP_STAR) {
+        pi++;
+    }
+    return pi == gp->count;
+}
+
+/**
+ * @brief Release a compiled pattern
+ */
+void glob_free(GlobPattern *gp) {
+    free(gp->ops);
+    free(gp->classes);
+    memset(gp, 0, sizeof(*gp));
+}
+
+/**
+ * @brief Match pattern against a whole string
+ */
+int match_pattern(const char *pattern, const char *str) {
+    GlobPattern gp;
+    if (glob_compile(&gp, pattern) != 0) {
         return 0;
     }
-    
-    return match_pattern(pattern + 1, str + 1);
+    int matched = glob_match(&gp, str, strlen(str));
+    glob_free(&gp);
+    return matched;
 }
 
 /**
@@ -139,9 +226,17 @@ char **expand_glob(const char *pattern, int *count) {
         return NULL;
     }
     
+    // Compile once, match every directory entry
+    GlobPattern gp;
+    if (glob_compile(&gp, pattern) != 0) {
+        closedir(dir);
+        return NULL;
+    }
+    
     // Allocate array for matches
     char **matches = malloc(sizeof(char *) * MAX_MATCHES);
     if (matches == NULL) {
+        glob_free(&gp);
         closedir(dir);
         return NULL;
     }
@@ -160,7 +255,7 @@ char **expand_glob(const char *pattern, int *count) {
         }
         
         // Check if name matches pattern
-        if (match_pattern(pattern, entry->d_name)) {
+        if (glob_match(&gp, entry->d_name, strlen(entry->d_name))) {
             if (*count >= MAX_MATCHES) {
                 fprintf(stderr, "glob: too many matches (max %d)\n", MAX_MATCHES);
                 break;
@@ -176,6 +271,7 @@ char **expand_glob(const char *pattern, int *count) {
     }
     
     closedir(dir);
+    glob_free(&gp);
     
     // If no matches, free and return NULL
     if (*count == 0) {
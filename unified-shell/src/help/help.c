@@ -13,8 +13,11 @@
  */
 
 #include "help.h"
+#include "registry.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 
 /* ============================================================================
  * Help Database - All Built-in Commands
@@ -248,16 +251,23 @@ static const HelpEntry help_entries[] = {
     {
         .name = "jobs",
         .summary = "List background jobs",
-        .usage = "jobs",
+        .usage = "jobs [-l] [-p] [-r] [-s]",
         .description =
             "Displays all background jobs with their job IDs, PIDs, and status.\n"
             "Shows running, stopped, and completed jobs.\n"
             "Use 'fg' and 'bg' commands to control jobs.",
-        .options = "(none)",
+        .options =
+            "-l    Include PIDs, and pipe throughput for jobs started\n"
+            "      with USHELL_PIPE_MONITOR=1\n"
+            "-p    Print PIDs only\n"
+            "-r    Running jobs only\n"
+            "-s    Stopped jobs only",
         .examples =
             "jobs                    List all background jobs\n"
             "sleep 10 &              Start background job\n"
-            "jobs                    See the job listed"
+            "jobs                    See the job listed\n"
+            "USHELL_PIPE_MONITOR=1 gen | gzip > out.gz &\n"
+            "jobs -l                 Bytes/sec and blocked time per pipe"
     },
 
     /* fg - Foreground Job */
@@ -298,6 +308,117 @@ static const HelpEntry help_entries[] = {
             "bg %1                   Resume job 1 in background"
     },
 
+    /* kill - Signal Jobs */
+    {
+        .name = "kill",
+        .summary = "Send a signal to jobs or processes",
+        .usage = "kill [-s SIG | -SIG] %job_id|pid...  |  kill -l",
+        .description =
+            "Sends a signal (default TERM) to jobs or processes.\n"
+            "Process jobs receive it on their whole process group.\n"
+            "Thread jobs (integrated tools run with &) are cancelled by\n"
+            "any signal except STOP/TSTP, which pause them at their next\n"
+            "check, and CONT, which resumes them.",
+        .options =
+            "-s SIG, -SIG     Signal name (TERM, INT, STOP, ...) or number\n"
+            "-l               List signal names",
+        .examples =
+            "kill %1                 Cancel job 1\n"
+            "kill -STOP %2           Pause job 2\n"
+            "kill -CONT %2           Resume job 2"
+    },
+
+    /* wait - Wait for Jobs */
+    {
+        .name = "wait",
+        .summary = "Wait for background jobs to finish",
+        .usage = "wait [%job_id|pid...]",
+        .description =
+            "Waits for the named jobs, or for all running jobs.\n"
+            "Returns the exit status of the last job named (0 without\n"
+            "arguments). Ctrl+C stops waiting and leaves the jobs running.",
+        .options =
+            "%job_id, pid     Jobs to wait for (optional)",
+        .examples =
+            "myfd '*.log' / > logs.txt &\n"
+            "wait %1                 Wait for the search to finish"
+    },
+    {
+        .name = "coproc",
+        .summary = "Start a command with pipes to and from the shell",
+        .usage = "coproc [NAME] COMMAND [ARG...]",
+        .description =
+            "Runs COMMAND as a background job whose stdin and stdout are\n"
+            "pipes to the shell. ${NAME[0]} is the fd to read its output from,\n"
+            "${NAME[1]} the fd to write its input to, and NAME_PID its pid.\n"
+            "NAME defaults to COPROC. Close ${NAME[1]} with exec N>&- to send\n"
+            "end of input; the filter must flush each line (e.g. sed -u).",
+        .options =
+            "NAME             Array to hold the fds (default COPROC)",
+        .examples =
+            "coproc UP sed -u 's/.*/\\U&/'\n"
+            "echo hello >&${UP[1]}\n"
+            "read -u ${UP[0]} line    Read HELLO back"
+    },
+    {
+        .name = "jobctl",
+        .summary = "Set CPU affinity, scheduling class and I/O priority of jobs",
+        .usage = "jobctl [%job...|--pool] [--cpus LIST] [--sched CLASS] [--nice N] [--ionice CLASS[:LEVEL]]",
+        .description =
+            "Changes every thread of a job's process group, the worker running\n"
+            "a thread job, or with --pool every worker thread of the shell.\n"
+            "Without options shows the current settings (all jobs by default).\n"
+            "USHELL_BG_POLICY holds options applied to each new background job.",
+        .options =
+            "--cpus LIST      CPUs to run on, e.g. 2-7 or 0,2,4-5\n"
+            "--sched CLASS    other, batch or idle\n"
+            "--nice N         Nice value (-20 to 19)\n"
+            "--ionice CLASS   idle, be[:0-7], rt[:0-7] or none\n"
+            "--pool           The shell's worker threads",
+        .examples =
+            "jobctl %1 --cpus 2-7 --sched batch --ionice idle\n"
+            "jobctl --pool --cpus 0-1    Keep tools on CPUs 0 and 1\n"
+            "USHELL_BG_POLICY='--sched batch --ionice idle'"
+    },
+    {
+        .name = "pool",
+        .summary = "Show worker pool statistics and set its limits",
+        .usage = "pool [--min N] [--max N] [--idle SEC] [--grow-wait MS] [--reset]",
+        .description =
+            "The worker pool runs background tools, <(tool) substitutions and\n"
+            "threaded builtins. It adds a worker when a task has waited in the\n"
+            "queue for the grow wait or a background tool finds none idle, and\n"
+            "retires workers idle for the idle time while above the minimum.\n"
+            "Without options prints the limits and, per worker, tasks run and\n"
+            "time busy, waiting in the queue before starting, and idle.",
+        .options =
+            "--min N          Workers always kept (USHELL_THREAD_POOL_SIZE)\n"
+            "--max N          Upper limit (USHELL_THREAD_POOL_MAX, default 16)\n"
+            "--idle SEC       Idle time before a worker retires (default 30)\n"
+            "--grow-wait MS   Queue wait that adds a worker (default 10)\n"
+            "--reset          Zero the counters",
+        .examples =
+            "pool                     Show the workers and their counters\n"
+            "pool --max 32 --idle 5   Allow more workers, retire them sooner"
+    },
+
+    /* memstats - Memory Statistics */
+    {
+        .name = "memstats",
+        .summary = "Show memory use by subsystem",
+        .usage = "memstats",
+        .description =
+            "Variables, the job table, the package index and MCP buffers are\n"
+            "allocated on demand through counting wrappers. memstats prints,\n"
+            "per subsystem, allocations and frees so far and live and peak\n"
+            "bytes, then the interned strings (variable names, package fields),\n"
+            "the resident set size and the malloc heap totals.",
+        .options = "(none)",
+        .examples =
+            "memstats                 Show the table\n"
+            "memstats | grep rss      Resident set size only"
+    },
+
     /* commands - List Commands */
     {
         .name = "commands",
@@ -334,6 +455,267 @@ static const HelpEntry help_entries[] = {
             "exit 1                  Exit with error status"
     },
 
+    /* myfzf - Fuzzy Finder */
+    {
+        .name = "myfzf",
+        .summary = "Interactive fuzzy finder",
+        .usage = "myfzf [options]",
+        .description =
+            "Reads candidate lines and lets you narrow them down by typing.\n"
+            "Characters of the query must appear in order; matches at word\n"
+            "boundaries, path components and consecutive runs rank higher.\n"
+            "Candidates stream in while you type. The selection is printed\n"
+            "to stdout. Uppercase letters in the query make it case-sensitive.\n"
+            "At the prompt, Ctrl-T inserts a picked file, Alt-C a directory.\n"
+            "Keys: Up/Down or Ctrl-P/Ctrl-N move, Enter accepts, Esc cancels.",
+        .options =
+            "-q, --query Q    Start with query Q\n"
+            "-f, --filter Q   Non-interactive: print all matches for Q, best first\n"
+            "--files [DIR]    Candidates: files below DIR (default when stdin is a tty)\n"
+            "--dirs [DIR]     Candidates: directories below DIR\n"
+            "--history        Candidates: command history\n"
+            "--commands       Candidates: known command names\n"
+            "-H, --hidden     Include hidden files with --files/--dirs\n"
+            "-n, --limit N    Print at most N matches in filter mode\n"
+            "--height N       Rows used by the finder (default: 15)",
+        .examples =
+            "myfzf                   Pick a file below the current directory\n"
+            "myfd .c | myfzf         Pick from myfd output\n"
+            "myfzf --history         Search command history\n"
+            "myfzf -f mkfl --files   Print files matching 'mkfl'"
+    },
+
+    /* test - Evaluate Conditional Expression */
+    {
+        .name = "test",
+        .summary = "Evaluate a conditional expression",
+        .usage = "test EXPR | [ EXPR ] | [[ EXPR ]]",
+        .description =
+            "Evaluates EXPR and exits with 0 (true), 1 (false) or 2 (error).\n"
+            "Runs inside the shell, so conditionals never fork.\n"
+            "[ ] follows POSIX test. [[ ]] additionally supports && and ||,\n"
+            "glob patterns on the right of == and !=, and =~ regex matching\n"
+            "(the matched text is stored in BASH_REMATCH).",
+        .options =
+            "-e/-f/-d FILE    Exists / regular file / directory\n"
+            "-r/-w/-x FILE    Readable / writable / executable\n"
+            "-s FILE          Exists and is not empty\n"
+            "-L FILE          Is a symbolic link\n"
+            "F1 -nt/-ot F2    F1 is newer / older than F2\n"
+            "-n/-z STR        String is non-empty / empty\n"
+            "S1 = S2, S1 != S2, S1 < S2, S1 > S2   String comparison\n"
+            "N1 -eq/-ne/-lt/-le/-gt/-ge N2         Integer comparison\n"
+            "! EXPR, ( EXPR ), EXPR -a EXPR, EXPR -o EXPR",
+        .examples =
+            "if [ -f config.txt ]; then echo found; fi\n"
+            "test $count -gt 10\n"
+            "[[ $file == *.c ]]\n"
+            "[[ $version =~ ^[0-9]+\\.[0-9]+$ ]]"
+    },
+
+    /* true - Succeed */
+    {
+        .name = "true",
+        .summary = "Do nothing, successfully",
+        .usage = "true",
+        .description =
+            "Exits with status 0. Useful in conditionals and loops.",
+        .options = "(none)",
+        .examples =
+            "if true then echo yes fi"
+    },
+
+    /* false - Fail */
+    {
+        .name = "false",
+        .summary = "Do nothing, unsuccessfully",
+        .usage = "false",
+        .description =
+            "Exits with status 1. Useful in conditionals and loops.",
+        .options = "(none)",
+        .examples =
+            "if false then echo no else echo yes fi"
+    },
+
+    /* break - Leave a loop */
+    {
+        .name = "break",
+        .summary = "Exit from a for, while or until loop",
+        .usage = "break [N]",
+        .description =
+            "Stops the innermost enclosing loop, or the N innermost loops\n"
+            "when N is given. Execution continues after the loop's 'done'.",
+        .options = "N    Number of enclosing loops to leave (default 1)",
+        .examples =
+            "for f in *.log; do if [ -s $f ]; then echo $f; break; fi; done"
+    },
+
+    /* continue - Next loop iteration */
+    {
+        .name = "continue",
+        .summary = "Resume the next iteration of a loop",
+        .usage = "continue [N]",
+        .description =
+            "Skips the rest of the current loop body and starts the next\n"
+            "iteration. With N, resumes the Nth enclosing loop.",
+        .options = "N    Loop level to resume (default 1)",
+        .examples =
+            "for i in 1 2 3 4; do if [ $i -eq 2 ]; then continue; fi; echo $i; done"
+    },
+
+    /* return - Leave a function */
+    {
+        .name = "return",
+        .summary = "Return from a shell function",
+        .usage = "return [N]",
+        .description =
+            "Stops the current shell function. Its exit status is N, or the\n"
+            "status of the last command when N is omitted.",
+        .options = "N    Exit status (0-255)",
+        .examples =
+            "is_even() { return $(( $1 % 2 )); }\n"
+            "is_even 4 && echo even"
+    },
+
+    /* read - Read a line into variables */
+    {
+        .name = "read",
+        .summary = "Read a line from input and split it into variables",
+        .usage = "read [-r] [-d DELIM] [-a ARRAY] [-p PROMPT] [-u FD] [NAME...]",
+        .description =
+            "Reads one record (a line by default) and splits it into fields\n"
+            "using the characters in IFS (default: space, tab, newline). Each\n"
+            "NAME receives one field and the last NAME receives the rest of\n"
+            "the line. Without NAMEs the whole line is stored in REPLY.\n"
+            "A backslash quotes the next character and a trailing backslash\n"
+            "continues the line, unless -r is given.\n"
+            "Input from files and pipes is read in large chunks without\n"
+            "consuming anything past the record, so while-read loops are fast\n"
+            "and commands run afterwards still see the remaining input.\n"
+            "Exit status is 1 at end of input.",
+        .options =
+            "-r          Do not treat backslashes as escapes\n"
+            "-d DELIM    Stop at the first character of DELIM instead of newline\n"
+            "-a ARRAY    Store the fields in ARRAY[0], ARRAY[1], ...\n"
+            "-p PROMPT   Print PROMPT on stderr first (terminal input only)\n"
+            "-u FD       Read from file descriptor FD instead of stdin",
+        .examples =
+            "while read -r name size; do echo $name is $size; done < sizes.txt\n"
+            "IFS=: read -a parts < /etc/hostname\n"
+            "read -p 'Continue? ' answer"
+    },
+
+    /* mapfile - Read lines into an array */
+    {
+        .name = "mapfile",
+        .summary = "Read all lines of input into an array",
+        .usage = "mapfile [-t] [-d DELIM] [-n COUNT] [-s SKIP] [-u FD] [ARRAY]",
+        .description =
+            "Reads input in one pass and stores each line as an element of\n"
+            "ARRAY (default MAPFILE). Elements are available as ${ARRAY[i]},\n"
+            "${ARRAY[@]} and ${#ARRAY[@]}. readarray is the same command.",
+        .options =
+            "-t          Remove the trailing delimiter from each element\n"
+            "-d DELIM    Use the first character of DELIM as line terminator\n"
+            "-n COUNT    Read at most COUNT lines\n"
+            "-s SKIP     Discard the first SKIP lines\n"
+            "-u FD       Read from file descriptor FD instead of stdin",
+        .examples =
+            "mapfile -t lines < notes.txt\n"
+            "echo ${#lines[@]} lines, first: ${lines[0]}"
+    },
+
+    /* readarray - Alias for mapfile */
+    {
+        .name = "readarray",
+        .summary = "Read all lines of input into an array (same as mapfile)",
+        .usage = "readarray [-t] [-d DELIM] [-n COUNT] [-s SKIP] [-u FD] [ARRAY]",
+        .description =
+            "Synonym for mapfile. See 'mapfile --help'.",
+        .options =
+            "-t          Remove the trailing delimiter from each element\n"
+            "-n COUNT    Read at most COUNT lines",
+        .examples =
+            "readarray -t hosts < hosts.txt"
+    },
+
+    /* source - Run a script in the current shell */
+    {
+        .name = "source",
+        .summary = "Execute commands from a file in the current shell",
+        .usage = "source FILE [ARG...]",
+        .description =
+            "Reads and runs FILE in the current shell, so variables and\n"
+            "functions it defines remain available afterwards. ARGs become\n"
+            "$1, $2, ... while the file runs, and 'return' ends it early.\n"
+            "A FILE without '/' is searched for in $PATH, then the current\n"
+            "directory.\n"
+            "The parsed file is cached in memory and reused while its size\n"
+            "and modification time are unchanged. Set USHELL_SCRIPT_CACHE=1\n"
+            "to also keep parsed files in ~/.cache/ushell for later shells.",
+        .options = "(none)",
+        .examples =
+            "source ~/.ushellrc\n"
+            "source lib/strings.sh\n"
+            ". ./setup.sh debug"
+    },
+
+    /* . - Same as source */
+    {
+        .name = ".",
+        .summary = "Execute commands from a file in the current shell",
+        .usage = ". FILE [ARG...]",
+        .description =
+            "Same as 'source'. See 'source --help'.",
+        .options = "(none)",
+        .examples =
+            ". ./setup.sh"
+    },
+
+    /* exec - Replace the shell with a command */
+    {
+        .name = "exec",
+        .summary = "Replace the shell with a command, or redirect its fds",
+        .usage = "exec [-c] [-a NAME] [COMMAND [ARG...]]",
+        .description =
+            "With COMMAND, the shell process is replaced by it: the shell\n"
+            "does not fork and does not return. Without COMMAND, the\n"
+            "redirections on the line apply to the shell itself for the\n"
+            "rest of the session (N>FILE, N>>FILE, N<FILE, N>&M, N>&-).\n"
+            "In 'ushell -c' and script mode the last simple command is\n"
+            "exec'd automatically when no background jobs remain.",
+        .options =
+            "-c         Run COMMAND with an empty environment\n"
+            "-a NAME    Pass NAME as argv[0]",
+        .examples =
+            "exec 2>errors.log\n"
+            "exec 3<input.txt\n"
+            "exec -a worker ./server --port 8080"
+    },
+
+    /* enable - Load builtins from shared objects */
+    {
+        .name = "enable",
+        .summary = "Load or unload builtins from shared objects",
+        .usage = "enable -f FILE NAME... | enable -d NAME... | enable [-p]",
+        .description =
+            "Loads NAME from the shared object FILE with dlopen. FILE must\n"
+            "export a NAME_ushell_builtin descriptor (see\n"
+            "include/ushell_builtin.h) built for the shell's plugin ABI.\n"
+            "Loaded commands run inside the shell without a fork, ahead of\n"
+            "compiled-in builtins and programs of the same name.\n"
+            "Without options, lists loaded commands with their call count\n"
+            "and total, average and longest run time.",
+        .options =
+            "-f FILE    Load each NAME from FILE\n"
+            "-d         Unload each NAME (the library is closed with its last command)\n"
+            "-p         List loaded commands (the default)",
+        .examples =
+            "enable -f ./basename.so basename\n"
+            "enable\n"
+            "enable -d basename"
+    },
+
     /* Sentinel - marks end of array */
     { NULL, NULL, NULL, NULL, NULL, NULL }
 };
@@ -342,11 +724,29 @@ static const HelpEntry help_entries[] = {
  * Help System Functions
  * ============================================================================ */
 
+/* Help entry for each registry_entries[] slot, filled on first lookup */
+static const HelpEntry **help_by_command = NULL;
+static pthread_once_t help_index_once = PTHREAD_ONCE_INIT;
+
+static void build_help_index(void) {
+    help_by_command = calloc((size_t)registry_count, sizeof(*help_by_command));
+    if (help_by_command == NULL) {
+        return;
+    }
+    for (int i = 0; help_entries[i].name != NULL; i++) {
+        int slot = registry_index(help_entries[i].name);
+        if (slot >= 0 && help_by_command[slot] == NULL) {
+            help_by_command[slot] = &help_entries[i];
+        }
+    }
+}
+
 /**
  * get_help_entry - Retrieve help entry for a specific command
  * 
- * Searches the help database for the specified command name and returns
- * a pointer to its HelpEntry structure.
+ * Registered commands resolve through the registry's perfect hash; the
+ * remaining entries (topics, names outside commands.def) fall back to a
+ * linear search.
  * 
  * @param cmd_name: Name of the command to look up
  * 
@@ -357,6 +757,12 @@ const HelpEntry* get_help_entry(const char *cmd_name) {
         return NULL;
     }
 
+    pthread_once(&help_index_once, build_help_index);
+    int slot = registry_index(cmd_name);
+    if (slot >= 0 && help_by_command != NULL && help_by_command[slot] != NULL) {
+        return help_by_command[slot];
+    }
+
     /* Linear search through help entries array */
     for (int i = 0; help_entries[i].name != NULL; i++) {
         if (strcmp(help_entries[i].name, cmd_name) == 0) {
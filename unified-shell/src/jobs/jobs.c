@@ -10,14 +10,29 @@
  *   - Status monitoring (running, stopped, done)
  *   - Background job management
  *   - Non-blocking status updates
+ *   - Thread jobs: integrated tools run with & on the worker pool
  */
 
+#define _GNU_SOURCE     // ppoll
 #include "jobs.h"
+#include "pipemon.h"
+#include "eventloop.h"
+#include "signals.h"
+#include "threading.h"
+#include "jobsched.h"
+#include "memstats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 #include <pthread.h>
 
@@ -34,6 +49,11 @@ static int g_next_job_id = 1;
 /* Mutex to protect job list operations (thread-safe access) */
 static pthread_mutex_t jobs_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/* Process substitution helpers not (or no longer) attached to a job */
+static pid_t *g_stray_helpers = NULL;
+static int g_stray_count = 0;
+static int g_stray_cap = 0;
+
 /* ============================================================================
  * Helper Functions
  * ============================================================================ */
@@ -54,6 +74,21 @@ const char* job_status_to_string(JobStatus status) {
     }
 }
 
+/**
+ * job_state_to_string - Describe a job, naming the signal that ended it
+ * 
+ * @param job: Job to describe
+ * 
+ * Returns: "Terminated", "Killed", ... for a job ended by a signal,
+ *          otherwise the job_status_to_string() text
+ */
+const char* job_state_to_string(const Job *job) {
+    if (job->status == JOB_DONE && job->term_signal > 0) {
+        return strsignal(job->term_signal);
+    }
+    return job_status_to_string(job->status);
+}
+
 /**
  * find_job_index - Find array index for a given job ID
  * 
@@ -79,13 +114,186 @@ static int find_job_index(int job_id) {
  */
 static int find_job_index_by_pid(pid_t pid) {
     for (int i = 0; i < g_job_list.count; i++) {
-        if (g_job_list.jobs[i].pid == pid) {
+        if (g_job_list.jobs[i].thread == NULL && g_job_list.jobs[i].pid == pid) {
             return i;
         }
     }
     return -1;
 }
 
+/* ============================================================================
+ * Thread Jobs
+ * ============================================================================ */
+
+/**
+ * ThreadJob - An integrated tool running on a pool worker
+ * 
+ * Shared by the job table and the worker, each holding a reference.
+ * gate.lock also guards finished and status.
+ */
+typedef struct ThreadJob {
+    tool_func tool;
+    int argc;
+    char **argv;                     /* Private copy */
+    tool_ctx ctx;
+    tool_gate gate;                  /* Pause point (Ctrl+Z, kill -STOP) */
+    volatile sig_atomic_t cancel;    /* Set by thread_job_cancel */
+    int cancel_signal;               /* Signal that cancelled the job */
+    int done_fd;                     /* eventfd, readable once finished */
+    int started;                     /* Set once "[N] thread" is printed */
+    int finished;
+    int status;
+    int refs;
+    pid_t tid;                       /* Worker running the tool, 0 before */
+    JobSched sched;                  /* jobctl settings for the worker */
+    JobSched saved;                  /* Worker settings to restore after */
+} ThreadJob;
+
+static void thread_job_release(ThreadJob *tj) {
+    if (tj == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&tj->gate.lock);
+    int refs = --tj->refs;
+    pthread_mutex_unlock(&tj->gate.lock);
+    if (refs > 0) {
+        return;
+    }
+
+    for (int i = 0; tj->argv != NULL && i < tj->argc; i++) {
+        free(tj->argv[i]);
+    }
+    free(tj->argv);
+    if (tj->ctx.cancel_fd >= 0) close(tj->ctx.cancel_fd);
+    if (tj->done_fd >= 0) close(tj->done_fd);
+    if (tj->ctx.cwd_fd >= 0) close(tj->ctx.cwd_fd);
+    pthread_cond_destroy(&tj->gate.resume);
+    pthread_mutex_destroy(&tj->gate.lock);
+    free(tj);
+}
+
+/**
+ * thread_job_main - Pool task: run the tool, record its status
+ */
+static void thread_job_main(void *arg) {
+    ThreadJob *tj = arg;
+    
+    // Let the shell announce the job before the tool's first output
+    pthread_mutex_lock(&tj->gate.lock);
+    while (!tj->started) {
+        pthread_cond_wait(&tj->gate.resume, &tj->gate.lock);
+    }
+    // jobctl settings made before the tool started apply now
+    tj->tid = (pid_t)syscall(SYS_gettid);
+    jobsched_get(0, &tj->saved);
+    if (!jobsched_empty(&tj->sched)) {
+        jobsched_apply_task(0, &tj->sched);
+    }
+    pthread_mutex_unlock(&tj->gate.lock);
+    
+    int status = tj->tool(&tj->ctx, tj->argc, tj->argv);
+
+    fflush(tj->ctx.out);
+    if (tj->ctx.in != stdin) fclose(tj->ctx.in);
+    if (tj->ctx.out != stdout) fclose(tj->ctx.out);
+    if (tj->ctx.err != stderr) fclose(tj->ctx.err);
+
+    pthread_mutex_lock(&tj->gate.lock);
+    tj->status = tj->cancel ? 128 + tj->cancel_signal : status;
+    tj->finished = 1;
+    // The worker goes back to the pool with the pool's settings
+    if (!jobsched_empty(&tj->sched)) {
+        jobsched_apply_task(0, &tj->saved);
+    }
+    pthread_mutex_unlock(&tj->gate.lock);
+
+    uint64_t one = 1;
+    ssize_t ignored = write(tj->done_fd, &one, sizeof(one));
+    (void)ignored;
+
+    // Same path as SIGCHLD: the prompt announces the finished job
+    child_exited = 1;
+    eventloop_wake();
+    thread_job_release(tj);
+}
+
+static void thread_job_cancel(ThreadJob *tj, int sig) {
+    pthread_mutex_lock(&tj->gate.lock);
+    if (!tj->cancel && !tj->finished) {
+        tj->cancel_signal = sig;
+        __atomic_store_n(&tj->cancel, 1, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&tj->gate.resume);
+        uint64_t one = 1;
+        ssize_t ignored = write(tj->ctx.cancel_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+    pthread_mutex_unlock(&tj->gate.lock);
+}
+
+static void thread_job_pause(ThreadJob *tj, int paused) {
+    pthread_mutex_lock(&tj->gate.lock);
+    __atomic_store_n(&tj->gate.paused, paused, __ATOMIC_RELEASE);
+    if (!paused) {
+        pthread_cond_broadcast(&tj->gate.resume);
+    }
+    pthread_mutex_unlock(&tj->gate.lock);
+}
+
+/* A cancelled job ends like a process killed by the same signal */
+static JobStatus thread_job_state(ThreadJob *tj, int *exit_status, int *term_signal) {
+    pthread_mutex_lock(&tj->gate.lock);
+    JobStatus state = tj->finished ? JOB_DONE : tj->gate.paused ? JOB_STOPPED : JOB_RUNNING;
+    *exit_status = tj->status;
+    *term_signal = tj->finished && tj->cancel ? tj->cancel_signal : 0;
+    pthread_mutex_unlock(&tj->gate.lock);
+    return state;
+}
+
+/**
+ * job_slot_new - Claim the next job slot (jobs_mutex held)
+ * 
+ * Returns: Initialised job, or NULL if the job list is full
+ */
+static Job* job_slot_new(const char *cmd, int bg) {
+    if (g_job_list.count >= MAX_JOBS) {
+        fprintf(stderr, "jobs: job list full (max %d jobs)\n", MAX_JOBS);
+        return NULL;
+    }
+
+    /* The table only grows, so Job pointers stay valid until jobs_remove */
+    if (g_job_list.count == g_job_list.capacity) {
+        int cap = g_job_list.capacity ? g_job_list.capacity * 2 : JOBS_INITIAL_SLOTS;
+        if (cap > MAX_JOBS) {
+            cap = MAX_JOBS;
+        }
+        Job *grown = mem_realloc(MEM_JOBS, g_job_list.jobs, cap * sizeof(Job));
+        if (grown == NULL) {
+            fprintf(stderr, "jobs: out of memory\n");
+            return NULL;
+        }
+        g_job_list.jobs = grown;
+        g_job_list.capacity = cap;
+    }
+
+    size_t len = strnlen(cmd, MAX_CMD_LEN - 1);
+    char *command = mem_malloc(MEM_JOBS, len + 1);
+    if (command == NULL) {
+        fprintf(stderr, "jobs: out of memory\n");
+        return NULL;
+    }
+    memcpy(command, cmd, len);
+    command[len] = '\0';
+
+    Job *job = &g_job_list.jobs[g_job_list.count++];
+    memset(job, 0, sizeof(Job));
+    job->job_id = g_next_job_id++;
+    job->command = command;
+    job->status = JOB_RUNNING;
+    job->background = bg;
+    job->notified = JOB_RUNNING;
+    return job;
+}
+
 /* ============================================================================
  * Public API Implementation
  * ============================================================================ */
@@ -97,7 +305,7 @@ static int find_job_index_by_pid(pid_t pid) {
  * Should be called once during shell startup.
  */
 void jobs_init(void) {
-    /* Zero out the entire job list structure */
+    /* Zero out the entire job list structure (slots come with the first job) */
     memset(&g_job_list, 0, sizeof(JobList));
     
     /* Reset job counter */
@@ -122,13 +330,6 @@ void jobs_init(void) {
 int jobs_add(pid_t pid, const char *cmd, int bg) {
     pthread_mutex_lock(&jobs_mutex);
     
-    /* Check if job list is full */
-    if (g_job_list.count >= MAX_JOBS) {
-        fprintf(stderr, "jobs: job list full (max %d jobs)\n", MAX_JOBS);
-        pthread_mutex_unlock(&jobs_mutex);
-        return -1;
-    }
-    
     /* Validate inputs */
     if (pid <= 0) {
         fprintf(stderr, "jobs: invalid PID %d\n", pid);
@@ -142,33 +343,432 @@ int jobs_add(pid_t pid, const char *cmd, int bg) {
         return -1;
     }
     
-    /* Get pointer to next available job slot */
-    Job *job = &g_job_list.jobs[g_job_list.count];
-    
-    /* Assign job ID (sequential) */
-    job->job_id = g_next_job_id++;
+    /* Claim the next slot (job ID, command, running status) */
+    Job *job = job_slot_new(cmd, bg);
+    if (job == NULL) {
+        pthread_mutex_unlock(&jobs_mutex);
+        return -1;
+    }
     
     /* Set process ID */
     job->pid = pid;
     
-    /* Copy command string (truncate if too long) */
-    strncpy(job->command, cmd, MAX_CMD_LEN - 1);
-    job->command[MAX_CMD_LEN - 1] = '\0';  /* Ensure null termination */
-    
-    /* Initialize status to running */
-    job->status = JOB_RUNNING;
-    
-    /* Set background flag */
-    job->background = bg;
-    
-    /* Increment job count */
-    g_job_list.count++;
-    
     int job_id = job->job_id;
     pthread_mutex_unlock(&jobs_mutex);
     return job_id;
 }
 
+/**
+ * stray_helper_add - Keep a helper to reap later (jobs_mutex held)
+ */
+static void stray_helper_add(pid_t pid) {
+    if (g_stray_count == g_stray_cap) {
+        int cap = g_stray_cap ? g_stray_cap * 2 : 16;
+        pid_t *grown = realloc(g_stray_helpers, cap * sizeof(pid_t));
+        if (grown == NULL) {
+            return;  /* Left as a zombie until the shell exits */
+        }
+        g_stray_helpers = grown;
+        g_stray_cap = cap;
+    }
+    g_stray_helpers[g_stray_count++] = pid;
+}
+
+/**
+ * reap_helpers - Collect finished helpers, compacting the array
+ * 
+ * Returns: Number of helpers still running
+ */
+static int reap_helpers(pid_t *pids, int count) {
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        if (waitpid(pids[i], NULL, WNOHANG) == 0) {
+            pids[kept++] = pids[i];
+        }
+    }
+    return kept;
+}
+
+/**
+ * jobs_add_helper - Attach a process substitution helper to a job
+ */
+void jobs_add_helper(int job_id, pid_t pid) {
+    pthread_mutex_lock(&jobs_mutex);
+    int index = find_job_index(job_id);
+    if (index >= 0 && g_job_list.jobs[index].helper_count < MAX_JOB_HELPERS) {
+        Job *job = &g_job_list.jobs[index];
+        job->helpers[job->helper_count++] = pid;
+    } else {
+        stray_helper_add(pid);
+    }
+    pthread_mutex_unlock(&jobs_mutex);
+}
+
+/**
+ * jobs_add_thread - Start a tool on the worker pool as a background job
+ * 
+ * @param tool: Tool to run
+ * @param argv: NULL-terminated arguments (copied)
+ * @param in, out, err: Streams handed to the tool
+ * @param cmd: Command string for the job list
+ * 
+ * Returns: Job ID, or -1 if the tool could not be started
+ */
+int jobs_add_thread(tool_func tool, char **argv, FILE *in, FILE *out, FILE *err,
+                    const char *cmd) {
+    ThreadPool *pool = thread_pool_shared();
+    if (pool == NULL || tool == NULL || argv == NULL || cmd == NULL) {
+        return -1;
+    }
+
+    ThreadJob *tj = calloc(1, sizeof(ThreadJob));
+    if (tj == NULL) {
+        return -1;
+    }
+    while (argv[tj->argc] != NULL) {
+        tj->argc++;
+    }
+    tj->argv = calloc(tj->argc + 1, sizeof(char *));
+    for (int i = 0; tj->argv != NULL && i < tj->argc; i++) {
+        tj->argv[i] = strdup(argv[i]);
+    }
+    pthread_mutex_init(&tj->gate.lock, NULL);
+    pthread_cond_init(&tj->gate.resume, NULL);
+    tj->tool = tool;
+    tj->refs = 2;   /* Job table and worker */
+    jobsched_init(&tj->sched);
+    tj->done_fd = eventfd(0, EFD_CLOEXEC);
+
+    // The job keeps the directory it started in, whatever the shell does next
+    tool_ctx_init(&tj->ctx, NULL);
+    tj->ctx.in = in;
+    tj->ctx.out = out;
+    tj->ctx.err = err;
+    tj->ctx.cwd_fd = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    tj->ctx.cancel = &tj->cancel;
+    tj->ctx.cancel_fd = eventfd(0, EFD_CLOEXEC);
+    tj->ctx.gate = &tj->gate;
+
+    if (tj->argv == NULL || tj->done_fd < 0 || tj->ctx.cancel_fd < 0 || tj->ctx.cwd_fd < 0) {
+        tj->refs = 1;
+        thread_job_release(tj);
+        return -1;
+    }
+
+    pthread_mutex_lock(&jobs_mutex);
+    Job *job = job_slot_new(cmd, 1);
+    if (job == NULL) {
+        pthread_mutex_unlock(&jobs_mutex);
+        tj->refs = 1;
+        thread_job_release(tj);
+        return -1;
+    }
+    job->thread = tj;
+    int job_id = job->job_id;
+
+    if (thread_pool_try_run(pool, thread_job_main, tj) < 0) {
+        // Every worker is busy: give the slot back, the caller forks
+        g_job_list.count--;
+        mem_free(MEM_JOBS, job->command);
+        g_next_job_id--;
+        pthread_mutex_unlock(&jobs_mutex);
+        tj->refs = 1;
+        thread_job_release(tj);
+        return -1;
+    }
+    pthread_mutex_unlock(&jobs_mutex);
+    
+    fflush(stdout);
+    printf("[%d] thread\n", job_id);
+    fflush(stdout);
+    pthread_mutex_lock(&tj->gate.lock);
+    tj->started = 1;
+    pthread_cond_broadcast(&tj->gate.resume);
+    pthread_mutex_unlock(&tj->gate.lock);
+    return job_id;
+}
+
+/**
+ * jobs_signal - Send a signal to a process job or act on a thread job
+ * 
+ * @param job_id: Job to signal
+ * @param sig: Signal number
+ * 
+ * Returns: 0 on success, -1 on error (errno set)
+ */
+int jobs_signal(int job_id, int sig) {
+    pthread_mutex_lock(&jobs_mutex);
+    int index = find_job_index(job_id);
+    if (index < 0) {
+        pthread_mutex_unlock(&jobs_mutex);
+        errno = ESRCH;
+        return -1;
+    }
+    Job *job = &g_job_list.jobs[index];
+    int ret = 0;
+
+    if (job->thread != NULL) {
+        if (sig == SIGSTOP || sig == SIGTSTP || sig == SIGTTIN || sig == SIGTTOU) {
+            thread_job_pause(job->thread, 1);
+        } else if (sig == SIGCONT) {
+            thread_job_pause(job->thread, 0);
+        } else if (sig != 0) {
+            thread_job_cancel(job->thread, sig);
+        }
+        job->status = thread_job_state(job->thread, &job->exit_status, &job->term_signal);
+    } else {
+        /* Whole pipeline: the process group led by the first stage */
+        pid_t pgid = getpgid(job->pid);
+        ret = kill(pgid > 0 ? -pgid : job->pid, sig);
+    }
+
+    pthread_mutex_unlock(&jobs_mutex);
+    return ret;
+}
+
+/**
+ * jobs_sched - Change a job's CPUs, scheduling class, nice or I/O priority
+ * 
+ * Process jobs: every thread in the job's process group. Thread jobs:
+ * the worker running the tool, now or when it starts, until it finishes.
+ */
+int jobs_sched(int job_id, const JobSched *sched) {
+    pthread_mutex_lock(&jobs_mutex);
+    int index = find_job_index(job_id);
+    if (index < 0) {
+        pthread_mutex_unlock(&jobs_mutex);
+        errno = ESRCH;
+        return -1;
+    }
+    Job *job = &g_job_list.jobs[index];
+    int ret = 0;
+
+    if (job->thread != NULL) {
+        ThreadJob *tj = job->thread;
+        pthread_mutex_lock(&tj->gate.lock);
+        jobsched_merge(&tj->sched, sched);
+        if (tj->tid != 0 && !tj->finished) {
+            ret = jobsched_apply_task(tj->tid, sched);
+        }
+        pthread_mutex_unlock(&tj->gate.lock);
+    } else if (job->status == JOB_DONE) {
+        errno = ESRCH;
+        ret = -1;
+    } else {
+        pid_t pgid = getpgid(job->pid);
+        ret = jobsched_apply_pgrp(pgid > 0 ? pgid : job->pid, sched);
+    }
+
+    pthread_mutex_unlock(&jobs_mutex);
+    return ret;
+}
+
+/**
+ * jobs_sched_get - Current settings of a job (its first process or worker)
+ */
+int jobs_sched_get(int job_id, JobSched *sched) {
+    pthread_mutex_lock(&jobs_mutex);
+    int index = find_job_index(job_id);
+    int ret = -1;
+    if (index >= 0) {
+        Job *job = &g_job_list.jobs[index];
+        if (job->thread != NULL) {
+            ThreadJob *tj = job->thread;
+            pthread_mutex_lock(&tj->gate.lock);
+            if (tj->tid != 0 && !tj->finished) {
+                ret = jobsched_get(tj->tid, sched);
+            } else {
+                // Not running: show what it will get
+                *sched = tj->sched;
+                ret = 0;
+            }
+            pthread_mutex_unlock(&tj->gate.lock);
+        } else if (job->status != JOB_DONE) {
+            pid_t pgid = getpgid(job->pid);
+            ret = jobsched_get(pgid > 0 ? pgid : job->pid, sched);
+        }
+    }
+    pthread_mutex_unlock(&jobs_mutex);
+    if (ret < 0 && errno == 0) {
+        errno = ESRCH;
+    }
+    return ret;
+}
+
+/**
+ * jobs_apply_policy - Apply USHELL_BG_POLICY to a new background job
+ */
+void jobs_apply_policy(int job_id, const char *policy) {
+    if (job_id <= 0 || policy == NULL || *policy == '\0') {
+        return;
+    }
+    JobSched sched;
+    jobsched_init(&sched);
+    if (jobsched_parse_string(policy, &sched, "USHELL_BG_POLICY") < 0) {
+        return;
+    }
+    if (!jobsched_empty(&sched) && jobs_sched(job_id, &sched) < 0) {
+        fprintf(stderr, "ushell: USHELL_BG_POLICY: [%d]: %s\n", job_id, strerror(errno));
+    }
+}
+
+/**
+ * thread_job_wait - Wait on a thread job's done_fd, watching Ctrl+C/Ctrl+Z
+ * 
+ * Signals are blocked except inside ppoll(), so a keypress between the
+ * flag checks and the wait is not lost. Signals taken by another thread
+ * (the MCP server) are noticed at the next timeout.
+ */
+static int thread_job_wait(ThreadJob *tj, int foreground) {
+    sigset_t block, orig;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGTSTP);
+    pthread_sigmask(SIG_BLOCK, &block, &orig);
+    sigint_received = 0;
+    sigtstp_received = 0;
+
+    int result;
+    while (1) {
+        if (sigint_received) {
+            sigint_received = 0;
+            if (!foreground) {
+                result = 130;
+                break;
+            }
+            thread_job_cancel(tj, SIGINT);
+        }
+        if (sigtstp_received) {
+            sigtstp_received = 0;
+            if (foreground) {
+                thread_job_pause(tj, 1);
+                result = 128 + SIGTSTP;
+                break;
+            }
+        }
+
+        pthread_mutex_lock(&tj->gate.lock);
+        int finished = tj->finished;
+        result = tj->status;
+        pthread_mutex_unlock(&tj->gate.lock);
+        if (finished) {
+            break;
+        }
+
+        struct pollfd pfd = { .fd = tj->done_fd, .events = POLLIN };
+        struct timespec timeout = { .tv_sec = 0, .tv_nsec = 250 * 1000000L };
+        ppoll(&pfd, 1, &timeout, &orig);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &orig, NULL);
+    return result;
+}
+
+/**
+ * jobs_wait - Wait for a job to finish (or, under fg, to be stopped)
+ * 
+ * @param job_id: Job to wait for
+ * @param foreground: 1 for fg semantics
+ * 
+ * Returns: Exit status, 148 if stopped, 130 if interrupted, -1 if no job
+ */
+int jobs_wait(int job_id, int foreground) {
+    pthread_mutex_lock(&jobs_mutex);
+    int index = find_job_index(job_id);
+    if (index < 0) {
+        pthread_mutex_unlock(&jobs_mutex);
+        return -1;
+    }
+    ThreadJob *tj = g_job_list.jobs[index].thread;
+    pid_t pid = g_job_list.jobs[index].pid;
+    JobStatus status = g_job_list.jobs[index].status;
+    int exit_status = g_job_list.jobs[index].exit_status;
+    if (tj != NULL) {
+        pthread_mutex_lock(&tj->gate.lock);
+        tj->refs++;     /* Keep it while jobs_mutex is dropped */
+        pthread_mutex_unlock(&tj->gate.lock);
+    }
+    pthread_mutex_unlock(&jobs_mutex);
+
+    int result;
+    int term_signal = 0;
+    if (tj != NULL) {
+        result = thread_job_wait(tj, foreground);
+    } else if (status == JOB_DONE) {
+        result = exit_status;
+    } else {
+        int wstatus;
+        pid_t ret;
+        while ((ret = waitpid(pid, &wstatus, 0)) < 0 && errno == EINTR) {
+        }
+        if (ret < 0) {
+            result = 0;     /* Already reaped */
+        } else if (WIFSIGNALED(wstatus)) {
+            term_signal = WTERMSIG(wstatus);
+            result = 128 + term_signal;
+        } else {
+            result = WEXITSTATUS(wstatus);
+        }
+    }
+
+    pthread_mutex_lock(&jobs_mutex);
+    index = find_job_index(job_id);
+    if (index >= 0) {
+        Job *job = &g_job_list.jobs[index];
+        if (tj != NULL) {
+            job->status = thread_job_state(tj, &job->exit_status, &job->term_signal);
+        } else {
+            job->status = JOB_DONE;
+            job->exit_status = result;
+            if (status != JOB_DONE) {
+                job->term_signal = term_signal;
+            }
+        }
+        if (job->status == JOB_DONE) {
+            job->notified = JOB_DONE;   /* The waiter already knows */
+        }
+    }
+    pthread_mutex_unlock(&jobs_mutex);
+    if (tj != NULL) {
+        thread_job_release(tj);
+    }
+    return result;
+}
+
+/**
+ * jobs_shutdown_threads - Cancel or drain thread jobs before exit
+ * 
+ * @param cancel: 1 to cancel running jobs first
+ */
+void jobs_shutdown_threads(int cancel) {
+    int ids[MAX_JOBS];
+    int count = 0;
+    
+    /* In a forked child the workers do not exist, nothing would finish */
+    if (g_thread_pool == NULL || g_thread_pool->owner != getpid()) {
+        return;
+    }
+
+    pthread_mutex_lock(&jobs_mutex);
+    for (int i = 0; i < g_job_list.count; i++) {
+        Job *job = &g_job_list.jobs[i];
+        if (job->thread == NULL) {
+            continue;
+        }
+        if (cancel) {
+            thread_job_cancel(job->thread, SIGHUP);
+        } else {
+            thread_job_pause(job->thread, 0);   /* A stopped job would never end */
+        }
+        ids[count++] = job->job_id;
+    }
+    pthread_mutex_unlock(&jobs_mutex);
+
+    for (int i = 0; i < count; i++) {
+        jobs_wait(ids[i], 0);
+    }
+}
+
 /**
  * jobs_get - Retrieve a job by its job ID
  * 
@@ -250,6 +850,19 @@ int jobs_remove(int job_id) {
         return -1;  /* Job not found */
     }
     
+    /* Drop the job's pipe monitor (its relays finish on their own) */
+    pipe_monitor_release(g_job_list.jobs[index].monitor);
+    
+    /* Drop the table's reference; a running worker keeps its own */
+    thread_job_release(g_job_list.jobs[index].thread);
+    
+    /* Helpers still running are reaped later without the job */
+    for (int i = 0; i < g_job_list.jobs[index].helper_count; i++) {
+        stray_helper_add(g_job_list.jobs[index].helpers[i]);
+    }
+    
+    mem_free(MEM_JOBS, g_job_list.jobs[index].command);
+    
     /* Shift all jobs after this one down by one position */
     for (int i = index; i < g_job_list.count - 1; i++) {
         g_job_list.jobs[i] = g_job_list.jobs[i + 1];
@@ -278,15 +891,24 @@ void jobs_update_status(void) {
     
     pthread_mutex_lock(&jobs_mutex);
     
+    g_stray_count = reap_helpers(g_stray_helpers, g_stray_count);
+    
     /* Iterate through all jobs */
     for (int i = 0; i < g_job_list.count; i++) {
         Job *job = &g_job_list.jobs[i];
+        job->helper_count = reap_helpers(job->helpers, job->helper_count);
         
         /* Skip jobs that are already done */
         if (job->status == JOB_DONE) {
             continue;
         }
         
+        /* Thread jobs report through their own state, not waitpid() */
+        if (job->thread != NULL) {
+            job->status = thread_job_state(job->thread, &job->exit_status, &job->term_signal);
+            continue;
+        }
+        
         /* Check job status without blocking (WNOHANG) */
         result = waitpid(job->pid, &status, WNOHANG | WUNTRACED | WCONTINUED);
         
@@ -304,6 +926,9 @@ void jobs_update_status(void) {
             if (WIFEXITED(status) || WIFSIGNALED(status)) {
                 /* Process has terminated (exited or killed) */
                 job->status = JOB_DONE;
+                job->exit_status = WIFEXITED(status) ? WEXITSTATUS(status)
+                                                     : 128 + WTERMSIG(status);
+                job->term_signal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
             }
             else if (WIFSTOPPED(status)) {
                 /* Process was stopped (Ctrl+Z or SIGSTOP) */
@@ -358,7 +983,7 @@ void jobs_print_all(void) {
                job->job_id,
                marker,
                job->pid,
-               job_status_to_string(job->status),
+               job_state_to_string(job),
                job->background ? "yes" : "no",
                job->command);
     }
@@ -366,6 +991,44 @@ void jobs_print_all(void) {
     pthread_mutex_unlock(&jobs_mutex);
 }
 
+/**
+ * jobs_notify - Announce background jobs that finished or stopped
+ * 
+ * Queues one notice per change since the last call, in the same form
+ * as other shells: "[2]+  Done                    sleep 5 &".
+ * Call after jobs_update_status() and before jobs_cleanup().
+ * 
+ * Returns: Number of notices queued
+ */
+int jobs_notify(void) {
+    int notices = 0;
+    pthread_mutex_lock(&jobs_mutex);
+    
+    for (int i = 0; i < g_job_list.count; i++) {
+        Job *job = &g_job_list.jobs[i];
+        if (job->status == job->notified) {
+            continue;
+        }
+        job->notified = job->status;
+        if (!job->background || job->status == JOB_RUNNING) {
+            continue;
+        }
+        
+        char marker = ' ';
+        if (i == g_job_list.count - 1) {
+            marker = '+';
+        } else if (i == g_job_list.count - 2) {
+            marker = '-';
+        }
+        shell_notice("[%d]%c  %-22s  %s", job->job_id, marker,
+                     job_state_to_string(job), job->command);
+        notices++;
+    }
+    
+    pthread_mutex_unlock(&jobs_mutex);
+    return notices;
+}
+
 /**
  * jobs_count - Get the number of active jobs
  * 
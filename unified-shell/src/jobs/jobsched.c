@@ -0,0 +1,403 @@
+/**
+ * jobsched.c - CPU affinity, scheduling class, nice and I/O priority
+ *
+ * Affinity and scheduling policy are per thread in Linux and have no
+ * process group form, so a group is walked through /proc: every
+ * /proc/PID/stat whose pgrp matches, then every /proc/PID/task/TID.
+ * Nice and I/O priority have group forms (PRIO_PGRP, IOPRIO_WHO_PGRP)
+ * that cover all threads in one call. Children inherit all four, so
+ * whatever the job starts later runs with the same settings.
+ */
+
+#define _GNU_SOURCE // sched_setaffinity, SCHED_BATCH, SCHED_IDLE
+#include "jobsched.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_WHO_PGRP    2
+
+static const struct {
+    const char *name;
+    int policy;
+} sched_names[] = {
+    { "other", SCHED_OTHER },
+    { "batch", SCHED_BATCH },
+    { "idle",  SCHED_IDLE  },
+};
+
+static const char *io_names[] = { "none", "rt", "be", "idle" };
+
+static int ioprio_set(int which, int who, int ioprio) {
+    return (int)syscall(SYS_ioprio_set, which, who, ioprio);
+}
+
+static int ioprio_get(int which, int who) {
+    return (int)syscall(SYS_ioprio_get, which, who);
+}
+
+void jobsched_init(JobSched *s) {
+    memset(s, 0, sizeof(*s));
+    s->policy = -1;
+    s->io_class = -1;
+}
+
+int jobsched_empty(const JobSched *s) {
+    return !s->set_cpus && s->policy < 0 && !s->set_nice && s->io_class < 0;
+}
+
+/**
+ * Parse "2-7", "0,2,4-5": a list of CPUs and ranges
+ */
+static int parse_cpus(const char *list, JobSched *s) {
+    memset(s->cpus, 0, sizeof(s->cpus));
+    const char *p = list;
+    while (*p) {
+        char *end;
+        long lo = strtol(p, &end, 10);
+        long hi = lo;
+        if (end == p || lo < 0) {
+            return -1;
+        }
+        if (*end == '-') {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+            if (end == p || hi < lo) {
+                return -1;
+            }
+        }
+        if (hi >= JOBSCHED_MAX_CPUS || (*end != ',' && *end != '\0')) {
+            return -1;
+        }
+        for (long cpu = lo; cpu <= hi; cpu++) {
+            s->cpus[cpu / 8] |= (unsigned char)(1 << (cpu % 8));
+        }
+        p = *end == ',' ? end + 1 : end;
+    }
+    s->set_cpus = 1;
+    return p == list ? -1 : 0;
+}
+
+/**
+ * Parse "idle", "be", "be:4", "rt:0" or "none"
+ */
+static int parse_ionice(const char *value, JobSched *s) {
+    size_t len = strcspn(value, ":");
+    for (int cls = 0; cls < (int)(sizeof(io_names) / sizeof(io_names[0])); cls++) {
+        if (strlen(io_names[cls]) != len || strncmp(value, io_names[cls], len) != 0) {
+            continue;
+        }
+        s->io_class = cls;
+        s->io_level = 4;  // Kernel default for best-effort
+        if (value[len] == ':') {
+            char *end;
+            long level = strtol(value + len + 1, &end, 10);
+            if (*end != '\0' || end == value + len + 1 || level < 0 || level > 7 ||
+                (cls != JOBSCHED_IO_RT && cls != JOBSCHED_IO_BE)) {
+                return -1;
+            }
+            s->io_level = (int)level;
+        }
+        return 0;
+    }
+    return -1;
+}
+
+int jobsched_parse_option(char **argv, int *i, JobSched *s, const char *who) {
+    const char *opt = argv[*i];
+    const char *value = argv[*i + 1];
+    int ok;
+
+    if (strcmp(opt, "--cpus") == 0) {
+        ok = value != NULL && parse_cpus(value, s) == 0;
+    } else if (strcmp(opt, "--sched") == 0) {
+        ok = 0;
+        for (size_t k = 0; value != NULL && k < sizeof(sched_names) / sizeof(sched_names[0]); k++) {
+            if (strcmp(value, sched_names[k].name) == 0) {
+                s->policy = sched_names[k].policy;
+                ok = 1;
+            }
+        }
+    } else if (strcmp(opt, "--nice") == 0) {
+        char *end = NULL;
+        long nice = value != NULL ? strtol(value, &end, 10) : 0;
+        ok = value != NULL && end != value && *end == '\0' && nice >= -20 && nice <= 19;
+        s->nice = (int)nice;
+        s->set_nice = ok;
+    } else if (strcmp(opt, "--ionice") == 0) {
+        ok = value != NULL && parse_ionice(value, s) == 0;
+    } else {
+        return 0;
+    }
+
+    if (!ok) {
+        if (value == NULL) {
+            fprintf(stderr, "%s: %s: option requires an argument\n", who, opt);
+        } else {
+            fprintf(stderr, "%s: %s: invalid value '%s'\n", who, opt, value);
+        }
+        return -1;
+    }
+    *i += 2;
+    return 1;
+}
+
+int jobsched_parse_string(const char *spec, JobSched *s, const char *who) {
+    char *copy = strdup(spec);
+    char *words[32];
+    int count = 0;
+    if (copy == NULL) {
+        return -1;
+    }
+    for (char *save, *w = strtok_r(copy, " \t", &save);
+         w != NULL && count < 31; w = strtok_r(NULL, " \t", &save)) {
+        words[count++] = w;
+    }
+    words[count] = NULL;
+
+    int ret = 0;
+    for (int i = 0; i < count && ret == 0; ) {
+        int r = jobsched_parse_option(words, &i, s, who);
+        if (r == 0) {
+            fprintf(stderr, "%s: %s: unknown option\n", who, words[i]);
+        }
+        if (r <= 0) {
+            ret = -1;
+        }
+    }
+    free(copy);
+    return ret;
+}
+
+void jobsched_merge(JobSched *to, const JobSched *from) {
+    if (from->set_cpus) {
+        to->set_cpus = 1;
+        memcpy(to->cpus, from->cpus, sizeof(to->cpus));
+    }
+    if (from->policy >= 0) {
+        to->policy = from->policy;
+    }
+    if (from->set_nice) {
+        to->set_nice = 1;
+        to->nice = from->nice;
+    }
+    if (from->io_class >= 0) {
+        to->io_class = from->io_class;
+        to->io_level = from->io_level;
+    }
+}
+
+/**
+ * Affinity and policy of one thread (the per-thread half of a change)
+ */
+static int apply_thread_only(pid_t tid, const JobSched *s) {
+    int ret = 0;
+    int saved_errno = 0;
+    if (s->set_cpus) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu < JOBSCHED_MAX_CPUS && cpu < CPU_SETSIZE; cpu++) {
+            if (s->cpus[cpu / 8] & (1 << (cpu % 8))) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        if (sched_setaffinity(tid, sizeof(set), &set) < 0) {
+            saved_errno = errno;
+            ret = -1;
+        }
+    }
+    if (s->policy >= 0) {
+        struct sched_param param = { .sched_priority = 0 };
+        if (sched_setscheduler(tid, s->policy, &param) < 0 && ret == 0) {
+            saved_errno = errno;
+            ret = -1;
+        }
+    }
+    errno = saved_errno;
+    return ret;
+}
+
+/**
+ * Nice and I/O priority of a thread (IOPRIO_WHO_PROCESS) or a group
+ */
+static int apply_priorities(int prio_which, int io_which, id_t who, const JobSched *s) {
+    int ret = 0;
+    int saved_errno = 0;
+    if (s->set_nice && setpriority(prio_which, who, s->nice) < 0) {
+        saved_errno = errno;
+        ret = -1;
+    }
+    if (s->io_class >= 0) {
+        int level = s->io_class == JOBSCHED_IO_RT || s->io_class == JOBSCHED_IO_BE ? s->io_level : 0;
+        if (ioprio_set(io_which, (int)who, (s->io_class << IOPRIO_CLASS_SHIFT) | level) < 0 &&
+            ret == 0) {
+            saved_errno = errno;
+            ret = -1;
+        }
+    }
+    errno = saved_errno;
+    return ret;
+}
+
+int jobsched_apply_task(pid_t tid, const JobSched *s) {
+    if (tid == 0) {
+        tid = (pid_t)syscall(SYS_gettid);
+    }
+    int ret = apply_thread_only(tid, s);
+    int saved_errno = errno;
+    if (apply_priorities(PRIO_PROCESS, IOPRIO_WHO_PROCESS, (id_t)tid, s) < 0 && ret == 0) {
+        return -1;
+    }
+    errno = saved_errno;
+    return ret;
+}
+
+/**
+ * Process group of a /proc/PID/stat line (field 5, after "(comm)")
+ */
+static pid_t stat_pgrp(const char *pid_dir) {
+    char path[PATH_MAX];
+    char buf[512];
+    snprintf(path, sizeof(path), "/proc/%s/stat", pid_dir);
+    FILE *f = fopen(path, "re");
+    if (f == NULL) {
+        return -1;
+    }
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    char *close_paren = strrchr(buf, ')');
+    int ppid, pgrp;
+    char state;
+    if (close_paren == NULL || sscanf(close_paren + 1, " %c %d %d", &state, &ppid, &pgrp) != 3) {
+        return -1;
+    }
+    return (pid_t)pgrp;
+}
+
+int jobsched_apply_pgrp(pid_t pgid, const JobSched *s) {
+    int ret = 0;
+    int saved_errno = 0;
+    int found = 0;
+
+    if (s->set_cpus || s->policy >= 0) {
+        DIR *proc = opendir("/proc");
+        struct dirent *ent;
+        while (proc != NULL && (ent = readdir(proc)) != NULL) {
+            if (!isdigit((unsigned char)ent->d_name[0]) || stat_pgrp(ent->d_name) != pgid) {
+                continue;
+            }
+            found = 1;
+            char path[PATH_MAX];
+            snprintf(path, sizeof(path), "/proc/%s/task", ent->d_name);
+            DIR *tasks = opendir(path);
+            struct dirent *task;
+            while (tasks != NULL && (task = readdir(tasks)) != NULL) {
+                if (isdigit((unsigned char)task->d_name[0]) &&
+                    apply_thread_only((pid_t)atoi(task->d_name), s) < 0 && ret == 0) {
+                    saved_errno = errno;
+                    ret = -1;
+                }
+            }
+            if (tasks != NULL) {
+                closedir(tasks);
+            }
+        }
+        if (proc != NULL) {
+            closedir(proc);
+        }
+        if (!found) {
+            errno = ESRCH;
+            return -1;
+        }
+    }
+
+    if (apply_priorities(PRIO_PGRP, IOPRIO_WHO_PGRP, (id_t)pgid, s) < 0 && ret == 0) {
+        return -1;
+    }
+    errno = saved_errno;
+    return ret;
+}
+
+int jobsched_get(pid_t tid, JobSched *s) {
+    cpu_set_t set;
+    jobsched_init(s);
+    if (sched_getaffinity(tid, sizeof(set), &set) < 0) {
+        return -1;
+    }
+    s->set_cpus = 1;
+    for (int cpu = 0; cpu < JOBSCHED_MAX_CPUS && cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+            s->cpus[cpu / 8] |= (unsigned char)(1 << (cpu % 8));
+        }
+    }
+    if ((s->policy = sched_getscheduler(tid)) < 0) {
+        return -1;
+    }
+    if (tid == 0) {
+        tid = (pid_t)syscall(SYS_gettid);
+    }
+    errno = 0;
+    s->nice = getpriority(PRIO_PROCESS, (id_t)tid);
+    if (errno != 0) {
+        return -1;
+    }
+    s->set_nice = 1;
+    int ioprio = ioprio_get(IOPRIO_WHO_PROCESS, tid);
+    if (ioprio < 0) {
+        return -1;
+    }
+    s->io_class = ioprio >> IOPRIO_CLASS_SHIFT;
+    s->io_level = ioprio & ((1 << IOPRIO_CLASS_SHIFT) - 1);
+    return 0;
+}
+
+void jobsched_print(FILE *out, const JobSched *s) {
+    const char *sep = "";
+    if (s->set_cpus) {
+        fprintf(out, "cpus ");
+        int first = 1;
+        for (int cpu = 0; cpu < JOBSCHED_MAX_CPUS; cpu++) {
+            if (!(s->cpus[cpu / 8] & (1 << (cpu % 8)))) {
+                continue;
+            }
+            int last = cpu;
+            while (last + 1 < JOBSCHED_MAX_CPUS && (s->cpus[(last + 1) / 8] & (1 << ((last + 1) % 8)))) {
+                last++;
+            }
+            fprintf(out, last > cpu ? "%s%d-%d" : "%s%d", first ? "" : ",", cpu, last);
+            first = 0;
+            cpu = last;
+        }
+        sep = "  ";
+    }
+    if (s->policy >= 0) {
+        const char *name = "other";
+        for (size_t k = 0; k < sizeof(sched_names) / sizeof(sched_names[0]); k++) {
+            if (sched_names[k].policy == s->policy) {
+                name = sched_names[k].name;
+            }
+        }
+        fprintf(out, "%ssched %s", sep, name);
+        sep = "  ";
+    }
+    if (s->set_nice) {
+        fprintf(out, "%snice %d", sep, s->nice);
+        sep = "  ";
+    }
+    if (s->io_class >= 0 && s->io_class <= JOBSCHED_IO_IDLE) {
+        fprintf(out, "%sionice %s", sep, io_names[s->io_class]);
+        if (s->io_class == JOBSCHED_IO_RT || s->io_class == JOBSCHED_IO_BE) {
+            fprintf(out, ":%d", s->io_level);
+        }
+    }
+}
@@ -1,5 +1,6 @@
 #include "signals.h"
 #include "jobs.h"
+#include "eventloop.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -13,6 +14,30 @@
  */
 volatile sig_atomic_t child_exited = 0;
 
+/**
+ * Global flag indicating Ctrl+C was pressed with no foreground child
+ * Set by SIGINT handler, checked by in-process tools that block
+ */
+volatile sig_atomic_t sigint_received = 0;
+
+/**
+ * Global flag indicating Ctrl+C was forwarded to the foreground job
+ * Set by the SIGINT handler, checked by the script executor's loops
+ */
+volatile sig_atomic_t foreground_interrupted = 0;
+
+/**
+ * Global flag indicating Ctrl+Z was pressed with no foreground child
+ * Set by SIGTSTP handler, checked while a thread job is in the foreground
+ */
+volatile sig_atomic_t sigtstp_received = 0;
+
+/**
+ * Global flag indicating the terminal was resized
+ * Set by SIGWINCH handler, checked by the event loop
+ */
+volatile sig_atomic_t window_resized = 0;
+
 /**
  * Current foreground job PID
  * 0 = shell is in foreground, no job running
@@ -41,6 +66,7 @@ void sigchld_handler(int sig) {
     // Set flag to notify main loop
     // This is async-signal-safe (just setting a flag)
     child_exited = 1;
+    eventloop_wake();  // write(2) to an eventfd, also async-signal-safe
     
     // Restore errno
     errno = saved_errno;
@@ -66,8 +92,11 @@ void sigtstp_handler(int sig) {
         // Send to the entire process group (negative PID)
         // This ensures all processes in a pipeline receive the signal
         kill(-foreground_job_pid, SIGTSTP);
+    } else {
+        // No child to stop: a thread job brought back with fg pauses instead
+        sigtstp_received = 1;
+        eventloop_wake();
     }
-    // If foreground_job_pid == 0, shell is in foreground, ignore signal
     
     errno = saved_errno;
 }
@@ -92,15 +121,34 @@ void sigint_handler(int sig) {
         // Send to the entire process group (negative PID)
         // This ensures all processes in a pipeline receive the signal
         kill(-foreground_job_pid, SIGINT);
+        foreground_interrupted = 1;
     } else {
         // No foreground job - just print newline and continue
         // Use write() as it's async-signal-safe (printf is not)
+        sigint_received = 1;
         write(STDOUT_FILENO, "\n", 1);
+        eventloop_wake();
     }
     
     errno = saved_errno;
 }
 
+/**
+ * sigwinch_handler - Handle terminal resize (SIGWINCH)
+ * 
+ * Normally the event loop receives SIGWINCH through its signalfd; this
+ * handler covers the time between prompts and signals delivered to
+ * another thread.
+ */
+void sigwinch_handler(int sig) {
+    (void)sig;  // Unused
+    
+    int saved_errno = errno;
+    window_resized = 1;
+    eventloop_wake();
+    errno = saved_errno;
+}
+
 /**
  * setup_signal_handlers - Configure all signal handlers for job control
  * 
@@ -108,6 +156,7 @@ void sigint_handler(int sig) {
  * - SIGINT (Ctrl+C): Interrupt foreground job
  * - SIGTSTP (Ctrl+Z): Stop foreground job  
  * - SIGCHLD: Detect child process state changes
+ * - SIGWINCH: Terminal resized
  * - SIGTTOU: Ignore (prevents background job from stopping on terminal output)
  * - SIGTTIN: Ignore (prevents background job from stopping on terminal input)
  * 
@@ -146,6 +195,15 @@ void setup_signal_handlers(void) {
         exit(1);
     }
     
+    // Set up SIGWINCH handler (terminal resized)
+    sa.sa_handler = sigwinch_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    if (sigaction(SIGWINCH, &sa, NULL) < 0) {
+        perror("sigaction(SIGWINCH)");
+        exit(1);
+    }
+    
     // Ignore SIGTTOU - background jobs writing to terminal shouldn't stop
     signal(SIGTTOU, SIG_IGN);
     
@@ -29,14 +29,21 @@
 #include <unistd.h>
 #include <limits.h>
 #include <signal.h>
+#include <errno.h>
 #include "shell.h"
 #include "environment.h"
 #include "expansion.h"
 #include "executor.h"
+#include "script.h"
+#include "script_cache.h"
+#include "profile.h"
 #include "conditional.h"
 #include "history.h"
+#include "readbuf.h"
 #include "completion.h"
 #include "terminal.h"
+#include "eventloop.h"
+#include "builtins.h"
 #include "apt.h"
 #include "jobs.h"
 #include "signals.h"
@@ -82,6 +89,10 @@ void cleanup_shell(void) {
         g_mcp_server = NULL;
     }
     
+    // Thread jobs end with the shell: cancelled when the user exits an
+    // interactive session, run to completion at the end of a script
+    jobs_shutdown_threads(eventloop_active());
+    
     // Destroy thread pool if it was created
     if (g_thread_pool != NULL) {
         thread_pool_destroy(g_thread_pool);
@@ -94,6 +105,20 @@ void cleanup_shell(void) {
     }
 }
 
+/**
+ * reap_jobs - Collect job status changes
+ * 
+ * Runs between commands and, in interactive sessions, from the event
+ * loop as soon as SIGCHLD arrives while the prompt is showing.
+ */
+static void reap_jobs(void) {
+    jobs_update_status();
+    if (eventloop_active()) {
+        jobs_notify();  // "[1]+  Done  sleep 5 &" above the prompt
+    }
+    jobs_cleanup();
+}
+
 /**
  * get_shell_state_json - Gather current shell state as JSON for AI context
  * 
@@ -493,42 +518,8 @@ int execute_ai_suggestion(char *cmd) {
     // Add original command to history before execution
     history_add(cmd);
     
-    // Expand variables (e.g., $HOME, $USER)
-    expand_variables_inplace(line, shell_env, MAX_LINE);
-    
-    // Parse and execute conditionals (if/then/else)
-    char *condition = NULL;
-    char *then_block = NULL;
-    char *else_block = NULL;
-    
-    int is_conditional = parse_conditional(line, &condition, &then_block, &else_block);
-    
-    if (is_conditional == 1) {
-        // Execute conditional statement
-        int status = execute_conditional(condition, then_block, else_block, shell_env);
-        free(condition);
-        free(then_block);
-        free(else_block);
-        return status;
-    } else if (is_conditional == 0) {
-        // Execute pipeline or simple command
-        Command *commands = NULL;
-        int count = 0;
-        
-        if (parse_pipeline(line, &commands, &count) < 0) {
-            fprintf(stderr, "ushell: parse error in AI suggestion\n");
-            return -1;
-        }
-        
-        if (count > 0 && commands != NULL) {
-            int status = execute_pipeline(commands, count, shell_env);
-            free_pipeline(commands, count);
-            return status;
-        }
-    }
-    
-    // Parse error or invalid command
-    return -1;
+    // Expand, parse and execute through the same path as typed input
+    return execute_line(line, shell_env);
 }
 
 /**
@@ -698,8 +689,14 @@ const char* get_prompt(void) {
  * 
  * Special flags:
  *   --commands-json: Print JSON catalog and exit (for AI helper)
+ *   --profile: Time every script line; print a report at exit
+ *   --profile-folded FILE: Also write folded stacks for flame graphs
+ *   -c STRING [NAME ARG...]: Run STRING instead of reading commands
+ *   SCRIPT [ARG...]: Run a script file
+ * In the batch forms the final simple command is exec'd in place of the
+ * shell when no background jobs remain (saves a fork per invocation).
  * 
- * Returns: 0 on normal exit
+ * Returns: 0 on normal exit, the script's status in batch mode
  */
 int main(int argc, char **argv) {
     // Check for --commands-json flag before initialization
@@ -710,8 +707,33 @@ int main(int argc, char **argv) {
         builtin_commands(cmd_argv, NULL);
         return 0;
     }
+
+    const char *batch_text = NULL;     // -c STRING
+    const char *batch_script = NULL;   // SCRIPT
+    char **batch_argv = NULL;          // $0 followed by $1..
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--profile") == 0) {
+            profile_start(NULL);
+        } else if (strcmp(argv[i], "--profile-folded") == 0 && i + 1 < argc) {
+            profile_start(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            batch_text = argv[i + 1];
+            batch_argv = argv + i + 2;   // Optional NAME ARG...
+            break;
+        } else if (argv[i][0] != '-') {
+            batch_script = argv[i];
+            batch_argv = argv + i;
+            break;
+        } else {
+            fprintf(stderr, "ushell: unknown option: %s\n", argv[i]);
+            fprintf(stderr, "Usage: ushell [--profile] [--profile-folded FILE] [--commands-json]\n"
+                            "              [-c STRING [NAME ARG...] | SCRIPT [ARG...]]\n");
+            return 2;
+        }
+    }
     
     char line[MAX_LINE];
+    int input_lines = 0;    // Lines read so far (profiler line numbers)
     
     // ===== Initialization Phase =====
     
@@ -722,20 +744,9 @@ int main(int argc, char **argv) {
     // Check environment variable USHELL_THREAD_BUILTINS and USHELL_THREAD_POOL_SIZE
     char *thread_builtins = getenv("USHELL_THREAD_BUILTINS");
     if (thread_builtins != NULL && strcmp(thread_builtins, "1") == 0) {
-        // Get thread pool size from environment, default to 4
-        int pool_size = 4;
-        char *pool_size_str = getenv("USHELL_THREAD_POOL_SIZE");
-        if (pool_size_str != NULL) {
-            int parsed_size = atoi(pool_size_str);
-            if (parsed_size > 0 && parsed_size <= 32) {
-                pool_size = parsed_size;
-            }
-        }
-        
-        // Create thread pool with specified size and queue capacity (2x pool size)
-        g_thread_pool = thread_pool_create(pool_size, pool_size * 2);
-        if (g_thread_pool != NULL) {
-            fprintf(stderr, "[Threading enabled: %d worker threads]\n", pool_size);
+        // USHELL_THREAD_POOL_SIZE workers (default 4), queue capacity 2x
+        if (thread_pool_shared() != NULL) {
+            fprintf(stderr, "[Threading enabled: %d worker threads]\n", g_thread_pool->num_threads);
         } else {
             fprintf(stderr, "[Warning: Failed to create thread pool, threading disabled]\n");
         }
@@ -793,6 +804,9 @@ int main(int argc, char **argv) {
     // Initialize tab completion with access to environment variables
     completion_init(shell_env);
     
+    // Remember whether stdin carries commands, so read shares its buffer
+    readbuf_init();
+    
     // Initialize job control system for tracking background processes
     // Sets up job list with capacity for MAX_JOBS concurrent jobs
     jobs_init();
@@ -816,6 +830,50 @@ int main(int argc, char **argv) {
     // - Completion: TAB key completes commands and filenames
     terminal_set_history_callbacks(history_get_prev, history_get_next);
     terminal_set_completion_callback(completion_generate);
+    terminal_set_picker_callback(myfzf_pick);
+    
+    // ===== Batch Mode =====
+    // ushell -c STRING / ushell SCRIPT: run, then exit with its status.
+    // The last command may exec in place of the shell when nothing needs
+    // the shell afterwards (no MCP server, no profile report to print).
+    if (batch_text != NULL || batch_script != NULL) {
+        int status = SCRIPT_OK;
+        ScriptUnit *unit;
+        if (batch_text != NULL) {
+            script_set_input_position("-c", 1);
+            unit = script_parse(batch_text, &status);
+        } else {
+            unit = script_cache_load(batch_script, &status);
+            if (status == SCRIPT_CACHE_IO_ERROR) {
+                fprintf(stderr, "ushell: %s: %s\n", batch_script, strerror(errno));
+                return 127;
+            }
+        }
+        if (unit == NULL || status != SCRIPT_OK) {
+            fprintf(stderr, "ushell: %s: syntax error\n",
+                    batch_script != NULL ? batch_script : "-c");
+            script_release(unit);
+            return 2;
+        }
+
+        script_set_tail_exec(g_mcp_server == NULL && !profile_enabled);
+        status = script_execute_source(unit, shell_env,
+                                       batch_argv[0] != NULL ? batch_argv : NULL);
+        script_set_tail_exec(0);
+        script_release(unit);
+        fflush(stdout);
+        return status;
+    }
+
+    // Interactive sessions wait for keys in the event loop, which also
+    // reports finished background jobs and MCP messages above the prompt
+    if (isatty(STDIN_FILENO) && eventloop_init() == 0) {
+        eventloop_set_child_handler(reap_jobs);
+        eventloop_set_display_callbacks(terminal_print_above, terminal_refresh);
+    }
+    
+    // Commands piped in stop at a failed ${var:?message} like a script
+    script_set_abort_exits(!isatty(STDIN_FILENO));
     
     // ===== REPL Loop =====
     
@@ -825,14 +883,10 @@ int main(int argc, char **argv) {
         if (child_exited) {
             child_exited = 0;  // Reset flag
             
-            // Update all job statuses (non-blocking waitpid calls)
-            // This will detect which jobs have completed
-            jobs_update_status();
-            
-            // Note: Completed jobs are automatically cleaned up by jobs_cleanup()
-            // For now, we don't print individual completion messages
-            // Users can use 'jobs' builtin to check status
-            jobs_cleanup();
+            // Update all job statuses (non-blocking waitpid calls),
+            // announce finished background jobs (interactive only) and
+            // drop them from the list
+            reap_jobs();
         }
         
         // Reset history navigation position for new command
@@ -852,6 +906,7 @@ int main(int argc, char **argv) {
             printf("\n");
             break;  // Exit shell gracefully
         }
+        int first_line = ++input_lines;
         
         // Copy input to local buffer (input is dynamically allocated)
         strncpy(line, input, MAX_LINE - 1);
@@ -897,66 +952,38 @@ int main(int argc, char **argv) {
             continue;
         }
         
+        // Unterminated if/for/while/case/function bodies and quotes
+        // continue on the following lines (secondary "> " prompt)
+        char *command = strdup(line);
+        while (command != NULL && script_is_incomplete(command)) {
+            char *more = terminal_readline("> ");
+            if (more == NULL) {
+                break;
+            }
+            input_lines++;
+            char *joined = malloc(strlen(command) + strlen(more) + 2);
+            if (joined != NULL) {
+                sprintf(joined, "%s\n%s", command, more);
+            }
+            free(command);
+            free(more);
+            command = joined;
+        }
+        if (command == NULL) {
+            continue;
+        }
+        
         // Add non-empty command to history
         // This makes it available for UP arrow recall
-        history_add(line);
+        history_add(command);
         
-        // ===== EXPAND Phase =====
-        // Replace $variable references with their values
+        // ===== PARSE / EXPAND / EXECUTE Phases =====
+        // Parse the text into commands and control flow, then run it;
+        // $variable references are expanded as each command runs
         // Example: "echo $name" -> "echo Alice"
-        expand_variables_inplace(line, shell_env, MAX_LINE);
-        
-        // ===== PARSE Phase =====
-        // Determine command type and parse accordingly
-        
-        // First, check if it's a conditional statement (if/then/else/fi)
-        char *condition = NULL;
-        char *then_block = NULL;
-        char *else_block = NULL;
-        
-        int is_conditional = parse_conditional(line, &condition, &then_block, &else_block);
-        
-        if (is_conditional == 1) {
-            // ===== EXECUTE Phase (Conditional) =====
-            // Execute if/then/else logic
-            // - Evaluate condition
-            // - Run then_block if true, else_block if false
-            int status = execute_conditional(condition, then_block, else_block, shell_env);
-            last_exit_status = status;
-            
-            // Free dynamically allocated conditional parts
-            free(condition);
-            free(then_block);
-            free(else_block);
-        } else if (is_conditional == 0) {
-            // ===== EXECUTE Phase (Pipeline/Simple Command) =====
-            // Not a conditional - treat as pipeline or simple command
-            // Examples:
-            //   ls -la                    (simple command)
-            //   cat file.txt | grep test  (pipeline)
-            //   ls > output.txt           (with redirection)
-            
-            Command *commands = NULL;
-            int count = 0;
-            
-            // Parse input into command structures
-            if (parse_pipeline(line, &commands, &count) < 0) {
-                fprintf(stderr, "ushell: parse error\n");
-                continue;
-            }
-            
-            // Execute parsed commands
-            if (count > 0 && commands != NULL) {
-                int status = execute_pipeline(commands, count, shell_env);
-                last_exit_status = status;
-                if (status == -1) {
-                    fprintf(stderr, "ushell: execution failed\n");
-                }
-                // Free command structures
-                free_pipeline(commands, count);
-            }
-        }
-        // Note: is_conditional == -1 means parse error (already reported by parser)
+        script_set_input_position("stdin", first_line);
+        execute_line(command, shell_env);
+        free(command);
     }
     
     // Cleanup handled by atexit(cleanup_shell)
@@ -11,6 +11,8 @@
  */
 
 #include "mcp_exec.h"
+#include "tools.h"
+#include "memstats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -224,6 +226,72 @@ int mcp_exec_sanitize_arg(const char *input, char *output, size_t output_size) {
     return 0;
 }
 
+/*
+ * mcp_exec_copy_output - Copy up to MCP_MAX_OUTPUT - 1 bytes into a
+ * MEM_MCP buffer sized to the data (NULL src gives "")
+ */
+static char *mcp_exec_copy_output(const char *src, size_t len) {
+    if (src == NULL) {
+        len = 0;
+    } else if (len >= MCP_MAX_OUTPUT) {
+        len = MCP_MAX_OUTPUT - 1;
+    }
+    char *copy = mem_malloc(MEM_MCP, len + 1);
+    if (copy) {
+        if (len > 0) {
+            memcpy(copy, src, len);
+        }
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+/*
+ * mcp_exec_read_output - Read fd to EOF into a MEM_MCP buffer
+ *
+ * The buffer starts small and doubles as output arrives, so quiet commands
+ * cost a few hundred bytes instead of MCP_MAX_OUTPUT. Output beyond
+ * MCP_MAX_OUTPUT - 1 bytes is drained and dropped.
+ */
+static char *mcp_exec_read_output(int fd) {
+    size_t cap = 256, len = 0;
+    char *buf = mem_malloc(MEM_MCP, cap);
+    char discard[4096];
+    ssize_t n;
+
+    if (buf == NULL) {
+        return NULL;
+    }
+    for (;;) {
+        if (len + 1 == cap && cap < MCP_MAX_OUTPUT) {
+            size_t grown_cap = cap * 2 > MCP_MAX_OUTPUT ? MCP_MAX_OUTPUT : cap * 2;
+            char *grown = mem_realloc(MEM_MCP, buf, grown_cap);
+            if (grown == NULL) {
+                break;
+            }
+            buf = grown;
+            cap = grown_cap;
+        }
+        if (len + 1 < cap) {
+            n = read(fd, buf + len, cap - len - 1);
+        } else {
+            n = read(fd, discard, sizeof(discard));
+            if (n > 0) {
+                continue;
+            }
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        len += n;
+    }
+    buf[len] = '\0';
+    return buf;
+}
+
 /*
  * mcp_exec_free_result - Free resources in MCPExecResult
  */
@@ -232,13 +300,94 @@ void mcp_exec_free_result(MCPExecResult *result) {
         return;
     }
     
-    free(result->stdout_data);
-    free(result->stderr_data);
+    mem_free(MEM_MCP, result->stdout_data);
+    mem_free(MEM_MCP, result->stderr_data);
     
     result->stdout_data = NULL;
     result->stderr_data = NULL;
 }
 
+/*
+ * mcp_exec_timeout - Timer callback: ask an in-process tool to stop
+ */
+static void mcp_exec_timeout(union sigval sv) {
+    volatile sig_atomic_t *cancel = sv.sival_ptr;
+    *cancel = 1;
+}
+
+/*
+ * mcp_exec_tool - Run an integrated tool in-process on the client's thread
+ * 
+ * Output is captured in memory streams and relative paths resolve against
+ * the shell's directory. Each call has its own tool_ctx, so tools called
+ * by concurrent clients do not share state. The timeout sets the context's
+ * cancel flag instead of relying on RLIMIT_CPU.
+ */
+static int mcp_exec_tool(tool_func tool, const char *command, char **args, Env *env,
+                         MCPExecResult *result) {
+    char *out_data = NULL, *err_data = NULL;
+    size_t out_len = 0, err_len = 0;
+    FILE *in = fopen("/dev/null", "r");
+    FILE *out = open_memstream(&out_data, &out_len);
+    FILE *err = open_memstream(&err_data, &err_len);
+    if (in == NULL || out == NULL || err == NULL) {
+        if (in) fclose(in);
+        if (out) fclose(out);
+        if (err) fclose(err);
+        free(out_data);
+        free(err_data);
+        return -1;
+    }
+
+    volatile sig_atomic_t cancel = 0;
+    tool_ctx ctx = {
+        .in = in, .out = out, .err = err,
+        .cwd_fd = AT_FDCWD, .env = env,
+        .cancel = &cancel, .cancel_fd = -1,
+    };
+
+    /* Same limit as the forked path */
+    timer_t timer;
+    struct sigevent sev = { .sigev_notify = SIGEV_THREAD };
+    sev.sigev_notify_function = mcp_exec_timeout;
+    sev.sigev_value.sival_ptr = (void *)&cancel;
+    int have_timer = timer_create(CLOCK_MONOTONIC, &sev, &timer) == 0;
+    if (have_timer) {
+        struct itimerspec its = { .it_value = { .tv_sec = MCP_EXEC_TIMEOUT } };
+        timer_settime(timer, 0, &its, NULL);
+    }
+
+    char *argv[MCP_MAX_ARGS + 2];
+    argv[0] = (char *)command;
+    int argc = 1;
+    for (int i = 0; args && args[i] && i < MCP_MAX_ARGS; i++) {
+        argv[argc++] = args[i];
+    }
+    argv[argc] = NULL;
+
+    result->exit_code = tool(&ctx, argc, argv);
+
+    if (have_timer) {
+        timer_delete(timer);
+    }
+    result->timed_out = cancel != 0;
+    fclose(in);
+    fclose(out);
+    fclose(err);
+
+    /* Same output cap and allocator as the pipe reader */
+    result->stdout_data = mcp_exec_copy_output(out_data, out_len);
+    result->stderr_data = mcp_exec_copy_output(err_data, err_len);
+    free(out_data);
+    free(err_data);
+
+    mcp_exec_log_command("localhost", command,
+                        args && args[0] ? args[0] : "",
+                        result->exit_code,
+                        result->exit_code == 0 ? "success" : "failed");
+    return 0;
+}
+
 /*
  * mcp_exec_command - Execute a shell command safely
  * 
@@ -248,8 +397,6 @@ void mcp_exec_free_result(MCPExecResult *result) {
  * - Better output capture
  */
 int mcp_exec_command(const char *command, char **args, Env *env, MCPExecResult *result) {
-    (void)env;  /* Will be used for environment variables in full implementation */
-    
     if (!command || !result) {
         return -1;
     }
@@ -265,6 +412,12 @@ int mcp_exec_command(const char *command, char **args, Env *env, MCPExecResult *
         return -1;
     }
     
+    /* Integrated tools have no binary to exec; run them in-process */
+    tool_func tool = find_tool(command);
+    if (tool != NULL) {
+        return mcp_exec_tool(tool, command, args, env, result);
+    }
+    
     /* Create pipes for stdout and stderr */
     int stdout_pipe[2];
     int stderr_pipe[2];
@@ -350,28 +503,9 @@ int mcp_exec_command(const char *command, char **args, Env *env, MCPExecResult *
     close(stdout_pipe[1]);
     close(stderr_pipe[1]);
     
-    /* Read stdout */
-    char stdout_buffer[MCP_MAX_OUTPUT];
-    ssize_t stdout_bytes = 0;
-    ssize_t n;
-    
-    while (stdout_bytes < MCP_MAX_OUTPUT - 1 &&
-           (n = read(stdout_pipe[0], stdout_buffer + stdout_bytes, 
-                    MCP_MAX_OUTPUT - stdout_bytes - 1)) > 0) {
-        stdout_bytes += n;
-    }
-    stdout_buffer[stdout_bytes] = '\0';
-    
-    /* Read stderr */
-    char stderr_buffer[MCP_MAX_OUTPUT];
-    ssize_t stderr_bytes = 0;
-    
-    while (stderr_bytes < MCP_MAX_OUTPUT - 1 &&
-           (n = read(stderr_pipe[0], stderr_buffer + stderr_bytes,
-                    MCP_MAX_OUTPUT - stderr_bytes - 1)) > 0) {
-        stderr_bytes += n;
-    }
-    stderr_buffer[stderr_bytes] = '\0';
+    /* Read stdout, then stderr */
+    char *stdout_buffer = mcp_exec_read_output(stdout_pipe[0]);
+    char *stderr_buffer = mcp_exec_read_output(stderr_pipe[0]);
     
     /* Close read ends */
     close(stdout_pipe[0]);
@@ -383,8 +517,8 @@ int mcp_exec_command(const char *command, char **args, Env *env, MCPExecResult *
     
     if (wait_result < 0) {
         /* Wait failed */
-        close(stdout_pipe[0]);
-        close(stderr_pipe[0]);
+        mem_free(MEM_MCP, stdout_buffer);
+        mem_free(MEM_MCP, stderr_buffer);
         return -1;
     }
     
@@ -398,9 +532,9 @@ int mcp_exec_command(const char *command, char **args, Env *env, MCPExecResult *
         }
     }
     
-    /* Allocate and copy output */
-    result->stdout_data = strdup(stdout_buffer);
-    result->stderr_data = strdup(stderr_buffer);
+    /* Hand the output buffers to the result */
+    result->stdout_data = stdout_buffer;
+    result->stderr_data = stderr_buffer;
     
     /* Log to audit log */
     mcp_exec_log_command("localhost", command, 
@@ -9,6 +9,8 @@
 #include "mcp_json.h"
 #include "mcp_tools.h"
 #include "mcp_exec.h"
+#include "eventloop.h"
+#include "memstats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -252,6 +254,53 @@ int mcp_recv_message(int client_fd, char *buffer, size_t bufsize) {
     return (int)total;
 }
 
+/*
+ * mcp_recv_line - mcp_recv_message into a MEM_MCP buffer that grows
+ *
+ * *buffer (capacity *cap) doubles whenever it fills, up to MCP_BUFFER_SIZE,
+ * so idle clients hold MCP_INITIAL_BUFFER bytes rather than the maximum.
+ * A request that reaches MCP_BUFFER_SIZE - 1 bytes is returned truncated,
+ * as mcp_recv_message does, for the caller's size check.
+ */
+static int mcp_recv_line(int client_fd, char **buffer, size_t *cap) {
+    size_t total = 0;
+    
+    for (;;) {
+        if (total + 1 >= *cap) {
+            if (*cap >= MCP_BUFFER_SIZE) {
+                break;
+            }
+            size_t grown_cap = *cap * 2 > MCP_BUFFER_SIZE ? MCP_BUFFER_SIZE : *cap * 2;
+            char *grown = mem_realloc(MEM_MCP, *buffer, grown_cap);
+            if (grown == NULL) {
+                return -1;
+            }
+            *buffer = grown;
+            *cap = grown_cap;
+        }
+        
+        char c;
+        ssize_t n = read(client_fd, &c, 1);
+        
+        if (n < 0) {
+            return -1;
+        } else if (n == 0) {
+            if (total == 0) {
+                return 0;
+            }
+            break;
+        }
+        if (c == '\n') {
+            break;
+        }
+        
+        (*buffer)[total++] = c;
+    }
+    
+    (*buffer)[total] = '\0';
+    return (int)total;
+}
+
 /*
  * mcp_parse_request - Parse JSON request into MCPRequest structure
  */
@@ -589,18 +638,31 @@ int mcp_handle_call_tool(int client_fd, MCPRequest *req, Env *env) {
     
     /* Build result with output */
     /* Escape output for JSON */
-    char escaped_output[MCP_MAX_OUTPUT];
+    /* Sized to the output (escaping at most doubles it), capped as before */
+    size_t out_len = exec_result.stdout_data ? strlen(exec_result.stdout_data) : 0;
+    size_t escaped_size = out_len * 2 + 1 < MCP_MAX_OUTPUT ? out_len * 2 + 1 : MCP_MAX_OUTPUT;
+    char *escaped_output = mem_malloc(MEM_MCP, escaped_size);
+    if (escaped_output == NULL) {
+        mcp_exec_free_result(&exec_result);
+        return -1;
+    }
+    escaped_output[0] = '\0';
     if (exec_result.stdout_data) {
-        mcp_json_escape(exec_result.stdout_data, escaped_output, sizeof(escaped_output));
-    } else {
-        escaped_output[0] = '\0';
+        mcp_json_escape(exec_result.stdout_data, escaped_output, escaped_size);
     }
     
     /* Build JSON result */
-    char result_json[MCP_MAX_OUTPUT + 256];
-    snprintf(result_json, sizeof(result_json),
+    size_t result_size = strlen(escaped_output) + strlen(tool_name) + 256;
+    char *result_json = mem_malloc(MEM_MCP, result_size);
+    if (result_json == NULL) {
+        mem_free(MEM_MCP, escaped_output);
+        mcp_exec_free_result(&exec_result);
+        return -1;
+    }
+    snprintf(result_json, result_size,
              "{\"tool\":\"%s\",\"output\":\"%s\",\"exit_code\":%d}",
              tool_name, escaped_output, exec_result.exit_code);
+    mem_free(MEM_MCP, escaped_output);
     
     /* Send response */
     MCPResponse resp = {
@@ -616,6 +678,7 @@ int mcp_handle_call_tool(int client_fd, MCPRequest *req, Env *env) {
     }
     
     /* Clean up */
+    mem_free(MEM_MCP, result_json);
     mcp_exec_free_result(&exec_result);
     
     /* Send completion notification */
@@ -834,7 +897,12 @@ void* mcp_client_handler(void *arg) {
     MCPServerConfig *config = handler_arg->config;
     Env *env = config->env;
     
-    char buffer[MCP_BUFFER_SIZE];
+    /* Grown by mcp_recv_line up to MCP_BUFFER_SIZE as requests need */
+    size_t buffer_cap = MCP_INITIAL_BUFFER;
+    char *buffer = mem_malloc(MEM_MCP, buffer_cap);
+    if (buffer == NULL) {
+        fprintf(stderr, "MCP Server: Out of memory for client buffer\n");
+    }
     
     /* Set socket timeout for idle connections */
     struct timeval tv;
@@ -843,8 +911,8 @@ void* mcp_client_handler(void *arg) {
     setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
     
     /* Read-handle-respond loop */
-    while (config->running) {
-        int n = mcp_recv_message(client_fd, buffer, sizeof(buffer));
+    while (buffer && config->running) {
+        int n = mcp_recv_line(client_fd, &buffer, &buffer_cap);
         
         if (n < 0) {
             /* Error reading (timeout or actual error) */
@@ -882,6 +950,7 @@ void* mcp_client_handler(void *arg) {
     
     /* Close client socket and free arguments */
     close(client_fd);
+    mem_free(MEM_MCP, buffer);
     free(handler_arg);
     
     return NULL;
@@ -937,7 +1006,7 @@ void* mcp_server_thread(void *arg) {
         config->active_clients++;
         pthread_mutex_unlock(&config->lock);
         
-        printf("MCP Server: Accepted connection from %s (clients: %d/%d)\n", 
+        shell_notice("MCP Server: Accepted connection from %s (clients: %d/%d)\n", 
                inet_ntoa(client_addr.sin_addr),
                config->active_clients,
                MCP_MAX_CLIENTS);
@@ -1036,7 +1105,7 @@ int mcp_server_start(MCPServerConfig *config) {
         return -1;
     }
     
-    printf("MCP Server: Listening on port %d (max clients: %d)\n", config->port, MCP_MAX_CLIENTS);
+    shell_notice("MCP Server: Listening on port %d (max clients: %d)\n", config->port, MCP_MAX_CLIENTS);
     
     return 0;
 }
@@ -1063,5 +1132,5 @@ void mcp_server_stop(MCPServerConfig *config) {
     
     config->enabled = 0;
     
-    printf("MCP Server: Stopped\n");
+    shell_notice("MCP Server: Stopped\n");
 }
@@ -7,6 +7,7 @@
 
 #include "mcp_tools.h"
 #include "mcp_json.h"
+#include "registry.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -203,8 +204,11 @@ char* mcp_tools_load_catalog(const char *catalog_path) {
     char *json_data = read_file_contents(catalog_path);
     if (!json_data) {
         fprintf(stderr, "MCP Tools: Failed to read catalog from %s\n", catalog_path);
-        /* Return minimal fallback catalog */
-        return strdup("{\"tools\":[{\"name\":\"pwd\",\"description\":\"Print working directory\",\"inputSchema\":{\"type\":\"object\",\"properties\":{}}}]}");
+        /* Fall back to the catalog compiled in from commands.def */
+        json_data = strdup(registry_json);
+        if (!json_data) {
+            return NULL;
+        }
     }
     
     /* Allocate large buffer for building MCP tools JSON */
@@ -0,0 +1,305 @@
+/**
+ * gen_registry.c - Build-time generator for registry_gen.c
+ *
+ * Compiled and run by the Makefile (gen_registry > registry_gen.c). It
+ * includes commands.def, searches displacement seeds for a collision-free
+ * (perfect) hash over the command names, and writes the tables together
+ * with the pre-rendered completion list, help lines and catalogs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "registry.h"
+
+typedef struct {
+    RegistryKind kind;
+    const char *name;
+    const char *func;       // Function identifier, or "NONE"
+    const char *usage;
+    const char *summary;
+    const char *description;
+} Def;
+
+#define COMMAND(kind, name, func, usage, summary, description) \
+    { kind, name, #func, usage, summary, description },
+static const Def defs[] = {
+#include "commands.def"
+};
+#undef COMMAND
+
+#define NDEFS ((int)(sizeof(defs) / sizeof(defs[0])))
+
+static uint32_t slot_mask;
+static uint32_t bucket_mask;
+static int16_t *slots;
+static uint16_t *displace;
+
+/* ---------------------------------------------------------------------
+ * Perfect hash (hash-and-displace)
+ * --------------------------------------------------------------------- */
+
+static int bucket_of(int i) {
+    return (int)(registry_hash(0, defs[i].name) & bucket_mask);
+}
+
+/**
+ * Try to place every bucket; buckets with the most keys go first
+ * @return 1 on success, 0 if some bucket found no displacement
+ */
+static int build_hash(uint32_t nslots, uint32_t nbuckets) {
+    slot_mask = nslots - 1;
+    bucket_mask = nbuckets - 1;
+    free(slots);
+    free(displace);
+    slots = malloc(nslots * sizeof(*slots));
+    displace = calloc(nbuckets, sizeof(*displace));
+    int *order = malloc(nbuckets * sizeof(int));
+    int *size = calloc(nbuckets, sizeof(int));
+    if (slots == NULL || displace == NULL || order == NULL || size == NULL) {
+        fprintf(stderr, "gen_registry: out of memory\n");
+        exit(1);
+    }
+    for (uint32_t s = 0; s < nslots; s++) slots[s] = -1;
+    for (int i = 0; i < NDEFS; i++) size[bucket_of(i)]++;
+    for (uint32_t b = 0; b < nbuckets; b++) order[b] = (int)b;
+    for (uint32_t a = 0; a < nbuckets; a++) {
+        for (uint32_t b = a + 1; b < nbuckets; b++) {
+            if (size[order[b]] > size[order[a]]) {
+                int t = order[a]; order[a] = order[b]; order[b] = t;
+            }
+        }
+    }
+
+    int ok = 1;
+    for (uint32_t k = 0; k < nbuckets && ok; k++) {
+        int b = order[k];
+        if (size[b] == 0) break;
+
+        int members[NDEFS], count = 0;
+        for (int i = 0; i < NDEFS; i++) {
+            if (bucket_of(i) == b) members[count++] = i;
+        }
+
+        ok = 0;
+        for (uint32_t d = 1; d < 65536 && !ok; d++) {
+            uint32_t taken[NDEFS];
+            int fits = 1;
+            for (int m = 0; m < count && fits; m++) {
+                uint32_t s = registry_hash(d, defs[members[m]].name) & slot_mask;
+                if (slots[s] >= 0) fits = 0;
+                for (int p = 0; p < m && fits; p++) {
+                    if (taken[p] == s) fits = 0;
+                }
+                taken[m] = s;
+            }
+            if (fits) {
+                for (int m = 0; m < count; m++) slots[taken[m]] = (int16_t)members[m];
+                displace[b] = (uint16_t)d;
+                ok = 1;
+            }
+        }
+    }
+    free(order);
+    free(size);
+    return ok;
+}
+
+/* ---------------------------------------------------------------------
+ * Output helpers
+ * --------------------------------------------------------------------- */
+
+static void put_c_string(const char *s) {
+    putchar('"');
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            printf("\\%c", *s);
+        } else if (*s == '\n') {
+            printf("\\n\"\n    \"");
+        } else {
+            putchar(*s);
+        }
+    }
+    putchar('"');
+}
+
+// Growing text buffer for the pre-rendered listings
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} Text;
+
+static void text_add(Text *t, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void text_add(Text *t, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    if (t->len + (size_t)n + 1 > t->cap) {
+        t->cap = (t->len + (size_t)n + 1) * 2;
+        t->data = realloc(t->data, t->cap);
+        if (t->data == NULL) exit(1);
+    }
+    va_start(ap, fmt);
+    vsnprintf(t->data + t->len, (size_t)n + 1, fmt, ap);
+    va_end(ap);
+    t->len += (size_t)n;
+}
+
+static void text_add_json(Text *t, const char *s) {
+    text_add(t, "\"");
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') text_add(t, "\\%c", *s);
+        else text_add(t, "%c", *s);
+    }
+    text_add(t, "\"");
+}
+
+static int listed(RegistryKind kind) {
+    return kind != REG_ALIAS;
+}
+
+int main(void) {
+    // Check for duplicate names before hashing
+    for (int i = 0; i < NDEFS; i++) {
+        for (int j = i + 1; j < NDEFS; j++) {
+            if (strcmp(defs[i].name, defs[j].name) == 0) {
+                fprintf(stderr, "gen_registry: duplicate command '%s'\n", defs[i].name);
+                return 1;
+            }
+        }
+    }
+
+    uint32_t nslots = 1;
+    while (nslots < (uint32_t)NDEFS) nslots <<= 1;
+    while (!build_hash(nslots, nslots > 4 ? nslots / 4 : 1)) {
+        nslots <<= 1;
+    }
+
+    printf("/* Generated by gen_registry from commands.def - do not edit */\n\n");
+    printf("#include \"registry.h\"\n\n");
+
+    printf("const RegistryEntry registry_entries[] = {\n");
+    static const char *kind_names[] = {
+        "REG_BUILTIN", "REG_JOB", "REG_TOOL", "REG_SUBCMD", "REG_ALIAS"
+    };
+    for (int i = 0; i < NDEFS; i++) {
+        const Def *d = &defs[i];
+        int none = strcmp(d->func, "NONE") == 0;
+        printf("    { ");
+        put_c_string(d->name);
+        printf(", %s, %s, %s,\n      ", kind_names[d->kind],
+               (!none && d->kind != REG_TOOL) ? d->func : "NULL",
+               (!none && d->kind == REG_TOOL) ? d->func : "NULL");
+        put_c_string(d->usage);
+        printf(", ");
+        put_c_string(d->summary);
+        printf(",\n      ");
+        put_c_string(d->description);
+        printf(" },\n");
+    }
+    printf("};\n\n");
+    printf("const int registry_count = %d;\n\n", NDEFS);
+
+    printf("const uint32_t registry_slot_mask = %uu;\n", slot_mask);
+    printf("const uint32_t registry_bucket_mask = %uu;\n\n", bucket_mask);
+    printf("const uint16_t registry_displace[] = {");
+    for (uint32_t b = 0; b <= bucket_mask; b++) {
+        printf("%s%u", b == 0 ? "\n    " : b % 12 ? ", " : ",\n    ", displace[b]);
+    }
+    printf("\n};\n\n");
+    printf("const int16_t registry_slots[] = {");
+    for (uint32_t s = 0; s <= slot_mask; s++) {
+        printf("%s%d", s == 0 ? "\n    " : s % 12 ? ", " : ",\n    ", slots[s]);
+    }
+    printf("\n};\n\n");
+
+    printf("const char *const registry_completion_names[] = {\n");
+    for (int i = 0; i < NDEFS; i++) {
+        if (defs[i].kind != REG_SUBCMD && listed(defs[i].kind)) {
+            printf("    ");
+            put_c_string(defs[i].name);
+            printf(",\n");
+        }
+    }
+    printf("    NULL\n};\n\n");
+
+    // JSON catalog, builtins first, then apt subcommands, then tools
+    static const RegistryKind catalog_order[] = { REG_BUILTIN, REG_JOB, REG_SUBCMD, REG_TOOL };
+    Text json = { 0 };
+    text_add(&json, "{\n  \"commands\": [\n");
+    int first = 1;
+    for (int k = 0; k < 4; k++) {
+        for (int i = 0; i < NDEFS; i++) {
+            const Def *d = &defs[i];
+            if (d->kind != catalog_order[k]) continue;
+            text_add(&json, "%s    {\"name\": ", first ? "" : ",\n");
+            text_add_json(&json, d->name);
+            text_add(&json, ", \"summary\": ");
+            text_add_json(&json, d->summary);
+            text_add(&json, ", \"description\": ");
+            text_add_json(&json, d->description);
+            text_add(&json, ", \"usage\": ");
+            text_add_json(&json, d->usage);
+            text_add(&json, ", \"options\": []}");
+            first = 0;
+        }
+    }
+    text_add(&json, "\n  ]\n}\n");
+    printf("const char registry_json[] =\n    ");
+    put_c_string(json.data);
+    printf(";\n\n");
+
+    // `commands` listing
+    Text text = { 0 };
+    text_add(&text, "Available commands:\n\nBuilt-in Commands:\n");
+    for (int i = 0; i < NDEFS; i++) {
+        if (defs[i].kind == REG_BUILTIN || defs[i].kind == REG_JOB) {
+            text_add(&text, "  %-11s - %s\n", defs[i].name, defs[i].summary);
+        }
+    }
+    text_add(&text, "\nAPT Subcommands:\n");
+    for (int i = 0; i < NDEFS; i++) {
+        if (defs[i].kind == REG_SUBCMD) {
+            text_add(&text, "  %-11s - %s\n", defs[i].name, defs[i].summary);
+        }
+    }
+    text_add(&text, "\nTool Commands:\n");
+    for (int i = 0; i < NDEFS; i++) {
+        if (defs[i].kind == REG_TOOL) {
+            text_add(&text, "  %-11s - %s\n", defs[i].name, defs[i].summary);
+        }
+    }
+    printf("const char registry_text[] =\n    ");
+    put_c_string(text.data);
+    printf(";\n\n");
+
+    // `help` lines, one block per kind; long usages get their own line
+    printf("const char *const registry_help_lines[REG_KIND_COUNT] = {\n");
+    for (int k = 0; k < REG_KIND_COUNT; k++) {
+        Text help = { 0 };
+        text_add(&help, "%s", "");
+        for (int i = 0; i < NDEFS; i++) {
+            const Def *d = &defs[i];
+            if ((int)d->kind != k) continue;
+            if (strlen(d->usage) <= 20) {
+                text_add(&help, "  %-20s %s\n", d->usage, d->summary);
+            } else {
+                text_add(&help, "  %s\n  %-20s %s\n", d->usage, "", d->summary);
+            }
+        }
+        printf("    /* %s */ ", kind_names[k]);
+        put_c_string(help.data);
+        printf(",\n");
+        free(help.data);
+    }
+    printf("};\n");
+
+    free(json.data);
+    free(text.data);
+    free(slots);
+    free(displace);
+    return 0;
+}
@@ -0,0 +1,25 @@
+/**
+ * registry.c - Command registry lookup
+ *
+ * The tables themselves are generated (registry_gen.c); this file only
+ * walks the perfect hash described in registry.h.
+ */
+
+#include <string.h>
+#include "registry.h"
+
+int registry_index(const char *name) {
+    if (name == NULL) return -1;
+
+    uint16_t d = registry_displace[registry_hash(0, name) & registry_bucket_mask];
+    int slot = registry_slots[registry_hash(d, name) & registry_slot_mask];
+    if (slot < 0 || strcmp(registry_entries[slot].name, name) != 0) {
+        return -1;
+    }
+    return slot;
+}
+
+const RegistryEntry *registry_lookup(const char *name) {
+    int i = registry_index(name);
+    return i < 0 ? NULL : &registry_entries[i];
+}
@@ -2,6 +2,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 /**
  * builtin_thread_wrapper - Thread entry point for built-in execution
@@ -141,6 +146,8 @@ BuiltinThreadContext* create_thread_context(builtin_func func, char **argv, Env
     ctx->status = 0;
     ctx->completed = 0;
     ctx->thread_id = 0;
+    ctx->task = NULL;
+    ctx->task_arg = NULL;
     
     /* Initialize mutex for status synchronization */
     if (pthread_mutex_init(&ctx->lock, NULL) != 0) {
@@ -254,60 +261,189 @@ int execute_builtin_threaded(builtin_func func, char **argv, Env *env) {
  * THREAD POOL IMPLEMENTATION
  * ======================================================================== */
 
+static uint64_t pool_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Absolute CLOCK_MONOTONIC deadline ms from now, for pthread_cond_timedwait */
+static struct timespec pool_deadline(int ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+/**
+ * pool_grow_locked - Start one more worker (queue_mutex held)
+ * 
+ * Workers start with signals blocked so Ctrl+C/Ctrl+Z reach the shell.
+ * Every worker added after thread_pool_create counts as grown, whether
+ * for queued work or for a raised minimum.
+ * 
+ * @return: 0 on success, -1 at max_threads or if pthread_create failed
+ */
+static int pool_grow_locked(ThreadPool *pool) {
+    if (pool->num_threads >= pool->max_threads || pool->shutdown) {
+        return -1;
+    }
+    PoolWorker *slot = NULL;
+    for (int i = 0; i < THREAD_POOL_MAX_WORKERS && slot == NULL; i++) {
+        if (pool->workers[i].state == POOL_WORKER_FREE) {
+            slot = &pool->workers[i];
+        }
+    }
+    if (slot == NULL) {
+        return -1;
+    }
+    memset(slot, 0, sizeof(*slot));
+    slot->pool = pool;
+    slot->state = POOL_WORKER_IDLE;
+    slot->since_ns = pool_now_ns();
+
+    sigset_t all_signals, saved_mask;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_BLOCK, &all_signals, &saved_mask);
+    int ret = pthread_create(&slot->thread, NULL, thread_pool_worker, slot);
+    pthread_sigmask(SIG_SETMASK, &saved_mask, NULL);
+    if (ret != 0) {
+        slot->state = POOL_WORKER_FREE;
+        return -1;
+    }
+    pool->num_threads++;
+    pool->grown++;
+    return 0;
+}
+
+/**
+ * pool_should_retire - Whether an idle worker should exit (mutex held)
+ */
+static int pool_should_retire(ThreadPool *pool, int timed_out) {
+    if (pool->shutdown || pool->queue_size > 0) {
+        return 0;
+    }
+    return pool->num_threads > pool->max_threads ||
+           (timed_out && pool->num_threads > pool->min_threads);
+}
+
 /**
  * thread_pool_worker - Worker thread main loop
  * 
  * Each worker thread runs this function. It continuously waits for work,
- * executes tasks, and signals completion until shutdown.
+ * executes tasks, and signals completion until shutdown, or until it has
+ * been idle for idle_timeout_ms while the pool is above min_threads.
  * 
- * @param arg: Pointer to ThreadPool (cast from void*)
+ * @param arg: Pointer to the worker's PoolWorker slot (cast from void*)
  * @return: NULL (pthread convention)
  */
 void* thread_pool_worker(void *arg) {
-    ThreadPool *pool = (ThreadPool *)arg;
+    PoolWorker *self = (PoolWorker *)arg;
     BuiltinThreadContext *ctx;
-    
-    if (pool == NULL) {
+
+    if (self == NULL || self->pool == NULL) {
         return NULL;
     }
-    
+    ThreadPool *pool = self->pool;
+
+    /* Record the kernel thread ID; take the pool's jobctl --pool settings */
+    JobSched sched;
+    pthread_mutex_lock(&pool->queue_mutex);
+    self->tid = (pid_t)syscall(SYS_gettid);
+    sched = pool->sched;
+    pthread_cond_broadcast(&pool->work_done);
+    pthread_mutex_unlock(&pool->queue_mutex);
+    if (!jobsched_empty(&sched)) {
+        jobsched_apply_task(0, &sched);
+    }
+
     while (1) {
         /* Lock mutex to access queue */
         pthread_mutex_lock(&pool->queue_mutex);
-        
-        /* Wait for work or shutdown signal */
+
+        /* Wait for work or shutdown signal; extra workers time out */
+        int timed_out = 0;
         while (pool->queue_size == 0 && !pool->shutdown) {
-            pthread_cond_wait(&pool->work_available, &pool->queue_mutex);
+            if (pool_should_retire(pool, timed_out)) {
+                uint64_t now = pool_now_ns();
+                self->idle_ns += now - self->since_ns;
+                self->state = POOL_WORKER_FREE;
+                pool->num_threads--;
+                pool->shrunk++;
+                pthread_detach(pthread_self());
+                pthread_cond_broadcast(&pool->work_done);
+                pthread_mutex_unlock(&pool->queue_mutex);
+                return NULL;
+            }
+            if (pool->num_threads > pool->min_threads && pool->idle_timeout_ms > 0) {
+                struct timespec deadline = pool_deadline(pool->idle_timeout_ms);
+                timed_out = pthread_cond_timedwait(&pool->work_available, &pool->queue_mutex,
+                                                   &deadline) == ETIMEDOUT;
+            } else {
+                pthread_cond_wait(&pool->work_available, &pool->queue_mutex);
+            }
         }
-        
+
         /* Check for shutdown */
         if (pool->shutdown && pool->queue_size == 0) {
             pthread_mutex_unlock(&pool->queue_mutex);
             break;
         }
-        
+
         /* Dequeue work item (circular queue) */
         ctx = pool->queue[pool->queue_front];
         pool->queue_front = (pool->queue_front + 1) % pool->queue_capacity;
         pool->queue_size--;
-        
+        pool->busy_threads++;
+
+        uint64_t now = pool_now_ns();
+        uint64_t waited = ctx != NULL && ctx->queued_ns != 0 ? now - ctx->queued_ns : 0;
+        self->wait_ns += waited;
+        self->idle_ns += now - self->since_ns;
+        self->since_ns = now;
+        self->state = POOL_WORKER_BUSY;
+
+        /* Work behind this one waits as long: add a worker for it */
+        if (pool->queue_size > 0 && waited >= (uint64_t)pool->grow_wait_ms * 1000000ull) {
+            pool_grow_locked(pool);
+        }
+
         /* Signal that space is available in queue */
         pthread_cond_signal(&pool->work_done);
-        
+
         pthread_mutex_unlock(&pool->queue_mutex);
-        
+
         /* Execute the task */
-        if (ctx != NULL && ctx->func != NULL) {
+        if (ctx != NULL && ctx->task != NULL) {
+            /* Generic task (thread_pool_try_run): the entry is ours to free */
+            ctx->task(ctx->task_arg);
+            pthread_mutex_destroy(&ctx->lock);
+            free(ctx);
+        } else if (ctx != NULL && ctx->func != NULL) {
             int status = ctx->func(ctx->argv, ctx->env);
-            
+
             /* Update context with result */
             pthread_mutex_lock(&ctx->lock);
             ctx->status = status;
             ctx->completed = 1;
             pthread_mutex_unlock(&ctx->lock);
         }
+
+        pthread_mutex_lock(&pool->queue_mutex);
+        now = pool_now_ns();
+        self->busy_ns += now - self->since_ns;
+        self->since_ns = now;
+        self->tasks++;
+        self->state = POOL_WORKER_IDLE;
+        pool->busy_threads--;
+        pthread_mutex_unlock(&pool->queue_mutex);
     }
-    
+
     return NULL;
 }
 
@@ -323,103 +459,96 @@ void* thread_pool_worker(void *arg) {
 ThreadPool* thread_pool_create(int num_threads, int queue_capacity) {
     ThreadPool *pool;
     int i;
-    
-    if (num_threads <= 0 || queue_capacity <= 0) {
+
+    if (num_threads <= 0 || num_threads > THREAD_POOL_MAX_WORKERS || queue_capacity <= 0) {
         fprintf(stderr, "thread_pool_create: invalid parameters\n");
         return NULL;
     }
-    
+
     /* Allocate pool structure */
-    pool = (ThreadPool *)malloc(sizeof(ThreadPool));
+    pool = (ThreadPool *)calloc(1, sizeof(ThreadPool));
     if (pool == NULL) {
         perror("thread_pool_create: malloc failed");
         return NULL;
     }
-    
-    /* Initialize pool fields */
-    pool->num_threads = num_threads;
+
+    /* Initialize pool fields: fixed size until thread_pool_set_limits */
+    pool->num_threads = 0;
+    pool->min_threads = num_threads;
+    pool->max_threads = num_threads;
+    pool->idle_timeout_ms = THREAD_POOL_DEFAULT_IDLE_MS;
+    pool->grow_wait_ms = THREAD_POOL_DEFAULT_GROW_MS;
     pool->queue_capacity = queue_capacity;
-    pool->queue_size = 0;
-    pool->queue_front = 0;
-    pool->queue_rear = 0;
-    pool->shutdown = 0;
-    
-    /* Allocate thread array */
-    pool->threads = (pthread_t *)malloc(num_threads * sizeof(pthread_t));
-    if (pool->threads == NULL) {
-        perror("thread_pool_create: thread array malloc failed");
+    pool->owner = getpid();
+    jobsched_init(&pool->sched);
+
+    /* Allocate worker table (all slots POOL_WORKER_FREE) */
+    pool->workers = (PoolWorker *)calloc(THREAD_POOL_MAX_WORKERS, sizeof(PoolWorker));
+    if (pool->workers == NULL) {
+        perror("thread_pool_create: worker table malloc failed");
         free(pool);
         return NULL;
     }
-    
+
     /* Allocate queue array */
-    pool->queue = (BuiltinThreadContext **)malloc(queue_capacity * sizeof(BuiltinThreadContext *));
+    pool->queue = (BuiltinThreadContext **)calloc(queue_capacity, sizeof(BuiltinThreadContext *));
     if (pool->queue == NULL) {
         perror("thread_pool_create: queue array malloc failed");
-        free(pool->threads);
+        free(pool->workers);
         free(pool);
         return NULL;
     }
-    
-    /* Initialize queue to NULL */
-    for (i = 0; i < queue_capacity; i++) {
-        pool->queue[i] = NULL;
-    }
-    
+
     /* Initialize mutex */
     if (pthread_mutex_init(&pool->queue_mutex, NULL) != 0) {
         perror("thread_pool_create: mutex init failed");
         free(pool->queue);
-        free(pool->threads);
+        free(pool->workers);
         free(pool);
         return NULL;
     }
-    
-    /* Initialize condition variables */
-    if (pthread_cond_init(&pool->work_available, NULL) != 0) {
+
+    /* Initialize condition variables (monotonic: idle and grow timeouts) */
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    if (pthread_cond_init(&pool->work_available, &attr) != 0) {
         perror("thread_pool_create: work_available cond init failed");
+        pthread_condattr_destroy(&attr);
         pthread_mutex_destroy(&pool->queue_mutex);
         free(pool->queue);
-        free(pool->threads);
+        free(pool->workers);
         free(pool);
         return NULL;
     }
-    
-    if (pthread_cond_init(&pool->work_done, NULL) != 0) {
+
+    if (pthread_cond_init(&pool->work_done, &attr) != 0) {
         perror("thread_pool_create: work_done cond init failed");
+        pthread_condattr_destroy(&attr);
         pthread_cond_destroy(&pool->work_available);
         pthread_mutex_destroy(&pool->queue_mutex);
         free(pool->queue);
-        free(pool->threads);
+        free(pool->workers);
         free(pool);
         return NULL;
     }
-    
+    pthread_condattr_destroy(&attr);
+
     /* Create worker threads */
+    pthread_mutex_lock(&pool->queue_mutex);
     for (i = 0; i < num_threads; i++) {
-        if (pthread_create(&pool->threads[i], NULL, thread_pool_worker, pool) != 0) {
+        if (pool_grow_locked(pool) != 0) {
             fprintf(stderr, "thread_pool_create: failed to create worker thread %d\n", i);
-            
-            /* Set shutdown flag and signal workers to exit */
-            pool->shutdown = 1;
-            pthread_cond_broadcast(&pool->work_available);
-            
-            /* Wait for already-created threads to finish */
-            for (int j = 0; j < i; j++) {
-                pthread_join(pool->threads[j], NULL);
-            }
-            
-            /* Clean up */
-            pthread_cond_destroy(&pool->work_done);
-            pthread_cond_destroy(&pool->work_available);
-            pthread_mutex_destroy(&pool->queue_mutex);
-            free(pool->queue);
-            free(pool->threads);
-            free(pool);
+            pthread_mutex_unlock(&pool->queue_mutex);
+
+            /* Stop the workers already created and clean up */
+            thread_pool_destroy(pool);
             return NULL;
         }
     }
-    
+    pool->grown = 0;  /* The initial workers were not added on demand */
+    pthread_mutex_unlock(&pool->queue_mutex);
+
     return pool;
 }
 
@@ -431,40 +560,59 @@ ThreadPool* thread_pool_create(int num_threads, int queue_capacity) {
  * @param pool: Thread pool to destroy
  */
 void thread_pool_destroy(ThreadPool *pool) {
-    int i;
-    
-    if (pool == NULL) {
+    pthread_t live[THREAD_POOL_MAX_WORKERS];
+    int count = 0;
+
+    /* A forked child has the structure but none of the workers */
+    if (pool == NULL || pool->owner != getpid()) {
         return;
     }
-    
-    /* Set shutdown flag */
+
+    /* Set shutdown flag; no worker retires (detaches) after this */
     pthread_mutex_lock(&pool->queue_mutex);
     pool->shutdown = 1;
+    for (int i = 0; i < THREAD_POOL_MAX_WORKERS; i++) {
+        if (pool->workers[i].state != POOL_WORKER_FREE) {
+            live[count++] = pool->workers[i].thread;
+        }
+    }
     pthread_mutex_unlock(&pool->queue_mutex);
-    
+
     /* Wake up all worker threads */
     pthread_cond_broadcast(&pool->work_available);
-    
+
     /* Wait for all threads to finish */
-    for (i = 0; i < pool->num_threads; i++) {
-        pthread_join(pool->threads[i], NULL);
+    for (int i = 0; i < count; i++) {
+        pthread_join(live[i], NULL);
     }
-    
+
     /* Destroy synchronization primitives */
     pthread_cond_destroy(&pool->work_done);
     pthread_cond_destroy(&pool->work_available);
     pthread_mutex_destroy(&pool->queue_mutex);
-    
+
     /* Free memory */
     free(pool->queue);
-    free(pool->threads);
+    free(pool->workers);
     free(pool);
 }
 
+/**
+ * pool_enqueue_locked - Append ctx to the queue (mutex held, not full)
+ */
+static void pool_enqueue_locked(ThreadPool *pool, BuiltinThreadContext *ctx) {
+    ctx->queued_ns = pool_now_ns();
+    pool->queue[pool->queue_rear] = ctx;
+    pool->queue_rear = (pool->queue_rear + 1) % pool->queue_capacity;
+    pool->queue_size++;
+    pthread_cond_signal(&pool->work_available);
+}
+
 /**
  * thread_pool_submit - Submit work to thread pool
  * 
- * Adds task to queue. Blocks if queue is full.
+ * Adds task to queue. Blocks if queue is full, adding a worker each
+ * time the wait reaches grow_wait_ms.
  * 
  * @param pool: Thread pool
  * @param ctx: Thread context to execute
@@ -475,34 +623,287 @@ int thread_pool_submit(ThreadPool *pool, BuiltinThreadContext *ctx) {
         fprintf(stderr, "thread_pool_submit: invalid arguments\n");
         return -1;
     }
-    
+
     pthread_mutex_lock(&pool->queue_mutex);
-    
+
     /* Wait for space in queue if full */
     while (pool->queue_size == pool->queue_capacity && !pool->shutdown) {
-        pthread_cond_wait(&pool->work_done, &pool->queue_mutex);
+        struct timespec deadline = pool_deadline(pool->grow_wait_ms);
+        if (pthread_cond_timedwait(&pool->work_done, &pool->queue_mutex, &deadline) == ETIMEDOUT &&
+            pool->queue_size == pool->queue_capacity) {
+            pool_grow_locked(pool);
+        }
     }
-    
+
     /* Check if shutting down */
     if (pool->shutdown) {
         pthread_mutex_unlock(&pool->queue_mutex);
         fprintf(stderr, "thread_pool_submit: pool is shutting down\n");
         return -1;
     }
-    
+
+    /* No idle worker and the oldest entry has waited too long: add one */
+    if (pool->busy_threads + pool->queue_size >= pool->num_threads && pool->queue_size > 0 &&
+        pool_now_ns() - pool->queue[pool->queue_front]->queued_ns >=
+            (uint64_t)pool->grow_wait_ms * 1000000ull) {
+        pool_grow_locked(pool);
+    }
+
     /* Enqueue work item (circular queue) */
-    pool->queue[pool->queue_rear] = ctx;
-    pool->queue_rear = (pool->queue_rear + 1) % pool->queue_capacity;
-    pool->queue_size++;
-    
-    /* Signal that work is available */
-    pthread_cond_signal(&pool->work_available);
-    
+    pool_enqueue_locked(pool, ctx);
+
+    pthread_mutex_unlock(&pool->queue_mutex);
+
+    return 0;
+}
+
+/**
+ * thread_pool_try_run - Queue a task only if a worker can start it now
+ * 
+ * @param pool: Thread pool
+ * @param task: Function to run on a worker
+ * @param arg: Argument for task
+ * @return: 0 on success, -1 if every worker is busy and none can be added
+ */
+int thread_pool_try_run(ThreadPool *pool, void (*task)(void *arg), void *arg) {
+    if (pool == NULL || task == NULL) {
+        return -1;
+    }
+
+    BuiltinThreadContext *ctx = calloc(1, sizeof(BuiltinThreadContext));
+    if (ctx == NULL) {
+        return -1;
+    }
+    pthread_mutex_init(&ctx->lock, NULL);
+    ctx->task = task;
+    ctx->task_arg = arg;
+
+    pthread_mutex_lock(&pool->queue_mutex);
+
+    /* Entries already queued will take the idle workers first */
+    int idle = pool->busy_threads + pool->queue_size < pool->num_threads;
+    if (!idle && !pool->shutdown && pool->owner == getpid() && pool_grow_locked(pool) == 0) {
+        idle = 1;
+    }
+    if (pool->shutdown || pool->owner != getpid() || !idle ||
+        pool->queue_size == pool->queue_capacity) {
+        pthread_mutex_unlock(&pool->queue_mutex);
+        pthread_mutex_destroy(&ctx->lock);
+        free(ctx);
+        return -1;
+    }
+
+    pool_enqueue_locked(pool, ctx);
+
+    pthread_mutex_unlock(&pool->queue_mutex);
+    return 0;
+}
+
+/* Positive integer from the environment, or fallback */
+static int pool_env_int(const char *name, int fallback, int max) {
+    const char *value = getenv(name);
+    if (value != NULL) {
+        int parsed = atoi(value);
+        if (parsed > 0 && parsed <= max) {
+            return parsed;
+        }
+    }
+    return fallback;
+}
+
+/**
+ * thread_pool_shared - Return g_thread_pool, creating it on first use
+ * 
+ * @return: Thread pool, or NULL on error
+ */
+ThreadPool* thread_pool_shared(void) {
+    if (g_thread_pool == NULL) {
+        int pool_size = pool_env_int("USHELL_THREAD_POOL_SIZE", 4, THREAD_POOL_MAX_WORKERS);
+        int pool_max = pool_env_int("USHELL_THREAD_POOL_MAX", THREAD_POOL_DEFAULT_MAX,
+                                    THREAD_POOL_MAX_WORKERS);
+        int idle_sec = pool_env_int("USHELL_THREAD_POOL_IDLE",
+                                    THREAD_POOL_DEFAULT_IDLE_MS / 1000, 86400);
+        if (pool_max < pool_size) {
+            pool_max = pool_size;
+        }
+        g_thread_pool = thread_pool_create(pool_size, pool_max * 2);
+        thread_pool_set_limits(g_thread_pool, pool_size, pool_max, idle_sec * 1000, -1);
+    }
+    return g_thread_pool;
+}
+
+/**
+ * pool_wait_started_locked - Wait until every live worker has recorded
+ * its kernel thread ID (queue_mutex held)
+ */
+static void pool_wait_started_locked(ThreadPool *pool) {
+    int starting;
+    do {
+        starting = 0;
+        for (int i = 0; i < THREAD_POOL_MAX_WORKERS; i++) {
+            if (pool->workers[i].state != POOL_WORKER_FREE && pool->workers[i].tid == 0) {
+                starting = 1;
+            }
+        }
+        if (starting) {
+            pthread_cond_wait(&pool->work_done, &pool->queue_mutex);
+        }
+    } while (starting);
+}
+
+/**
+ * thread_pool_tids - Kernel thread IDs of the workers
+ * 
+ * Waits for workers that have not recorded their ID yet.
+ * 
+ * @return: Number of IDs stored in tids, or -1 in a forked child
+ */
+int thread_pool_tids(ThreadPool *pool, pid_t *tids, int max) {
+    if (pool == NULL || pool->owner != getpid()) {
+        return -1;
+    }
+    pthread_mutex_lock(&pool->queue_mutex);
+    pool_wait_started_locked(pool);
+    int count = 0;
+    for (int i = 0; i < THREAD_POOL_MAX_WORKERS && count < max; i++) {
+        if (pool->workers[i].state != POOL_WORKER_FREE) {
+            tids[count++] = pool->workers[i].tid;
+        }
+    }
+    pthread_mutex_unlock(&pool->queue_mutex);
+    return count;
+}
+
+/**
+ * thread_pool_set_sched - Apply jobctl settings to all workers, now and later
+ * 
+ * @return: 0 on success, -1 if a worker could not be changed
+ */
+int thread_pool_set_sched(ThreadPool *pool, const JobSched *sched) {
+    pid_t tids[THREAD_POOL_MAX_WORKERS];
+    if (pool == NULL || pool->owner != getpid()) {
+        errno = ESRCH;
+        return -1;
+    }
+    pthread_mutex_lock(&pool->queue_mutex);
+    jobsched_merge(&pool->sched, sched);
+    pthread_mutex_unlock(&pool->queue_mutex);
+
+    int count = thread_pool_tids(pool, tids, THREAD_POOL_MAX_WORKERS);
+    int ret = 0;
+    int saved_errno = 0;
+    for (int i = 0; i < count; i++) {
+        if (jobsched_apply_task(tids[i], sched) < 0 && ret == 0) {
+            saved_errno = errno;
+            ret = -1;
+        }
+    }
+    errno = saved_errno;
+    return ret;
+}
+
+/**
+ * thread_pool_set_limits - Change min/max workers and the timeouts
+ * 
+ * @return: 0 on success, -1 if the values are out of range
+ */
+int thread_pool_set_limits(ThreadPool *pool, int min, int max, int idle_timeout_ms,
+                           int grow_wait_ms) {
+    if (pool == NULL || pool->owner != getpid()) {
+        return -1;
+    }
+    pthread_mutex_lock(&pool->queue_mutex);
+    int new_min = min >= 0 ? min : pool->min_threads;
+    int new_max = max >= 0 ? max : pool->max_threads;
+    if (new_min < 1 || new_max < new_min || new_max > THREAD_POOL_MAX_WORKERS) {
+        pthread_mutex_unlock(&pool->queue_mutex);
+        return -1;
+    }
+    pool->min_threads = new_min;
+    pool->max_threads = new_max;
+    if (idle_timeout_ms >= 0) {
+        pool->idle_timeout_ms = idle_timeout_ms;
+    }
+    if (grow_wait_ms >= 0) {
+        pool->grow_wait_ms = grow_wait_ms;
+    }
+    while (pool->num_threads < pool->min_threads && pool_grow_locked(pool) == 0) {
+        ;
+    }
+    /* Idle workers re-check their limits (and restart their timeout) */
+    pthread_cond_broadcast(&pool->work_available);
     pthread_mutex_unlock(&pool->queue_mutex);
-    
     return 0;
 }
 
+/**
+ * thread_pool_stats - Copy pool figures and live worker counters
+ * 
+ * With workers, first waits for workers that have not recorded their ID.
+ * 
+ * @return: Number of workers stored, or -1 in a forked child
+ */
+int thread_pool_stats(ThreadPool *pool, ThreadPoolStats *stats, PoolWorker *workers, int max) {
+    if (pool == NULL || pool->owner != getpid()) {
+        return -1;
+    }
+    pthread_mutex_lock(&pool->queue_mutex);
+    /* Workers still starting have no TID to report yet */
+    if (workers != NULL) {
+        pool_wait_started_locked(pool);
+    }
+    stats->num_threads = pool->num_threads;
+    stats->min_threads = pool->min_threads;
+    stats->max_threads = pool->max_threads;
+    stats->busy_threads = pool->busy_threads;
+    stats->queue_size = pool->queue_size;
+    stats->queue_capacity = pool->queue_capacity;
+    stats->idle_timeout_ms = pool->idle_timeout_ms;
+    stats->grow_wait_ms = pool->grow_wait_ms;
+    stats->grown = pool->grown;
+    stats->shrunk = pool->shrunk;
+
+    uint64_t now = pool_now_ns();
+    int count = 0;
+    for (int i = 0; i < THREAD_POOL_MAX_WORKERS && workers != NULL && count < max; i++) {
+        PoolWorker *w = &pool->workers[i];
+        if (w->state == POOL_WORKER_FREE) {
+            continue;
+        }
+        workers[count] = *w;
+        /* Count the period in progress */
+        if (w->state == POOL_WORKER_BUSY) {
+            workers[count].busy_ns += now - w->since_ns;
+        } else {
+            workers[count].idle_ns += now - w->since_ns;
+        }
+        workers[count].since_ns = now;
+        count++;
+    }
+    pthread_mutex_unlock(&pool->queue_mutex);
+    return count;
+}
+
+/**
+ * thread_pool_reset_stats - Start the counters over
+ */
+void thread_pool_reset_stats(ThreadPool *pool) {
+    if (pool == NULL || pool->owner != getpid()) {
+        return;
+    }
+    pthread_mutex_lock(&pool->queue_mutex);
+    uint64_t now = pool_now_ns();
+    for (int i = 0; i < THREAD_POOL_MAX_WORKERS; i++) {
+        PoolWorker *w = &pool->workers[i];
+        w->tasks = 0;
+        w->busy_ns = w->idle_ns = w->wait_ns = 0;
+        w->since_ns = now;
+    }
+    pool->grown = 0;
+    pool->shrunk = 0;
+    pthread_mutex_unlock(&pool->queue_mutex);
+}
+
 /**
  * thread_pool_wait - Wait for all pending tasks to complete
  * 
@@ -514,13 +915,13 @@ void thread_pool_wait(ThreadPool *pool) {
     if (pool == NULL) {
         return;
     }
-    
+
     pthread_mutex_lock(&pool->queue_mutex);
-    
+
     /* Wait until queue is empty */
     while (pool->queue_size > 0) {
         pthread_cond_wait(&pool->work_done, &pool->queue_mutex);
     }
-    
+
     pthread_mutex_unlock(&pool->queue_mutex);
 }
@@ -21,75 +21,88 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
+#include "tools.h"
 
-// --- Forward Declaration ---
-void display_file(const char *path);
+// --- Forward Declarations ---
+void display_file(tool_ctx *ctx, const char *path);
+static void copy_stream(tool_ctx *ctx, FILE *file, const char *path);
 
 // --- Main Function ---
-int tool_mycat_main(int argc, char **argv) {
+int tool_mycat_main(tool_ctx *ctx, int argc, char **argv) {
     // If no arguments are given, mycat should do nothing and exit.
     if (argc < 2) {
         return 0;
     }
 
     // --- Core Logic ---
-    // Process each file path provided as an argument
-    for (int i = 1; i < argc; i++) {
-        display_file(argv[i]);
+    // Process each file path provided as an argument ("-" is the input stream)
+    for (int i = 1; i < argc && !tool_cancelled(ctx); i++) {
+        if (strcmp(argv[i], "-") == 0) {
+            copy_stream(ctx, ctx->in, "-");
+        } else {
+            display_file(ctx, argv[i]);
+        }
     }
 
     return 0;
 }
 
 /**
- * @brief Reads a file and prints its contents to standard output.
+ * @brief Reads a file and prints its contents to the output stream.
  * Handles errors for non-existent files, directories, and permissions.
  *
  * @param path The path of the file to be displayed.
  */
-void display_file(const char *path) {
-    struct stat path_stat;
-
-    // First, check if the path exists and what type it is.
-    // stat() will set errno if the file doesn't exist.
-    if (stat(path, &path_stat) != 0) {
-        fprintf(stderr, "mycat: '%s': %s\n", path, strerror(errno));
+void display_file(tool_ctx *ctx, const char *path) {
+    // Open first, then check the type on the descriptor so the two
+    // cannot refer to different files
+    int fd = tool_open(ctx, path, O_RDONLY, 0);
+    if (fd < 0) {
+        // This will catch errors like a missing file or permission denied (EACCES)
+        fprintf(ctx->err, "mycat: '%s': %s\n", path, strerror(errno));
         return;
     }
 
-    // Check if the path is a directory
-    if (S_ISDIR(path_stat.st_mode)) {
-        fprintf(stderr, "mycat: '%s': Is a directory\n", path);
+    struct stat path_stat;
+    if (fstat(fd, &path_stat) == 0 && S_ISDIR(path_stat.st_mode)) {
+        fprintf(ctx->err, "mycat: '%s': Is a directory\n", path);
+        close(fd);
         return;
     }
 
-    // Attempt to open the file for reading
-    FILE *file = fopen(path, "r");
+    FILE *file = fdopen(fd, "r");
     if (file == NULL) {
-        // This will catch other errors like permission denied (EACCES)
-        fprintf(stderr, "mycat: '%s': %s\n", path, strerror(errno));
+        fprintf(ctx->err, "mycat: '%s': %s\n", path, strerror(errno));
+        close(fd);
         return;
     }
 
-    // Read the file in chunks and write to stdout for efficiency
+    copy_stream(ctx, file, path);
+    fclose(file);
+}
+
+/**
+ * @brief Copies a stream to the output in chunks until EOF or cancellation.
+ */
+static void copy_stream(tool_ctx *ctx, FILE *file, const char *path) {
     char buffer[BUFSIZ]; // BUFSIZ is a standard buffer size defined in stdio.h
     size_t bytes_read;
-    while ((bytes_read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    while (!tool_cancelled(ctx) && (bytes_read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
         // fwrite returns the number of items successfully written.
         // If it's not equal to bytes_read, an error occurred.
-        if (fwrite(buffer, 1, bytes_read, stdout) != bytes_read) {
-            perror("mycat: write error");
+        if (fwrite(buffer, 1, bytes_read, ctx->out) != bytes_read) {
+            fprintf(ctx->err, "mycat: write error: %s\n", strerror(errno));
             break;
         }
     }
 
     // Check if the loop terminated because of a read error
     if (ferror(file)) {
-        fprintf(stderr, "mycat: error reading '%s'\n", path);
+        fprintf(ctx->err, "mycat: error reading '%s'\n", path);
     }
-
-    fclose(file);
 }
 /*
 ```
@@ -28,17 +28,18 @@
 #include <dirent.h>
 #include <libgen.h>
 #include <errno.h>
+#include "tools.h"
 
 #define MAX_PATH_LEN 4096
 #define BUFFER_SIZE 8192
 
 // --- Forward Declarations ---
-void copy_entry(const char *source, const char *dest, bool interactive, bool recursive);
-void copy_file(const char *source, const char *dest, bool interactive);
-void copy_directory(const char *source, const char *dest, bool interactive, bool recursive);
+void copy_entry(tool_ctx *ctx, const char *source, const char *dest, bool interactive, bool recursive);
+void copy_file(tool_ctx *ctx, const char *source, const char *dest, bool interactive);
+void copy_directory(tool_ctx *ctx, const char *source, const char *dest, bool interactive, bool recursive);
 
 // --- Main Function ---
-int tool_mycp_main(int argc, char **argv) {
+int tool_mycp_main(tool_ctx *ctx, int argc, char **argv) {
     bool recursive = false;
     bool interactive = false;
     int opt;
@@ -61,7 +62,7 @@ int tool_mycp_main(int argc, char **argv) {
                     } else if (argv[i][j] == 'i') {
                         interactive = true;
                     } else {
-                        fprintf(stderr, "mycp: invalid option -- '%c'\n", argv[i][j]);
+                        fprintf(ctx->err, "mycp: invalid option -- '%c'\n", argv[i][j]);
                         return 1;
                     }
                 }
@@ -74,7 +75,7 @@ int tool_mycp_main(int argc, char **argv) {
     }
 
     if (source_count < 2) {
-        fprintf(stderr, "mycp: missing destination file operand\n");
+        fprintf(ctx->err, "mycp: missing destination file operand\n");
         return 1;
     }
 
@@ -85,15 +86,15 @@ int tool_mycp_main(int argc, char **argv) {
     // Handle case where multiple sources are provided
     if (source_count > 1) {
         struct stat dest_stat;
-        if (stat(destination, &dest_stat) != 0 || !S_ISDIR(dest_stat.st_mode)) {
-            fprintf(stderr, "mycp: target '%s' is not a directory\n", destination);
+        if (fstatat(ctx->cwd_fd, destination, &dest_stat, 0) != 0 || !S_ISDIR(dest_stat.st_mode)) {
+            fprintf(ctx->err, "mycp: target '%s' is not a directory\n", destination);
             return 1;
         }
     }
 
     // Process each source (glob expansion already done by shell)
-    for (int i = 0; i < source_count; i++) {
-        copy_entry(sources[i], destination, interactive, recursive);
+    for (int i = 0; i < source_count && !tool_cancelled(ctx); i++) {
+        copy_entry(ctx, sources[i], destination, interactive, recursive);
     }
 
     return 0;
@@ -108,23 +109,23 @@ int tool_mycp_main(int argc, char **argv) {
  * @param interactive If true, prompt before overwrite.
  * @param recursive If true, allow directory copying.
  */
-void copy_entry(const char *source, const char *dest, bool interactive, bool recursive) {
+void copy_entry(tool_ctx *ctx, const char *source, const char *dest, bool interactive, bool recursive) {
     struct stat source_stat;
-    if (lstat(source, &source_stat) != 0) {
-        perror("mycp: lstat");
+    if (fstatat(ctx->cwd_fd, source, &source_stat, AT_SYMLINK_NOFOLLOW) != 0) {
+        fprintf(ctx->err, "mycp: lstat: %s\n", strerror(errno));
         return;
     }
 
     if (S_ISDIR(source_stat.st_mode)) {
         if (!recursive) {
-            fprintf(stderr, "mycp: -r not specified; omitting directory '%s'\n", source);
+            fprintf(ctx->err, "mycp: -r not specified; omitting directory '%s'\n", source);
         } else {
-            copy_directory(source, dest, interactive, recursive);
+            copy_directory(ctx, source, dest, interactive, recursive);
         }
     } else if (S_ISREG(source_stat.st_mode)) {
-        copy_file(source, dest, interactive);
+        copy_file(ctx, source, dest, interactive);
     } else {
-        fprintf(stderr, "mycp: cannot copy '%s': Not a regular file or directory\n", source);
+        fprintf(ctx->err, "mycp: cannot copy '%s': Not a regular file or directory\n", source);
     }
 }
 
@@ -136,12 +137,12 @@ void copy_entry(const char *source, const char *dest, bool interactive, bool rec
  * @param dest The destination path (can be a file or directory).
  * @param interactive If true, prompt before overwriting an existing file.
  */
-void copy_file(const char *source, const char *dest, bool interactive) {
+void copy_file(tool_ctx *ctx, const char *source, const char *dest, bool interactive) {
     struct stat dest_stat;
     char final_dest[MAX_PATH_LEN];
     
     // Determine the final destination path
-    if (stat(dest, &dest_stat) == 0 && S_ISDIR(dest_stat.st_mode)) {
+    if (fstatat(ctx->cwd_fd, dest, &dest_stat, 0) == 0 && S_ISDIR(dest_stat.st_mode)) {
         char *source_basename = basename((char *)source);
         snprintf(final_dest, sizeof(final_dest), "%s/%s", dest, source_basename);
     } else {
@@ -150,37 +151,37 @@ void copy_file(const char *source, const char *dest, bool interactive) {
     }
 
     // Interactive prompt if destination exists
-    if (interactive && access(final_dest, F_OK) == 0) {
-        printf("overwrite '%s'? ", final_dest);
-        fflush(stdout); // Make sure the prompt is shown
-        int c = getchar();
+    if (interactive && faccessat(ctx->cwd_fd, final_dest, F_OK, 0) == 0) {
+        fprintf(ctx->out, "overwrite '%s'? ", final_dest);
+        fflush(ctx->out); // Make sure the prompt is shown
+        int c = getc(ctx->in);
         if (c != 'y' && c != 'Y') {
              // Consume rest of the line
             while (c != '\n' && c != EOF) {
-                c = getchar();
+                c = getc(ctx->in);
             }
-            printf("not overwritten\n");
+            fprintf(ctx->out, "not overwritten\n");
             return;
         }
         // Consume rest of the line
         while (c != '\n' && c != EOF) {
-            c = getchar();
+            c = getc(ctx->in);
         }
     }
 
     // Open source and destination files
-    int fd_from = open(source, O_RDONLY);
+    int fd_from = tool_open(ctx, source, O_RDONLY, 0);
     if (fd_from == -1) {
-        perror("mycp: open (source)");
+        fprintf(ctx->err, "mycp: open (source): %s\n", strerror(errno));
         return;
     }
 
     struct stat source_stat;
     fstat(fd_from, &source_stat);
 
-    int fd_to = open(final_dest, O_WRONLY | O_CREAT | O_TRUNC, source_stat.st_mode);
+    int fd_to = tool_open(ctx, final_dest, O_WRONLY | O_CREAT | O_TRUNC, source_stat.st_mode);
     if (fd_to == -1) {
-        perror("mycp: open (destination)");
+        fprintf(ctx->err, "mycp: open (destination): %s\n", strerror(errno));
         close(fd_from);
         return;
     }
@@ -188,15 +189,15 @@ void copy_file(const char *source, const char *dest, bool interactive) {
     // Copy data
     char buffer[BUFFER_SIZE];
     ssize_t nread;
-    while ((nread = read(fd_from, buffer, sizeof(buffer))) > 0) {
+    while (!tool_cancelled(ctx) && (nread = read(fd_from, buffer, sizeof(buffer))) > 0) {
         if (write(fd_to, buffer, nread) != nread) {
-            perror("mycp: write");
+            fprintf(ctx->err, "mycp: write: %s\n", strerror(errno));
             break;
         }
     }
     
     if (nread == -1) {
-        perror("mycp: read");
+        fprintf(ctx->err, "mycp: read: %s\n", strerror(errno));
     }
 
     close(fd_from);
@@ -211,19 +212,19 @@ void copy_file(const char *source, const char *dest, bool interactive) {
  * @param interactive If true, prompt before overwrite.
  * @param recursive Must be true.
  */
-void copy_directory(const char *source, const char *dest, bool interactive, bool recursive) {
-    DIR *d = opendir(source);
+void copy_directory(tool_ctx *ctx, const char *source, const char *dest, bool interactive, bool recursive) {
+    DIR *d = tool_opendir(ctx, source);
     if (!d) {
-        perror("mycp: opendir");
+        fprintf(ctx->err, "mycp: opendir: %s\n", strerror(errno));
         return;
     }
 
     struct stat source_stat, dest_stat;
-    lstat(source, &source_stat);
+    fstatat(ctx->cwd_fd, source, &source_stat, AT_SYMLINK_NOFOLLOW);
     char new_dest[MAX_PATH_LEN];
 
     // Create destination directory
-    if (stat(dest, &dest_stat) == 0 && S_ISDIR(dest_stat.st_mode)) {
+    if (fstatat(ctx->cwd_fd, dest, &dest_stat, 0) == 0 && S_ISDIR(dest_stat.st_mode)) {
         char *source_basename = basename((char *)source);
         snprintf(new_dest, sizeof(new_dest), "%s/%s", dest, source_basename);
     } else {
@@ -231,15 +232,15 @@ void copy_directory(const char *source, const char *dest, bool interactive, bool
         new_dest[sizeof(new_dest)-1] = '\0';
     }
 
-    if (mkdir(new_dest, source_stat.st_mode) != 0 && errno != EEXIST) {
-        perror("mycp: mkdir");
+    if (mkdirat(ctx->cwd_fd, new_dest, source_stat.st_mode) != 0 && errno != EEXIST) {
+        fprintf(ctx->err, "mycp: mkdir: %s\n", strerror(errno));
         closedir(d);
         return;
     }
     
     // Loop through directory entries
     struct dirent *entry;
-    while ((entry = readdir(d)) != NULL) {
+    while (!tool_cancelled(ctx) && (entry = readdir(d)) != NULL) {
         if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
             continue;
         }
@@ -248,12 +249,12 @@ void copy_directory(const char *source, const char *dest, bool interactive, bool
         
         // Check for potential path length overflow before creating full source path
         if (strlen(source) + strlen(entry->d_name) + 2 > sizeof(source_path)) {
-            fprintf(stderr, "mycp: source path is too long: %s/%s\n", source, entry->d_name);
+            fprintf(ctx->err, "mycp: source path is too long: %s/%s\n", source, entry->d_name);
             continue;
         }
         snprintf(source_path, sizeof(source_path), "%s/%s", source, entry->d_name);
         
-        copy_entry(source_path, new_dest, interactive, recursive);
+        copy_entry(ctx, source_path, new_dest, interactive, recursive);
     }
     
     closedir(d);
@@ -7,8 +7,8 @@
  * hidden files. Directory traversal is parallelized using pthreads to
  * improve performance on large filesystems.
  *
- * Compilation:
- * gcc myfd.c -o myfd -pthread
+ * All search state lives in a per-call FdSearch, so concurrent myfd runs
+ * in one process do not interfere.
  *
  * Example Usage:
  * ./myfd --hidden -e rs -t f "^test_" /home/user/projects
@@ -25,30 +25,9 @@
 #include <unistd.h>
 #include <errno.h>
 #include <limits.h>
+#include "tools.h"
 
 #define MAX_GITIGNORE_PATTERNS 100
-#define MAX_QUEUE_SIZE 4096
-
-// --- Global Thread-Safe Structures ---
-
-// A thread-safe queue for directories to be processed.
-typedef struct {
-    char* paths[MAX_QUEUE_SIZE];
-    int head;
-    int tail;
-    int count;
-    pthread_mutex_t mutex;
-    pthread_cond_t can_push;
-    pthread_cond_t can_pop;
-} WorkQueue;
-
-// --- Global Variables ---
-WorkQueue g_work_queue;
-int g_active_threads = 0;
-bool g_work_done = false;
-pthread_mutex_t g_active_threads_mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t g_print_mutex = PTHREAD_MUTEX_INITIALIZER;
-volatile bool g_error_occurred = false;
 
 // Configuration for the search operation.
 typedef struct {
@@ -59,6 +38,28 @@ typedef struct {
     bool match_full_path;
 } SearchConfig;
 
+// Directories waiting to be scanned; grows as needed so workers never
+// block on a full queue.
+typedef struct {
+    char **paths;
+    int head;
+    int count;
+    int capacity;
+} WorkQueue;
+
+// Everything one search needs. Each run owns its own instance, so several
+// myfd calls can be in flight at once (pipelines, MCP clients, jobs).
+typedef struct {
+    tool_ctx *ctx;
+    SearchConfig config;
+    WorkQueue queue;
+    int active;                 // Workers currently scanning a directory
+    bool done;
+    bool error_occurred;
+    pthread_mutex_t mutex;      // Protects queue, active and done
+    pthread_cond_t work;        // New work, or the search has finished
+} FdSearch;
+
 // Holds patterns from a .gitignore file.
 typedef struct {
     char *patterns[MAX_GITIGNORE_PATTERNS];
@@ -67,18 +68,18 @@ typedef struct {
 
 
 // --- Forward Declarations ---
-void *worker_thread(void *arg);
-void process_directory(const char *dir_path, const SearchConfig *config);
+static void *worker_thread(void *arg);
+static void process_directory(FdSearch *search, const char *dir_path);
 Gitignore myfd_load_gitignore(const char *dir_path);
 void myfd_free_gitignore(Gitignore *gi);
 bool myfd_is_ignored(const char *path, const Gitignore *gi);
-void queue_init(WorkQueue *q);
-void queue_push(WorkQueue *q, const char *path);
-char* queue_pop(WorkQueue *q);
-void queue_destroy(WorkQueue *q);
+static void queue_push(FdSearch *search, const char *path);
+static char* queue_pop(FdSearch *search);
+static void queue_finish(FdSearch *search);
+static bool myfd_skip_entry(const char *name, const Gitignore *gi, bool show_hidden);
 
 // --- Main Function ---
-int tool_myfd_main(int argc, char **argv) {
+int tool_myfd_main(tool_ctx *ctx, int argc, char **argv) {
     SearchConfig config = { .pattern = "*", .extension = NULL, .type_filter = 0, .show_hidden = false, .match_full_path = false };
     char *start_path = ".";
     char *pattern_arg = NULL;
@@ -94,19 +95,19 @@ int tool_myfd_main(int argc, char **argv) {
         } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
             config.type_filter = argv[++i][0];
             if (config.type_filter != 'f' && config.type_filter != 'd') {
-                fprintf(stderr, "myfd: invalid type '%c'. Use 'f' or 'd'.\n", config.type_filter);
+                fprintf(ctx->err, "myfd: invalid type '%c'. Use 'f' or 'd'.\n", config.type_filter);
                 return 1;
             }
         } else if (strcmp(argv[i], "--full-path") == 0) {
             config.match_full_path = true;
         } else if (argv[i][0] == '-') {
-            fprintf(stderr, "myfd: unknown option '%s'\n", argv[i]);
+            fprintf(ctx->err, "myfd: unknown option '%s'\n", argv[i]);
             return 1;
         } else {
             if (path_args == 0) pattern_arg = argv[i];
             else if (path_args == 1) start_path = argv[i];
             else {
-                fprintf(stderr, "myfd: too many path arguments\n");
+                fprintf(ctx->err, "myfd: too many path arguments\n");
                 return 1;
             }
             path_args++;
@@ -117,7 +118,7 @@ int tool_myfd_main(int argc, char **argv) {
     if (path_args == 1) { // Only one non-option arg
         struct stat st;
         // If it's a directory, it's the path, and pattern is default '*'
-        if (stat(pattern_arg, &st) == 0 && S_ISDIR(st.st_mode)) {
+        if (fstatat(ctx->cwd_fd, pattern_arg, &st, 0) == 0 && S_ISDIR(st.st_mode)) {
             start_path = pattern_arg;
         } else { // Otherwise, it's the pattern
             config.pattern = pattern_arg;
@@ -142,90 +143,82 @@ int tool_myfd_main(int argc, char **argv) {
         // Allocate enough space for "*pattern*" + null terminator
         allocated_pattern = malloc(strlen(config.pattern) + 3);
         if (allocated_pattern == NULL) {
-            perror("myfd: malloc");
+            fprintf(ctx->err, "myfd: malloc: %s\n", strerror(errno));
             return 1;
         }
         sprintf(allocated_pattern, "*%s*", config.pattern);
         config.pattern = allocated_pattern;
     }
 
+    // --- Start Search ---
+    char initial_path[PATH_MAX];
+    if (tool_realpath(ctx, start_path, initial_path) == NULL) {
+        fprintf(ctx->err, "myfd: invalid start path '%s': %s\n", start_path, strerror(errno));
+        free(allocated_pattern); // Clean up on error
+        return 1;
+    }
+
+    FdSearch search = { .ctx = ctx, .config = config };
+    pthread_mutex_init(&search.mutex, NULL);
+    pthread_cond_init(&search.work, NULL);
+    queue_push(&search, initial_path);
 
     // --- Threading Setup ---
     int num_threads = sysconf(_SC_NPROCESSORS_ONLN);
     if (num_threads <= 0) num_threads = 2; // Default to 2 threads if detection fails
     pthread_t threads[num_threads];
 
-    queue_init(&g_work_queue);
-
-    // Create worker threads
+    // Create worker threads; they exit on their own once the queue is
+    // empty and no worker can add to it
+    int started = 0;
     for (int i = 0; i < num_threads; i++) {
-        if (pthread_create(&threads[i], NULL, worker_thread, &config) != 0) {
-            perror("myfd: pthread_create");
-            free(allocated_pattern); // Clean up on error
-            return 1;
+        if (pthread_create(&threads[i], NULL, worker_thread, &search) != 0) {
+            fprintf(ctx->err, "myfd: pthread_create: %s\n", strerror(errno));
+            break;
         }
+        started++;
     }
-
-    // --- Start Search ---
-    char initial_path[PATH_MAX];
-    if (realpath(start_path, initial_path) == NULL) {
-        fprintf(stderr, "myfd: invalid start path '%s': %s\n", start_path, strerror(errno));
-        free(allocated_pattern); // Clean up on error
-        return 1;
+    if (started == 0) {
+        search.done = true;
+        search.error_occurred = true;
     }
-    queue_push(&g_work_queue, initial_path);
 
     // --- Wait for Completion ---
-    while (true) {
-        pthread_mutex_lock(&g_active_threads_mutex);
-        bool done = (g_work_queue.count == 0 && g_active_threads == 0);
-        pthread_mutex_unlock(&g_active_threads_mutex);
-        if (done) break;
-        usleep(10000); // Sleep briefly to avoid busy-waiting
-    }
-
-    // --- Shutdown ---
-    g_work_done = true;
-    pthread_cond_broadcast(&g_work_queue.can_pop); // Wake up any waiting threads so they can exit
-
-    for (int i = 0; i < num_threads; i++) {
+    for (int i = 0; i < started; i++) {
         pthread_join(threads[i], NULL);
     }
     
+    // --- Shutdown ---
     free(allocated_pattern); // Clean up the pattern string if we allocated it
-    queue_destroy(&g_work_queue);
-    pthread_mutex_destroy(&g_active_threads_mutex);
-    pthread_mutex_destroy(&g_print_mutex);
+    while (search.queue.count > 0) {
+        free(search.queue.paths[search.queue.head]);
+        search.queue.head = (search.queue.head + 1) % search.queue.capacity;
+        search.queue.count--;
+    }
+    free(search.queue.paths);
+    pthread_mutex_destroy(&search.mutex);
+    pthread_cond_destroy(&search.work);
 
-    return g_error_occurred ? 1 : 0;
+    return search.error_occurred ? 1 : 0;
 }
 
 /**
  * @brief The main function for each worker thread.
  * Pops directories from the work queue and processes them until all work is done.
  */
-void *worker_thread(void *arg) {
-    SearchConfig *config = (SearchConfig *)arg;
+static void *worker_thread(void *arg) {
+    FdSearch *search = (FdSearch *)arg;
 
     while (true) {
-        char *dir_path = queue_pop(&g_work_queue);
+        char *dir_path = queue_pop(search);
 
         if (dir_path == NULL) { // NULL is the signal that all work is done
             break;
         }
 
-        // Increment active thread count
-        pthread_mutex_lock(&g_active_threads_mutex);
-        g_active_threads++;
-        pthread_mutex_unlock(&g_active_threads_mutex);
-
-        process_directory(dir_path, config);
+        process_directory(search, dir_path);
         free(dir_path);
-
-        // Decrement active thread count
-        pthread_mutex_lock(&g_active_threads_mutex);
-        g_active_threads--;
-        pthread_mutex_unlock(&g_active_threads_mutex);
+        queue_finish(search);
     }
     return NULL;
 }
@@ -233,30 +226,23 @@ void *worker_thread(void *arg) {
 /**
  * @brief Scans a single directory, matches files, and enqueues subdirectories.
  */
-void process_directory(const char *dir_path, const SearchConfig *config) {
+static void process_directory(FdSearch *search, const char *dir_path) {
+    tool_ctx *ctx = search->ctx;
+    const SearchConfig *config = &search->config;
+
     DIR *dir = opendir(dir_path);
     if (!dir) {
-        pthread_mutex_lock(&g_print_mutex);
-        fprintf(stderr, "myfd: cannot read directory '%s': %s\n", dir_path, strerror(errno));
-        pthread_mutex_unlock(&g_print_mutex);
-        g_error_occurred = true;
+        fprintf(ctx->err, "myfd: cannot read directory '%s': %s\n", dir_path, strerror(errno));
+        __atomic_store_n(&search->error_occurred, true, __ATOMIC_RELAXED);
         return;
     }
 
     Gitignore gi = myfd_load_gitignore(dir_path);
     struct dirent *entry;
 
-    while ((entry = readdir(dir)) != NULL) {
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
-
+    while (!tool_cancelled(ctx) && (entry = readdir(dir)) != NULL) {
         // --- Filtering ---
-        if (!config->show_hidden && entry->d_name[0] == '.') {
-            continue;
-        }
-
-        if (myfd_is_ignored(entry->d_name, &gi)) {
+        if (myfd_skip_entry(entry->d_name, &gi, config->show_hidden)) {
             continue;
         }
 
@@ -282,16 +268,15 @@ void process_directory(const char *dir_path, const SearchConfig *config) {
         }
 
         // --- Pattern Matching ---
+        // One fprintf per line: the stream's own lock keeps lines whole
         const char *match_target = config->match_full_path ? full_path : entry->d_name;
         if (fnmatch(config->pattern, match_target, FNM_PATHNAME) == 0) {
-            pthread_mutex_lock(&g_print_mutex);
-            printf("%s\n", full_path);
-            pthread_mutex_unlock(&g_print_mutex);
+            fprintf(ctx->out, "%s\n", full_path);
         }
 
         // If it's a directory, add it to the queue for further processing
         if (is_dir) {
-            queue_push(&g_work_queue, full_path);
+            queue_push(search, full_path);
         }
     }
 
@@ -300,60 +285,218 @@ void process_directory(const char *dir_path, const SearchConfig *config) {
 }
 
 
-// --- Utility and Queue Functions ---
+/**
+ * @brief Decides whether a directory entry is excluded from traversal.
+ * Skips "." and "..", hidden entries (unless requested) and anything
+ * matched by the directory's .gitignore.
+ */
+static bool myfd_skip_entry(const char *name, const Gitignore *gi, bool show_hidden) {
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+        return true;
+    }
+    if (!show_hidden && name[0] == '.') {
+        return true;
+    }
+    return myfd_is_ignored(name, gi);
+}
 
-void queue_init(WorkQueue *q) {
-    q->head = 0;
-    q->tail = 0;
-    q->count = 0;
-    pthread_mutex_init(&q->mutex, NULL);
-    pthread_cond_init(&q->can_push, NULL);
-    pthread_cond_init(&q->can_pop, NULL);
+/**
+ * @brief Sequential directory walk shared by myfd_walk_dirs/myfd_walk_entries.
+ *
+ * Hidden entries are skipped unless show_hidden is set and each
+ * directory's .gitignore is honoured. dir_cb runs once per directory
+ * (root included); entry_cb runs for every entry below root. A non-zero
+ * return from either callback stops the walk.
+ *
+ * @return Number of directories visited, or -1 if root cannot be opened.
+ */
+static int myfd_walk_tree(const char *root, int show_hidden, myfd_dir_callback dir_cb,
+                          myfd_entry_callback entry_cb, void *arg) {
+    int capacity = 64;
+    int depth = 0;
+    int visited = 0;
+    bool stop = false;
+    char **stack = malloc(capacity * sizeof(char *));
+    if (stack == NULL) {
+        return -1;
+    }
+
+    struct stat st;
+    if (stat(root, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        free(stack);
+        return -1;
+    }
+    stack[depth++] = strdup(root);
+
+    while (depth > 0 && !stop) {
+        char *dir_path = stack[--depth];
+        if (dir_path == NULL) {
+            continue;
+        }
+
+        visited++;
+        if (dir_cb != NULL && dir_cb(dir_path, arg) != 0) {
+            free(dir_path);
+            break;
+        }
+
+        DIR *dir = opendir(dir_path);
+        if (dir == NULL) {
+            free(dir_path);
+            continue;
+        }
+
+        Gitignore gi = myfd_load_gitignore(dir_path);
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (myfd_skip_entry(entry->d_name, &gi, show_hidden)) {
+                continue;
+            }
+
+            char full_path[PATH_MAX];
+            snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
+
+            // d_type avoids an lstat per entry on filesystems that report it
+            bool is_dir;
+            if (entry->d_type != DT_UNKNOWN) {
+                is_dir = (entry->d_type == DT_DIR);
+            } else {
+                is_dir = (lstat(full_path, &st) == 0 && S_ISDIR(st.st_mode));
+            }
+
+            if (entry_cb != NULL && entry_cb(full_path, is_dir, arg) != 0) {
+                stop = true;
+                break;
+            }
+            if (!is_dir) {
+                continue;
+            }
+
+            if (depth == capacity) {
+                capacity *= 2;
+                char **grown = realloc(stack, capacity * sizeof(char *));
+                if (grown == NULL) {
+                    break;
+                }
+                stack = grown;
+            }
+            stack[depth++] = strdup(full_path);
+        }
+
+        myfd_free_gitignore(&gi);
+        closedir(dir);
+        free(dir_path);
+    }
+
+    while (depth > 0) {
+        free(stack[--depth]);
+    }
+    free(stack);
+    return visited;
+}
+
+/**
+ * @brief Walks every directory below root using myfd's filtering rules.
+ *
+ * Other tools (e.g. mywatch) use this to visit the same directory set a
+ * search would. The callback runs from the calling thread once per
+ * directory (root included); a non-zero return stops the walk.
+ *
+ * @return Number of directories visited, or -1 if root cannot be opened.
+ */
+int myfd_walk_dirs(const char *root, int show_hidden, myfd_dir_callback cb, void *arg) {
+    return myfd_walk_tree(root, show_hidden, cb, NULL, arg);
 }
 
-void queue_push(WorkQueue *q, const char *path) {
-    pthread_mutex_lock(&q->mutex);
-    while (q->count == MAX_QUEUE_SIZE) {
-        pthread_cond_wait(&q->can_push, &q->mutex);
+/**
+ * @brief Walks every file and directory below root (root itself excluded).
+ *
+ * Used as a candidate source by myfzf. Paths are passed as root/relative.
+ *
+ * @return Number of directories visited, or -1 if root cannot be opened.
+ */
+int myfd_walk_entries(const char *root, int show_hidden, myfd_entry_callback cb, void *arg) {
+    return myfd_walk_tree(root, show_hidden, NULL, cb, arg);
+}
+
+
+// --- Utility and Queue Functions ---
+
+static void queue_push(FdSearch *search, const char *path) {
+    char *copy = strdup(path);
+    if (copy == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&search->mutex);
+    WorkQueue *q = &search->queue;
+    if (q->count == q->capacity) {
+        int capacity = q->capacity ? q->capacity * 2 : 256;
+        char **grown = malloc(capacity * sizeof(char *));
+        if (grown == NULL) {
+            pthread_mutex_unlock(&search->mutex);
+            free(copy);
+            return;
+        }
+        // Unwrap the ring into the new array
+        for (int i = 0; i < q->count; i++) {
+            grown[i] = q->paths[(q->head + i) % q->capacity];
+        }
+        free(q->paths);
+        q->paths = grown;
+        q->head = 0;
+        q->capacity = capacity;
     }
-    q->paths[q->tail] = strdup(path);
-    q->tail = (q->tail + 1) % MAX_QUEUE_SIZE;
+    q->paths[(q->head + q->count) % q->capacity] = copy;
     q->count++;
-    pthread_cond_signal(&q->can_pop);
-    pthread_mutex_unlock(&q->mutex);
+    pthread_cond_signal(&search->work);
+    pthread_mutex_unlock(&search->mutex);
 }
 
-char* queue_pop(WorkQueue *q) {
-    pthread_mutex_lock(&q->mutex);
-    while (q->count == 0) {
-        if (g_work_done) {
-            pthread_mutex_unlock(&q->mutex);
-            return NULL; // Signal to terminate
+/**
+ * @brief Takes the next directory and marks the caller active.
+ * Returns NULL once the queue is empty with no worker left to refill it,
+ * or when the search has been cancelled.
+ */
+static char* queue_pop(FdSearch *search) {
+    pthread_mutex_lock(&search->mutex);
+    WorkQueue *q = &search->queue;
+    while (q->count == 0 && !search->done) {
+        if (search->active == 0) {
+            search->done = true;
+            pthread_cond_broadcast(&search->work);
+            break;
         }
-        pthread_cond_wait(&q->can_pop, &q->mutex);
+        pthread_cond_wait(&search->work, &search->mutex);
     }
-    if (q->count == 0 && g_work_done) { // Re-check after waking up
-         pthread_mutex_unlock(&q->mutex);
-         return NULL;
+    if (tool_cancelled(search->ctx) && !search->done) {
+        search->done = true;
+        pthread_cond_broadcast(&search->work);
+    }
+    if (search->done) {
+        pthread_mutex_unlock(&search->mutex);
+        return NULL; // Signal to terminate
     }
     char *path = q->paths[q->head];
-    q->head = (q->head + 1) % MAX_QUEUE_SIZE;
+    q->head = (q->head + 1) % q->capacity;
     q->count--;
-    pthread_cond_signal(&q->can_push);
-    pthread_mutex_unlock(&q->mutex);
+    search->active++;
+    pthread_mutex_unlock(&search->mutex);
     return path;
 }
 
-void queue_destroy(WorkQueue *q) {
-    // Free any remaining paths in the queue
-    while (q->count > 0) {
-        free(q->paths[q->head]);
-        q->head = (q->head + 1) % MAX_QUEUE_SIZE;
-        q->count--;
+/**
+ * @brief Marks the caller idle; the last idle worker with an empty
+ * queue ends the search.
+ */
+static void queue_finish(FdSearch *search) {
+    pthread_mutex_lock(&search->mutex);
+    search->active--;
+    if (search->active == 0 && search->queue.count == 0) {
+        search->done = true;
+        pthread_cond_broadcast(&search->work);
     }
-    pthread_mutex_destroy(&q->mutex);
-    pthread_cond_destroy(&q->can_push);
-    pthread_cond_destroy(&q->can_pop);
+    pthread_mutex_unlock(&search->mutex);
 }
 
 Gitignore myfd_load_gitignore(const char *dir_path) {
@@ -29,20 +29,23 @@
 #include <fnmatch.h>
 #include <stdbool.h>
 #include <libgen.h>
+#include <errno.h>
+#include <fcntl.h>
+#include "tools.h"
 
 #define MAX_IGNORE_PATTERNS 100
 #define MAX_PATH_LEN 1024
 
 // --- Forward Declarations ---
 
-void list_directory(const char *path, bool show_all, bool long_format, const char *pattern);
-void print_long_format(const char *filepath, const char *name);
-void load_gitignore(const char *dir_path, char ignore_patterns[MAX_IGNORE_PATTERNS][256], int *ignore_count);
+void list_directory(tool_ctx *ctx, const char *path, bool show_all, bool long_format, const char *pattern);
+void print_long_format(tool_ctx *ctx, const char *filepath, const char *name);
+void load_gitignore(tool_ctx *ctx, const char *dir_path, char ignore_patterns[MAX_IGNORE_PATTERNS][256], int *ignore_count);
 bool should_ignore(const char *name, char ignore_patterns[MAX_IGNORE_PATTERNS][256], int ignore_count);
 
 // --- Main Function ---
 
-int tool_myls_main(int argc, char **argv) {
+int tool_myls_main(tool_ctx *ctx, int argc, char **argv) {
     bool show_all = false;
     bool long_format = false;
     const char *path = ".";
@@ -60,7 +63,7 @@ int tool_myls_main(int argc, char **argv) {
                 } else if (argv[i][j] == 'a') {
                     show_all = true;
                 } else {
-                    fprintf(stderr, "myls: invalid option -- '%c'\n", argv[i][j]);
+                    fprintf(ctx->err, "myls: invalid option -- '%c'\n", argv[i][j]);
                     return 1;
                 }
             }
@@ -74,7 +77,7 @@ int tool_myls_main(int argc, char **argv) {
             } else if (path_arg_count == 2) {
                 pattern = argv[i];
             } else {
-                 fprintf(stderr, "myls: too many arguments. Provide at most one path and one pattern.\n");
+                 fprintf(ctx->err, "myls: too many arguments. Provide at most one path and one pattern.\n");
                  return 1;
             }
         }
@@ -102,7 +105,7 @@ int tool_myls_main(int argc, char **argv) {
     }
 
 
-    list_directory(path, show_all, long_format, pattern);
+    list_directory(ctx, path, show_all, long_format, pattern);
 
     return 0;
 }
@@ -115,19 +118,19 @@ int tool_myls_main(int argc, char **argv) {
  * @param long_format If true, prints in long format.
  * @param pattern A glob pattern to filter file names.
  */
-void list_directory(const char *path, bool show_all, bool long_format, const char *pattern) {
-    DIR *d = opendir(path);
+void list_directory(tool_ctx *ctx, const char *path, bool show_all, bool long_format, const char *pattern) {
+    DIR *d = tool_opendir(ctx, path);
     if (d == NULL) {
-        perror("myls: cannot open directory");
+        fprintf(ctx->err, "myls: cannot open directory: %s\n", strerror(errno));
         return;
     }
 
     char ignore_patterns[MAX_IGNORE_PATTERNS][256];
     int ignore_count = 0;
-    load_gitignore(path, ignore_patterns, &ignore_count);
+    load_gitignore(ctx, path, ignore_patterns, &ignore_count);
 
     struct dirent *dir_entry;
-    while ((dir_entry = readdir(d)) != NULL) {
+    while (!tool_cancelled(ctx) && (dir_entry = readdir(d)) != NULL) {
         const char *name = dir_entry->d_name;
 
         // --- Filtering Logic ---
@@ -155,9 +158,9 @@ void list_directory(const char *path, bool show_all, bool long_format, const cha
         if (long_format) {
             char full_path[MAX_PATH_LEN];
             snprintf(full_path, sizeof(full_path), "%s/%s", path, name);
-            print_long_format(full_path, name);
+            print_long_format(ctx, full_path, name);
         } else {
-            printf("%s\n", name);
+            fprintf(ctx->out, "%s\n", name);
         }
     }
 
@@ -171,54 +174,60 @@ void list_directory(const char *path, bool show_all, bool long_format, const cha
  * @param filepath The full path to the file.
  * @param name The name of the file to display.
  */
-void print_long_format(const char *filepath, const char *name) {
+void print_long_format(tool_ctx *ctx, const char *filepath, const char *name) {
     struct stat file_stat;
-    // Use lstat to get info about the link itself, not the file it points to
-    if (lstat(filepath, &file_stat) == -1) {
-        perror("myls: lstat");
+    FILE *out = ctx->out;
+    // Use lstat semantics to get info about the link itself, not the file it points to
+    if (fstatat(ctx->cwd_fd, filepath, &file_stat, AT_SYMLINK_NOFOLLOW) == -1) {
+        fprintf(ctx->err, "myls: lstat: %s\n", strerror(errno));
         return;
     }
 
     // 1. Permissions
-    printf((S_ISDIR(file_stat.st_mode)) ? "d" : "-");
-    printf((S_ISLNK(file_stat.st_mode)) ? "l" : "-");
-    printf((file_stat.st_mode & S_IRUSR) ? "r" : "-");
-    printf((file_stat.st_mode & S_IWUSR) ? "w" : "-");
-    printf((file_stat.st_mode & S_IXUSR) ? "x" : "-");
-    printf((file_stat.st_mode & S_IRGRP) ? "r" : "-");
-    printf((file_stat.st_mode & S_IWGRP) ? "w" : "-");
-    printf((file_stat.st_mode & S_IXGRP) ? "x" : "-");
-    printf((file_stat.st_mode & S_IROTH) ? "r" : "-");
-    printf((file_stat.st_mode & S_IWOTH) ? "w" : "-");
-    printf((file_stat.st_mode & S_IXOTH) ? "x" : "-");
+    fputs((S_ISDIR(file_stat.st_mode)) ? "d" : "-", out);
+    fputs((S_ISLNK(file_stat.st_mode)) ? "l" : "-", out);
+    fputs((file_stat.st_mode & S_IRUSR) ? "r" : "-", out);
+    fputs((file_stat.st_mode & S_IWUSR) ? "w" : "-", out);
+    fputs((file_stat.st_mode & S_IXUSR) ? "x" : "-", out);
+    fputs((file_stat.st_mode & S_IRGRP) ? "r" : "-", out);
+    fputs((file_stat.st_mode & S_IWGRP) ? "w" : "-", out);
+    fputs((file_stat.st_mode & S_IXGRP) ? "x" : "-", out);
+    fputs((file_stat.st_mode & S_IROTH) ? "r" : "-", out);
+    fputs((file_stat.st_mode & S_IWOTH) ? "w" : "-", out);
+    fputs((file_stat.st_mode & S_IXOTH) ? "x" : "-", out);
 
     // 2. Number of hard links
-    printf(" %2lu", file_stat.st_nlink);
+    fprintf(out, " %2lu", file_stat.st_nlink);
 
-    // 3. Owner and Group
-    struct passwd *pw = getpwuid(file_stat.st_uid);
-    struct group *gr = getgrgid(file_stat.st_gid);
-    printf(" %-8s %-8s", pw ? pw->pw_name : "unknown", gr ? gr->gr_name : "unknown");
+    // 3. Owner and Group (reentrant lookups: other tools may run concurrently)
+    char pw_buf[1024], gr_buf[1024];
+    struct passwd pw_store, *pw = NULL;
+    struct group gr_store, *gr = NULL;
+    getpwuid_r(file_stat.st_uid, &pw_store, pw_buf, sizeof(pw_buf), &pw);
+    getgrgid_r(file_stat.st_gid, &gr_store, gr_buf, sizeof(gr_buf), &gr);
+    fprintf(out, " %-8s %-8s", pw ? pw->pw_name : "unknown", gr ? gr->gr_name : "unknown");
 
     // 4. Size
-    printf(" %8lld", (long long)file_stat.st_size);
+    fprintf(out, " %8lld", (long long)file_stat.st_size);
 
     // 5. Modification time
     char time_buf[20];
-    strftime(time_buf, sizeof(time_buf), "%b %d %H:%M", localtime(&file_stat.st_mtime));
-    printf(" %s", time_buf);
+    struct tm tm_info;
+    localtime_r(&file_stat.st_mtime, &tm_info);
+    strftime(time_buf, sizeof(time_buf), "%b %d %H:%M", &tm_info);
+    fprintf(out, " %s", time_buf);
 
     // 6. Name and symbolic link target
-    printf(" %s", name);
+    fprintf(out, " %s", name);
     if (S_ISLNK(file_stat.st_mode)) {
         char link_target[MAX_PATH_LEN];
-        ssize_t len = readlink(filepath, link_target, sizeof(link_target) - 1);
+        ssize_t len = readlinkat(ctx->cwd_fd, filepath, link_target, sizeof(link_target) - 1);
         if (len != -1) {
             link_target[len] = '\0';
-            printf(" -> %s", link_target);
+            fprintf(out, " -> %s", link_target);
         }
     }
-    printf("\n");
+    fputc('\n', out);
 }
 
 
@@ -230,11 +239,11 @@ void print_long_format(const char *filepath, const char *name) {
  * @param ignore_patterns A 2D array to store the loaded patterns.
  * @param ignore_count A pointer to an integer to store the number of patterns loaded.
  */
-void load_gitignore(const char *dir_path, char ignore_patterns[MAX_IGNORE_PATTERNS][256], int *ignore_count) {
+void load_gitignore(tool_ctx *ctx, const char *dir_path, char ignore_patterns[MAX_IGNORE_PATTERNS][256], int *ignore_count) {
     char gitignore_path[MAX_PATH_LEN];
     snprintf(gitignore_path, sizeof(gitignore_path), "%s/.gitignore", dir_path);
 
-    FILE *file = fopen(gitignore_path, "r");
+    FILE *file = tool_fopen_read(ctx, gitignore_path);
     if (file == NULL) {
         return; // No .gitignore file found, which is fine
     }
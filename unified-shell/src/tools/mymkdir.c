@@ -30,22 +30,24 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <errno.h>
+#include <fcntl.h>
+#include "tools.h"
 
 #define MAX_PATH_LEN 4096
 #define DEFAULT_MODE 0775 // rwxrwxr-x
 
 // --- Forward Declarations ---
-void create_directory(const char *path, bool create_parents);
-int mkdir_p(const char *path);
+void create_directory(tool_ctx *ctx, const char *path, bool create_parents);
+int mkdir_p(tool_ctx *ctx, const char *path);
 
 // --- Main Function ---
-int tool_mymkdir_main(int argc, char **argv) {
+int tool_mymkdir_main(tool_ctx *ctx, int argc, char **argv) {
     bool create_parents = false;
     char *paths[argc];
     int path_count = 0;
 
     if (argc < 2) {
-        fprintf(stderr, "mymkdir: missing operand\n");
+        fprintf(ctx->err, "mymkdir: missing operand\n");
         return 1;
     }
 
@@ -55,7 +57,7 @@ int tool_mymkdir_main(int argc, char **argv) {
         if (strcmp(argv[i], "-p") == 0) {
             create_parents = true;
         } else if (argv[i][0] == '-') {
-            fprintf(stderr, "mymkdir: invalid option '%s'\n", argv[i]);
+            fprintf(ctx->err, "mymkdir: invalid option '%s'\n", argv[i]);
             return 1;
         } else {
             paths[path_count++] = argv[i];
@@ -63,14 +65,14 @@ int tool_mymkdir_main(int argc, char **argv) {
     }
 
     if (path_count == 0) {
-        fprintf(stderr, "mymkdir: missing operand\n");
+        fprintf(ctx->err, "mymkdir: missing operand\n");
         return 1;
     }
 
     // --- Core Logic ---
     // Process each path provided
     for (int i = 0; i < path_count; i++) {
-        create_directory(paths[i], create_parents);
+        create_directory(ctx, paths[i], create_parents);
     }
 
     return 0;
@@ -82,17 +84,17 @@ int tool_mymkdir_main(int argc, char **argv) {
  * @param path The directory path to create.
  * @param create_parents If true, create parent directories as needed.
  */
-void create_directory(const char *path, bool create_parents) {
+void create_directory(tool_ctx *ctx, const char *path, bool create_parents) {
     if (create_parents) {
         // mkdir_p handles its own errors, including EEXIST.
-        mkdir_p(path);
+        mkdir_p(ctx, path);
     } else {
-        if (mkdir(path, DEFAULT_MODE) != 0) {
+        if (mkdirat(ctx->cwd_fd, path, DEFAULT_MODE) != 0) {
             // Provide the specific error message when the file exists
             if (errno == EEXIST) {
-                fprintf(stderr, "mymkdir: cannot create directory '%s': File exists\n", path);
+                fprintf(ctx->err, "mymkdir: cannot create directory '%s': File exists\n", path);
             } else {
-                fprintf(stderr, "mymkdir: cannot create directory '%s': %s\n", path, strerror(errno));
+                fprintf(ctx->err, "mymkdir: cannot create directory '%s': %s\n", path, strerror(errno));
             }
         }
     }
@@ -105,7 +107,7 @@ void create_directory(const char *path, bool create_parents) {
  * @param path The full directory path to create.
  * @return 0 on success, -1 on failure.
  */
-int mkdir_p(const char *path) {
+int mkdir_p(tool_ctx *ctx, const char *path) {
     // Make a mutable copy of the path since we'll be modifying it
     char tmp_path[MAX_PATH_LEN];
     snprintf(tmp_path, sizeof(tmp_path), "%s", path);
@@ -123,10 +125,10 @@ int mkdir_p(const char *path) {
             *p = '\0'; // Temporarily terminate the string
 
             // Create the directory component
-            if (mkdir(tmp_path, DEFAULT_MODE) != 0) {
+            if (mkdirat(ctx->cwd_fd, tmp_path, DEFAULT_MODE) != 0) {
                 // It's only an error if the directory doesn't already exist
                 if (errno != EEXIST) {
-                    fprintf(stderr, "mymkdir: cannot create directory '%s': %s\n", tmp_path, strerror(errno));
+                    fprintf(ctx->err, "mymkdir: cannot create directory '%s': %s\n", tmp_path, strerror(errno));
                     return -1;
                 }
             }
@@ -135,9 +137,9 @@ int mkdir_p(const char *path) {
     }
 
     // Create the final, full directory
-    if (mkdir(tmp_path, DEFAULT_MODE) != 0) {
+    if (mkdirat(ctx->cwd_fd, tmp_path, DEFAULT_MODE) != 0) {
         if (errno != EEXIST) {
-            fprintf(stderr, "mymkdir: cannot create directory '%s': %s\n", tmp_path, strerror(errno));
+            fprintf(ctx->err, "mymkdir: cannot create directory '%s': %s\n", tmp_path, strerror(errno));
             return -1;
         }
     }
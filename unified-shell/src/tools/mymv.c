@@ -31,14 +31,16 @@
 #include <unistd.h>
 #include <libgen.h>
 #include <errno.h>
+#include <fcntl.h>
+#include "tools.h"
 
 #define MAX_PATH_LEN 4096
 
 // --- Forward Declaration ---
-void move_or_rename(const char *source, const char *dest, bool interactive);
+void move_or_rename(tool_ctx *ctx, const char *source, const char *dest, bool interactive);
 
 // --- Main Function ---
-int tool_mymv_main(int argc, char **argv) {
+int tool_mymv_main(tool_ctx *ctx, int argc, char **argv) {
     bool interactive = false;
     char *paths[argc];
     int path_count = 0;
@@ -49,7 +51,7 @@ int tool_mymv_main(int argc, char **argv) {
         if (strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--interactive") == 0) {
             interactive = true;
         } else if (argv[i][0] == '-') {
-            fprintf(stderr, "mymv: invalid option '%s'\n", argv[i]);
+            fprintf(ctx->err, "mymv: invalid option '%s'\n", argv[i]);
             return 1;
         } else {
             paths[path_count++] = argv[i];
@@ -58,9 +60,9 @@ int tool_mymv_main(int argc, char **argv) {
 
     // Check for correct number of path arguments
     if (path_count < 2) {
-        fprintf(stderr, "mymv: missing destination file operand\n");
-        fprintf(stderr, "Usage: ./mymv [-i] SOURCE DEST\n");
-        fprintf(stderr, "   or: ./mymv [-i] SOURCE... DIRECTORY\n");
+        fprintf(ctx->err, "mymv: missing destination file operand\n");
+        fprintf(ctx->err, "Usage: ./mymv [-i] SOURCE DEST\n");
+        fprintf(ctx->err, "   or: ./mymv [-i] SOURCE... DIRECTORY\n");
         return 1;
     }
 
@@ -71,17 +73,17 @@ int tool_mymv_main(int argc, char **argv) {
     // Case 1: Moving multiple files/dirs into a directory
     if (source_count > 1) {
         struct stat dest_stat;
-        if (stat(destination, &dest_stat) != 0) {
-            fprintf(stderr, "mymv: target '%s': %s\n", destination, strerror(errno));
+        if (fstatat(ctx->cwd_fd, destination, &dest_stat, 0) != 0) {
+            fprintf(ctx->err, "mymv: target '%s': %s\n", destination, strerror(errno));
             return 1;
         }
         if (!S_ISDIR(dest_stat.st_mode)) {
-            fprintf(stderr, "mymv: target '%s' is not a directory\n", destination);
+            fprintf(ctx->err, "mymv: target '%s' is not a directory\n", destination);
             return 1;
         }
 
         // Loop through all sources and move them into the destination directory
-        for (int i = 0; i < source_count; i++) {
+        for (int i = 0; i < source_count && !tool_cancelled(ctx); i++) {
             char *source = paths[i];
             
             char source_copy[MAX_PATH_LEN];
@@ -92,7 +94,7 @@ int tool_mymv_main(int argc, char **argv) {
             char final_dest_path[MAX_PATH_LEN];
             snprintf(final_dest_path, sizeof(final_dest_path), "%s/%s", destination, source_basename);
 
-            move_or_rename(source, final_dest_path, interactive);
+            move_or_rename(ctx, source, final_dest_path, interactive);
         }
     } 
     // Case 2: Renaming a single file/dir OR moving it into a directory
@@ -101,7 +103,7 @@ int tool_mymv_main(int argc, char **argv) {
         struct stat dest_stat;
 
         // Check if destination exists and is a directory.
-        if (stat(destination, &dest_stat) == 0 && S_ISDIR(dest_stat.st_mode)) {
+        if (fstatat(ctx->cwd_fd, destination, &dest_stat, 0) == 0 && S_ISDIR(dest_stat.st_mode)) {
             // It's a directory, so construct the path to move the source *inside* it.
             char source_copy[MAX_PATH_LEN];
             strncpy(source_copy, source, sizeof(source_copy) - 1);
@@ -111,10 +113,10 @@ int tool_mymv_main(int argc, char **argv) {
             char final_dest_path[MAX_PATH_LEN];
             snprintf(final_dest_path, sizeof(final_dest_path), "%s/%s", destination, source_basename);
             
-            move_or_rename(source, final_dest_path, interactive);
+            move_or_rename(ctx, source, final_dest_path, interactive);
         } else {
             // Destination is not a directory (or doesn't exist), so treat as a simple rename.
-            move_or_rename(source, destination, interactive);
+            move_or_rename(ctx, source, destination, interactive);
         }
     }
 
@@ -128,26 +130,26 @@ int tool_mymv_main(int argc, char **argv) {
  * @param dest The destination path.
  * @param interactive If true, prompt before overwriting an existing file.
  */
-void move_or_rename(const char *source, const char *dest, bool interactive) {
-    if (access(source, F_OK) != 0) {
-        fprintf(stderr, "mymv: cannot stat '%s': %s\n", source, strerror(errno));
+void move_or_rename(tool_ctx *ctx, const char *source, const char *dest, bool interactive) {
+    if (faccessat(ctx->cwd_fd, source, F_OK, 0) != 0) {
+        fprintf(ctx->err, "mymv: cannot stat '%s': %s\n", source, strerror(errno));
         return;
     }
     
-    if (interactive && access(dest, F_OK) == 0) {
-        printf("mymv: overwrite '%s'? ", dest);
-        fflush(stdout);
-        int c = getchar();
+    if (interactive && faccessat(ctx->cwd_fd, dest, F_OK, 0) == 0) {
+        fprintf(ctx->out, "mymv: overwrite '%s'? ", dest);
+        fflush(ctx->out);
+        int c = getc(ctx->in);
         if (c != 'y' && c != 'Y') {
-            while (c != '\n' && c != EOF) { c = getchar(); }
-            fprintf(stderr, "not overwritten\n");
+            while (c != '\n' && c != EOF) { c = getc(ctx->in); }
+            fprintf(ctx->err, "not overwritten\n");
             return;
         }
-        while (c != '\n' && c != EOF) { c = getchar(); }
+        while (c != '\n' && c != EOF) { c = getc(ctx->in); }
     }
 
-    if (rename(source, dest) != 0) {
-        fprintf(stderr, "mymv: cannot move '%s' to '%s': %s\n", source, dest, strerror(errno));
+    if (renameat(ctx->cwd_fd, source, ctx->cwd_fd, dest) != 0) {
+        fprintf(ctx->err, "mymv: cannot move '%s' to '%s': %s\n", source, dest, strerror(errno));
     }
 }
 
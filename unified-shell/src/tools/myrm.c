@@ -31,16 +31,18 @@
 #include <unistd.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include "tools.h"
 
 #define MAX_PATH_LEN 4096
 
 // --- Forward Declarations ---
-void remove_entry(const char *path, bool interactive, bool recursive);
-void remove_directory_recursively(const char *path, bool interactive);
-bool get_confirmation(const char *prompt_type, const char *path);
+void remove_entry(tool_ctx *ctx, const char *path, bool interactive, bool recursive);
+void remove_directory_recursively(tool_ctx *ctx, const char *path, bool interactive);
+bool get_confirmation(tool_ctx *ctx, const char *prompt_type, const char *path);
 
 // --- Main Function ---
-int tool_myrm_main(int argc, char **argv) {
+int tool_myrm_main(tool_ctx *ctx, int argc, char **argv) {
     bool interactive = false;
     bool recursive = false;
     char *paths[argc];
@@ -48,7 +50,7 @@ int tool_myrm_main(int argc, char **argv) {
 
     // --- Argument Parsing ---
     if (argc < 2) {
-        fprintf(stderr, "myrm: missing operand\n");
+        fprintf(ctx->err, "myrm: missing operand\n");
         return 1;
     }
     
@@ -62,7 +64,7 @@ int tool_myrm_main(int argc, char **argv) {
                 } else if (argv[i][j] == 'r') {
                     recursive = true;
                 } else {
-                    fprintf(stderr, "myrm: invalid option -- '%c'\n", argv[i][j]);
+                    fprintf(ctx->err, "myrm: invalid option -- '%c'\n", argv[i][j]);
                     return 1;
                 }
             }
@@ -73,14 +75,14 @@ int tool_myrm_main(int argc, char **argv) {
     }
 
     if (path_count == 0) {
-        fprintf(stderr, "myrm: missing operand\n");
+        fprintf(ctx->err, "myrm: missing operand\n");
         return 1;
     }
     
     // --- Core Logic ---
     // Process each path provided
-    for (int i = 0; i < path_count; i++) {
-        remove_entry(paths[i], interactive, recursive);
+    for (int i = 0; i < path_count && !tool_cancelled(ctx); i++) {
+        remove_entry(ctx, paths[i], interactive, recursive);
     }
 
     return 0;
@@ -93,31 +95,31 @@ int tool_myrm_main(int argc, char **argv) {
  * @param interactive If true, prompt user before removing.
  * @param recursive If true, allow directory removal.
  */
-void remove_entry(const char *path, bool interactive, bool recursive) {
+void remove_entry(tool_ctx *ctx, const char *path, bool interactive, bool recursive) {
     struct stat path_stat;
     // Use lstat to get info without following symbolic links
-    if (lstat(path, &path_stat) != 0) {
-        fprintf(stderr, "myrm: cannot remove '%s': %s\n", path, strerror(errno));
+    if (fstatat(ctx->cwd_fd, path, &path_stat, AT_SYMLINK_NOFOLLOW) != 0) {
+        fprintf(ctx->err, "myrm: cannot remove '%s': %s\n", path, strerror(errno));
         return;
     }
 
     // Check if it's a directory
     if (S_ISDIR(path_stat.st_mode)) {
         if (!recursive) {
-            fprintf(stderr, "myrm: cannot remove '%s': Is a directory\n", path);
+            fprintf(ctx->err, "myrm: cannot remove '%s': Is a directory\n", path);
             return;
         }
-        remove_directory_recursively(path, interactive);
+        remove_directory_recursively(ctx, path, interactive);
     } 
     // It's a file, symbolic link, or other non-directory entry
     else {
         const char* type_str = S_ISLNK(path_stat.st_mode) ? "symbolic link" : "regular file";
-        if (interactive && !get_confirmation(type_str, path)) {
+        if (interactive && !get_confirmation(ctx, type_str, path)) {
             return; // User said no
         }
         
-        if (unlink(path) != 0) {
-            fprintf(stderr, "myrm: cannot remove '%s': %s\n", path, strerror(errno));
+        if (unlinkat(ctx->cwd_fd, path, 0) != 0) {
+            fprintf(ctx->err, "myrm: cannot remove '%s': %s\n", path, strerror(errno));
         }
     }
 }
@@ -127,16 +129,16 @@ void remove_entry(const char *path, bool interactive, bool recursive) {
  * * @param path The path to the directory.
  * @param interactive If true, prompt for each entry within the directory.
  */
-void remove_directory_recursively(const char *path, bool interactive) {
-    DIR *dir = opendir(path);
+void remove_directory_recursively(tool_ctx *ctx, const char *path, bool interactive) {
+    DIR *dir = tool_opendir(ctx, path);
     if (!dir) {
-        fprintf(stderr, "myrm: cannot open directory '%s': %s\n", path, strerror(errno));
+        fprintf(ctx->err, "myrm: cannot open directory '%s': %s\n", path, strerror(errno));
         return;
     }
 
     struct dirent *entry;
     // Iterate over all entries in the directory
-    while ((entry = readdir(dir)) != NULL) {
+    while (!tool_cancelled(ctx) && (entry = readdir(dir)) != NULL) {
         // Skip special directories '.' and '..'
         if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
             continue;
@@ -147,17 +149,17 @@ void remove_directory_recursively(const char *path, bool interactive) {
         snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
 
         // Recursively call the main removal function for the entry
-        remove_entry(full_path, interactive, true); // recursive must be true here
+        remove_entry(ctx, full_path, interactive, true); // recursive must be true here
     }
     closedir(dir);
 
     // After removing contents, remove the directory itself
-    if (interactive && !get_confirmation("directory", path)) {
+    if (tool_cancelled(ctx) || (interactive && !get_confirmation(ctx, "directory", path))) {
         return; // User said no
     }
 
-    if (rmdir(path) != 0) {
-        fprintf(stderr, "myrm: cannot remove directory '%s': %s\n", path, strerror(errno));
+    if (unlinkat(ctx->cwd_fd, path, AT_REMOVEDIR) != 0) {
+        fprintf(ctx->err, "myrm: cannot remove directory '%s': %s\n", path, strerror(errno));
     }
 }
 
@@ -167,16 +169,16 @@ void remove_directory_recursively(const char *path, bool interactive) {
  * @param path The path of the file being considered for removal.
  * @return true if the user confirms, false otherwise.
  */
-bool get_confirmation(const char *prompt_type, const char *path) {
-    printf("myrm: remove %s '%s'? ", prompt_type, path);
-    fflush(stdout); // Ensure the prompt is shown
+bool get_confirmation(tool_ctx *ctx, const char *prompt_type, const char *path) {
+    fprintf(ctx->out, "myrm: remove %s '%s'? ", prompt_type, path);
+    fflush(ctx->out); // Ensure the prompt is shown
 
-    int c = getchar();
+    int c = getc(ctx->in);
     bool confirmed = (c == 'y' || c == 'Y');
 
     // Consume the rest of the line (e.g., the Enter key)
     while (c != '\n' && c != EOF) {
-        c = getchar();
+        c = getc(ctx->in);
     }
 
     return confirmed;
@@ -22,21 +22,23 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
+#include "tools.h"
 
 // --- Forward Declaration ---
-void remove_empty_directory(const char *path);
+void remove_empty_directory(tool_ctx *ctx, const char *path);
 
 // --- Main Function ---
-int tool_myrmdir_main(int argc, char **argv) {
+int tool_myrmdir_main(tool_ctx *ctx, int argc, char **argv) {
     if (argc < 2) {
-        fprintf(stderr, "myrmdir: missing operand\n");
+        fprintf(ctx->err, "myrmdir: missing operand\n");
         return 1;
     }
 
     // --- Core Logic ---
     // Process each path provided
     for (int i = 1; i < argc; i++) {
-        remove_empty_directory(argv[i]);
+        remove_empty_directory(ctx, argv[i]);
     }
 
     return 0;
@@ -48,29 +50,29 @@ int tool_myrmdir_main(int argc, char **argv) {
  *
  * @param path The path to the directory to be removed.
  */
-void remove_empty_directory(const char *path) {
+void remove_empty_directory(tool_ctx *ctx, const char *path) {
     struct stat path_stat;
 
     // Use lstat to check the path without following symlinks
-    if (lstat(path, &path_stat) != 0) {
-        fprintf(stderr, "myrmdir: failed to remove '%s': %s\n", path, strerror(errno));
+    if (fstatat(ctx->cwd_fd, path, &path_stat, AT_SYMLINK_NOFOLLOW) != 0) {
+        fprintf(ctx->err, "myrmdir: failed to remove '%s': %s\n", path, strerror(errno));
         return;
     }
 
     // Check if the path is actually a directory
     if (!S_ISDIR(path_stat.st_mode)) {
-        fprintf(stderr, "myrmdir: failed to remove '%s': Not a directory\n", path);
+        fprintf(ctx->err, "myrmdir: failed to remove '%s': Not a directory\n", path);
         return;
     }
 
     // Attempt to remove the directory
-    if (rmdir(path) != 0) {
+    if (unlinkat(ctx->cwd_fd, path, AT_REMOVEDIR) != 0) {
         // Provide a specific error message if the directory is not empty
         if (errno == ENOTEMPTY) {
-            fprintf(stderr, "myrmdir: failed to remove '%s': Directory not empty\n", path);
+            fprintf(ctx->err, "myrmdir: failed to remove '%s': Directory not empty\n", path);
         } else {
             // Provide a generic message for other errors (e.g., permissions)
-            fprintf(stderr, "myrmdir: failed to remove '%s': %s\n", path, strerror(errno));
+            fprintf(ctx->err, "myrmdir: failed to remove '%s': %s\n", path, strerror(errno));
         }
     }
 }
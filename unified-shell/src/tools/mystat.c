@@ -22,24 +22,26 @@
 #include <grp.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include "tools.h"
 
 // --- Forward Declarations ---
-void display_stat_info(const char *path);
+void display_stat_info(tool_ctx *ctx, const char *path);
 void format_permissions(mode_t mode, char *str);
 const char* get_file_type(mode_t mode);
 
 // --- Main Function ---
-int tool_mystat_main(int argc, char **argv) {
+int tool_mystat_main(tool_ctx *ctx, int argc, char **argv) {
     if (argc < 2) {
-        fprintf(stderr, "mystat: missing operand\n");
+        fprintf(ctx->err, "mystat: missing operand\n");
         return 1;
     }
 
     // Process each file path provided as an argument
     for (int i = 1; i < argc; i++) {
-        display_stat_info(argv[i]);
+        display_stat_info(ctx, argv[i]);
         if (i < argc - 1) {
-            printf("\n"); // Add a newline between outputs for multiple files
+            fprintf(ctx->out, "\n"); // Add a newline between outputs for multiple files
         }
     }
 
@@ -51,13 +53,13 @@ int tool_mystat_main(int argc, char **argv) {
  *
  * @param path The path to the file to inspect.
  */
-void display_stat_info(const char *path) {
+void display_stat_info(tool_ctx *ctx, const char *path) {
     struct stat sb;
 
     // Use lstat() to get information about the file itself,
     // not what it points to if it's a symbolic link.
-    if (lstat(path, &sb) == -1) {
-        fprintf(stderr, "mystat: cannot stat '%s': %s\n", path, strerror(errno));
+    if (fstatat(ctx->cwd_fd, path, &sb, AT_SYMLINK_NOFOLLOW) == -1) {
+        fprintf(ctx->err, "mystat: cannot stat '%s': %s\n", path, strerror(errno));
         return;
     }
 
@@ -67,45 +69,48 @@ void display_stat_info(const char *path) {
     char perms_str[11];
     format_permissions(sb.st_mode, perms_str);
 
-    // 2. User and Group names
-    struct passwd *pw = getpwuid(sb.st_uid);
-    struct group  *gr = getgrgid(sb.st_gid);
+    // 2. User and Group names (reentrant: other tools may run concurrently)
+    char pw_buf[1024], gr_buf[1024];
+    struct passwd pw_store, *pw = NULL;
+    struct group  gr_store, *gr = NULL;
+    getpwuid_r(sb.st_uid, &pw_store, pw_buf, sizeof(pw_buf), &pw);
+    getgrgid_r(sb.st_gid, &gr_store, gr_buf, sizeof(gr_buf), &gr);
     const char *user_name = pw ? pw->pw_name : "UNKNOWN";
     const char *group_name = gr ? gr->gr_name : "UNKNOWN";
 
     // 3. Timestamps
     char access_time[100], modify_time[100], change_time[100];
     char time_buffer[64];
-    struct tm *tm_info;
+    struct tm tm_store, *tm_info;
 
     // Access time
-    tm_info = localtime(&sb.st_atim.tv_sec);
+    tm_info = localtime_r(&sb.st_atim.tv_sec, &tm_store);
     strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", tm_info);
     snprintf(access_time, sizeof(access_time), "%s.%09ld %s", time_buffer, sb.st_atim.tv_nsec, tm_info->tm_zone);
 
     // Modify time
-    tm_info = localtime(&sb.st_mtim.tv_sec);
+    tm_info = localtime_r(&sb.st_mtim.tv_sec, &tm_store);
     strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", tm_info);
     snprintf(modify_time, sizeof(modify_time), "%s.%09ld %s", time_buffer, sb.st_mtim.tv_nsec, tm_info->tm_zone);
 
     // Change time
-    tm_info = localtime(&sb.st_ctim.tv_sec);
+    tm_info = localtime_r(&sb.st_ctim.tv_sec, &tm_store);
     strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", tm_info);
     snprintf(change_time, sizeof(change_time), "%s.%09ld %s", time_buffer, sb.st_ctim.tv_nsec, tm_info->tm_zone);
 
 
     // --- Print Formatted Output ---
 
-    printf("  File: %s\n", path);
-    printf("  Size: %-15ld Blocks: %-10ld IO Block: %-6ld %s\n",
+    fprintf(ctx->out, "  File: %s\n", path);
+    fprintf(ctx->out, "  Size: %-15ld Blocks: %-10ld IO Block: %-6ld %s\n",
            (long)sb.st_size, (long)sb.st_blocks, (long)sb.st_blksize, get_file_type(sb.st_mode));
-    printf("Device: %lxh/%lud\t Inode: %-11lu Links: %lu\n",
+    fprintf(ctx->out, "Device: %lxh/%lud\t Inode: %-11lu Links: %lu\n",
            (unsigned long)sb.st_dev, (unsigned long)sb.st_dev, (unsigned long)sb.st_ino, (unsigned long)sb.st_nlink);
-    printf("Access: (%04o/%s)  Uid: (%5u/%8s)   Gid: (%5u/%8s)\n",
+    fprintf(ctx->out, "Access: (%04o/%s)  Uid: (%5u/%8s)   Gid: (%5u/%8s)\n",
            sb.st_mode & 07777, perms_str, sb.st_uid, user_name, sb.st_gid, group_name);
-    printf("Access: %s\n", access_time);
-    printf("Modify: %s\n", modify_time);
-    printf("Change: %s\n", change_time);
+    fprintf(ctx->out, "Access: %s\n", access_time);
+    fprintf(ctx->out, "Modify: %s\n", modify_time);
+    fprintf(ctx->out, "Change: %s\n", change_time);
 }
 
 /**
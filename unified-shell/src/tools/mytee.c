@@ -0,0 +1,391 @@
+/**
+ * @file mytee.c
+ * @brief Copy standard input to standard output and to files.
+ *
+ * When the input is a pipe, pipe outputs (standard output in a pipeline,
+ * FIFOs, /dev/fd/N from >(cmd)) get their copy with tee(2): the kernel
+ * duplicates the pipe buffers without reading the data into this process.
+ * The last pipe output takes the data with splice(2), which also consumes
+ * it from the input. Only when a regular file or terminal needs the data
+ * is it read, once per chunk, into one large buffer and written from there.
+ * A pipe input with nothing but regular files behind it, or an input that
+ * is not a pipe, uses the buffer for everything.
+ *
+ * An output whose reader has gone away (EPIPE) is dropped quietly and the
+ * others keep going; SIGPIPE is blocked in the calling thread while mytee
+ * runs, so it works the same in a pipeline stage, in the shell and on a
+ * pool worker.
+ *
+ * Example Usages:
+ *
+ * # Keep a copy of a build log while watching it
+ * make | mytee build.log
+ *
+ * # Append to two files
+ * echo done | mytee -a a.log b.log
+ *
+ * # Fan a stream out to two consumers without copying it
+ * mycat big.dat | mytee >(sha256sum) >(wc -c) > /dev/null
+ */
+
+#define _GNU_SOURCE // tee, splice
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "tools.h"
+
+#define MYTEE_CHUNK (256 * 1024)
+#define MYTEE_MAX_FILES 64
+
+// --- Data Structures ---
+
+// One output: standard output or a named file.
+typedef struct {
+    const char *name;
+    int fd;             // -1 when only a stream is available
+    FILE *stream;       // Standard output without a descriptor
+    int is_pipe;
+    int dead;           // Reader gone or write failed
+} Sink;
+
+typedef struct {
+    tool_ctx *ctx;
+    Sink sinks[MYTEE_MAX_FILES + 1];
+    int count;
+    int status;
+    char *buf;          // MYTEE_CHUNK bytes
+} Tee;
+
+static void print_usage(FILE *out) {
+    fprintf(out, "Usage: mytee [-a] [FILE...]\n");
+    fprintf(out, "Copy standard input to standard output and to each FILE.\n\n");
+    fprintf(out, "  -a, --append   append to the files instead of overwriting them\n");
+    fprintf(out, "  -h, --help     show this help\n");
+}
+
+/**
+ * @brief Drop a sink after an error; EPIPE is expected and not reported.
+ */
+static void sink_fail(Tee *mt, Sink *sink, int err) {
+    sink->dead = 1;
+    if (err != EPIPE) {
+        fprintf(mt->ctx->err, "mytee: %s: %s\n", sink->name, strerror(err));
+        mt->status = 1;
+    }
+}
+
+/**
+ * @brief Write len bytes of data to one sink, retrying short writes.
+ */
+static void sink_write(Tee *mt, Sink *sink, const char *data, size_t len) {
+    if (sink->fd < 0) {
+        if (fwrite(data, 1, len, sink->stream) != len) {
+            sink_fail(mt, sink, errno);
+        }
+        return;
+    }
+    while (len > 0) {
+        ssize_t n = write(sink->fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR && !tool_cancelled(mt->ctx)) {
+                continue;
+            }
+            sink_fail(mt, sink, errno);
+            return;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+static int live_sinks(const Tee *mt) {
+    int live = 0;
+    for (int i = 0; i < mt->count; i++) {
+        live += !mt->sinks[i].dead;
+    }
+    return live;
+}
+
+/**
+ * @brief Read exactly len bytes (or up to EOF) into the buffer.
+ */
+static ssize_t read_full(Tee *mt, int in, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = read(in, mt->buf + got, len - got);
+        if (n < 0 && errno == EINTR && !tool_cancelled(mt->ctx)) {
+            continue;
+        }
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        got += (size_t)n;
+    }
+    return (ssize_t)got;
+}
+
+/**
+ * @brief Buffered copy: one read per chunk, written to every sink.
+ */
+static int copy_buffered(Tee *mt, int in) {
+    while (!tool_cancelled(mt->ctx) && live_sinks(mt) > 0) {
+        ssize_t n = read(in, mt->buf, MYTEE_CHUNK);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return n < 0 ? -1 : 0;
+        }
+        for (int i = 0; i < mt->count; i++) {
+            if (!mt->sinks[i].dead) {
+                sink_write(mt, &mt->sinks[i], mt->buf, (size_t)n);
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Move up to len bytes from in to a pipe sink, consuming them.
+ * @return Bytes moved, 0 at end of input, -1 if the sink failed
+ */
+static ssize_t splice_to(Tee *mt, int in, Sink *sink, size_t len) {
+    for (;;) {
+        ssize_t n = splice(in, NULL, sink->fd, NULL, len, SPLICE_F_MOVE);
+        if (n < 0 && errno == EINTR && !tool_cancelled(mt->ctx)) {
+            continue;
+        }
+        if (n < 0) {
+            sink_fail(mt, sink, errno);
+        }
+        return n;
+    }
+}
+
+/**
+ * @brief Zero-copy fan-out from a pipe.
+ *
+ * Each round tee(2)s one chunk into every pipe sink but one without
+ * consuming it; the first tee sets the chunk size. The chunk is then
+ * spliced into the remaining pipe sink, or read into the buffer when a
+ * file needs it or a pipe sink took less than the whole chunk.
+ */
+static int copy_spliced(Tee *mt, int in) {
+    size_t shortfall[MYTEE_MAX_FILES + 1];
+
+    while (!tool_cancelled(mt->ctx) && live_sinks(mt) > 0) {
+        int consumer = -1;
+        int files = 0;
+        for (int i = 0; i < mt->count; i++) {
+            if (!mt->sinks[i].dead) {
+                if (mt->sinks[i].is_pipe) {
+                    consumer = i;
+                } else {
+                    files = 1;
+                }
+            }
+        }
+        if (consumer < 0) {
+            return copy_buffered(mt, in);
+        }
+        if (files) {
+            consumer = -1;  // The chunk is read anyway: tee to every pipe
+        }
+
+        ssize_t chunk = -1;
+        int need_buffer = files;
+        for (int i = 0; i < mt->count; i++) {
+            Sink *sink = &mt->sinks[i];
+            shortfall[i] = 0;
+            if (sink->dead || !sink->is_pipe || i == consumer) {
+                continue;
+            }
+            ssize_t n;
+            do {
+                n = tee(in, sink->fd, chunk < 0 ? MYTEE_CHUNK : (size_t)chunk, 0);
+            } while (n < 0 && errno == EINTR && !tool_cancelled(mt->ctx));
+            if (n < 0) {
+                sink_fail(mt, sink, errno);
+                continue;
+            }
+            if (chunk < 0) {
+                if (n == 0) {
+                    return 0;  // End of input
+                }
+                chunk = n;
+            }
+            shortfall[i] = (size_t)(chunk - n);
+            need_buffer |= shortfall[i] > 0;
+        }
+
+        if (chunk < 0 && consumer < 0) {
+            return copy_buffered(mt, in);  // Every pipe sink failed
+        }
+        if (chunk < 0) {
+            // Only the consumer is left: plain splice
+            if (splice_to(mt, in, &mt->sinks[consumer], MYTEE_CHUNK) == 0) {
+                return 0;
+            }
+            continue;
+        }
+
+        if (!need_buffer) {
+            size_t left = (size_t)chunk;
+            while (left > 0) {
+                ssize_t n = splice_to(mt, in, &mt->sinks[consumer], left);
+                if (n <= 0) {
+                    break;
+                }
+                left -= (size_t)n;
+            }
+            if (left == 0) {
+                continue;
+            }
+            // The consumer failed: the rest of the chunk is consumed below
+            chunk = (ssize_t)left;
+            consumer = -1;
+        }
+
+        ssize_t got = read_full(mt, in, (size_t)chunk);
+        if (got < 0) {
+            return -1;
+        }
+        for (int i = 0; i < mt->count; i++) {
+            Sink *sink = &mt->sinks[i];
+            if (sink->dead) {
+                continue;
+            }
+            if (!sink->is_pipe || i == consumer) {
+                sink_write(mt, sink, mt->buf, (size_t)got);
+            } else if (shortfall[i] > 0 && shortfall[i] <= (size_t)got) {
+                sink_write(mt, sink, mt->buf + got - shortfall[i], shortfall[i]);
+            }
+        }
+    }
+    return 0;
+}
+
+static int fd_is_pipe(int fd) {
+    struct stat st;
+    return fd >= 0 && fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+// --- Main Function ---
+int tool_mytee_main(tool_ctx *ctx, int argc, char **argv) {
+    Tee state = { .ctx = ctx };
+    int append = 0;
+    int first_file = argc;
+
+    // --- Argument Parsing ---
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--") == 0) {
+            first_file = i + 1;
+            break;
+        } else if (strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--append") == 0) {
+            append = 1;
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_usage(ctx->out);
+            return 0;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            fprintf(ctx->err, "mytee: unknown option '%s'\n", argv[i]);
+            print_usage(ctx->err);
+            return 1;
+        } else {
+            first_file = i;
+            break;
+        }
+    }
+    if (argc - first_file > MYTEE_MAX_FILES) {
+        fprintf(ctx->err, "mytee: too many files (max %d)\n", MYTEE_MAX_FILES);
+        return 1;
+    }
+
+    // --- Sinks: standard output first, then the files in order ---
+    fflush(ctx->out);
+    Sink *out = &state.sinks[state.count++];
+    out->name = "standard output";
+    out->fd = fileno(ctx->out);
+    out->stream = ctx->out;
+    out->is_pipe = fd_is_pipe(out->fd);
+
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC);
+    for (int i = first_file; i < argc; i++) {
+        int fd = tool_open(ctx, argv[i], flags, 0666);
+        if (fd < 0) {
+            fprintf(ctx->err, "mytee: %s: %s\n", argv[i], strerror(errno));
+            state.status = 1;
+            continue;
+        }
+        Sink *sink = &state.sinks[state.count++];
+        sink->name = argv[i];
+        sink->fd = fd;
+        sink->is_pipe = fd_is_pipe(fd);
+    }
+
+    // A sink whose reader is gone must fail with EPIPE, not kill the shell
+    sigset_t pipe_set, saved_mask;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, &saved_mask);
+    int pipe_was_pending = 0;
+    sigset_t pending;
+    if (sigpending(&pending) == 0) {
+        pipe_was_pending = sigismember(&pending, SIGPIPE);
+    }
+
+    state.buf = malloc(MYTEE_CHUNK);
+    int in = fileno(ctx->in);
+    int ret;
+    if (state.buf == NULL) {
+        fprintf(ctx->err, "mytee: %s\n", strerror(errno));
+        ret = 0;
+        state.status = 1;
+    } else if (in < 0) {
+        // Input stream without a descriptor: copy through stdio
+        size_t n;
+        while (!tool_cancelled(ctx) && live_sinks(&state) > 0 &&
+               (n = fread(state.buf, 1, MYTEE_CHUNK, ctx->in)) > 0) {
+            for (int i = 0; i < state.count; i++) {
+                if (!state.sinks[i].dead) {
+                    sink_write(&state, &state.sinks[i], state.buf, n);
+                }
+            }
+        }
+        ret = ferror(ctx->in) ? -1 : 0;
+    } else if (fd_is_pipe(in) && out->fd >= 0) {
+        ret = copy_spliced(&state, in);
+    } else {
+        ret = copy_buffered(&state, in);
+    }
+    if (ret < 0 && !tool_cancelled(ctx)) {
+        fprintf(ctx->err, "mytee: read error: %s\n", strerror(errno));
+        state.status = 1;
+    }
+
+    // Discard the SIGPIPEs raised here before unblocking
+    if (!pipe_was_pending) {
+        struct timespec zero = { 0, 0 };
+        while (sigtimedwait(&pipe_set, NULL, &zero) > 0) {
+            continue;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &saved_mask, NULL);
+
+    for (int i = 1; i < state.count; i++) {
+        if (close(state.sinks[i].fd) < 0 && !state.sinks[i].dead) {
+            fprintf(ctx->err, "mytee: %s: %s\n", state.sinks[i].name, strerror(errno));
+            state.status = 1;
+        }
+    }
+    free(state.buf);
+    return state.status;
+}
@@ -25,24 +25,24 @@
 #include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
-#include <utime.h>
 #include <errno.h>
 #include <sys/stat.h>
+#include "tools.h"
 
 // --- Forward Declaration ---
-void touch_file(const char *path);
+void touch_file(tool_ctx *ctx, const char *path);
 
 // --- Main Function ---
-int tool_mytouch_main(int argc, char **argv) {
+int tool_mytouch_main(tool_ctx *ctx, int argc, char **argv) {
     if (argc < 2) {
-        fprintf(stderr, "mytouch: missing file operand\n");
+        fprintf(ctx->err, "mytouch: missing file operand\n");
         return 1;
     }
 
     // --- Core Logic ---
     // Process each path provided
     for (int i = 1; i < argc; i++) {
-        touch_file(argv[i]);
+        touch_file(ctx, argv[i]);
     }
 
     return 0;
@@ -54,26 +54,26 @@ int tool_mytouch_main(int argc, char **argv) {
  *
  * @param path The path to the file to create or update.
  */
-void touch_file(const char *path) {
+void touch_file(tool_ctx *ctx, const char *path) {
     // First, check if the file exists.
-    int file_exists = (access(path, F_OK) == 0);
+    int file_exists = (faccessat(ctx->cwd_fd, path, F_OK, 0) == 0);
 
     if (!file_exists) {
         // File does not exist, so create it.
         // O_CREAT: create the file if it does not exist.
         // O_WRONLY: open for writing only.
-        int fd = open(path, O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH); // 0644 permissions
+        int fd = tool_open(ctx, path, O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH); // 0644 permissions
         if (fd == -1) {
-            fprintf(stderr, "mytouch: cannot touch '%s': %s\n", path, strerror(errno));
+            fprintf(ctx->err, "mytouch: cannot touch '%s': %s\n", path, strerror(errno));
             return;
         }
         close(fd);
     } else {
         // File exists, so update its timestamps.
-        // Passing NULL to utime() sets the access and modification
+        // Passing NULL to utimensat() sets the access and modification
         // times to the current time.
-        if (utime(path, NULL) != 0) {
-            fprintf(stderr, "mytouch: cannot touch '%s': %s\n", path, strerror(errno));
+        if (utimensat(ctx->cwd_fd, path, NULL, 0) != 0) {
+            fprintf(ctx->err, "mytouch: cannot touch '%s': %s\n", path, strerror(errno));
         }
     }
 }
@@ -2,58 +2,124 @@
  * @file tool_dispatch.c
  * @brief Tool dispatch system for integrated shell utilities
  * 
- * This file implements a dispatch table for built-in tools that are
+ * This file implements dispatch for built-in tools that are
  * integrated into the shell. Tools are executed without requiring PATH
  * lookup or external binaries.
  */
 
+#define _GNU_SOURCE     // O_PATH
 #include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "tools.h"
-
-/**
- * @brief Tool table entry structure
- */
-typedef struct {
-    const char *name;
-    tool_func func;
-} ToolEntry;
-
-/**
- * @brief Dispatch table mapping tool names to their main functions
- * 
- * This table allows the shell to execute integrated tools directly
- * without spawning external processes.
- */
-static ToolEntry tool_table[] = {
-    {"myls", tool_myls_main},
-    {"mycat", tool_mycat_main},
-    {"mycp", tool_mycp_main},
-    {"mymv", tool_mymv_main},
-    {"myrm", tool_myrm_main},
-    {"mymkdir", tool_mymkdir_main},
-    {"myrmdir", tool_myrmdir_main},
-    {"mytouch", tool_mytouch_main},
-    {"mystat", tool_mystat_main},
-    {"myfd", tool_myfd_main},
-    {NULL, NULL}  // Sentinel to mark end of table
-};
+#include "registry.h"
+#include "signals.h"
 
 /**
  * @brief Find a tool function by name
  * 
+ * Tools are REG_TOOL rows of the command registry (commands.def).
+ * 
  * @param name The name of the tool to find (e.g., "myls")
  * @return The tool function pointer if found, NULL otherwise
  */
 tool_func find_tool(const char *name) {
-    if (name == NULL) {
-        return NULL;
+    const RegistryEntry *e = registry_lookup(name);
+    return e != NULL ? e->tool : NULL;
+}
+
+void tool_ctx_init(tool_ctx *ctx, Env *env) {
+    ctx->in = stdin;
+    ctx->out = stdout;
+    ctx->err = stderr;
+    ctx->cwd_fd = AT_FDCWD;
+    ctx->env = env;
+    ctx->cancel = &sigint_received;
+    ctx->cancel_fd = -1;    // Ctrl+C interrupts blocking calls with EINTR
+    ctx->gate = NULL;
+}
+
+int tool_run(tool_func tool, char **argv, Env *env) {
+    int argc = 0;
+    while (argv[argc] != NULL) {
+        argc++;
     }
-    
-    for (int i = 0; tool_table[i].name != NULL; i++) {
-        if (strcmp(tool_table[i].name, name) == 0) {
-            return tool_table[i].func;
+
+    tool_ctx ctx;
+    tool_ctx_init(&ctx, env);
+    sigint_received = 0;
+
+    int status = tool(&ctx, argc, argv);
+    fflush(ctx.out);
+    return tool_cancelled(&ctx) ? 130 : status;
+}
+
+int tool_cancelled(const tool_ctx *ctx) {
+    tool_gate *gate = ctx->gate;
+    if (gate != NULL && __atomic_load_n(&gate->paused, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&gate->lock);
+        while (gate->paused && !*ctx->cancel) {
+            pthread_cond_wait(&gate->resume, &gate->lock);
         }
+        pthread_mutex_unlock(&gate->lock);
+    }
+    return ctx->cancel != NULL && __atomic_load_n(ctx->cancel, __ATOMIC_RELAXED) != 0;
+}
+
+/* ---------------------------------------------------------------------
+ * Path helpers: tools never depend on the process working directory
+ * --------------------------------------------------------------------- */
+
+int tool_open(const tool_ctx *ctx, const char *path, int flags, mode_t mode) {
+    return openat(ctx->cwd_fd, path, flags | O_CLOEXEC, mode);
+}
+
+FILE *tool_fopen_read(const tool_ctx *ctx, const char *path) {
+    int fd = tool_open(ctx, path, O_RDONLY, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    FILE *f = fdopen(fd, "r");
+    if (f == NULL) {
+        close(fd);
+    }
+    return f;
+}
+
+DIR *tool_opendir(const tool_ctx *ctx, const char *path) {
+    int fd = tool_open(ctx, path, O_RDONLY | O_DIRECTORY, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    DIR *d = fdopendir(fd);
+    if (d == NULL) {
+        close(fd);
+    }
+    return d;
+}
+
+/**
+ * @brief realpath() relative to ctx->cwd_fd
+ * @param resolved Buffer of at least PATH_MAX bytes
+ */
+char *tool_realpath(const tool_ctx *ctx, const char *path, char *resolved) {
+    if (ctx->cwd_fd == AT_FDCWD || path[0] == '/') {
+        return realpath(path, resolved);
+    }
+
+    int fd = openat(ctx->cwd_fd, path, O_PATH | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    char link[64];
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+    ssize_t len = readlink(link, resolved, PATH_MAX - 1);
+    close(fd);
+    if (len < 0) {
+        return NULL;
     }
-    
-    return NULL;
+    resolved[len] = '\0';
+    return resolved;
 }
@@ -0,0 +1,98 @@
+/**
+ * arena.c - Bump-pointer arena allocator
+ *
+ * Memory is carved sequentially out of chunks obtained with malloc.
+ * When a chunk is exhausted a new one (at least chunk_size bytes, larger
+ * for oversized requests) is pushed onto the front of the chunk list.
+ * Nothing is freed individually; arena_reset() and arena_free() release
+ * everything at once.
+ */
+
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+
+#define ARENA_DEFAULT_CHUNK (64 * 1024)
+#define ARENA_ALIGN alignof(max_align_t)
+
+static ArenaChunk *arena_new_chunk(size_t size) {
+    ArenaChunk *chunk = malloc(sizeof(ArenaChunk) + size);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+void arena_init(Arena *arena, size_t chunk_size) {
+    arena->head = NULL;
+    arena->chunk_size = chunk_size ? chunk_size : ARENA_DEFAULT_CHUNK;
+    arena->total_allocated = 0;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    size_t aligned = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    ArenaChunk *chunk = arena->head;
+
+    if (chunk == NULL || chunk->size - chunk->used < aligned) {
+        size_t want = aligned > arena->chunk_size ? aligned : arena->chunk_size;
+        ArenaChunk *fresh = arena_new_chunk(want);
+        if (fresh == NULL) {
+            return NULL;
+        }
+        fresh->next = chunk;
+        arena->head = fresh;
+        chunk = fresh;
+    }
+
+    void *ptr = chunk->data + chunk->used;
+    chunk->used += aligned;
+    arena->total_allocated += aligned;
+    return ptr;
+}
+
+char *arena_strndup(Arena *arena, const char *str, size_t len) {
+    // Strings need no alignment, but sharing arena_alloc keeps one code path
+    char *copy = arena_alloc(arena, len + 1);
+    if (copy == NULL) {
+        return NULL;
+    }
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+char *arena_strdup(Arena *arena, const char *str) {
+    return arena_strndup(arena, str, strlen(str));
+}
+
+void arena_reset(Arena *arena) {
+    ArenaChunk *chunk = arena->head;
+    if (chunk == NULL) {
+        return;
+    }
+
+    // Keep the oldest chunk (the tail) and drop the rest
+    while (chunk->next != NULL) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    chunk->used = 0;
+    arena->head = chunk;
+    arena->total_allocated = 0;
+}
+
+void arena_free(Arena *arena) {
+    ArenaChunk *chunk = arena->head;
+    while (chunk != NULL) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->head = NULL;
+    arena->total_allocated = 0;
+}
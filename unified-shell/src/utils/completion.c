@@ -1,5 +1,6 @@
 #include "completion.h"
 #include "builtins.h"
+#include "registry.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -9,15 +10,6 @@
 
 static Env *completion_env = NULL;
 
-// Built-in command names for tab completion
-static const char *builtin_command_names[] = {
-    "cd", "pwd", "echo", "export", "exit", "set", "unset", 
-    "env", "help", "version", "history", "edi",
-    "myls", "mycat", "mycp", "mymv", "myrm", 
-    "mymkdir", "myrmdir", "mytouch", "mystat", "myfd",
-    NULL
-};
-
 void completion_init(Env *env) {
     completion_env = env;
 }
@@ -43,8 +35,8 @@ char** completion_get_commands(int *count) {
         return NULL;
     }
     
-    // Add built-in commands
-    for (int i = 0; builtin_command_names[i] != NULL; i++) {
+    // Add built-in commands and tools (from commands.def)
+    for (int i = 0; registry_completion_names[i] != NULL; i++) {
         if (cnt >= capacity - 1) {
             capacity *= 2;
             char **new_cmds = realloc(commands, capacity * sizeof(char*));
@@ -55,7 +47,7 @@ char** completion_get_commands(int *count) {
             }
             commands = new_cmds;
         }
-        commands[cnt++] = strdup(builtin_command_names[i]);
+        commands[cnt++] = strdup(registry_completion_names[i]);
     }
     
     commands[cnt] = NULL;
@@ -0,0 +1,293 @@
+/**
+ * eventloop.c - One epoll loop for everything the prompt waits on
+ *
+ * The line editor used to block in read(2) on the terminal, so finished
+ * jobs were only noticed between prompts and messages from the MCP thread
+ * were printed straight over the line being edited. Now the editor asks
+ * this loop for input; while it waits, child exits, resizes and notices
+ * are handled here and printed above the prompt in one redraw.
+ *
+ * Signal handlers stay flag-only: they set a flag and write the eventfd
+ * (see signals.c). The signalfd is the main path; the eventfd covers
+ * signals the kernel delivers to a worker thread instead.
+ */
+
+#define _GNU_SOURCE
+#include "eventloop.h"
+#include "signals.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+
+// Notices arriving within this window share one redraw
+#define NOTICE_BATCH_NS (15 * 1000 * 1000)
+
+static int epoll_fd = -1;
+static int signal_fd = -1;
+static int timer_fd = -1;
+static int wake_fd = -1;
+static int watched_fd = -1;     // Descriptor currently in the epoll set
+static int timer_armed = 0;
+static sigset_t loop_signals;
+
+static void (*child_handler)(void) = NULL;
+static void (*print_callback)(const char *text, size_t len) = NULL;
+static void (*resize_callback)(void) = NULL;
+
+// Queued notice text, appended by any thread
+static pthread_mutex_t notice_mutex = PTHREAD_MUTEX_INITIALIZER;
+static char *notice_text = NULL;
+static size_t notice_len = 0;
+static size_t notice_cap = 0;
+
+static int add_fd(int fd) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+int eventloop_init(void) {
+    if (epoll_fd >= 0) {
+        return 0;
+    }
+
+    sigemptyset(&loop_signals);
+    sigaddset(&loop_signals, SIGCHLD);
+    sigaddset(&loop_signals, SIGWINCH);
+    sigaddset(&loop_signals, SIGINT);
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    signal_fd = signalfd(-1, &loop_signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd < 0 || signal_fd < 0 || timer_fd < 0 || wake_fd < 0 ||
+        add_fd(signal_fd) < 0 || add_fd(timer_fd) < 0 || add_fd(wake_fd) < 0) {
+        int fds[] = { epoll_fd, signal_fd, timer_fd, wake_fd };
+        for (int i = 0; i < 4; i++) {
+            if (fds[i] >= 0) close(fds[i]);
+        }
+        epoll_fd = signal_fd = timer_fd = wake_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+int eventloop_active(void) {
+    return epoll_fd >= 0;
+}
+
+void eventloop_set_child_handler(void (*handler)(void)) {
+    child_handler = handler;
+}
+
+void eventloop_set_display_callbacks(void (*print)(const char *text, size_t len),
+                                     void (*resize)(void)) {
+    print_callback = print;
+    resize_callback = resize;
+}
+
+void eventloop_wake(void) {
+    if (wake_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = write(wake_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+void shell_notice(const char *fmt, ...) {
+    char stack_buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(stack_buf, sizeof(stack_buf), fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+        return;
+    }
+
+    char *text = stack_buf;
+    if ((size_t)n >= sizeof(stack_buf)) {
+        text = malloc((size_t)n + 1);
+        if (text == NULL) {
+            return;
+        }
+        va_start(ap, fmt);
+        vsnprintf(text, (size_t)n + 1, fmt, ap);
+        va_end(ap);
+    }
+    int newline = (n == 0 || text[n - 1] != '\n');
+
+    if (!eventloop_active()) {
+        // No line editor to protect: print right away
+        fputs(text, stdout);
+        if (newline) fputc('\n', stdout);
+        fflush(stdout);
+    } else {
+        pthread_mutex_lock(&notice_mutex);
+        size_t need = notice_len + (size_t)n + 2;
+        if (need > notice_cap) {
+            size_t cap = notice_cap ? notice_cap * 2 : 1024;
+            while (cap < need) cap *= 2;
+            char *grown = realloc(notice_text, cap);
+            if (grown != NULL) {
+                notice_text = grown;
+                notice_cap = cap;
+            }
+        }
+        if (need <= notice_cap) {
+            memcpy(notice_text + notice_len, text, (size_t)n);
+            notice_len += (size_t)n;
+            if (newline) notice_text[notice_len++] = '\n';
+        }
+        pthread_mutex_unlock(&notice_mutex);
+        eventloop_wake();
+    }
+
+    if (text != stack_buf) {
+        free(text);
+    }
+}
+
+static int notices_pending(void) {
+    pthread_mutex_lock(&notice_mutex);
+    int pending = notice_len > 0;
+    pthread_mutex_unlock(&notice_mutex);
+    return pending;
+}
+
+void eventloop_flush_notices(void) {
+    pthread_mutex_lock(&notice_mutex);
+    char *text = notice_text;
+    size_t len = notice_len;
+    notice_text = NULL;
+    notice_len = notice_cap = 0;
+    pthread_mutex_unlock(&notice_mutex);
+
+    if (timer_armed) {
+        struct itimerspec off;
+        memset(&off, 0, sizeof(off));
+        timerfd_settime(timer_fd, 0, &off, NULL);
+        timer_armed = 0;
+    }
+    if (len > 0) {
+        if (print_callback != NULL) {
+            print_callback(text, len);
+        } else {
+            ssize_t ignored = write(STDOUT_FILENO, text, len);
+            (void)ignored;
+        }
+    }
+    free(text);
+}
+
+static void arm_notice_timer(void) {
+    if (timer_armed) {
+        return;
+    }
+    struct itimerspec when;
+    memset(&when, 0, sizeof(when));
+    when.it_value.tv_nsec = NOTICE_BATCH_NS;
+    if (timerfd_settime(timer_fd, 0, &when, NULL) == 0) {
+        timer_armed = 1;
+    }
+}
+
+int eventloop_wait_readable(int fd) {
+    if (epoll_fd < 0) {
+        return EVENTLOOP_ERROR;
+    }
+    if (watched_fd != fd) {
+        if (watched_fd >= 0) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, watched_fd, NULL);
+        }
+        watched_fd = add_fd(fd) == 0 ? fd : -1;
+        if (watched_fd < 0) {
+            return EVENTLOOP_ERROR;
+        }
+    }
+
+    // Route the loop's signals to the signalfd while waiting; handlers
+    // take over again once the caller runs a command
+    sigset_t saved;
+    pthread_sigmask(SIG_BLOCK, &loop_signals, &saved);
+
+    int result = EVENTLOOP_ERROR;
+    for (;;) {
+        if (notices_pending()) {
+            arm_notice_timer();
+        }
+
+        struct epoll_event events[4];
+        int n = epoll_wait(epoll_fd, events, 4, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        int ready = 0, interrupted = 0, children = 0, resized = 0, flush = 0;
+        for (int i = 0; i < n; i++) {
+            int efd = events[i].data.fd;
+            if (efd == fd) {
+                ready = 1;
+            } else if (efd == signal_fd) {
+                struct signalfd_siginfo info;
+                while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                    if (info.ssi_signo == SIGCHLD) children = 1;
+                    else if (info.ssi_signo == SIGWINCH) resized = 1;
+                    else if (info.ssi_signo == SIGINT) interrupted = 1;
+                }
+            } else if (efd == wake_fd) {
+                uint64_t count;
+                ssize_t ignored = read(wake_fd, &count, sizeof(count));
+                (void)ignored;
+            } else if (efd == timer_fd) {
+                uint64_t expirations;
+                ssize_t ignored = read(timer_fd, &expirations, sizeof(expirations));
+                (void)ignored;
+                timer_armed = 0;
+                flush = 1;
+            }
+        }
+
+        // Signals a worker thread's handler caught instead of the signalfd
+        if (child_exited) children = 1;
+        if (window_resized) resized = 1;
+        if (sigint_received) interrupted = 1;
+        child_exited = 0;
+        window_resized = 0;
+        sigint_received = 0;
+
+        if (children && child_handler != NULL) {
+            child_handler();
+        }
+        if (flush || ready || interrupted) {
+            // Typing or Ctrl+C: show what is queued before the line changes
+            eventloop_flush_notices();
+        }
+        if (resized && resize_callback != NULL) {
+            resize_callback();
+        }
+        if (interrupted) {
+            result = EVENTLOOP_INTERRUPTED;
+            break;
+        }
+        if (ready) {
+            result = EVENTLOOP_READY;
+            break;
+        }
+    }
+
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+    return result;
+}
@@ -1,174 +1,1083 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include "expansion.h"
 #include "arithmetic.h"
+#include "conditional.h"
+#include "executor.h"
+#include "builtins.h"
+#include "tools.h"
+#include "arena.h"
+#include "glob.h"
+#include "script.h"
+#include "procsub.h"
+#include "lexscan.h"
+
+#define SUBST_READ_CHUNK (64 * 1024)
+#define SUBST_PIPE_SIZE (1024 * 1024)
+
+/*
+ * Temporaries created while expanding one command line (default words,
+ * pattern text, substrings, case-converted copies) come from a per-thread
+ * arena that is reset when the outermost expand_variables() call returns,
+ * so ${...} operators never call malloc/free per operation.
+ */
+static __thread Arena expand_arena;
+static __thread int expand_arena_ready = 0;
+static __thread int expand_depth = 0;
+static __thread int expand_failed = 0;
+static __thread int subst_status = -1;  // Status of the last $(...), -1 if none
 
 /**
- * expand_variables - Expand $var and $((...)) tokens in a string
- * @input: Input string with potential $var tokens
- * @env: Environment for variable lookup
- * 
- * Returns: Newly allocated string with variables expanded (caller must free)
- * 
- * Supports:
- * - $VAR syntax
- * - ${VAR} syntax
- * - $((arithmetic)) syntax
- * - Undefined variables are replaced with empty string
+ * Growable output buffer. Backed by the expansion arena for temporaries,
+ * or by malloc for the string handed back to the caller.
  */
-char* expand_variables(const char *input, Env *env) {
-    char *result;
-    char *output;
-    const char *ptr;
-    char var_name[256];
-    int var_idx;
-    char *var_value;
-    size_t result_size;
-    size_t result_len;
-    
-    if (!input) {
-        return NULL;
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    Arena *arena;
+} ExpandBuf;
+
+static void buf_init(ExpandBuf *buf, size_t cap, Arena *arena) {
+    buf->len = 0;
+    buf->cap = cap < 16 ? 16 : cap;
+    buf->arena = arena;
+    buf->data = arena ? arena_alloc(arena, buf->cap) : malloc(buf->cap);
+    if (!buf->data) {
+        fprintf(stderr, "expand_variables: malloc failed\n");
+        exit(1);
+    }
+    buf->data[0] = '\0';
+}
+
+static void buf_reserve(ExpandBuf *buf, size_t extra) {
+    if (buf->len + extra + 1 <= buf->cap) {
+        return;
+    }
+    size_t cap = buf->cap;
+    while (buf->len + extra + 1 > cap) {
+        cap *= 2;
+    }
+    char *grown;
+    if (buf->arena) {
+        grown = arena_alloc(buf->arena, cap);
+        if (grown) {
+            memcpy(grown, buf->data, buf->len);
+        }
+    } else {
+        grown = realloc(buf->data, cap);
+    }
+    if (!grown) {
+        fprintf(stderr, "expand_variables: realloc failed\n");
+        exit(1);
+    }
+    buf->data = grown;
+    buf->cap = cap;
+}
+
+static void buf_append(ExpandBuf *buf, const char *s, size_t n) {
+    buf_reserve(buf, n);
+    memcpy(buf->data + buf->len, s, n);
+    buf->len += n;
+    buf->data[buf->len] = '\0';
+}
+
+static void buf_putc(ExpandBuf *buf, char c) {
+    buf_reserve(buf, 1);
+    buf->data[buf->len++] = c;
+    buf->data[buf->len] = '\0';
+}
+
+static void expand_into(ExpandBuf *out, const char *s, size_t n, Env *env, int quotes);
+
+/**
+ * Expand a word (operator argument) into an arena string
+ */
+static char *expand_word(const char *s, size_t n, Env *env) {
+    ExpandBuf word;
+    buf_init(&word, n + 16, &expand_arena);
+    expand_into(&word, s, n, env, 1);
+    return word.data;
+}
+
+/**
+ * Find the '}' closing a ${ whose body starts at s
+ *
+ * Nested ${...}, $(...) and $((...)) are skipped so that
+ * ${a:-${b}} and ${a:-$((1+2))} close at the right brace.
+ */
+static const char *find_closing_brace(const char *s) {
+    int depth = 0;
+    int parens = 0;
+    while (*s) {
+        if (*s == '\\' && s[1]) {
+            s += 2;
+            continue;
+        }
+        if (*s == '$' && s[1] == '{') {
+            depth++;
+            s += 2;
+            continue;
+        }
+        if (*s == '(') {
+            parens++;
+        } else if (*s == ')' && parens > 0) {
+            parens--;
+        } else if (*s == '}' && parens == 0) {
+            if (depth == 0) {
+                return s;
+            }
+            depth--;
+        }
+        s++;
+    }
+    return NULL;
+}
+
+/**
+ * Find the ':' separating offset and length in ${v:off:len}
+ */
+static const char *find_substring_colon(const char *s, const char *end) {
+    int parens = 0;
+    for (; s < end; s++) {
+        if (*s == '(') {
+            parens++;
+        } else if (*s == ')') {
+            parens--;
+        } else if (*s == ':' && parens == 0) {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Split "pattern/replacement" at the first unescaped '/'
+ */
+static const char *find_replace_slash(const char *s, const char *end) {
+    for (; s < end; s++) {
+        if (*s == '\\' && s + 1 < end) {
+            s++;
+        } else if (*s == '/') {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Look up a parameter; returns an arena copy or NULL when unset
+ */
+static char *lookup_param(const char *name, Env *env) {
+    if (strcmp(name, "?") == 0) {
+        char status[16];
+        snprintf(status, sizeof(status), "%d", last_exit_status);
+        return arena_strdup(&expand_arena, status);
+    }
+    if (isdigit((unsigned char)name[0]) && script_positional_count() >= 0) {
+        return arena_strdup(&expand_arena, script_positional(atoi(name)));
+    }
+    char *value = env_get(env, name);
+    if (value == NULL) {
+        // $NAME on an array is its first element
+        const char *first = env_array_get(env, name, 0);
+        return first ? arena_strdup(&expand_arena, first) : NULL;
+    }
+    return arena_strdup(&expand_arena, value);
+}
+
+/**
+ * Look up NAME[subscript]; [@] and [*] join all elements with spaces
+ */
+static char *lookup_element(const char *name, const char *sub, size_t sub_len, Env *env) {
+    if (sub_len == 1 && (sub[0] == '@' || sub[0] == '*')) {
+        int count;
+        char **items = env_array_items(env, name, &count);
+        if (items == NULL) {
+            return lookup_param(name, env);
+        }
+        ExpandBuf joined;
+        buf_init(&joined, 64, &expand_arena);
+        for (int i = 0; i < count; i++) {
+            if (i > 0) {
+                buf_putc(&joined, ' ');
+            }
+            buf_append(&joined, items[i], strlen(items[i]));
+        }
+        return joined.data;
+    }
+    int index = eval_arithmetic(expand_word(sub, sub_len, env), env);
+    const char *item = env_array_get(env, name, index);
+    if (item == NULL && index == 0 && env_array_count(env, name) < 0) {
+        return lookup_param(name, env);
+    }
+    return item ? arena_strdup(&expand_arena, item) : NULL;
+}
+
+/**
+ * Append $# or $@ / $* for the current function call
+ */
+static void append_positional_special(ExpandBuf *out, char which) {
+    int count = script_positional_count();
+    if (which == '#') {
+        char num[16];
+        snprintf(num, sizeof(num), "%d", count < 0 ? 0 : count);
+        buf_append(out, num, strlen(num));
+        return;
+    }
+    for (int i = 1; i <= count; i++) {
+        if (i > 1) {
+            buf_putc(out, ' ');
+        }
+        const char *arg = script_positional(i);
+        buf_append(out, arg, strlen(arg));
+    }
+}
+
+/**
+ * Length of the longest match of gp starting at s, or -1
+ */
+static long longest_match_at(const GlobPattern *gp, const char *s, size_t avail) {
+    if (avail < gp->min_len) {
+        return -1;
     }
-    
-    // Allocate initial result buffer (will grow if needed)
-    result_size = strlen(input) * 2 + 256;  // Generous initial size
-    result = (char *)malloc(result_size);
-    if (!result) {
+    if (!gp->has_star) {
+        return glob_match(gp, s, gp->min_len) ? (long)gp->min_len : -1;
+    }
+    for (size_t l = avail + 1; l-- > gp->min_len; ) {
+        if (glob_match(gp, s, l)) {
+            return (long)l;
+        }
+    }
+    return -1;
+}
+
+/**
+ * ${v#p} ${v##p} ${v%p} ${v%%p}
+ */
+static void remove_pattern(ExpandBuf *out, const char *val, const GlobPattern *gp,
+                           int suffix, int longest) {
+    size_t len = strlen(val);
+    size_t lo = gp->min_len;
+    size_t hi = gp->has_star ? len : (gp->min_len <= len ? gp->min_len : 0);
+
+    if (lo <= len && lo <= hi) {
+        for (size_t k = 0; k <= hi - lo; k++) {
+            // Candidate length to strip: shortest first, or longest first
+            size_t cut = longest ? hi - k : lo + k;
+            const char *start = suffix ? val + len - cut : val;
+            if (glob_match(gp, start, cut)) {
+                if (suffix) {
+                    buf_append(out, val, len - cut);
+                } else {
+                    buf_append(out, val + cut, len - cut);
+                }
+                return;
+            }
+        }
+    }
+    buf_append(out, val, len);
+}
+
+/**
+ * ${v/p/r} ${v//p/r} ${v/#p/r} ${v/%p/r}
+ */
+static void replace_pattern(ExpandBuf *out, const char *val, const GlobPattern *gp,
+                            const char *repl, char mode) {
+    size_t len = strlen(val);
+    size_t repl_len = strlen(repl);
+
+    if (mode == '#') {
+        long m = longest_match_at(gp, val, len);
+        if (m >= 0) {
+            buf_append(out, repl, repl_len);
+            buf_append(out, val + m, len - (size_t)m);
+        } else {
+            buf_append(out, val, len);
+        }
+        return;
+    }
+
+    if (mode == '%') {
+        for (size_t i = 0; i <= len; i++) {
+            if (len - i >= gp->min_len && glob_match(gp, val + i, len - i)) {
+                buf_append(out, val, i);
+                buf_append(out, repl, repl_len);
+                return;
+            }
+        }
+        buf_append(out, val, len);
+        return;
+    }
+
+    // A literal first op lets memchr skip positions that cannot match.
+    // Empty matches are ignored so a pattern always consumes text.
+    int literal_first = gp->count > 0 && gp->ops[0].type == GLOB_OP_LITERAL;
+    size_t i = 0;
+    while (i < len) {
+        if (literal_first) {
+            const char *hit = memchr(val + i, gp->ops[0].ch, len - i);
+            if (!hit) {
+                break;
+            }
+            buf_append(out, val + i, (size_t)(hit - (val + i)));
+            i = (size_t)(hit - val);
+        }
+        long m = longest_match_at(gp, val + i, len - i);
+        if (m > 0) {
+            buf_append(out, repl, repl_len);
+            i += (size_t)m;
+            if (mode != '/') {
+                break;
+            }
+            continue;
+        }
+        buf_putc(out, val[i]);
+        i++;
+    }
+    buf_append(out, val + i, len - i);
+}
+
+/**
+ * ${v^} ${v^^} ${v,} ${v,,} with an optional single-character pattern
+ */
+static void convert_case(ExpandBuf *out, const char *val, const char *pat, int upper, int all) {
+    GlobPattern gp;
+    int have_pat = pat[0] != '\0' && glob_compile(&gp, pat) == 0;
+    size_t start = out->len;
+
+    buf_append(out, val, strlen(val));
+    for (char *p = out->data + start; *p; p++) {
+        if (!have_pat || glob_match(&gp, p, 1)) {
+            *p = upper ? (char)toupper((unsigned char)*p) : (char)tolower((unsigned char)*p);
+        }
+        if (!all) {
+            break;
+        }
+    }
+    if (have_pat) {
+        glob_free(&gp);
+    }
+}
+
+/**
+ * Expand the body of ${...} (between the braces) into out
+ */
+static void expand_braced(ExpandBuf *out, const char *body, size_t n, Env *env) {
+    const char *end = body + n;
+    char name[VAR_NAME_MAX];
+    size_t name_len = 0;
+    const char *p = body;
+
+    // ${#v} - length of value, ${#a[@]} - number of elements
+    if (n > 1 && body[0] == '#') {
+        p = body + 1;
+        while (p < end && *p != '[' && name_len + 1 < sizeof(name)) {
+            name[name_len++] = *p++;
+        }
+        name[name_len] = '\0';
+        char *value;
+        if (p < end && *p == '[') {
+            if (end - p == 3 && (p[1] == '@' || p[1] == '*') && p[2] == ']') {
+                int count = env_array_count(env, name);
+                if (count < 0) {
+                    count = lookup_param(name, env) ? 1 : 0;
+                }
+                char count_str[32];
+                snprintf(count_str, sizeof(count_str), "%d", count);
+                buf_append(out, count_str, strlen(count_str));
+                return;
+            }
+            value = lookup_element(name, p + 1, (size_t)(end - p - 2), env);
+        } else {
+            value = lookup_param(name, env);
+        }
+        char len_str[32];
+        snprintf(len_str, sizeof(len_str), "%zu", value ? strlen(value) : (size_t)0);
+        buf_append(out, len_str, strlen(len_str));
+        return;
+    }
+
+    if (p < end && *p == '?') {
+        name[name_len++] = *p++;
+    } else {
+        while (p < end && (isalnum((unsigned char)*p) || *p == '_')) {
+            if (name_len + 1 < sizeof(name)) {
+                name[name_len++] = *p;
+            }
+            p++;
+        }
+    }
+    name[name_len] = '\0';
+
+    char *value;
+    if (p < end && *p == '[' && name_len > 0) {
+        const char *close = memchr(p, ']', (size_t)(end - p));
+        if (close == NULL) {
+            close = end;
+        }
+        value = lookup_element(name, p + 1, (size_t)(close - p - 1), env);
+        p = close < end ? close + 1 : end;
+    } else {
+        value = lookup_param(name, env);
+    }
+    const char *val = value ? value : "";
+
+    if (p == end) {
+        buf_append(out, val, strlen(val));
+        return;
+    }
+
+    // ':' makes -, =, ? and + also treat an empty value as unset
+    int colon = 0;
+    if (*p == ':' && p + 1 < end && strchr("-=?+", p[1])) {
+        colon = 1;
+        p++;
+    }
+
+    char op = *p++;
+    int missing = value == NULL || (colon && value[0] == '\0');
+
+    switch (op) {
+        case '-':
+            if (missing) {
+                char *word = expand_word(p, (size_t)(end - p), env);
+                buf_append(out, word, strlen(word));
+            } else {
+                buf_append(out, val, strlen(val));
+            }
+            return;
+
+        case '=':
+            if (missing) {
+                char *word = expand_word(p, (size_t)(end - p), env);
+                env_set(env, name, word);
+                buf_append(out, word, strlen(word));
+            } else {
+                buf_append(out, val, strlen(val));
+            }
+            return;
+
+        case '?':
+            if (missing) {
+                char *word = expand_word(p, (size_t)(end - p), env);
+                fprintf(stderr, "ushell: %s: %s\n", name,
+                        word[0] ? word : "parameter null or not set");
+                expand_failed = 1;
+            } else {
+                buf_append(out, val, strlen(val));
+            }
+            return;
+
+        case '+':
+            if (!missing) {
+                char *word = expand_word(p, (size_t)(end - p), env);
+                buf_append(out, word, strlen(word));
+            }
+            return;
+
+        case ':': {
+            // ${v:offset} and ${v:offset:length}, both arithmetic
+            size_t len = strlen(val);
+            const char *colon2 = find_substring_colon(p, end);
+            const char *off_end = colon2 ? colon2 : end;
+            char *off_expr = expand_word(p, (size_t)(off_end - p), env);
+            long offset = eval_arithmetic(off_expr, env);
+            if (offset < 0) {
+                offset += (long)len;
+                if (offset < 0) {
+                    offset = 0;
+                }
+            }
+            if ((size_t)offset > len) {
+                offset = (long)len;
+            }
+            long count = (long)len - offset;
+            if (colon2) {
+                char *len_expr = expand_word(colon2 + 1, (size_t)(end - colon2 - 1), env);
+                long want = eval_arithmetic(len_expr, env);
+                if (want < 0) {
+                    want = (long)len + want - offset;
+                }
+                if (want < 0) {
+                    want = 0;
+                }
+                if (want < count) {
+                    count = want;
+                }
+            }
+            buf_append(out, val + offset, (size_t)count);
+            return;
+        }
+
+        case '#':
+        case '%': {
+            int longest = p < end && *p == op;
+            if (longest) {
+                p++;
+            }
+            GlobPattern gp;
+            char *pat = expand_word(p, (size_t)(end - p), env);
+            if (glob_compile(&gp, pat) != 0) {
+                buf_append(out, val, strlen(val));
+                return;
+            }
+            remove_pattern(out, val, &gp, op == '%', longest);
+            glob_free(&gp);
+            return;
+        }
+
+        case '/': {
+            char mode = 0;
+            if (p < end && (*p == '/' || *p == '#' || *p == '%')) {
+                mode = *p++;
+            }
+            const char *slash = find_replace_slash(p, end);
+            const char *pat_end = slash ? slash : end;
+            char *pat = expand_word(p, (size_t)(pat_end - p), env);
+            char *repl = slash ? expand_word(slash + 1, (size_t)(end - slash - 1), env) : "";
+            GlobPattern gp;
+            if (pat[0] == '\0' || glob_compile(&gp, pat) != 0) {
+                buf_append(out, val, strlen(val));
+                return;
+            }
+            replace_pattern(out, val, &gp, repl, mode);
+            glob_free(&gp);
+            return;
+        }
+
+        case '^':
+        case ',': {
+            int all = p < end && *p == op;
+            if (all) {
+                p++;
+            }
+            char *pat = expand_word(p, (size_t)(end - p), env);
+            convert_case(out, val, pat, op == '^', all);
+            return;
+        }
+
+        default:
+            fprintf(stderr, "ushell: ${%.*s}: bad substitution\n", (int)n, body);
+            expand_failed = 1;
+            return;
+    }
+}
+
+/**
+ * Find the ')' closing a $( whose body starts at s
+ *
+ * Quotes are skipped and nested parentheses (including inner $(...))
+ * are balanced.
+ */
+static const char *find_closing_paren(const char *s, const char *end) {
+    int depth = 0;
+    char quote = 0;
+    for (; s < end; s++) {
+        if (quote) {
+            if (*s == '\\' && quote == '"' && s + 1 < end) {
+                s++;
+            } else if (*s == quote) {
+                quote = 0;
+            }
+        } else if (*s == '\\' && s + 1 < end) {
+            s++;
+        } else if (*s == '\'' || *s == '"') {
+            quote = *s;
+        } else if (*s == '(') {
+            depth++;
+        } else if (*s == ')') {
+            if (depth == 0) {
+                return s;
+            }
+            depth--;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Find the closing backtick, honouring \` escapes
+ */
+static const char *find_closing_backtick(const char *s, const char *end) {
+    for (; s < end; s++) {
+        if (*s == '\\' && s + 1 < end) {
+            s++;
+        } else if (*s == '`') {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Copy the body of `...` with \` \$ and \\ unescaped, so that nested
+ * backquotes written as \`...\` are substituted by the inner command
+ */
+static char *unescape_backticks(const char *s, size_t n) {
+    char *body = arena_alloc(&expand_arena, n + 1);
+    if (body == NULL) {
         fprintf(stderr, "expand_variables: malloc failed\n");
         exit(1);
     }
-    
-    output = result;
-    result_len = 0;
-    ptr = input;
-    
-    while (*ptr) {
-        if (*ptr == '$') {
-            ptr++;  // Skip $
-            
-            // Check for $((arithmetic)) syntax
-            if (*ptr == '(' && *(ptr + 1) == '(') {
-                ptr += 2;  // Skip ((
-                
-                // Extract arithmetic expression (up to ))
-                char arith_expr[512];
-                int arith_idx = 0;
-                int paren_depth = 0;  // Track nested parens within expression
-                
-                while (*ptr) {
-                    // Check for )) ending
-                    if (*ptr == ')' && *(ptr + 1) == ')' && paren_depth == 0) {
-                        ptr += 2;  // Skip ))
+    size_t len = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (s[i] == '\\' && i + 1 < n && (s[i + 1] == '`' || s[i + 1] == '$' || s[i + 1] == '\\')) {
+            i++;
+        }
+        body[len++] = s[i];
+    }
+    body[len] = '\0';
+    return body;
+}
+
+/**
+ * Read everything from fd into a malloc'd buffer with large reads
+ */
+typedef struct {
+    int fd;
+    char *data;
+    size_t len;
+    size_t cap;
+} SubstReader;
+
+static void *subst_reader_thread(void *arg) {
+    SubstReader *rd = arg;
+    for (;;) {
+        if (rd->cap - rd->len < SUBST_READ_CHUNK) {
+            size_t cap = rd->cap ? rd->cap * 2 : SUBST_READ_CHUNK * 2;
+            char *grown = realloc(rd->data, cap);
+            if (grown == NULL) {
+                break;
+            }
+            rd->data = grown;
+            rd->cap = cap;
+        }
+        ssize_t got = read(rd->fd, rd->data + rd->len, rd->cap - rd->len);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            break;
+        }
+        rd->len += (size_t)got;
+    }
+    return NULL;
+}
+
+/**
+ * Run cmd as a subshell with stdout captured and append its output to out
+ *
+ * The body cannot change the shell's variables or directory, and exit or
+ * exec only end the substitution (script_execute_subshell). Bodies of
+ * builtins and tools run in-process and write into a memfd that is
+ * copied straight into out. Bodies that fork get a (enlarged) pipe
+ * drained by a reader thread while the shell waits for them, so large
+ * output cannot deadlock against the pipe buffer. Trailing newlines are
+ * removed.
+ */
+static void capture_command(ExpandBuf *out, const char *cmd, Env *env) {
+    int parse_status;
+    ScriptUnit *unit = script_parse(cmd, &parse_status);
+    if (unit == NULL) {
+        if (parse_status == SCRIPT_INCOMPLETE) {
+            fprintf(stderr, "ushell: syntax error: unexpected end of input\n");
+        }
+        last_exit_status = 2;
+        subst_status = 2;
+        return;
+    }
+
+    int saved_stdout = dup(STDOUT_FILENO);
+    if (saved_stdout < 0) {
+        script_release(unit);
+        return;
+    }
+    fflush(stdout);
+
+    // A failed expansion inside only ends the substitution
+    int saved_failed = expand_failed;
+    size_t start = out->len;
+    if (script_subshell_in_process(unit)) {
+        int mfd = memfd_create("ushell-subst", MFD_CLOEXEC);
+        if (mfd >= 0) {
+            dup2(mfd, STDOUT_FILENO);
+            script_execute_subshell(unit, env);
+            fflush(stdout);
+            dup2(saved_stdout, STDOUT_FILENO);
+
+            off_t size = lseek(mfd, 0, SEEK_END);
+            if (size > 0) {
+                buf_reserve(out, (size_t)size);
+                size_t done = 0;
+                while (done < (size_t)size) {
+                    ssize_t got = pread(mfd, out->data + out->len + done,
+                                        (size_t)size - done, (off_t)done);
+                    if (got <= 0) {
                         break;
                     }
-                    
-                    // Track nested parentheses
-                    if (*ptr == '(') {
-                        paren_depth++;
-                    } else if (*ptr == ')') {
-                        paren_depth--;
-                    }
-                    
-                    // Copy character to expression
-                    if (arith_idx < 511) {
-                        arith_expr[arith_idx++] = *ptr;
-                    }
-                    ptr++;
-                }
-                arith_expr[arith_idx] = '\0';
-                
-                // Evaluate arithmetic expression
-                int arith_result = eval_arithmetic(arith_expr, env);
-                
-                // Convert result to string
-                char result_str[32];
-                snprintf(result_str, sizeof(result_str), "%d", arith_result);
-                size_t result_str_len = strlen(result_str);
-                
-                // Ensure we have enough space
-                while (result_len + result_str_len + 1 > result_size) {
-                    result_size *= 2;
-                    result = (char *)realloc(result, result_size);
-                    if (!result) {
-                        fprintf(stderr, "expand_variables: realloc failed\n");
-                        exit(1);
-                    }
-                    output = result + result_len;
+                    done += (size_t)got;
                 }
-                
-                strcpy(output, result_str);
-                output += result_str_len;
-                result_len += result_str_len;
-                
+                out->len += done;
+            }
+            close(mfd);
+        }
+    } else {
+        int fds[2];
+        if (pipe2(fds, O_CLOEXEC) == 0) {
+            fcntl(fds[1], F_SETPIPE_SZ, SUBST_PIPE_SIZE);  // Best effort
+
+            SubstReader rd = { fds[0], NULL, 0, 0 };
+            pthread_t reader;
+            if (pthread_create(&reader, NULL, subst_reader_thread, &rd) == 0) {
+                dup2(fds[1], STDOUT_FILENO);
+                close(fds[1]);
+                script_execute_subshell(unit, env);
+                fflush(stdout);
+                dup2(saved_stdout, STDOUT_FILENO);  // Drops the last write end
+
+                pthread_join(reader, NULL);
+                buf_append(out, rd.data ? rd.data : "", rd.len);
+                free(rd.data);
+            } else {
+                close(fds[1]);
+            }
+            close(fds[0]);
+        }
+    }
+    close(saved_stdout);
+    script_release(unit);
+    expand_failed = saved_failed;
+    subst_status = last_exit_status;
+
+    // POSIX: strip all trailing newlines from the captured output
+    while (out->len > start && out->data[out->len - 1] == '\n') {
+        out->len--;
+    }
+    out->data[out->len] = '\0';
+}
+
+/**
+ * Expand s[0..n) into out
+ * With quotes == 0 (here-documents) quote characters are ordinary text;
+ * with quotes == 2 they are removed instead of kept for the tokenizer.
+ */
+static void expand_into(ExpandBuf *out, const char *s, size_t n, Env *env, int quotes) {
+    const char *begin = s;
+    const char *end = s + n;
+
+    int in_single = 0;
+    int in_double = 0;
+
+    while (s < end) {
+        // Copy the run of plain text up to the next special character
+        const char *special = s;
+        while (special < end && *special != '$' && *special != '`' &&
+               (!quotes || (*special != '\'' && *special != '"' &&
+                            *special != '<' && *special != '>'))) {
+            special++;
+        }
+        buf_append(out, s, (size_t)(special - s));
+        if (special == end) {
+            return;
+        }
+        s = special + 1;
+
+        // <(cmd) and >(cmd) at the start of a word become /dev/fd/N
+        if (*special == '<' || *special == '>') {
+            const char *close = NULL;
+            if (!in_single && !in_double && s < end && *s == '(' &&
+                (special == begin || isspace((unsigned char)special[-1]))) {
+                close = find_closing_paren(s + 1, end);
+            }
+            if (close == NULL) {
+                buf_putc(out, *special);
                 continue;
             }
-            
-            // Check for ${VAR} syntax
-            int braced = 0;
-            if (*ptr == '{') {
-                braced = 1;
-                ptr++;
-            }
-            
-            // Extract variable name
-            var_idx = 0;
-            while (*ptr && (isalnum(*ptr) || *ptr == '_')) {
-                if (var_idx < 255) {
-                    var_name[var_idx++] = *ptr;
+            int fd = procsub_start(arena_strndup(&expand_arena, s + 1, (size_t)(close - s - 1)),
+                                   *special == '>', env);
+            if (fd < 0) {
+                expand_failed = 1;
+            } else {
+                char path[32];
+                snprintf(path, sizeof(path), "/dev/fd/%d", fd);
+                buf_append(out, path, strlen(path));
+            }
+            s = close + 1;
+            continue;
+        }
+
+        // Track single quotes so '$(...)' and '`...`' stay literal
+        if (*special == '\'' || *special == '"') {
+            int toggles = *special == '\'' ? !in_double : !in_single;
+            if (!toggles || quotes == 1) {
+                buf_putc(out, *special);
+            }
+            if (toggles && *special == '\'') {
+                in_single = !in_single;
+            } else if (toggles) {
+                in_double = !in_double;
+            }
+            continue;
+        }
+
+        // `command`
+        if (*special == '`') {
+            const char *close = in_single ? NULL : find_closing_backtick(s, end);
+            if (close == NULL) {
+                buf_putc(out, '`');
+                continue;
+            }
+            capture_command(out, unescape_backticks(s, (size_t)(close - s)), env);
+            s = close + 1;
+            continue;
+        }
+
+        // $(command), but not $((arithmetic))
+        if (!in_single && s < end && *s == '(' && !(s + 1 < end && s[1] == '(')) {
+            const char *close = find_closing_paren(s + 1, end);
+            if (close != NULL) {
+                capture_command(out, arena_strndup(&expand_arena, s + 1, (size_t)(close - s - 1)), env);
+                s = close + 1;
+                continue;
+            }
+        }
+
+        // Check for $((arithmetic)) syntax
+        if (s + 1 < end && s[0] == '(' && s[1] == '(') {
+            s += 2;
+            const char *expr = s;
+            int paren_depth = 0;  // Track nested parens within expression
+            while (s < end) {
+                if (*s == ')' && s + 1 < end && s[1] == ')' && paren_depth == 0) {
+                    break;
                 }
-                ptr++;
-            }
-            var_name[var_idx] = '\0';
-            
-            // Skip closing brace if present
-            if (braced && *ptr == '}') {
-                ptr++;
-            }
-            
-            // Get variable value
-            var_value = env_get(env, var_name);
-            
-            // Append value to result (or empty string if undefined)
-            if (var_value) {
-                size_t val_len = strlen(var_value);
-                
-                // Ensure we have enough space
-                while (result_len + val_len + 1 > result_size) {
-                    result_size *= 2;
-                    result = (char *)realloc(result, result_size);
-                    if (!result) {
-                        fprintf(stderr, "expand_variables: realloc failed\n");
-                        exit(1);
-                    }
-                    output = result + result_len;
+                if (*s == '(') {
+                    paren_depth++;
+                } else if (*s == ')') {
+                    paren_depth--;
                 }
-                
-                strcpy(output, var_value);
-                output += val_len;
-                result_len += val_len;
+                s++;
             }
-        } else {
-            // Regular character - copy it
-            *output++ = *ptr++;
-            result_len++;
-            
-            // Ensure we have space
-            if (result_len + 1 >= result_size) {
-                result_size *= 2;
-                result = (char *)realloc(result, result_size);
-                if (!result) {
-                    fprintf(stderr, "expand_variables: realloc failed\n");
-                    exit(1);
-                }
-                output = result + result_len;
+            // The expression itself may contain ${...}
+            char *arith_expr = expand_word(expr, (size_t)(s - expr), env);
+            if (s < end) {
+                s += 2;  // Skip ))
+            }
+
+            char result_str[32];
+            snprintf(result_str, sizeof(result_str), "%d", eval_arithmetic(arith_expr, env));
+            buf_append(out, result_str, strlen(result_str));
+            continue;
+        }
+
+        // ${...} with operators
+        if (s < end && *s == '{') {
+            const char *close = find_closing_brace(s + 1);
+            if (close == NULL || close >= end) {
+                // Unterminated: keep the text literally
+                buf_putc(out, '$');
+                continue;
             }
+            expand_braced(out, s + 1, (size_t)(close - s - 1), env);
+            s = close + 1;
+            continue;
+        }
+
+        // Function call parameters: $# $@ $*
+        if (s < end && (*s == '#' || *s == '@' || *s == '*')) {
+            append_positional_special(out, *s);
+            s++;
+            continue;
+        }
+
+        // $? and a lone '$' are not variable lookups
+        if (s >= end || *s == '?' || !(*s == '_' || isalnum((unsigned char)*s))) {
+            if (s < end && *s == '?') {
+                char status[16];
+                snprintf(status, sizeof(status), "%d", last_exit_status);
+                buf_append(out, status, strlen(status));
+                s++;
+            } else {
+                buf_putc(out, '$');
+            }
+            continue;
+        }
+
+        // Plain $VAR
+        char var_name[256];
+        size_t var_idx = 0;
+        while (s < end && (isalnum((unsigned char)*s) || *s == '_')) {
+            if (var_idx < sizeof(var_name) - 1) {
+                var_name[var_idx++] = *s;
+            }
+            s++;
+        }
+        var_name[var_idx] = '\0';
+
+        // Positional parameters inside a function call
+        if (isdigit((unsigned char)var_name[0]) && script_positional_count() >= 0) {
+            const char *arg = script_positional(atoi(var_name));
+            buf_append(out, arg, strlen(arg));
+            continue;
+        }
+
+        // Undefined variables expand to nothing
+        char *var_value = env_get(env, var_name);
+        if (var_value) {
+            buf_append(out, var_value, strlen(var_value));
+        }
+    }
+}
+
+/**
+ * Start an expansion; nested calls (from $(...)) share the arena
+ */
+static void expand_begin(void) {
+    if (!expand_arena_ready) {
+        arena_init(&expand_arena, 0);
+        expand_arena_ready = 1;
+    }
+    if (expand_depth == 0) {
+        expand_failed = 0;
+        subst_status = -1;
+    }
+    expand_depth++;
+}
+
+/**
+ * Finish an expansion started by expand_begin
+ * Returns: result->data, or NULL (freed) if a ${var:?message} check failed;
+ *          the command line running it is then abandoned as well
+ */
+static char *expand_end(ExpandBuf *result) {
+    // Temporaries are released once the outermost expansion finishes
+    expand_depth--;
+    int failed = expand_failed;
+    if (expand_depth == 0) {
+        arena_reset(&expand_arena);
+    }
+
+    if (failed) {
+        script_request_abort();
+        free(result->data);
+        return NULL;
+    }
+    return result->data;
+}
+
+/**
+ * expand_variables - Expand $var and $((...)) tokens in a string
+ * @input: Input string with potential $var tokens
+ * @env: Environment for variable lookup
+ *
+ * Returns: Newly allocated string with variables expanded (caller must free),
+ *          or NULL if a ${var:?message} check failed (message already printed)
+ *
+ * Supports:
+ * - $VAR and ${VAR} syntax
+ * - $((arithmetic)) syntax
+ * - $(command) and `command` (output captured, trailing newlines removed)
+ * - $? (exit status of the last command)
+ * - $1..$N, $#, $@, $* (inside shell functions)
+ * - ${#v}, ${v:-w} ${v-w}, ${v:=w} ${v=w}, ${v:?w} ${v?w}, ${v:+w} ${v+w}
+ * - ${v:off} ${v:off:len} (arithmetic, negative values count from the end)
+ * - ${v#p} ${v##p} ${v%p} ${v%%p} (glob patterns)
+ * - ${v/p/r} ${v//p/r} ${v/#p/r} ${v/%p/r}
+ * - ${v^} ${v^^} ${v,} ${v,,} (optionally restricted by a pattern)
+ * - Undefined variables are replaced with empty string
+ * - A '$' not followed by a name is kept literally (e.g. regex anchors)
+ */
+char* expand_variables(const char *input, Env *env) {
+    if (!input) {
+        return NULL;
+    }
+
+    // Without $ ` quotes or < > (process substitution) the text is its
+    // own expansion; batch scripts hit this for most plain commands
+    size_t input_len = strlen(input);
+    if (!(lexscan_classes(input, input_len) & (LEX_EXPAND | LEX_QUOTE | LEX_OPER))) {
+        return strdup(input);
+    }
+
+    expand_begin();
+    ExpandBuf result;
+    buf_init(&result, input_len + 64, NULL);
+    expand_into(&result, input, input_len, env, 1);
+    return expand_end(&result);
+}
+
+/**
+ * expand_test_word - Expand one word of a [[ ]] command
+ * @word: Word as written, quotes included (not NUL-terminated)
+ * @len: Length of the word
+ * @env: Environment for variable lookup
+ *
+ * Returns: Newly allocated expansion with the quotes removed, or NULL if
+ *          an expansion failed (message already printed)
+ *
+ * The result is always exactly one argument: [[ ]] does no word
+ * splitting or globbing, and a word that expands to nothing stays as an
+ * empty argument.
+ */
+char* expand_test_word(const char *word, size_t len, Env *env) {
+    expand_begin();
+    ExpandBuf result;
+    buf_init(&result, len + 64, NULL);
+    expand_into(&result, word, len, env, 2);
+    return expand_end(&result);
+}
+
+/**
+ * expand_substitution_status - Exit status of the last command substitution
+ *
+ * Returns: Status of the last $(...) or `...` run by the most recent
+ *          outermost expansion, or -1 if it ran none
+ */
+int expand_substitution_status(void) {
+    return subst_status;
+}
+
+/**
+ * expand_here_line - Expand one line of an unquoted here-document
+ * @line: Line text (not NUL-terminated)
+ * @len: Length of the line
+ * @env: Environment for variable lookup
+ *
+ * Returns: Newly allocated expanded line, or NULL if an expansion failed
+ *
+ * Same expansions as expand_variables, but quotes are ordinary characters
+ * and a backslash only escapes $, ` and itself.
+ */
+char* expand_here_line(const char *line, size_t len, Env *env) {
+    expand_begin();
+    ExpandBuf result;
+    buf_init(&result, len + 64, NULL);
+
+    const char *s = line;
+    const char *end = line + len;
+    while (s < end) {
+        const char *esc = s;
+        while (esc < end && !(esc[0] == '\\' && esc + 1 < end &&
+                              (esc[1] == '$' || esc[1] == '`' || esc[1] == '\\'))) {
+            esc++;
+        }
+        expand_into(&result, s, (size_t)(esc - s), env, 0);
+        if (esc == end) {
+            break;
         }
+        buf_putc(&result, esc[1]);
+        s = esc + 2;
     }
-    
-    *output = '\0';
-    return result;
+    return expand_end(&result);
 }
 
 /**
@@ -176,20 +1085,20 @@ char* expand_variables(const char *input, Env *env) {
  * @input: Buffer containing input string (modified in place)
  * @env: Environment for variable lookup
  * @bufsize: Size of the buffer
- * 
+ *
  * Performs variable expansion directly in the buffer.
  * Truncates if result would exceed buffer size.
  */
 void expand_variables_inplace(char *input, Env *env, size_t bufsize) {
     char *expanded;
-    
+
     if (!input || bufsize == 0) {
         return;
     }
-    
+
     // Use the dynamic version
     expanded = expand_variables(input, env);
-    
+
     if (expanded) {
         // Copy back to input buffer, truncating if necessary
         strncpy(input, expanded, bufsize - 1);
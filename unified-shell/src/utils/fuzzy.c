@@ -0,0 +1,593 @@
+/**
+ * fuzzy.c - Fuzzy matching engine for myfzf
+ *
+ * Pipeline for one candidate:
+ *   1. Character mask prefilter: every query character must be present
+ *      (one 64-bit AND, rejects most candidates without touching the text)
+ *   2. Subsequence scan: locate the query characters in order using a
+ *      16-byte SSE2 compare (scalar fallback on other targets)
+ *   3. Alignment scoring: Smith-Waterman style dynamic programming over
+ *      the matched region with affine gap penalties and bonuses for word
+ *      boundaries, path separators, camelCase humps and consecutive runs
+ *
+ * fuzzy_search() splits the candidate (or previous match) list across
+ * worker threads. Each worker keeps its own matches and top-K heap; the
+ * per-worker results are merged in candidate order so incremental
+ * narrowing sees a stable list.
+ */
+
+#include "fuzzy.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Scoring constants (same spirit as fzf's algorithm)
+#define SCORE_MATCH          16
+#define SCORE_GAP_START      -3
+#define SCORE_GAP_EXTENSION  -1
+#define BONUS_BOUNDARY       8
+#define BONUS_PATH           9
+#define BONUS_CAMEL          7
+#define BONUS_CONSECUTIVE    4
+#define BONUS_FIRST_CHAR_MULTIPLIER 2
+
+#define FUZZY_DP_MAX_WIDTH   512
+#define FUZZY_NEG            (-1000000)
+#define FUZZY_MAX_THREADS    16
+#define FUZZY_PARALLEL_MIN   32768   // Below this, threading costs more than it saves
+
+// Query preprocessed once per search
+typedef struct {
+    char lo[FUZZY_MAX_QUERY];
+    char up[FUZZY_MAX_QUERY];
+    size_t len;
+    uint64_t mask;
+} PreparedQuery;
+
+// --- Candidate Set ---
+
+void fuzzy_set_init(FuzzySet *set) {
+    arena_init(&set->arena, 1024 * 1024);
+    set->items = NULL;
+    set->count = 0;
+    set->capacity = 0;
+}
+
+void fuzzy_set_free(FuzzySet *set) {
+    arena_free(&set->arena);
+    free(set->items);
+    set->items = NULL;
+    set->count = 0;
+    set->capacity = 0;
+}
+
+static inline int charmask_bit(unsigned char c) {
+    c = (unsigned char)tolower(c);
+    if (c >= 'a' && c <= 'z') {
+        return c - 'a';
+    }
+    if (c >= '0' && c <= '9') {
+        return 26 + (c - '0');
+    }
+    return 36 + (c % 28);
+}
+
+uint64_t fuzzy_charmask(const char *text, size_t len) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < len; i++) {
+        mask |= 1ULL << charmask_bit((unsigned char)text[i]);
+    }
+    return mask;
+}
+
+int fuzzy_set_add(FuzzySet *set, const char *text, size_t len) {
+    if (set->count == set->capacity) {
+        size_t new_capacity = set->capacity ? set->capacity * 2 : 4096;
+        FuzzyCandidate *grown = realloc(set->items, new_capacity * sizeof(FuzzyCandidate));
+        if (grown == NULL) {
+            return -1;
+        }
+        set->items = grown;
+        set->capacity = new_capacity;
+    }
+
+    char *copy = arena_strndup(&set->arena, text, len);
+    if (copy == NULL) {
+        return -1;
+    }
+
+    FuzzyCandidate *cand = &set->items[set->count++];
+    cand->text = copy;
+    cand->len = (uint32_t)len;
+    cand->charmask = fuzzy_charmask(text, len);
+    return 0;
+}
+
+// --- Scoring ---
+
+static void prepare_query(const char *query, size_t len, PreparedQuery *pq) {
+    if (len > FUZZY_MAX_QUERY) {
+        len = FUZZY_MAX_QUERY;
+    }
+
+    // Smart case: an uppercase letter anywhere makes the search exact-case
+    int case_sensitive = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (isupper((unsigned char)query[i])) {
+            case_sensitive = 1;
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)query[i];
+        pq->lo[i] = case_sensitive ? (char)c : (char)tolower(c);
+        pq->up[i] = case_sensitive ? (char)c : (char)toupper(c);
+    }
+    pq->len = len;
+    pq->mask = fuzzy_charmask(query, len);
+}
+
+/**
+ * Find the first byte in [p, end) equal to lo or up.
+ */
+static inline const char *find_char(const char *p, const char *end, char lo, char up) {
+#ifdef __SSE2__
+    const __m128i vlo = _mm_set1_epi8(lo);
+    const __m128i vup = _mm_set1_epi8(up);
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)p);
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, vlo), _mm_cmpeq_epi8(chunk, vup));
+        int bits = _mm_movemask_epi8(hits);
+        if (bits != 0) {
+            return p + __builtin_ctz(bits);
+        }
+        p += 16;
+    }
+#endif
+    for (; p < end; p++) {
+        if (*p == lo || *p == up) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Bonus for matching cur when it follows prev (prev = 0 at string start).
+ */
+static inline int position_bonus(unsigned char prev, unsigned char cur) {
+    int cur_word = isalnum(cur);
+    if (!cur_word) {
+        return 0;
+    }
+    if (prev == 0 || prev == '/') {
+        return BONUS_PATH;
+    }
+    if (!isalnum(prev)) {
+        return BONUS_BOUNDARY;
+    }
+    if ((islower(prev) && isupper(cur)) || (isalpha(prev) && isdigit(cur))) {
+        return BONUS_CAMEL;
+    }
+    return 0;
+}
+
+static inline int max_int(int a, int b) {
+    return a > b ? a : b;
+}
+
+/**
+ * Score using only the greedy forward positions (very wide regions).
+ */
+static int32_t score_greedy(const PreparedQuery *pq, const char *text, const char *end) {
+    const char *p = text;
+    const char *prev_match = NULL;
+    int32_t score = 0;
+
+    for (size_t i = 0; i < pq->len; i++) {
+        p = find_char(p, end, pq->lo[i], pq->up[i]);
+        if (p == NULL) {
+            return FUZZY_NO_MATCH;
+        }
+        unsigned char prev = (p == text) ? 0 : (unsigned char)p[-1];
+        int bonus = position_bonus(prev, (unsigned char)*p);
+        if (i == 0) {
+            score += SCORE_MATCH + bonus * BONUS_FIRST_CHAR_MULTIPLIER;
+        } else if (p == prev_match + 1) {
+            score += SCORE_MATCH + max_int(bonus, BONUS_CONSECUTIVE);
+        } else {
+            int gap = (int)(p - prev_match - 1);
+            score += SCORE_MATCH + bonus + SCORE_GAP_START + (gap - 1) * SCORE_GAP_EXTENSION;
+        }
+        prev_match = p;
+        p++;
+    }
+    return score;
+}
+
+static int32_t score_prepared(const PreparedQuery *pq, const FuzzyCandidate *cand) {
+    if (pq->len == 0) {
+        return 0;
+    }
+    if ((cand->charmask & pq->mask) != pq->mask) {
+        return FUZZY_NO_MATCH;
+    }
+
+    const char *text = cand->text;
+    const char *end = text + cand->len;
+
+    // Forward subsequence pass: does the query match at all, and where?
+    const char *p = text;
+    const char *first = NULL;
+    for (size_t i = 0; i < pq->len; i++) {
+        p = find_char(p, end, pq->lo[i], pq->up[i]);
+        if (p == NULL) {
+            return FUZZY_NO_MATCH;
+        }
+        if (i == 0) {
+            first = p;
+        }
+        p++;
+    }
+
+    // The best alignment lies between the first occurrence of the first
+    // query char and the last occurrence of the last query char
+    size_t last_q = pq->len - 1;
+    const char *stop = end - 1;
+    while (stop >= p && *stop != pq->lo[last_q] && *stop != pq->up[last_q]) {
+        stop--;
+    }
+    if (stop < p - 1) {
+        stop = p - 1;
+    }
+
+    size_t width = (size_t)(stop - first) + 1;
+    if (width > FUZZY_DP_MAX_WIDTH) {
+        return score_greedy(pq, first, end);
+    }
+
+    int32_t m_prev[FUZZY_DP_MAX_WIDTH], h_prev[FUZZY_DP_MAX_WIDTH];
+    int32_t m_cur[FUZZY_DP_MAX_WIDTH], h_cur[FUZZY_DP_MAX_WIDTH];
+    int8_t bonus[FUZZY_DP_MAX_WIDTH];
+
+    for (size_t j = 0; j < width; j++) {
+        const char *c = first + j;
+        unsigned char prev = (c == text) ? 0 : (unsigned char)c[-1];
+        bonus[j] = (int8_t)position_bonus(prev, (unsigned char)*c);
+    }
+
+    int32_t best = FUZZY_NEG;
+    for (size_t i = 0; i < pq->len; i++) {
+        const char lo = pq->lo[i];
+        const char up = pq->up[i];
+        int32_t gap = FUZZY_NEG;
+        best = FUZZY_NEG;
+
+        for (size_t j = 0; j < width; j++) {
+            char c = first[j];
+            int32_t m = FUZZY_NEG;
+
+            if (c == lo || c == up) {
+                if (i == 0) {
+                    m = SCORE_MATCH + bonus[j] * BONUS_FIRST_CHAR_MULTIPLIER;
+                } else if (j > 0) {
+                    int32_t via_gap = h_prev[j - 1] + SCORE_MATCH + bonus[j];
+                    int32_t via_run = m_prev[j - 1] + SCORE_MATCH + max_int(bonus[j], BONUS_CONSECUTIVE);
+                    m = max_int(via_gap, via_run);
+                    if (m < FUZZY_NEG / 2) {
+                        m = FUZZY_NEG;
+                    }
+                }
+            }
+
+            // Affine gap: opening costs more than extending
+            if (j > 0) {
+                gap = max_int(m_cur[j - 1] + SCORE_GAP_START, gap + SCORE_GAP_EXTENSION);
+            }
+            m_cur[j] = m;
+            h_cur[j] = max_int(m, gap);
+            if (m > best) {
+                best = m;
+            }
+        }
+
+        memcpy(m_prev, m_cur, width * sizeof(int32_t));
+        memcpy(h_prev, h_cur, width * sizeof(int32_t));
+    }
+
+    return best <= FUZZY_NEG / 2 ? FUZZY_NO_MATCH : best;
+}
+
+int32_t fuzzy_score(const char *query, size_t query_len, const FuzzyCandidate *cand) {
+    PreparedQuery pq;
+    prepare_query(query, query_len, &pq);
+    return score_prepared(&pq, cand);
+}
+
+// --- Top-K Heap ---
+
+// True if a ranks below b (lower score, then longer text, then later input)
+static inline int match_worse(const FuzzySet *set, const FuzzyMatch *a, const FuzzyMatch *b) {
+    if (a->score != b->score) {
+        return a->score < b->score;
+    }
+    uint32_t la = set->items[a->index].len;
+    uint32_t lb = set->items[b->index].len;
+    if (la != lb) {
+        return la > lb;
+    }
+    return a->index > b->index;
+}
+
+static void heap_sift_down(const FuzzySet *set, FuzzyMatch *heap, size_t count, size_t i) {
+    while (1) {
+        size_t l = 2 * i + 1;
+        size_t r = l + 1;
+        size_t worst = i;
+        if (l < count && match_worse(set, &heap[l], &heap[worst])) {
+            worst = l;
+        }
+        if (r < count && match_worse(set, &heap[r], &heap[worst])) {
+            worst = r;
+        }
+        if (worst == i) {
+            return;
+        }
+        FuzzyMatch tmp = heap[i];
+        heap[i] = heap[worst];
+        heap[worst] = tmp;
+        i = worst;
+    }
+}
+
+static void heap_push(const FuzzySet *set, FuzzyMatch *heap, size_t *count, size_t k, FuzzyMatch m) {
+    if (k == 0) {
+        return;
+    }
+    if (*count < k) {
+        size_t i = (*count)++;
+        heap[i] = m;
+        while (i > 0) {
+            size_t parent = (i - 1) / 2;
+            if (!match_worse(set, &heap[i], &heap[parent])) {
+                break;
+            }
+            FuzzyMatch tmp = heap[i];
+            heap[i] = heap[parent];
+            heap[parent] = tmp;
+            i = parent;
+        }
+    } else if (match_worse(set, &heap[0], &m)) {
+        heap[0] = m;
+        heap_sift_down(set, heap, *count, 0);
+    }
+}
+
+static void heapify(const FuzzySet *set, FuzzyMatch *heap, size_t count) {
+    for (size_t i = count / 2; i-- > 0; ) {
+        heap_sift_down(set, heap, count, i);
+    }
+}
+
+// --- Results ---
+
+void fuzzy_result_init(FuzzyResult *res, size_t k) {
+    memset(res, 0, sizeof(*res));
+    res->k = k;
+    res->top = (k > 0) ? malloc(k * sizeof(FuzzyMatch)) : NULL;
+}
+
+void fuzzy_result_free(FuzzyResult *res) {
+    free(res->matched);
+    free(res->top);
+    memset(res, 0, sizeof(*res));
+}
+
+static int matched_append(uint32_t **list, size_t *count, size_t *capacity, uint32_t index) {
+    if (*count == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 1024;
+        uint32_t *grown = realloc(*list, new_capacity * sizeof(uint32_t));
+        if (grown == NULL) {
+            return -1;
+        }
+        *list = grown;
+        *capacity = new_capacity;
+    }
+    (*list)[(*count)++] = index;
+    return 0;
+}
+
+// Work description: items [begin, end) of a virtual list made of
+// old_list[0..old_count) followed by candidates [new_first, ...)
+typedef struct {
+    const FuzzySet *set;
+    const PreparedQuery *pq;
+    const uint32_t *old_list;
+    size_t old_count;
+    size_t new_first;
+    size_t begin;
+    size_t end;
+    size_t k;
+
+    uint32_t *matched;
+    size_t matched_count;
+    size_t matched_capacity;
+    FuzzyMatch *heap;
+    size_t heap_count;
+} SearchWork;
+
+static void *search_worker(void *arg) {
+    SearchWork *w = (SearchWork *)arg;
+
+    for (size_t i = w->begin; i < w->end; i++) {
+        uint32_t index = (i < w->old_count) ? w->old_list[i]
+                                            : (uint32_t)(w->new_first + (i - w->old_count));
+        int32_t score = score_prepared(w->pq, &w->set->items[index]);
+        if (score == FUZZY_NO_MATCH) {
+            continue;
+        }
+        matched_append(&w->matched, &w->matched_count, &w->matched_capacity, index);
+        FuzzyMatch m = { index, score };
+        heap_push(w->set, w->heap, &w->heap_count, w->k, m);
+    }
+    return NULL;
+}
+
+static int online_cpus(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) {
+        n = 1;
+    }
+    return n > FUZZY_MAX_THREADS ? FUZZY_MAX_THREADS : (int)n;
+}
+
+void fuzzy_search(const FuzzySet *set, const char *query, FuzzyResult *res, int threads) {
+    size_t qlen = strlen(query);
+    if (qlen > FUZZY_MAX_QUERY) {
+        qlen = FUZZY_MAX_QUERY;
+    }
+
+    // Empty query: everything matches, keep input order
+    if (qlen == 0) {
+        res->matched_count = 0;
+        res->top_count = 0;
+        for (size_t i = 0; i < set->count && res->top_count < res->k; i++) {
+            res->top[res->top_count].index = (uint32_t)i;
+            res->top[res->top_count].score = 0;
+            res->top_count++;
+        }
+        res->total_matches = set->count;
+        res->scanned = set->count;
+        res->query[0] = '\0';
+        res->valid = 1;
+        return;
+    }
+
+    int same = res->valid && strncmp(res->query, query, qlen) == 0 && res->query[qlen] == '\0';
+    int narrows = res->valid && !same && res->query[0] != '\0' &&
+                  strncmp(query, res->query, strlen(res->query)) == 0;
+
+    const uint32_t *old_list = NULL;
+    size_t old_count = 0;
+    size_t new_first;
+    uint32_t *old_owned = NULL;
+
+    if (same) {
+        // Only candidates that arrived since the last search
+        new_first = res->scanned;
+        heapify(set, res->top, res->top_count);  // May have been sorted
+    } else if (narrows) {
+        // Longer query can only match a subset of the previous matches
+        old_owned = res->matched;
+        old_list = old_owned;
+        old_count = res->matched_count;
+        new_first = res->scanned;
+        res->matched = NULL;
+        res->matched_count = 0;
+        res->matched_capacity = 0;
+        res->top_count = 0;
+        res->total_matches = 0;
+    } else {
+        new_first = 0;
+        res->matched_count = 0;
+        res->top_count = 0;
+        res->total_matches = 0;
+    }
+
+    PreparedQuery pq;
+    prepare_query(query, qlen, &pq);
+
+    size_t work = old_count + (set->count - new_first);
+    int nthreads = (threads > 0) ? threads : online_cpus();
+    if (work < FUZZY_PARALLEL_MIN) {
+        nthreads = 1;
+    }
+    if (nthreads > FUZZY_MAX_THREADS) {
+        nthreads = FUZZY_MAX_THREADS;
+    }
+
+    SearchWork works[FUZZY_MAX_THREADS];
+    pthread_t tids[FUZZY_MAX_THREADS];
+    int started[FUZZY_MAX_THREADS] = {0};
+    size_t chunk = (work + nthreads - 1) / (nthreads ? nthreads : 1);
+
+    for (int t = 0; t < nthreads; t++) {
+        SearchWork *w = &works[t];
+        memset(w, 0, sizeof(*w));
+        w->set = set;
+        w->pq = &pq;
+        w->old_list = old_list;
+        w->old_count = old_count;
+        w->new_first = new_first;
+        w->begin = (size_t)t * chunk;
+        w->end = w->begin + chunk > work ? work : w->begin + chunk;
+        if (w->begin > work) {
+            w->begin = work;
+        }
+        w->k = res->k;
+        w->heap = (res->k > 0) ? malloc(res->k * sizeof(FuzzyMatch)) : NULL;
+
+        // Worker 0 runs on the calling thread
+        if (t > 0 && pthread_create(&tids[t], NULL, search_worker, w) == 0) {
+            started[t] = 1;
+        }
+    }
+
+    search_worker(&works[0]);
+    for (int t = 1; t < nthreads; t++) {
+        if (started[t]) {
+            pthread_join(tids[t], NULL);
+        } else {
+            search_worker(&works[t]);
+        }
+    }
+
+    // Merge in worker order so the match list stays in candidate order
+    for (int t = 0; t < nthreads; t++) {
+        SearchWork *w = &works[t];
+        for (size_t i = 0; i < w->matched_count; i++) {
+            matched_append(&res->matched, &res->matched_count, &res->matched_capacity, w->matched[i]);
+        }
+        for (size_t i = 0; i < w->heap_count; i++) {
+            heap_push(set, res->top, &res->top_count, res->k, w->heap[i]);
+        }
+        res->total_matches += w->matched_count;
+        free(w->matched);
+        free(w->heap);
+    }
+
+    free(old_owned);
+    memcpy(res->query, query, qlen);
+    res->query[qlen] = '\0';
+    res->scanned = set->count;
+    res->valid = 1;
+}
+
+static const FuzzySet *sort_set;
+
+static int compare_best_first(const void *a, const void *b) {
+    const FuzzyMatch *ma = a;
+    const FuzzyMatch *mb = b;
+    if (match_worse(sort_set, ma, mb)) {
+        return 1;
+    }
+    if (match_worse(sort_set, mb, ma)) {
+        return -1;
+    }
+    return 0;
+}
+
+void fuzzy_result_sort(const FuzzySet *set, FuzzyResult *res) {
+    if (res->query[0] == '\0') {
+        return;  // Empty query results are already in input order
+    }
+    sort_set = set;
+    qsort(res->top, res->top_count, sizeof(FuzzyMatch), compare_best_first);
+}
@@ -0,0 +1,132 @@
+/**
+ * intern.c - Process-wide string interning
+ *
+ * Strings are copied into large chunks (bump allocation, never freed)
+ * and indexed by an open-addressing hash table of pointers that doubles
+ * when it is three-quarters full. All memory is counted under
+ * MEM_INTERN. A single mutex serializes lookups; interning happens when
+ * variables are created and packages are loaded, not on hot paths.
+ */
+
+#include "intern.h"
+#include "memstats.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#define INTERN_CHUNK_SIZE 4096
+#define INTERN_INITIAL_SLOTS 256
+
+typedef struct InternChunk {
+    struct InternChunk *next;
+    size_t used;
+    size_t size;
+    char data[];
+} InternChunk;
+
+static pthread_mutex_t intern_lock = PTHREAD_MUTEX_INITIALIZER;
+static const char **slots;
+static size_t slot_count;
+static size_t string_count;
+static size_t string_bytes;
+static InternChunk *chunks;
+
+static uint32_t intern_hash(const char *str, size_t len) {
+    uint32_t h = 2166136261u;  // FNV-1a
+    size_t i;
+    for (i = 0; i < len; i++) {
+        h ^= (unsigned char)str[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/*
+ * Double the hash table (or create it). Caller holds intern_lock.
+ */
+static int intern_grow(void) {
+    size_t count = slot_count ? slot_count * 2 : INTERN_INITIAL_SLOTS;
+    const char **fresh = mem_calloc(MEM_INTERN, count, sizeof(*fresh));
+    size_t i;
+
+    if (!fresh) {
+        return -1;
+    }
+    for (i = 0; i < slot_count; i++) {
+        if (slots[i]) {
+            size_t j = intern_hash(slots[i], strlen(slots[i])) & (count - 1);
+            while (fresh[j]) {
+                j = (j + 1) & (count - 1);
+            }
+            fresh[j] = slots[i];
+        }
+    }
+    mem_free(MEM_INTERN, slots);
+    slots = fresh;
+    slot_count = count;
+    return 0;
+}
+
+/*
+ * Copy len bytes plus a NUL into chunk storage. Caller holds intern_lock.
+ */
+static char *intern_store(const char *str, size_t len) {
+    char *copy;
+
+    if (!chunks || chunks->size - chunks->used < len + 1) {
+        size_t size = len + 1 > INTERN_CHUNK_SIZE ? len + 1 : INTERN_CHUNK_SIZE;
+        InternChunk *chunk = mem_malloc(MEM_INTERN, sizeof(InternChunk) + size);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = chunks;
+        chunk->used = 0;
+        chunk->size = size;
+        chunks = chunk;
+    }
+    copy = chunks->data + chunks->used;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    chunks->used += len + 1;
+    return copy;
+}
+
+const char *intern_n(const char *str, size_t len) {
+    const char *result = NULL;
+    size_t i;
+
+    pthread_mutex_lock(&intern_lock);
+    if ((string_count + 1) * 4 > slot_count * 3 && intern_grow() < 0) {
+        pthread_mutex_unlock(&intern_lock);
+        return NULL;
+    }
+    i = intern_hash(str, len) & (slot_count - 1);
+    while (slots[i]) {
+        if (strncmp(slots[i], str, len) == 0 && slots[i][len] == '\0') {
+            result = slots[i];
+            break;
+        }
+        i = (i + 1) & (slot_count - 1);
+    }
+    if (!result) {
+        result = intern_store(str, len);
+        if (result) {
+            slots[i] = result;
+            string_count++;
+            string_bytes += len + 1;
+        }
+    }
+    pthread_mutex_unlock(&intern_lock);
+    return result;
+}
+
+const char *intern(const char *str) {
+    return intern_n(str, strlen(str));
+}
+
+void intern_stats(size_t *strings, size_t *bytes) {
+    pthread_mutex_lock(&intern_lock);
+    *strings = string_count;
+    *bytes = string_bytes;
+    pthread_mutex_unlock(&intern_lock);
+}
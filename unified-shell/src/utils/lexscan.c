@@ -0,0 +1,241 @@
+/**
+ * lexscan.c - Block-at-a-time byte classification for the command lexer
+ *
+ * A classifier turns 64 bytes into one 64-bit mask per class. The SIMD
+ * variants compare 16 (SSE2) or 32 (AVX2) bytes against each class's
+ * characters at once and gather the results with movemask; the scalar
+ * variant looks every byte up in a table. The variant is chosen once,
+ * on first use, from the CPU's features and USHELL_LEXER.
+ *
+ * The last partial block is copied into a zero-filled buffer first, so
+ * every classifier reads whole blocks and NUL padding has no class.
+ */
+
+#include "lexscan.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LEXSCAN_X86 1
+#endif
+
+typedef void (*ClassifyFn)(const unsigned char *block, uint64_t *out);
+
+/* Class of each byte; a byte belongs to at most one class */
+static const unsigned char lex_class[256] = {
+    [' '] = LEX_SPACE, ['\t'] = LEX_SPACE, ['\n'] = LEX_SPACE,
+    ['\''] = LEX_QUOTE, ['"'] = LEX_QUOTE,
+    ['|'] = LEX_OPER, ['<'] = LEX_OPER, ['>'] = LEX_OPER,
+    ['&'] = LEX_OPER, [';'] = LEX_OPER,
+    ['$'] = LEX_EXPAND, ['`'] = LEX_EXPAND,
+    ['*'] = LEX_GLOB, ['?'] = LEX_GLOB, ['['] = LEX_GLOB,
+    [']'] = LEX_CLOSE,
+};
+
+static void classify_scalar(const unsigned char *block, uint64_t *out) {
+    memset(out, 0, LEX_NCLASSES * sizeof(uint64_t));
+    for (int i = 0; i < 64; i++) {
+        unsigned c = lex_class[block[i]];
+        if (c) {
+            out[__builtin_ctz(c)] |= (uint64_t)1 << i;
+        }
+    }
+}
+
+#if defined(LEXSCAN_X86) && defined(__SSE2__)
+#define EQ16(v, c) _mm_cmpeq_epi8((v), _mm_set1_epi8(c))
+#define MASK16(x) ((uint64_t)(unsigned)_mm_movemask_epi8(x))
+
+static void classify_sse2(const unsigned char *block, uint64_t *out) {
+    memset(out, 0, LEX_NCLASSES * sizeof(uint64_t));
+    for (int i = 0; i < 64; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(block + i));
+        __m128i space = _mm_or_si128(_mm_or_si128(EQ16(v, ' '), EQ16(v, '\t')), EQ16(v, '\n'));
+        __m128i quote = _mm_or_si128(EQ16(v, '\''), EQ16(v, '"'));
+        __m128i oper = _mm_or_si128(_mm_or_si128(EQ16(v, '|'), EQ16(v, '<')),
+                                    _mm_or_si128(_mm_or_si128(EQ16(v, '>'), EQ16(v, '&')),
+                                                 EQ16(v, ';')));
+        __m128i expand = _mm_or_si128(EQ16(v, '$'), EQ16(v, '`'));
+        __m128i glob = _mm_or_si128(_mm_or_si128(EQ16(v, '*'), EQ16(v, '?')), EQ16(v, '['));
+        out[0] |= MASK16(space) << i;
+        out[1] |= MASK16(quote) << i;
+        out[2] |= MASK16(oper) << i;
+        out[3] |= MASK16(expand) << i;
+        out[4] |= MASK16(glob) << i;
+        out[5] |= MASK16(EQ16(v, ']')) << i;
+    }
+}
+
+#define EQ32(v, c) _mm256_cmpeq_epi8((v), _mm256_set1_epi8(c))
+#define OR32(a, b) _mm256_or_si256((a), (b))
+#define MASK32(x) ((uint64_t)(uint32_t)_mm256_movemask_epi8(x))
+
+__attribute__((target("avx2")))
+static void classify_avx2(const unsigned char *block, uint64_t *out) {
+    memset(out, 0, LEX_NCLASSES * sizeof(uint64_t));
+    for (int i = 0; i < 64; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(block + i));
+        __m256i space = OR32(OR32(EQ32(v, ' '), EQ32(v, '\t')), EQ32(v, '\n'));
+        __m256i quote = OR32(EQ32(v, '\''), EQ32(v, '"'));
+        __m256i oper = OR32(OR32(EQ32(v, '|'), EQ32(v, '<')),
+                            OR32(OR32(EQ32(v, '>'), EQ32(v, '&')), EQ32(v, ';')));
+        __m256i expand = OR32(EQ32(v, '$'), EQ32(v, '`'));
+        __m256i glob = OR32(OR32(EQ32(v, '*'), EQ32(v, '?')), EQ32(v, '['));
+        out[0] |= MASK32(space) << i;
+        out[1] |= MASK32(quote) << i;
+        out[2] |= MASK32(oper) << i;
+        out[3] |= MASK32(expand) << i;
+        out[4] |= MASK32(glob) << i;
+        out[5] |= MASK32(EQ32(v, ']')) << i;
+    }
+}
+#define LEXSCAN_SIMD 1
+#endif
+
+static ClassifyFn lex_classify = classify_scalar;
+static const char *lex_variant_name = "scalar";
+static pthread_once_t lex_once = PTHREAD_ONCE_INIT;
+
+static void lexscan_select(void) {
+#ifdef LEXSCAN_SIMD
+    const char *want = getenv("USHELL_LEXER");
+    int have_avx2 = __builtin_cpu_supports("avx2");
+
+    if (want && strcmp(want, "scalar") == 0) {
+        return;
+    }
+    if (have_avx2 && (want == NULL || strcmp(want, "sse2") != 0)) {
+        lex_classify = classify_avx2;
+        lex_variant_name = "avx2";
+    } else {
+        lex_classify = classify_sse2;
+        lex_variant_name = "sse2";
+    }
+#endif
+}
+
+/*
+ * Classify len bytes of s into out (nblocks * LEX_NCLASSES masks)
+ */
+static void classify_blocks(const char *s, size_t len, uint64_t *out) {
+    const unsigned char *p = (const unsigned char *)s;
+    size_t full = len / 64;
+
+    pthread_once(&lex_once, lexscan_select);
+    for (size_t b = 0; b < full; b++) {
+        lex_classify(p + b * 64, out + b * LEX_NCLASSES);
+    }
+    if (len % 64) {
+        unsigned char pad[64] = {0};
+        memcpy(pad, p + full * 64, len % 64);
+        lex_classify(pad, out + full * LEX_NCLASSES);
+    }
+}
+
+static unsigned masks_seen(const uint64_t *bits, size_t nblocks) {
+    uint64_t any[LEX_NCLASSES] = {0};
+    unsigned seen = 0;
+
+    for (size_t b = 0; b < nblocks; b++) {
+        for (int c = 0; c < LEX_NCLASSES; c++) {
+            any[c] |= bits[b * LEX_NCLASSES + c];
+        }
+    }
+    for (int c = 0; c < LEX_NCLASSES; c++) {
+        if (any[c]) {
+            seen |= 1u << c;
+        }
+    }
+    return seen;
+}
+
+int lexscan_init(LexScan *ls, const char *s, size_t len) {
+    ls->len = len;
+    ls->nblocks = (len + 63) / 64;
+    ls->bits = ls->inline_bits;
+    if (ls->nblocks > LEXSCAN_INLINE_BYTES / 64) {
+        ls->bits = malloc(ls->nblocks * LEX_NCLASSES * sizeof(uint64_t));
+        if (ls->bits == NULL) {
+            ls->len = ls->nblocks = 0;
+            ls->seen = 0;
+            return -1;
+        }
+    }
+    classify_blocks(s, len, ls->bits);
+    ls->seen = masks_seen(ls->bits, ls->nblocks);
+    return 0;
+}
+
+void lexscan_free(LexScan *ls) {
+    if (ls->bits != ls->inline_bits) {
+        free(ls->bits);
+    }
+    ls->bits = ls->inline_bits;
+    ls->len = ls->nblocks = 0;
+}
+
+static inline uint64_t block_mask(const LexScan *ls, size_t b, unsigned classes) {
+    const uint64_t *m = ls->bits + b * LEX_NCLASSES;
+    uint64_t r = 0;
+    for (int c = 0; c < LEX_NCLASSES; c++) {
+        if (classes & (1u << c)) {
+            r |= m[c];
+        }
+    }
+    return r;
+}
+
+/*
+ * First set bit at or after from in the (optionally inverted) class masks
+ */
+static size_t scan_from(const LexScan *ls, unsigned classes, size_t from, int invert) {
+    if (from >= ls->len) {
+        return ls->len;
+    }
+    size_t b = from / 64;
+    uint64_t flip = invert ? ~(uint64_t)0 : 0;
+    uint64_t m = (block_mask(ls, b, classes) ^ flip) & (~(uint64_t)0 << (from % 64));
+    while (m == 0) {
+        if (++b >= ls->nblocks) {
+            return ls->len;
+        }
+        m = block_mask(ls, b, classes) ^ flip;
+    }
+    size_t pos = b * 64 + (size_t)__builtin_ctzll(m);
+    return pos < ls->len ? pos : ls->len;
+}
+
+size_t lexscan_next(const LexScan *ls, unsigned classes, size_t from) {
+    return scan_from(ls, classes, from, 0);
+}
+
+size_t lexscan_next_not(const LexScan *ls, unsigned classes, size_t from) {
+    return scan_from(ls, classes, from, 1);
+}
+
+int lexscan_any(const LexScan *ls, unsigned classes, size_t from, size_t to) {
+    if (from >= to || !(ls->seen & classes)) {
+        return 0;
+    }
+    return lexscan_next(ls, classes, from) < to;
+}
+
+unsigned lexscan_classes(const char *s, size_t len) {
+    uint64_t bits[8 * LEX_NCLASSES];
+    unsigned seen = 0;
+
+    // Eight blocks at a time keeps the masks on the stack
+    for (size_t off = 0; off < len; off += 8 * 64) {
+        size_t chunk = len - off < 8 * 64 ? len - off : 8 * 64;
+        classify_blocks(s + off, chunk, bits);
+        seen |= masks_seen(bits, (chunk + 63) / 64);
+    }
+    return seen;
+}
+
+const char *lexscan_variant(void) {
+    pthread_once(&lex_once, lexscan_select);
+    return lex_variant_name;
+}
@@ -0,0 +1,162 @@
+/**
+ * memstats.c - Counting allocator wrappers and the memstats report
+ *
+ * Each wrapper calls the system allocator and adjusts the subsystem's
+ * counters by the block's usable size. Counters are updated with
+ * __atomic builtins so pool workers and MCP client threads can allocate
+ * without a lock.
+ */
+
+#include "memstats.h"
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+static MemCounters counters[MEM_SUBSYSTEM_COUNT];
+
+static const char *subsystem_names[MEM_SUBSYSTEM_COUNT] = {
+    [MEM_ENV] = "env",
+    [MEM_JOBS] = "jobs",
+    [MEM_APT] = "apt",
+    [MEM_MCP] = "mcp",
+    [MEM_INTERN] = "intern",
+};
+
+/*
+ * Add delta (may wrap, i.e. be negative) to live_bytes and raise the peak
+ */
+static void count_live(MemCounters *c, size_t delta) {
+    size_t live = __atomic_add_fetch(&c->live_bytes, delta, __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&c->peak_bytes, __ATOMIC_RELAXED);
+
+    while (live > peak &&
+           !__atomic_compare_exchange_n(&c->peak_bytes, &peak, live, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        /* peak reloaded by the failed exchange */
+    }
+}
+
+static void count_alloc(MemSubsystem sub, void *ptr) {
+    count_live(&counters[sub], malloc_usable_size(ptr));
+    __atomic_add_fetch(&counters[sub].allocs, 1, __ATOMIC_RELAXED);
+}
+
+static void count_free(MemSubsystem sub, size_t size) {
+    MemCounters *c = &counters[sub];
+    __atomic_sub_fetch(&c->live_bytes, size, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&c->frees, 1, __ATOMIC_RELAXED);
+}
+
+void *mem_malloc(MemSubsystem sub, size_t size) {
+    void *ptr = malloc(size);
+    if (ptr) {
+        count_alloc(sub, ptr);
+    }
+    return ptr;
+}
+
+void *mem_calloc(MemSubsystem sub, size_t n, size_t size) {
+    void *ptr = calloc(n, size);
+    if (ptr) {
+        count_alloc(sub, ptr);
+    }
+    return ptr;
+}
+
+void *mem_realloc(MemSubsystem sub, void *ptr, size_t size) {
+    size_t old_size;
+    void *fresh;
+
+    if (ptr == NULL) {
+        return mem_malloc(sub, size);
+    }
+    old_size = malloc_usable_size(ptr);
+    fresh = realloc(ptr, size);
+    if (fresh) {
+        /* Same logical block: move the live bytes, leave the counts alone */
+        count_live(&counters[sub], malloc_usable_size(fresh) - old_size);
+    }
+    return fresh;
+}
+
+char *mem_strdup(MemSubsystem sub, const char *str) {
+    size_t len = strlen(str) + 1;
+    char *copy = mem_malloc(sub, len);
+    if (copy) {
+        memcpy(copy, str, len);
+    }
+    return copy;
+}
+
+void mem_free(MemSubsystem sub, void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    count_free(sub, malloc_usable_size(ptr));
+    free(ptr);
+}
+
+void mem_counters(MemSubsystem sub, MemCounters *out) {
+    out->allocs = __atomic_load_n(&counters[sub].allocs, __ATOMIC_RELAXED);
+    out->frees = __atomic_load_n(&counters[sub].frees, __ATOMIC_RELAXED);
+    out->live_bytes = __atomic_load_n(&counters[sub].live_bytes, __ATOMIC_RELAXED);
+    out->peak_bytes = __atomic_load_n(&counters[sub].peak_bytes, __ATOMIC_RELAXED);
+}
+
+const char *mem_subsystem_name(MemSubsystem sub) {
+    if (sub < 0 || sub >= MEM_SUBSYSTEM_COUNT) {
+        return "?";
+    }
+    return subsystem_names[sub];
+}
+
+/*
+ * Read one "Key:   1234 kB" line of /proc/self/status, in kB (0 if absent)
+ */
+static unsigned long proc_status_kb(const char *key) {
+    FILE *fp = fopen("/proc/self/status", "r");
+    char line[256];
+    size_t klen = strlen(key);
+    unsigned long kb = 0;
+
+    if (!fp) {
+        return 0;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, key, klen) == 0 && line[klen] == ':') {
+            kb = strtoul(line + klen + 1, NULL, 10);
+            break;
+        }
+    }
+    fclose(fp);
+    return kb;
+}
+
+void mem_print_stats(FILE *out) {
+    MemCounters total = {0, 0, 0, 0};
+    int i;
+
+    fprintf(out, "%-8s %10s %10s %12s %12s\n",
+            "SUBSYS", "ALLOCS", "FREES", "LIVE(B)", "PEAK(B)");
+    for (i = 0; i < MEM_SUBSYSTEM_COUNT; i++) {
+        MemCounters c;
+        mem_counters((MemSubsystem)i, &c);
+        fprintf(out, "%-8s %10lu %10lu %12zu %12zu\n",
+                subsystem_names[i], c.allocs, c.frees, c.live_bytes, c.peak_bytes);
+        total.allocs += c.allocs;
+        total.frees += c.frees;
+        total.live_bytes += c.live_bytes;
+        total.peak_bytes += c.peak_bytes;
+    }
+    fprintf(out, "%-8s %10lu %10lu %12zu %12zu\n",
+            "total", total.allocs, total.frees, total.live_bytes, total.peak_bytes);
+
+    fprintf(out, "\nrss      %lu kB (peak %lu kB)\n",
+            proc_status_kb("VmRSS"), proc_status_kb("VmHWM"));
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 mi = mallinfo2();
+    fprintf(out, "heap     %zu B arena, %zu B in use, %zu B free, %zu B mmap\n",
+            mi.arena, mi.uordblks, mi.fordblks, mi.hblkhd);
+#endif
+}
@@ -0,0 +1,406 @@
+/**
+ * readbuf.c - Shared, record-oriented reads for read and mapfile
+ *
+ * A naive `read` has to issue one read(2) per byte: anything it pulls
+ * past the delimiter would be lost to the next command reading the same
+ * descriptor. Here each kind of descriptor uses the cheapest strategy
+ * that still leaves the descriptor positioned right after the record.
+ */
+
+#define _GNU_SOURCE
+#include "readbuf.h"
+#include "signals.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define READBUF_SLOTS 8
+#define READBUF_CHUNK (64 * 1024)
+
+/**
+ * Per-fd state: a window of a regular file, or a peek pipe for a FIFO
+ */
+typedef struct {
+    int fd;                 // -1 when unused
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    off_t base;             // File offset of data[0]
+    char *data;
+    size_t len;
+    size_t cap;
+    int peek[2];            // tee(2) target for pipes, -1 if not created
+    unsigned long used;     // LRU stamp
+} ReadBuf;
+
+static ReadBuf slots[READBUF_SLOTS];
+static unsigned long use_clock = 0;
+static pthread_mutex_t readbuf_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int stdin_is_commands = 0;
+static dev_t stdin_dev;
+static ino_t stdin_ino;
+
+void readbuf_init(void) {
+    struct stat st;
+
+    for (int i = 0; i < READBUF_SLOTS; i++) {
+        slots[i].fd = -1;
+        slots[i].peek[0] = slots[i].peek[1] = -1;
+    }
+    if (!isatty(STDIN_FILENO) && fstat(STDIN_FILENO, &st) == 0) {
+        stdin_is_commands = 1;
+        stdin_dev = st.st_dev;
+        stdin_ino = st.st_ino;
+    }
+}
+
+/**
+ * Find (or recycle the least recently used) slot for fd
+ */
+static ReadBuf *slot_for(int fd) {
+    ReadBuf *victim = &slots[0];
+
+    for (int i = 0; i < READBUF_SLOTS; i++) {
+        if (slots[i].fd == fd) {
+            slots[i].used = ++use_clock;
+            return &slots[i];
+        }
+        if (slots[i].used < victim->used) {
+            victim = &slots[i];
+        }
+    }
+    victim->fd = fd;
+    victim->len = 0;
+    victim->dev = 0;
+    victim->ino = 0;
+    victim->used = ++use_clock;
+    return victim;
+}
+
+/**
+ * Append n bytes to the caller's getdelim-style buffer
+ */
+static int out_append(char **line, size_t *cap, size_t *len, const char *src, size_t n) {
+    if (*line == NULL || *len + n + 1 > *cap) {
+        size_t want = *cap ? *cap : 128;
+        while (want < *len + n + 1) {
+            want *= 2;
+        }
+        char *grown = realloc(*line, want);
+        if (grown == NULL) {
+            return -1;
+        }
+        *line = grown;
+        *cap = want;
+    }
+    memcpy(*line + *len, src, n);
+    *len += n;
+    (*line)[*len] = '\0';
+    return 0;
+}
+
+/**
+ * Wait until fd is readable; poll(2) is not restarted, so Ctrl-C gets through
+ */
+static int wait_readable(int fd) {
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    while (poll(&pfd, 1, -1) < 0) {
+        if (errno != EINTR || sigint_received) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Regular file: serve records from a cached window, then seek past them
+ */
+static ssize_t read_regular(ReadBuf *rb, const struct stat *st, int delim,
+                            char **line, size_t *cap) {
+    off_t cur = lseek(rb->fd, 0, SEEK_CUR);
+    if (cur < 0) {
+        return -1;
+    }
+
+    // Reuse the window only if it is the same, unmodified file
+    if (rb->dev != st->st_dev || rb->ino != st->st_ino || rb->size != st->st_size ||
+        rb->mtime.tv_sec != st->st_mtim.tv_sec || rb->mtime.tv_nsec != st->st_mtim.tv_nsec ||
+        cur < rb->base || cur > rb->base + (off_t)rb->len) {
+        rb->dev = st->st_dev;
+        rb->ino = st->st_ino;
+        rb->size = st->st_size;
+        rb->mtime = st->st_mtim;
+        rb->base = cur;
+        rb->len = 0;
+    }
+    size_t pos = (size_t)(cur - rb->base);
+    size_t scanned = pos;
+    size_t end;
+
+    for (;;) {
+        char *hit = rb->len > scanned ? memchr(rb->data + scanned, delim, rb->len - scanned) : NULL;
+        if (hit) {
+            end = (size_t)(hit - rb->data) + 1;
+            break;
+        }
+        scanned = rb->len;
+
+        // Slide the unread tail to the front and refill behind it
+        if (pos > 0) {
+            memmove(rb->data, rb->data + pos, rb->len - pos);
+            rb->base += pos;
+            rb->len -= pos;
+            scanned -= pos;
+            pos = 0;
+        }
+        if (rb->len == rb->cap) {
+            size_t grown_cap = rb->cap ? rb->cap * 2 : READBUF_CHUNK;
+            char *grown = realloc(rb->data, grown_cap);
+            if (grown == NULL) {
+                return -1;
+            }
+            rb->data = grown;
+            rb->cap = grown_cap;
+        }
+        ssize_t n = pread(rb->fd, rb->data + rb->len, rb->cap - rb->len,
+                          rb->base + (off_t)rb->len);
+        if (n < 0) {
+            if (errno == EINTR && !sigint_received) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            end = rb->len;
+            break;
+        }
+        rb->len += (size_t)n;
+    }
+
+    size_t out_len = 0;
+    if (out_append(line, cap, &out_len, rb->data + pos, end - pos) < 0) {
+        return -1;
+    }
+    lseek(rb->fd, rb->base + (off_t)end, SEEK_SET);
+    return (ssize_t)out_len;
+}
+
+/**
+ * Read exactly n bytes that are known to be pending
+ */
+static int read_exact(int fd, char *dst, size_t n) {
+    while (n > 0) {
+        ssize_t r = read(fd, dst, n);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            return -1;
+        }
+        dst += r;
+        n -= (size_t)r;
+    }
+    return 0;
+}
+
+/**
+ * Pipe: peek at pending data with tee(2), then consume one record
+ * Returns -2 if tee is not usable on this descriptor.
+ */
+static ssize_t read_pipe(ReadBuf *rb, int delim, char **line, size_t *cap) {
+    if (rb->peek[0] < 0 && pipe2(rb->peek, O_CLOEXEC) < 0) {
+        return -2;
+    }
+    rb->len = 0;  // data[] is only scratch space here
+    rb->ino = 0;
+    if (rb->cap < READBUF_CHUNK) {
+        char *grown = realloc(rb->data, READBUF_CHUNK);
+        if (grown == NULL) {
+            return -1;
+        }
+        rb->data = grown;
+        rb->cap = READBUF_CHUNK;
+    }
+
+    size_t out_len = 0;
+    for (;;) {
+        if (wait_readable(rb->fd) < 0) {
+            return -1;
+        }
+        ssize_t peeked = tee(rb->fd, rb->peek[1], rb->cap, SPLICE_F_NONBLOCK);
+        if (peeked < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                continue;
+            }
+            return out_len == 0 && errno == EINVAL ? -2 : -1;
+        }
+        if (peeked == 0) {
+            break;  // Writers gone and pipe drained
+        }
+        if (read_exact(rb->peek[0], rb->data, (size_t)peeked) < 0) {
+            return -1;
+        }
+
+        char *hit = memchr(rb->data, delim, (size_t)peeked);
+        size_t take = hit ? (size_t)(hit - rb->data) + 1 : (size_t)peeked;
+        if (out_append(line, cap, &out_len, rb->data, take) < 0 ||
+            read_exact(rb->fd, *line + out_len - take, take) < 0) {
+            return -1;
+        }
+        if (hit) {
+            break;
+        }
+    }
+    if (*line == NULL && out_append(line, cap, &out_len, "", 0) < 0) {
+        return -1;
+    }
+    return (ssize_t)out_len;
+}
+
+/**
+ * Terminals and other descriptors: one read per line on a tty in
+ * canonical mode, one byte at a time otherwise
+ */
+static ssize_t read_unbuffered(int fd, int delim, char **line, size_t *cap) {
+    size_t out_len = 0;
+    int whole_lines = delim == '\n' && isatty(fd);
+    char chunk[4096];
+
+    if (out_append(line, cap, &out_len, "", 0) < 0) {
+        return -1;
+    }
+    for (;;) {
+        if (wait_readable(fd) < 0) {
+            return -1;
+        }
+        ssize_t n = read(fd, chunk, whole_lines ? sizeof(chunk) : 1);
+        if (n < 0) {
+            if (errno == EINTR && !sigint_received) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        if (out_append(line, cap, &out_len, chunk, (size_t)n) < 0) {
+            return -1;
+        }
+        if (chunk[n - 1] == delim) {
+            break;
+        }
+    }
+    return (ssize_t)out_len;
+}
+
+/**
+ * True if fd is the stdin the command reader is consuming via stdio
+ */
+static int is_command_stream(int fd, const struct stat *st) {
+    return fd == STDIN_FILENO && stdin_is_commands &&
+           st->st_dev == stdin_dev && st->st_ino == stdin_ino;
+}
+
+ssize_t readbuf_getdelim(int fd, int delim, char **line, size_t *cap) {
+    struct stat st;
+    ssize_t result;
+
+    if (fstat(fd, &st) < 0) {
+        return -1;
+    }
+
+    if (is_command_stream(fd, &st)) {
+        result = getdelim(line, cap, delim, stdin);
+        if (result < 0) {
+            clearerr(stdin);
+            return ferror(stdin) ? -1 : 0;
+        }
+        return result;
+    }
+
+    pthread_mutex_lock(&readbuf_mutex);
+    if (S_ISREG(st.st_mode)) {
+        result = read_regular(slot_for(fd), &st, delim, line, cap);
+    } else if (S_ISFIFO(st.st_mode)) {
+        result = read_pipe(slot_for(fd), delim, line, cap);
+        if (result == -2) {
+            result = read_unbuffered(fd, delim, line, cap);
+        }
+    } else {
+        result = read_unbuffered(fd, delim, line, cap);
+    }
+    pthread_mutex_unlock(&readbuf_mutex);
+    return result;
+}
+
+int readbuf_slurp(int fd, char **data, size_t *len) {
+    struct stat st;
+    size_t cap = READBUF_CHUNK;
+
+    if (fstat(fd, &st) < 0) {
+        return -1;
+    }
+    if (S_ISREG(st.st_mode) && st.st_size + 1 > (off_t)cap) {
+        cap = (size_t)st.st_size + 1;
+    }
+
+    *len = 0;
+    *data = malloc(cap);
+    if (*data == NULL) {
+        return -1;
+    }
+
+    if (is_command_stream(fd, &st)) {
+        size_t n;
+        while ((n = fread(*data + *len, 1, cap - *len - 1, stdin)) > 0) {
+            *len += n;
+            if (*len + 1 == cap) {
+                char *grown = realloc(*data, cap * 2);
+                if (grown == NULL) {
+                    free(*data);
+                    return -1;
+                }
+                *data = grown;
+                cap *= 2;
+            }
+        }
+        clearerr(stdin);
+        (*data)[*len] = '\0';
+        return 0;
+    }
+
+    // Everything is consumed, so plain large reads are safe here
+    for (;;) {
+        if (*len + 1 == cap) {
+            char *grown = realloc(*data, cap * 2);
+            if (grown == NULL) {
+                free(*data);
+                return -1;
+            }
+            *data = grown;
+            cap *= 2;
+        }
+        ssize_t n = read(fd, *data + *len, cap - *len - 1);
+        if (n < 0) {
+            if (errno == EINTR && !sigint_received) {
+                continue;
+            }
+            free(*data);
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        *len += (size_t)n;
+    }
+    (*data)[*len] = '\0';
+    return 0;
+}
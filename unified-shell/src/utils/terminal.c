@@ -15,6 +15,8 @@
  * - Maintains local line buffer for editing
  * - Callbacks to history and completion modules
  * - Redraws line on every change for visual feedback
+ * - Waits for keys in the shell event loop (eventloop.c), which prints
+ *   job and MCP notices above the line while it is being edited
  * 
  * Terminal modes:
  * - NORMAL: Canonical mode with line buffering (default)
@@ -28,11 +30,14 @@
  * - Enter: Submit command
  * - Ctrl+C: Cancel current input
  * - Ctrl+D: EOF (exit if line empty)
+ * - Ctrl+T: Fuzzy-pick a file and insert its path
+ * - Alt+C: Fuzzy-pick a directory and insert its path
  */
 
 #include <sys/ioctl.h>
 
 #include "terminal.h"
+#include "eventloop.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -50,6 +55,7 @@ static int term_mode = TERM_MODE_NORMAL;
 static char** (*completion_callback)(const char *text, int *count) = NULL;
 static const char* (*history_prev_callback)(void) = NULL;
 static const char* (*history_next_callback)(void) = NULL;
+static char* (*picker_callback)(int want_dirs) = NULL;
 
 // History navigation state
 // Tracks position in history list when using UP/DOWN arrows
@@ -59,6 +65,17 @@ static char saved_line[1024] = {0};      // Saves current input when entering hi
 // Mutex to protect terminal state (thread-safe access)
 static pthread_mutex_t terminal_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+// Keys read from the terminal but not yet handled (a paste or an escape
+// sequence arrives as one read); kept across calls for type-ahead
+static char input_buf[256];
+static size_t input_pos = 0;
+static size_t input_len = 0;
+
+// Line being edited, so notices and resizes can redraw it
+static const char *edit_prompt = NULL;
+static const char *edit_line = NULL;
+static const int *edit_cursor = NULL;
+
 /**
  * terminal_set_completion_callback - Register tab completion handler
  * @callback: Function that generates completions for given text
@@ -90,6 +107,17 @@ void terminal_set_history_callbacks(
     pthread_mutex_unlock(&terminal_mutex);
 }
 
+/**
+ * terminal_set_picker_callback - Register fuzzy picker for Ctrl-T / Alt-C
+ * @picker: Function that lets the user choose a path (want_dirs selects
+ *          directories only) and returns it allocated, or NULL
+ */
+void terminal_set_picker_callback(char* (*picker)(int want_dirs)) {
+    pthread_mutex_lock(&terminal_mutex);
+    picker_callback = picker;
+    pthread_mutex_unlock(&terminal_mutex);
+}
+
 /**
  * terminal_raw_mode - Enable raw terminal mode for character-by-character input
  * 
@@ -325,6 +353,74 @@ static void redraw_line(const char *prompt, const char *line, int cursor_pos) {
 }
 
 
+/**
+ * read_key - Get the next input byte
+ * @c: Output byte
+ * 
+ * Waits in the event loop when no buffered input is left, then takes
+ * whatever the terminal has (one read per burst, not per byte).
+ * 
+ * Returns: 1 for a byte, 0 on EOF/error, -1 if SIGINT interrupted the wait
+ */
+static int read_key(char *c) {
+    if (input_pos == input_len) {
+        if (eventloop_active()) {
+            int ready = eventloop_wait_readable(STDIN_FILENO);
+            if (ready == EVENTLOOP_INTERRUPTED) return -1;
+            if (ready != EVENTLOOP_READY) return 0;
+        }
+        ssize_t n = read(STDIN_FILENO, input_buf, sizeof(input_buf));
+        if (n <= 0) return 0;
+        input_pos = 0;
+        input_len = (size_t)n;
+    }
+    *c = input_buf[input_pos++];
+    return 1;
+}
+
+/**
+ * terminal_print_above - Print text above the line being edited
+ * @text: Complete lines to print
+ * @len: Length of text
+ * 
+ * Clears the prompt and input, prints the text where they were, and
+ * draws them again below it. Outside of terminal_readline the text is
+ * simply written.
+ */
+void terminal_print_above(const char *text, size_t len) {
+    if (edit_line == NULL) {
+        write(STDOUT_FILENO, text, len);
+        return;
+    }
+
+    struct winsize w;
+    ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
+    int width = (w.ws_col > 0) ? w.ws_col : 80;
+
+    // Back to the first row of the prompt, clear it and everything below
+    int row = ((int)strlen(edit_prompt) + *edit_cursor) / width;
+    if (row > 0) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "\x1b[%dA", row);
+        write(STDOUT_FILENO, buf, strlen(buf));
+    }
+    write(STDOUT_FILENO, "\r\x1b[J", 4);
+    write(STDOUT_FILENO, text, len);
+
+    last_prompt_len = 0;
+    last_line_len = 0;
+    redraw_line(edit_prompt, edit_line, *edit_cursor);
+}
+
+/**
+ * terminal_refresh - Redraw the line being edited (after a resize)
+ */
+void terminal_refresh(void) {
+    if (edit_line != NULL) {
+        redraw_line(edit_prompt, edit_line, *edit_cursor);
+    }
+}
+
 /**
  * show_completions - Display list of possible completions
  * @completions: Array of completion strings
@@ -359,6 +455,48 @@ static void show_completions(char **completions, int count) {
     write(STDOUT_FILENO, "\n", 1);
 }
 
+/**
+ * insert_picked_path - Run the picker and insert its result at the cursor
+ * @prompt: Prompt string (for redrawing)
+ * @line: Line buffer of size line_size
+ * @line_len: Current line length (updated)
+ * @cursor_pos: Cursor position (updated)
+ * @want_dirs: Pick directories instead of files
+ *
+ * Paths containing spaces are single-quoted. The picker draws below the
+ * input line, so the line is redrawn afterwards.
+ */
+static void insert_picked_path(const char *prompt, char *line, size_t line_size,
+                               int *line_len, int *cursor_pos, int want_dirs) {
+    if (picker_callback == NULL) {
+        return;
+    }
+
+    write(STDOUT_FILENO, "\n", 1);
+    char *path = picker_callback(want_dirs);
+    write(STDOUT_FILENO, "\x1b[A", 3);
+
+    if (path != NULL) {
+        char quoted[1024];
+        const char *insert = path;
+        if (strchr(path, ' ') != NULL) {
+            snprintf(quoted, sizeof(quoted), "'%s'", path);
+            insert = quoted;
+        }
+
+        int ins_len = strlen(insert);
+        if (*line_len + ins_len < (int)line_size - 1) {
+            memmove(&line[*cursor_pos + ins_len], &line[*cursor_pos], *line_len - *cursor_pos + 1);
+            memcpy(&line[*cursor_pos], insert, ins_len);
+            *cursor_pos += ins_len;
+            *line_len += ins_len;
+        }
+        free(path);
+    }
+
+    redraw_line(prompt, line, *cursor_pos);
+}
+
 /**
  * terminal_readline - Read a line of input with advanced editing features
  * @prompt: Prompt string to display
@@ -379,6 +517,7 @@ static void show_completions(char **completions, int count) {
  * - Arrow keys: Escape sequences [A/B/C/D for up/down/left/right
  * - Ctrl+C (3): Cancel input, return empty string
  * - Ctrl+D (4): EOF on empty line, return NULL
+ * - Ctrl+T (20) / Alt+C (ESC c): Insert a fuzzy-picked file / directory
  * 
  * Returns: Dynamically allocated string with input line (caller must free)
  *          NULL on EOF or error
@@ -424,17 +563,29 @@ char* terminal_readline(const char *prompt) {
         return NULL;
     }
     
+    // Notices queued while the last command ran go above the new prompt
+    eventloop_flush_notices();
+    
     // Print prompt
     write(STDOUT_FILENO, prompt, strlen(prompt));
+    edit_prompt = prompt;
+    edit_line = line;
+    edit_cursor = &cursor_pos;
     
     while (1) {
-        if (read(STDIN_FILENO, &c, 1) != 1) {
+        int got = read_key(&c);
+        if (got == 0) {
+            edit_line = NULL;
             terminal_normal_mode();
             return NULL;
         }
+        if (got < 0) {
+            c = 3;  // SIGINT sent to the shell while it waited: same as Ctrl+C
+        }
         
         // Handle Ctrl+D (EOF)
         if (c == 4 && line_len == 0) {
+            edit_line = NULL;
             terminal_normal_mode();
             return NULL;
         }
@@ -442,6 +593,7 @@ char* terminal_readline(const char *prompt) {
         // Handle Ctrl+C
         if (c == 3) {
             write(STDOUT_FILENO, "^C\n", 3);
+            edit_line = NULL;
             terminal_normal_mode();
             line[0] = '\0';
             return strdup(line);
@@ -450,6 +602,7 @@ char* terminal_readline(const char *prompt) {
         // Handle Enter
         if (c == '\n' || c == '\r') {
             write(STDOUT_FILENO, "\n", 1);
+            edit_line = NULL;
             terminal_normal_mode();
             line[line_len] = '\0';
             return strdup(line);
@@ -498,12 +651,26 @@ char* terminal_readline(const char *prompt) {
             continue;
         }
         
-        // Handle Escape sequences (arrow keys, etc.)
+        // Handle Ctrl+T (fuzzy file picker)
+        if (c == 20) {
+            insert_picked_path(prompt, line, sizeof(line), &line_len, &cursor_pos, 0);
+            continue;
+        }
+        
+        // Handle Escape sequences (arrow keys, Alt+key, etc.)
         if (c == 27) {
             char seq[3];
             
-            if (read(STDIN_FILENO, &seq[0], 1) != 1) continue;
-            if (read(STDIN_FILENO, &seq[1], 1) != 1) continue;
+            if (read_key(&seq[0]) != 1) continue;
+            
+            // Alt+C arrives as ESC followed by 'c'
+            if (seq[0] == 'c') {
+                insert_picked_path(prompt, line, sizeof(line), &line_len, &cursor_pos, 1);
+                continue;
+            }
+            if (seq[0] != '[' && seq[0] != 'O') continue;
+            
+            if (read_key(&seq[1]) != 1) continue;
             
             if (seq[0] == '[') {
                 // Arrow keys
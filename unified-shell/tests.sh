@@ -141,6 +141,88 @@ test_variables() {
     else
         fail_test "multiple variables failed" "Expected 'foo bar', Got: '$result'"
     fi
+    
+    print_test "parameter expansion defaults and length"
+    result=$(run_ushell "set f=archive.tar.gz
+echo \${#f} \${nosuch:-dflt} \${f:+alt}")
+    if echo "$result" | grep -q "14 dflt alt"; then
+        pass_test "\${#v}, \${v:-w} and \${v:+w} work"
+    else
+        fail_test "parameter expansion failed" "Expected '14 dflt alt', Got: '$result'"
+    fi
+    
+    print_test "parameter expansion patterns"
+    result=$(run_ushell "set f=archive.tar.gz
+echo \${f%%.*} \${f##*.} \${f%.gz} \${f//a/A} \${f:0:4} \${f^^}")
+    if echo "$result" | grep -q "archive gz archive.tar Archive.tAr.gz arch ARCHIVE.TAR.GZ"; then
+        pass_test "prefix/suffix removal, substitution, substring and case"
+    else
+        fail_test "pattern expansion failed" "Got: '$result'"
+    fi
+    
+    print_test "parameter expansion error"
+    result=$(run_ushell "echo \${nosuch:?missing value}")
+    if echo "$result" | grep -q "nosuch: missing value"; then
+        pass_test "\${v:?msg} reports unset variable"
+    else
+        fail_test "\${v:?msg} did not report" "Got: '$result'"
+    fi
+    
+    print_test "parameter expansion error aborts"
+    result=$($USHELL -c 'f() { echo ${nosuch:?gone}; echo in_f; }; (echo ${nosuch:?sub}; echo in_sub); echo sub=$?; f; echo after' 2>&1)
+    status=$?
+    if [ $status -ne 0 ] && echo "$result" | grep -q "sub=1" && echo "$result" | grep -q "nosuch: gone" &&
+       ! echo "$result" | grep -q "in_f\|in_sub\|after"; then
+        pass_test "a non-interactive shell exits (status $status), a subshell only ends itself"
+    else
+        fail_test "\${v:?msg} did not abort" "Status $status, Got: '$result'"
+    fi
+    if command -v script >/dev/null 2>&1; then
+        print_test "parameter expansion error at the prompt"
+        result=$( (sleep 0.5; printf 'echo ${nosuch:?gone}; echo same_line\r'; sleep 0.3
+                   printf 'echo next_line\r'; sleep 0.3; printf 'exit\r') |
+                  script -qfec "$USHELL" /dev/null 2>&1 | tr -d '\r')
+        if echo "$result" | grep -q "^next_line" && ! echo "$result" | grep -q "^same_line"; then
+            pass_test "an interactive shell only abandons the command line"
+        else
+            fail_test "interactive \${v:?msg} handling failed" "Got: '$result'"
+        fi
+    fi
+    
+    print_test "command substitution"
+    result=$(run_ushell "echo [\$(echo in)] [\`printf 'ext\\n\\n'\`] [\$(echo \$(echo nested))]")
+    if echo "$result" | grep -q "\[in\] \[ext\] \[nested\]"; then
+        pass_test "\$(...), backticks and nesting work"
+    else
+        fail_test "command substitution failed" "Expected '[in] [ext] [nested]', Got: '$result'"
+    fi
+    
+    print_test "nested backquotes"
+    result=$($USHELL -c 'echo `echo \`echo hi\``; v=val; echo "[`echo \`echo \$v\``]"' 2>&1)
+    if [ "$result" = "$(printf 'hi\n[val]')" ]; then
+        pass_test "\\\` inside backquotes starts an inner substitution"
+    else
+        fail_test "nested backquotes failed" "Expected 'hi' and '[val]', Got: '$result'"
+    fi
+    
+    print_test "assignment takes the status of its command substitution"
+    result=$($USHELL -c 'x=$(exit 3); echo a=$?; y=`sh -c "exit 4"`; echo b=$?; false; z=$?; echo c=$? z=$z; w=$(false)$(true); echo d=$?' 2>&1)
+    if [ "$result" = "$(printf 'a=3\nb=4\nc=0 z=1\nd=0')" ]; then
+        pass_test "x=\$(cmd) sets \$? from the last substitution"
+    else
+        fail_test "assignment status failed" "Got: '$result'"
+    fi
+    
+    print_test "variables beyond the old table size and memstats"
+    result=$($USHELL -c 'i=0; while [ $i -lt 150 ]; do export V$i=$i; i=$((i+1)); done
+echo $V149
+memstats' 2>&1)
+    if echo "$result" | grep -q "^149$" && echo "$result" | grep -qE "^env +[0-9]+ " &&
+       echo "$result" | grep -q "^rss "; then
+        pass_test "150 variables set, memstats reports env and rss"
+    else
+        fail_test "memstats or variable growth failed" "Got: '$result'"
+    fi
 }
 
 # ==================================================
@@ -227,6 +309,130 @@ test_conditionals() {
     else
         fail_test "if-then-else failed" "Expected 'no', Got: '$result'"
     fi
+    
+    print_test "builtin [ file test"
+    touch testfile.txt
+    result=$(run_ushell "if [ -f testfile.txt ]; then echo FOUND_FILE; fi")
+    if echo "$result" | grep -q "FOUND_FILE"; then
+        pass_test "[ -f ] evaluates in-process"
+    else
+        fail_test "[ -f ] failed" "Expected 'FOUND_FILE', Got: '$result'"
+    fi
+    rm -f testfile.txt
+    
+    print_test "test exit status"
+    result=$(printf 'test 3 -lt 2\necho status=$?\n[ abc != abd ]\necho status=$?\n' | $USHELL 2>&1)
+    if echo "$result" | grep -q "status=1" && echo "$result" | grep -q "status=0"; then
+        pass_test "test sets last exit status"
+    else
+        fail_test "test exit status failed" "Got: '$result'"
+    fi
+    
+    print_test "[[ pattern and regex"
+    result=$(run_ushell "if [[ main.c == *.c && v1.20 =~ ^v[0-9]+\.[0-9]+$ ]] then echo MATCHED fi")
+    if echo "$result" | grep -q "MATCHED"; then
+        pass_test "[[ ]] pattern and regex matching"
+    else
+        fail_test "[[ ]] matching failed" "Expected 'MATCHED', Got: '$result'"
+    fi
+    
+    print_test "[[ ]] quoted patterns are literal"
+    result=$($USHELL -c 'P="a?c"; [[ abc == "a*" ]] && echo glob_q; [[ abc == a* ]] && echo glob_u; [[ abc == $P ]] && echo var_u; [[ abc == "$P" ]] && echo var_q; [[ abc =~ "a.c" ]] && echo re_q; [[ abc =~ a.c ]] && echo re_u' 2>&1)
+    if [ "$result" = "$(printf 'glob_u\nvar_u\nre_u')" ]; then
+        pass_test "quoted right-hand sides of == and =~ compare as strings"
+    else
+        fail_test "[[ ]] quoted pattern failed" "Expected only unquoted matches, Got: '$result'"
+    fi
+    
+    print_test "[[ ]] words are not split or dropped"
+    result=$(cd "$TEST_DIR" && $USHELL -c 'x="a b"; [[ $x == "a b" ]] && echo spaced; e=; [[ -n $e ]] || echo empty_n; [[ -z $e ]] && echo empty_z; [[ $unset == "" ]] && echo unset_eq; g="*"; [[ $g == "*" ]] && echo star' 2>&1)
+    if [ "$result" = "$(printf 'spaced\nempty_n\nempty_z\nunset_eq\nstar')" ]; then
+        pass_test "each [[ ]] word is one argument"
+    else
+        fail_test "[[ ]] word expansion failed" "Got: '$result'"
+    fi
+    
+    print_test "for and while loops"
+    result=$(printf 'for w in a b c; do echo item_$w; done\ni=0\nwhile [ $i -lt 3 ]; do i=$((i+1)); done\necho count=$i\n' | $USHELL 2>&1)
+    if echo "$result" | grep -q "item_c" && echo "$result" | grep -q "count=3"; then
+        pass_test "for/while loops execute their bodies"
+    else
+        fail_test "loops failed" "Expected 'item_c' and 'count=3', Got: '$result'"
+    fi
+    
+    print_test "exit status 130 is not an interrupt"
+    result=$($USHELL -c "for i in 1 2 3; do echo iter_\$i; sh -c 'exit 130'; done; until sh -c 'exit 130'; do echo body; break; done; for i in 1 2; do echo sig_\$i; sh -c 'kill -INT \$\$'; done; echo after" 2>&1)
+    if echo "$result" | grep -q "iter_3" && echo "$result" | grep -q "^body" &&
+       echo "$result" | grep -q "sig_2" && echo "$result" | grep -q "after"; then
+        pass_test "a child dying of SIGINT by itself does not stop a loop"
+    else
+        fail_test "loop interrupt check failed" "Got: '$result'"
+    fi
+    
+    print_test "Ctrl+C stops only the loop that was running"
+    $USHELL -c 'for i in 1 2 3; do echo it_$i; sleep 1; done; true && echo and_ran; for j in a b; do echo next_$j; done' > /tmp/ushell_intr.$$ 2>&1 &
+    intr_pid=$!
+    sleep 0.4
+    kill -INT $intr_pid
+    wait $intr_pid
+    result=$(cat /tmp/ushell_intr.$$)
+    rm -f /tmp/ushell_intr.$$
+    if echo "$result" | grep -q "it_1" && ! echo "$result" | grep -q "it_2" &&
+       echo "$result" | grep -q "and_ran" && echo "$result" | grep -q "next_b"; then
+        pass_test "a forwarded SIGINT ends the loop and later commands still run"
+    else
+        fail_test "forwarded SIGINT handling failed" "Got: '$result'"
+    fi
+    
+    print_test "case statement"
+    result=$(run_ushell "case main.c in *.h) echo HEADER;; *.c|*.cc) echo SOURCE;; esac")
+    if echo "$result" | grep -q "SOURCE" && ! echo "$result" | grep -q "HEADER"; then
+        pass_test "case selects matching arm"
+    else
+        fail_test "case failed" "Expected 'SOURCE', Got: '$result'"
+    fi
+    
+    print_test "functions, return, break and continue"
+    result=$(printf 'is_even() { return $(( $1 %% 2 )); }\nfor n in 1 2 3 4 5 6; do if [ $n -eq 5 ]; then break; fi; if ! is_even $n; then continue; fi; echo even_$n; done\n' | $USHELL 2>&1)
+    if echo "$result" | grep -q "even_4" && ! echo "$result" | grep -q "even_3\|even_6"; then
+        pass_test "function status drives break/continue"
+    else
+        fail_test "functions failed" "Expected 'even_2 even_4', Got: '$result'"
+    fi
+    
+    print_test "subshells scope cd, variables and exit"
+    result=$($USHELL -c 'cd /; X=outer; (cd /tmp; X=inner; export SUB_V=1; echo "in $(pwd) $X"); echo "out $(pwd) $X ${SUB_V:-unset}"; (exit 3); echo "status $?"; (cd /usr; ls -d bin)' 2>&1)
+    if echo "$result" | grep -q "in /tmp inner" && echo "$result" | grep -q "out / outer unset" &&
+       echo "$result" | grep -q "status 3" && echo "$result" | grep -qx "bin"; then
+        pass_test "( list ) leaves the shell's state unchanged"
+    else
+        fail_test "subshell failed" "Got: '$result'"
+    fi
+    
+    print_test "command substitution runs in a subshell"
+    result=$($USHELL -c 'cd /; echo "sub $(cd /usr; pwd)"; echo "cwd $(pwd)"; X=1; echo "sub $(X=2; echo $X)"; echo "var $X"' 2>&1)
+    if [ "$result" = "$(printf 'sub /usr\ncwd /\nsub 2\nvar 1')" ]; then
+        pass_test "cd and assignments inside \$(...) do not leak"
+    else
+        fail_test "command substitution scope failed" "Got: '$result'"
+    fi
+    
+    print_test "exit and exec inside command substitution"
+    result=$($USHELL -c 'echo a $(exit 3) b; echo still-here; echo "[$(exec echo replaced)]"; echo end' 2>&1)
+    status=$?
+    if [ "$result" = "$(printf 'a b\nstill-here\n[replaced]\nend')" ] && [ $status -eq 0 ]; then
+        pass_test "exit and exec end only the substitution"
+    else
+        fail_test "exit in command substitution failed" "Status $status, Got: '$result'"
+    fi
+    
+    print_test "exit in command substitution keeps an interactive shell"
+    result=$(printf 'echo $(exit 5)\necho alive_after\n' | $USHELL 2>&1)
+    if echo "$result" | grep -q "alive_after"; then
+        pass_test "interactive session survives \$(exit 5)"
+    else
+        fail_test "interactive shell exited" "Got: '$result'"
+    fi
 }
 
 # ==================================================
@@ -252,6 +458,54 @@ test_pipelines() {
     else
         fail_test "grep pipeline failed" "Expected '2', Got: '$result'"
     fi
+    
+    print_test "compound commands as pipeline stages"
+    result=$($USHELL -c 'for i in 2 1 3; do echo $i; done | sort; for i in a b; do echo $i; done | wc -l; (echo y; echo x) | sort; if true; then echo in_if; fi | tr a-z A-Z; echo out | while read w; do echo while_$w; done' 2>&1)
+    expected=$(printf '1\n2\n3\n2\nx\ny\nIN_IF\nwhile_out')
+    if [ "$(echo "$result" | tr -d ' ')" = "$expected" ]; then
+        pass_test "for, ( ), if and while stages are piped"
+    else
+        fail_test "compound pipeline failed" "Expected '$expected', Got: '$result'"
+    fi
+    
+    print_test "monitored pipeline with enlarged pipes"
+    result=$(run_ushell "USHELL_PIPE_SIZE=1M USHELL_PIPE_MONITOR=1 seq 1 100000 | cat | wc -l" 2>&1)
+    if echo "$result" | grep -q "100000$" &&
+       echo "$result" | grep -q "pipe 1 (seq -> cat): 575.1 KB" &&
+       echo "$result" | grep -q "pipe 2 (cat -> wc)"; then
+        pass_test "USHELL_PIPE_MONITOR relays data and reports throughput"
+    else
+        fail_test "pipe monitor failed" "Got: '$result'"
+    fi
+    
+    print_test "monitored pipeline with default pipe sizes"
+    bigfile=$(mktemp)
+    head -c 1288895 /dev/urandom > "$bigfile"
+    want=$(cksum < "$bigfile")
+    ok=1
+    for run in 1 2 3 4 5 6 7 8; do
+        got=$(USHELL_PIPE_MONITOR=1 $USHELL -c "cat $bigfile | cat | cksum" 2>/dev/null)
+        [ "$got" = "$want" ] || { ok=0; break; }
+    done
+    rm -f "$bigfile"
+    if [ $ok -eq 1 ]; then
+        pass_test "relays deliver every byte when the producer exits first"
+    else
+        fail_test "monitored pipeline lost data" "Expected '$want', Got: '$got' (run $run)"
+    fi
+    
+    print_test "lexer variants split long lines identically"
+    long=$(printf 'w%02d "q %02d" ' $(seq 1 40 | sed 'p'))
+    cmd="echo $long 'a|b' \"[[ x ]]\" | cat"
+    expected=$(USHELL_LEXER=scalar $USHELL -c "$cmd" 2>&1)
+    sse2=$(USHELL_LEXER=sse2 $USHELL -c "$cmd" 2>&1)
+    avx2=$(USHELL_LEXER=avx2 $USHELL -c "$cmd" 2>&1)
+    if [ "$sse2" = "$expected" ] && [ "$avx2" = "$expected" ] &&
+       echo "$expected" | grep -q '^w01 q 01 w02 .* a|b \[\[ x \]\]$'; then
+        pass_test "scalar, SSE2 and AVX2 classifiers agree across blocks"
+    else
+        fail_test "lexer variants differ" "scalar: '$expected' sse2: '$sse2' avx2: '$avx2'"
+    fi
 }
 
 # ==================================================
@@ -292,6 +546,69 @@ test_redirection() {
         fail_test "input redirection failed" "Expected 'inputdata', Got: '$result'"
     fi
     rm input.txt
+    
+    print_test "while read loop with input redirection"
+    printf 'alpha 1\nbeta 2 extra\ngamma 3\n' > records.txt
+    result=$(printf 'while read name rest; do echo rec_$name=$rest; done < records.txt\n{ read first; cat; } < records.txt\necho first=$first\n' | $USHELL 2>&1)
+    if echo "$result" | grep -q "rec_beta=2 extra" && echo "$result" | grep -q "first=alpha 1" &&
+       [ "$(echo "$result" | grep -c 'alpha 1')" = "1" ]; then
+        pass_test "read splits fields and leaves the rest of the input"
+    else
+        fail_test "while read failed" "Expected 'rec_beta=2 extra', Got: '$result'"
+    fi
+    
+    print_test "while read loop on a pipe"
+    result=$($USHELL -c 'printf "alpha 1\nbeta 2 extra\ngamma 3\n" | while read name rest; do echo "rec_$name=$rest"; done' 2>&1)
+    if [ "$result" = "$(printf 'rec_alpha=1\nrec_beta=2 extra\nrec_gamma=3')" ]; then
+        pass_test "printf | while read splits every line"
+    else
+        fail_test "while read on a pipe failed" "Got: '$result'"
+    fi
+    
+    print_test "read leaves the rest of a pipe to the next command"
+    result=$($USHELL -c 'seq 1 20000 | { read a; read b; echo "a=$a b=$b"; cat | wc -l; }; seq 1 20000 | { read a; cat; } | head -1' 2>&1)
+    if [ "$(echo "$result" | tr -d ' ')" = "$(printf 'a=1b=2\n19998\n2')" ]; then
+        pass_test "{ read a; cat; } gives cat exactly the lines read did not take"
+    else
+        fail_test "read on a pipe over-consumed" "Got: '$result'"
+    fi
+    
+    print_test "mapfile into array"
+    result=$(printf 'mapfile -t lines < records.txt\necho n=${#lines[@]} last=${lines[2]}\n' | $USHELL 2>&1)
+    if echo "$result" | grep -q "n=3 last=gamma 3"; then
+        pass_test "mapfile stores one element per line"
+    else
+        fail_test "mapfile failed" "Expected 'n=3 last=gamma 3', Got: '$result'"
+    fi
+    rm -f records.txt
+    
+    print_test "here-documents and here-strings"
+    result=$($USHELL -c "$(printf 'X=world\ncat <<EOF\nhello $X \x27q\x27\nEOF\ncat <<\x27EOF\x27\nraw $X\nEOF\n\tcat <<-END\n\ttabbed\n\tEND\nread a b <<< "one two"; echo "$a/$b"\n')" 2>&1)
+    if echo "$result" | grep -qx "hello world 'q'" && echo "$result" | grep -qx 'raw $X' &&
+       echo "$result" | grep -qx "tabbed" && echo "$result" | grep -qx "one/two"; then
+        pass_test "<<EOF expands, <<'EOF' does not, <<- strips tabs, <<< feeds a word"
+    else
+        fail_test "here-documents failed" "Got: '$result'"
+    fi
+    
+    print_test "large here-document"
+    result=$($USHELL -c "$(echo 'wc -l <<EOF'; seq 1 15000; echo EOF)" 2>&1)
+    if [ "$(echo "$result" | tr -d ' ')" = "15000" ]; then
+        pass_test "body larger than a pipe buffer arrives complete"
+    else
+        fail_test "large here-document failed" "Expected '15000', Got: '$result'"
+    fi
+
+    print_test "process substitution <(cmd) and >(cmd)"
+    printf 'one\ntwo\n' > procsub.txt
+    result=$($USHELL -c 'diff <(echo a) <(echo a) && echo same; cat <(mycat procsub.txt) | wc -l; echo hi > >(cat); while read l; do echo "[$l]"; done < <(printf "x\ny\n")' 2>&1)
+    expected=$(printf 'same\n2\nhi\n[x]\n[y]')
+    if [ "$(echo "$result" | tr -d ' ')" = "$expected" ]; then
+        pass_test "/dev/fd paths feed and read inner commands"
+    else
+        fail_test "process substitution failed" "Expected '$expected', Got: '$result'"
+    fi
+    rm -f procsub.txt
 }
 
 # ==================================================
@@ -417,6 +734,97 @@ test_builtin_tools() {
         fail_test "mystat failed"
     fi
     rm statfile.txt
+    
+    print_test "myfzf filter mode"
+    printf 'src/main.c\nsrc/utils/fuzzy.c\ndocs/README.md\n' > fzfinput.txt
+    result=$(run_ushell "myfzf -f fzc < fzfinput.txt")
+    if [ "$(echo "$result" | grep -c "fuzzy.c")" = "1" ] && ! echo "$result" | grep -q "main.c"; then
+        pass_test "myfzf ranks fuzzy matches"
+    else
+        fail_test "myfzf filter failed" "Got: '$result'"
+    fi
+    rm fzfinput.txt
+    
+    print_test "mywatch --once reports events and runs the command"
+    watch_dir=$(mktemp -d)
+    (sleep 0.5; touch "$watch_dir/seen.txt") &
+    events=$(timeout 10 $USHELL -c "mywatch --once $watch_dir" 2>&1)
+    wait
+    (sleep 0.5; touch "$watch_dir/again.txt") &
+    result=$(timeout 10 $USHELL -c "mywatch --once $watch_dir -- sh -c 'echo ran; echo \"two words\"'" 2>&1)
+    wait
+    if echo "$events" | grep -q "^CREATE  *$watch_dir/seen.txt" &&
+       [ "$result" = "$(printf 'ran\ntwo words')" ]; then
+        pass_test "event printed; words after -- kept their quoting"
+    else
+        fail_test "mywatch --once failed" "Events: '$events', Command: '$result'"
+    fi
+    rm -rf "$watch_dir"
+    
+    print_test "source defines functions and variables"
+    printf 'lib_greet() { echo hi_$1; }\nLIB_LOADED=yes_$1\nreturn 4\necho not_reached\n' > srclib.sh
+    result=$(printf 'source ./srclib.sh arg\necho status=$?\n. ./srclib.sh\nlib_greet there\necho $LIB_LOADED\n' | $USHELL 2>&1)
+    if echo "$result" | grep -q "hi_there" && echo "$result" | grep -q "status=4" &&
+       echo "$result" | grep -q "yes_" && ! echo "$result" | grep -q "not_reached"; then
+        pass_test "source runs the file in the current shell"
+    else
+        fail_test "source failed" "Expected 'hi_there' and 'status=4', Got: '$result'"
+    fi
+    rm -f srclib.sh
+    
+    print_test "source reads pipes and process substitutions"
+    result=$($USHELL -c 'source /dev/stdin <<< "SRC_V=7; echo from_stdin"; echo v=$SRC_V; source <(/bin/echo echo from_procsub); echo status=$?' 2>&1)
+    if [ "$result" = "$(printf 'from_stdin\nv=7\nfrom_procsub\nstatus=0')" ]; then
+        pass_test "non-regular files are read to EOF instead of by size"
+    else
+        fail_test "source from a pipe failed" "Got: '$result'"
+    fi
+    
+    print_test "enable -f loads a builtin from a shared object"
+    if gcc -shared -fPIC -I"$SCRIPT_DIR/include" -o basename.so \
+           "$SCRIPT_DIR/examples/plugins/basename.c" 2>/dev/null; then
+        result=$($USHELL -c 'enable -f ./basename.so basename; basename /a/b/c.txt .txt; x=$(basename /q/r/); echo $x; enable; enable -d basename; enable' 2>&1)
+        if echo "$result" | grep -q "^c$" && echo "$result" | grep -q "^r$" &&
+           echo "$result" | grep -q "^basename  *2 " && echo "$result" | grep -q "No loaded builtins"; then
+            pass_test "Loaded builtin ran in-process, was timed and unloaded"
+        else
+            fail_test "enable -f failed" "Got: '$result'"
+        fi
+        rm -f basename.so
+    fi
+
+    print_test "command registry catalog"
+    result=$($USHELL --commands-json | python3 -c '
+import json, sys
+names = [c["name"] for c in json.load(sys.stdin)["commands"]]
+print(" ".join(names))' 2>&1)
+    if echo " $result " | grep -q " enable " && echo " $result " | grep -q " mywatch " &&
+       echo " $result " | grep -q " apt verify " && $USHELL -c 'help' | grep -q "^  exec "; then
+        pass_test "Catalog and help list are generated from commands.def"
+    else
+        fail_test "command registry catalog failed" "Got: '$result'"
+    fi
+
+    print_test "reentrant tools"
+    mkdir -p /tmp/ushell_reent/a/b && touch /tmp/ushell_reent/a/b/hit.txt /tmp/ushell_reent/hit.log
+    result=$(echo "from stdin" | $USHELL -c 'cd /tmp/ushell_reent; myfd hit; myfd hit; mycat -' 2>&1)
+    if [ "$(echo "$result" | grep -c hit)" -eq 4 ] && echo "$result" | grep -q "from stdin"; then
+        pass_test "myfd repeats cleanly and mycat - reads stdin"
+    else
+        fail_test "reentrant tools failed" "Got: '$result'"
+    fi
+    rm -rf /tmp/ushell_reent
+
+    print_test "mytee fan-out"
+    seq 1 50000 > /tmp/ushell_tee.in
+    result=$($USHELL -c 'cd /tmp; mycat ushell_tee.in | mytee ushell_tee.1 >(wc -l > ushell_tee.2) | wc -l; echo x | mytee -a ushell_tee.1 > /dev/null; mycat ushell_tee.in | mytee >(head -1 > /dev/null) | wc -l' 2>&1)
+    if [ "$(echo "$result" | tr -d ' ')" = "$(printf '50000\n50000')" ] &&
+       [ "$(wc -l < /tmp/ushell_tee.1)" -eq 50001 ] && [ "$(tr -d ' ' < /tmp/ushell_tee.2)" = "50000" ]; then
+        pass_test "mytee copies to pipes and files, -a appends, closed readers are dropped"
+    else
+        fail_test "mytee fan-out failed" "Got: '$result'"
+    fi
+    rm -f /tmp/ushell_tee.in /tmp/ushell_tee.1 /tmp/ushell_tee.2
 }
 
 # ==================================================
@@ -443,6 +851,132 @@ test_job_control() {
     TOTAL_TESTS=$((TOTAL_TESTS + 1))
     pass_test "bg command available"
     
+    if command -v script >/dev/null 2>&1; then
+        print_test "finished background job is announced at the prompt"
+        # Keys arrive one line at a time, while the prompt waits for input
+        result=$( (sleep 0.5; printf 'sleep 0.2 &\r'; sleep 1; printf 'exit\r') |
+                  script -qfec "$USHELL" /dev/null 2>&1 | tr -d '\r')
+        if echo "$result" | grep -q "\[1\]+  Done *sleep 0.2 &"; then
+            pass_test "Done notice printed while the prompt was showing"
+        else
+            fail_test "No job notice" "Got: '$result'"
+        fi
+        
+        print_test "thread job pauses with Ctrl-Z and cancels with Ctrl-C"
+        mkdir -p /tmp/ushell_tjob
+        result=$( (sleep 0.5; printf 'mywatch /tmp/ushell_tjob &\r'; sleep 0.5; printf 'fg\r'
+                   sleep 0.5; printf '\032'; sleep 0.3; printf 'jobs\r'; sleep 0.3
+                   printf 'fg %%1\r'; sleep 0.5; printf '\003'; sleep 0.3
+                   printf 'echo after=$?\r'; sleep 0.3; printf 'exit\r') |
+                  script -qfec "$USHELL" /dev/null 2>&1 | tr -d '\r')
+        rm -rf /tmp/ushell_tjob
+        if echo "$result" | grep -q "^\[1\] thread" &&
+           echo "$result" | grep -q "\[1\]+  Stopped *mywatch" && echo "$result" | grep -q "after=130"; then
+            pass_test "fg'd thread job stopped, resumed and cancelled"
+        else
+            fail_test "thread job control failed" "Got: '$result'"
+        fi
+        
+        print_test "killed jobs are reported by signal"
+        mkdir -p /tmp/ushell_tjob
+        result=$( (sleep 0.5; printf 'sleep 10 &\r'; sleep 0.3; printf 'kill %%1\r'; sleep 0.5
+                   printf 'mywatch /tmp/ushell_tjob &\r'; sleep 0.3; printf 'kill %%+\r'; sleep 0.5
+                   printf 'mywatch /tmp/ushell_tjob &\r'; sleep 0.3; printf 'kill -KILL %%+\r'; sleep 0.3
+                   printf 'jobs\r'; sleep 0.3; printf 'exit\r') |
+                  script -qfec "$USHELL" /dev/null 2>&1 | tr -d '\r')
+        rm -rf /tmp/ushell_tjob
+        if echo "$result" | grep -q "\[1\]+  Terminated *sleep 10" &&
+           echo "$result" | grep -q "\]+  Terminated *mywatch" &&
+           echo "$result" | grep -q "\]+  Killed *mywatch"; then
+            pass_test "kill %N shows Terminated for process and thread jobs"
+        else
+            fail_test "killed job report failed" "Got: '$result'"
+        fi
+    fi
+    
+    print_test "background tool runs as a waitable thread job"
+    mkdir -p /tmp/ushell_tjob/a && touch /tmp/ushell_tjob/a/hit.txt
+    result=$(cd /tmp/ushell_tjob && $USHELL -c 'myfd hit > out.txt &
+cd /
+jobs -l
+wait %1
+echo status=$?
+mycat /tmp/ushell_tjob/out.txt' 2>&1)
+    rm -rf /tmp/ushell_tjob
+    if echo "$result" | grep -q "^\[1\] thread" && echo "$result" | grep -q "thread .*myfd hit &" &&
+       echo "$result" | grep -q "status=0" && echo "$result" | grep -q "a/hit.txt"; then
+        pass_test "myfd & ran on a worker in its starting directory"
+    else
+        fail_test "thread job failed" "Got: '$result'"
+    fi
+    
+    print_test "coproc talks to a long-lived filter"
+    result=$($USHELL -c 'coproc UP sed -u s/o/0/
+echo foo >&${UP[1]}
+read -u ${UP[0]} a
+echo bob >&${UP[1]}
+read b <&${UP[0]}
+echo "$a $b"
+jobs
+exec ${UP[1]}>&-
+wait
+echo status=$?' 2>&1)
+    if echo "$result" | grep -q "^f0o b0b$" && echo "$result" | grep -q "Running *coproc UP sed" &&
+       echo "$result" | grep -q "status=0"; then
+        pass_test "coproc answered twice and exited on end of input"
+    else
+        fail_test "coproc failed" "Got: '$result'"
+    fi
+    
+    print_test "jobctl sets scheduling of jobs and pool workers"
+    result=$($USHELL -c 'sleep 3 | sleep 3 &
+jobctl %1 --cpus 0 --sched batch --nice 5
+jobctl %1
+USHELL_BG_POLICY="--sched idle --ionice idle"
+sleep 3 &
+jobctl %2
+jobctl --pool --nice 2
+jobctl --pool
+jobctl %1 --sched fifo
+echo rc=$?
+kill %1 %2' 2>&1)
+    if echo "$result" | grep -q "^\[1\]  cpus 0  sched batch  nice 5" &&
+       echo "$result" | grep -q "^\[2\] .*sched idle .*ionice idle" &&
+       echo "$result" | grep -q "^worker [0-9]* .*nice 2" && echo "$result" | grep -q "rc=2"; then
+        pass_test "jobctl, USHELL_BG_POLICY and jobctl --pool applied"
+    else
+        fail_test "jobctl failed" "Got: '$result'"
+    fi
+    
+    print_test "worker pool grows for background tools and shrinks when idle"
+    mkdir -p /tmp/ushell_pool
+    result=$($USHELL -c 'for i in 1 2 3 4 5 6; do mywatch -1 /tmp/ushell_pool >/dev/null & done
+sleep 0.3
+pool
+mytouch /tmp/ushell_pool/go
+wait
+pool --idle 1 --min 2
+sleep 1.6
+pool' 2>&1)
+    rm -rf /tmp/ushell_pool
+    if echo "$result" | grep -q "^workers 6 (min 4, max 16), busy 6" &&
+       echo "$result" | grep -q "^workers 2 (min 2, max 16), busy 0" &&
+       echo "$result" | grep -q "grown 2, shrunk 4" &&
+       echo "$result" | grep -qE "^ +[0-9]+ +1 .* idle$"; then
+        pass_test "pool grew to 6 workers, then retired idle ones"
+    else
+        fail_test "elastic pool failed" "Got: '$result'"
+    fi
+    
+    print_test "raising the pool minimum counts as growth"
+    result=$($USHELL -c 'pool --min 6; pool' 2>&1)
+    if echo "$result" | grep -q "^workers 6 (min 6, max 16)" && echo "$result" | grep -q "grown 2, shrunk 0" &&
+       [ "$(echo "$result" | grep -cE '^ +[1-9][0-9]* +0 ')" -eq 6 ]; then
+        pass_test "pool --min adds 2 workers, each listed with its TID"
+    else
+        fail_test "pool --min growth failed" "Got: '$result'"
+    fi
+    
     echo "  Note: Full job control testing requires interactive mode"
 }
 
@@ -489,6 +1023,47 @@ test_integration() {
         fail_test "glob myls integration failed" "Expected 3 files, Got: $count"
     fi
     rm glob1.tmp glob2.tmp glob3.tmp
+    
+    print_test "--profile reports per-line statistics"
+    result=$(printf 'work() { /bin/true; }\nfor i in 1 2 3; do\n  work\ndone\n' | $USHELL --profile --profile-folded prof.folded 2>&1 >/dev/null)
+    if echo "$result" | grep -q "ushell profile:.*3 forks, 3 execs" &&
+       echo "$result" | grep -q "stdin:3 *work" && grep -q "^stdin:3;work();stdin:1 " prof.folded; then
+        pass_test "--profile table and folded stacks"
+    else
+        fail_test "--profile failed" "Got: '$result'"
+    fi
+    rm -f prof.folded
+    
+    print_test "-c execs its last command in place of the shell"
+    $USHELL -c 'echo first; cat /proc/self/stat' > tail.tmp &
+    shell_pid=$!
+    wait $shell_pid
+    if [ "$(tail -1 tail.tmp | cut -d' ' -f1)" = "$shell_pid" ] && [ "$(head -1 tail.tmp)" = "first" ]; then
+        pass_test "Final command ran as the shell's own process"
+    else
+        fail_test "Tail exec failed" "Shell $shell_pid, got: '$(cat tail.tmp)'"
+    fi
+    rm -f tail.tmp
+    
+    print_test "exec redirections persist for the session"
+    result=$($USHELL -c 'exec >exec.tmp; echo one; echo two 2>/dev/null; cat exec.tmp >&2' 2>&1)
+    if [ "$result" = "$(printf 'one\ntwo')" ]; then
+        pass_test "exec >FILE redirected later commands"
+    else
+        fail_test "exec redirection failed" "Got: '$result'"
+    fi
+    rm -f exec.tmp
+    
+    print_test "exec opens numbered descriptors"
+    printf 'first\nsecond\n' > exec.tmp
+    # fd 3 starts closed, so open() hands back 3 itself
+    result=$($USHELL -c 'exec 3<exec.tmp; read -u 3 a; read -u 3 b; echo "$a/$b"; exec 3>exec.tmp; echo out >&3; cat exec.tmp' 3<&- 2>&1)
+    if [ "$result" = "$(printf 'first/second\nout')" ]; then
+        pass_test "exec 3<FILE and exec 3>FILE keep fd 3 open"
+    else
+        fail_test "exec numbered descriptor failed" "Got: '$result'"
+    fi
+    rm -f exec.tmp
 }
 
 # ==================================================
@@ -39,7 +39,7 @@ run_test() {
 
 # Test 1-17: --help flag for all built-ins
 echo "--- Built-in Commands --help Tests ---"
-BUILTINS="cd pwd echo export set unset env help version history jobs fg bg commands exit"
+BUILTINS="cd pwd echo export set unset env help version history jobs fg bg kill wait coproc jobctl pool memstats commands myfzf test true break continue return read mapfile source exec enable exit"
 
 for cmd in $BUILTINS; do
     run_test "$cmd --help shows help" \